@@ -391,10 +391,15 @@ public:
 
   // Type system.
   void EmitDxilTypeSystem(DxilTypeSystem &TypeSystem, std::vector<llvm::GlobalVariable *> &LLVMUsed);
-  void LoadDxilTypeSystemNode(const llvm::MDTuple &MDT, DxilTypeSystem &TypeSystem);
-  void LoadDxilTypeSystem(DxilTypeSystem &TypeSystem);
+  // With bLazyStructs, struct annotations are only checked for shape and
+  // decoded when the type system first needs them; this helper must outlive
+  // the type system then.
+  void LoadDxilTypeSystemNode(const llvm::MDTuple &MDT, DxilTypeSystem &TypeSystem,
+                              bool bLazyStructs = false);
+  void LoadDxilTypeSystem(DxilTypeSystem &TypeSystem, bool bLazyStructs = false);
   llvm::Metadata *EmitDxilStructAnnotation(const DxilStructAnnotation &SA);
   void LoadDxilStructAnnotation(const llvm::MDOperand &MDO, DxilStructAnnotation &SA);
+  void LoadDxilStructAnnotation(const llvm::MDTuple &MDT, DxilStructAnnotation &SA);
   llvm::Metadata *EmitDxilFieldAnnotation(const DxilFieldAnnotation &FA);
   void LoadDxilFieldAnnotation(const llvm::MDOperand &MDO, DxilFieldAnnotation &FA);
   llvm::Metadata *EmitDxilFunctionAnnotation(const DxilFunctionAnnotation &FA);
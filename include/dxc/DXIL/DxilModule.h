@@ -83,8 +83,15 @@ public:
 
   // Flags.
   unsigned GetGlobalFlags() const;
+  // Recomputes function summaries and module flags from the current IR.
   void CollectShaderFlagsForModule();
 
+  // Per-function summaries, collected on first use and shared by shader
+  // flags, RDAT and validation. Passes that change function bodies after
+  // flags are collected must reset them.
+  const DxilFunctionSummary &GetFunctionSummary(const llvm::Function *F) const;
+  void ResetFunctionSummaries();
+
   // Resources.
   unsigned AddCBuffer(std::unique_ptr<DxilCBuffer> pCB);
   DxilCBuffer &GetCBuffer(unsigned idx);
@@ -180,10 +187,27 @@ public:
   /// Note: this method not update Metadata for ViewIdState.
   void ReEmitDxilResources();
   /// Deserialize DXIL metadata form into in-memory form.
+  /// Categories in LazyMetadata are only deserialized on first access.
   void LoadDxilMetadata();
   /// Return true if non-fatal metadata error was detected.
+  /// Deserializes any pending metadata first.
   bool HasMetadataErrors();
 
+  /// Metadata categories that LoadDxilMetadata deserializes on first access.
+  enum class LazyMetadata : unsigned {
+    TypeSystem    = 1 << 0,
+    RootSignature = 1 << 1,
+    ViewIdState   = 1 << 2,
+    Subobjects    = 1 << 3,
+  };
+  /// Return true if the category was loaded but not accessed yet.
+  bool IsMetadataPending(LazyMetadata Kind) const;
+  /// Return true if the category was requested, through its accessor or
+  /// MaterializeDxilMetadata, since the metadata was loaded.
+  bool IsMetadataAccessed(LazyMetadata Kind) const;
+  /// Deserialize every category not accessed yet.
+  void MaterializeDxilMetadata() const;
+
   void EmitDxilCounters();
   void LoadDxilCounters(DxilCounters &counters) const;
 
@@ -306,7 +330,7 @@ public:
 
 private:
   // Signatures.
-  std::vector<uint8_t> m_SerializedRootSignature;
+  mutable std::vector<uint8_t> m_SerializedRootSignature; // Lazy, see m_PendingMetadata.
 
   // Shader resources.
   std::vector<std::unique_ptr<DxilResource> > m_SRVs;
@@ -351,8 +375,20 @@ private:
   // Keeps track of patch constant functions used by hull shaders
   std::unordered_set<const llvm::Function *>  m_PatchConstantFunctions;
 
+  // Cached function summaries, see GetFunctionSummary.
+  mutable std::unordered_map<const llvm::Function *, DxilFunctionSummary>
+      m_FunctionSummaries;
+
   // Serialized ViewId state.
-  std::vector<unsigned> m_SerializedState;
+  mutable std::vector<unsigned> m_SerializedState; // Lazy, see m_PendingMetadata.
+
+  // LazyMetadata categories still to be deserialized, and categories
+  // requested since the last load. Deserializing only fills in what the
+  // metadata already holds, so the const accessors do it on first use; this
+  // state and the members it fills are mutable for that reason.
+  mutable unsigned m_PendingMetadata;
+  mutable unsigned m_AccessedMetadata;
+  void MaterializeMetadata(LazyMetadata Kind) const;
 
   // DXIL metadata serialization/deserialization.
   llvm::MDTuple *EmitDxilResources();
@@ -371,11 +407,11 @@ private:
   uint32_t m_IntermediateFlags;
   uint32_t m_AutoBindingSpace;
 
-  std::unique_ptr<DxilSubobjects> m_pSubobjects;
+  mutable std::unique_ptr<DxilSubobjects> m_pSubobjects; // Lazy, see m_PendingMetadata.
 
   // m_bMetadataErrors is true if non-fatal metadata errors were encountered.
   // Validator will fail in this case, but should not block module load.
-  bool m_bMetadataErrors;
+  mutable bool m_bMetadataErrors;
 };
 
 } // namespace hlsl
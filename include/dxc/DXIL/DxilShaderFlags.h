@@ -11,6 +11,9 @@
 
 #pragma once
 
+#include "dxc/DXIL/DxilConstants.h"
+#include <bitset>
+
 namespace hlsl {
   class DxilModule;
 }
@@ -20,12 +23,36 @@ namespace llvm {
 }
 
 namespace hlsl {
+  // Facts gathered in a single walk over a function body. Module level state
+  // (options, signatures, subobjects and validator version) is applied when
+  // flags are computed, so a summary only goes stale when the body changes.
+  struct DxilFunctionSummary {
+    DxilFunctionSummary();
+
+    static DxilFunctionSummary Collect(const llvm::Function *F, const hlsl::DxilModule *M);
+
+    bool UsesOp(DXIL::OpCode op) const { return UsedOps.test((unsigned)op); }
+    bool UsesDerivatives() const;
+
+    std::bitset<(unsigned)DXIL::OpCode::NumOpCodes> UsedOps;
+    unsigned HasDouble : 1;
+    unsigned HasDoubleExtension : 1; // ddiv dfma drcp d2i d2u i2d u2d
+    unsigned Has64Int : 1;
+    unsigned Has16 : 1;
+    unsigned HasWaveOps : 1;
+    unsigned HasUAVLoads : 1;
+    unsigned HasMulticomponentUAVLoads : 1; // typed, not single component
+  };
+
   // Shader properties.
   class ShaderFlags {
   public:
     ShaderFlags();
 
+    // Uses the summary cached on M for F.
     static ShaderFlags CollectShaderFlags(const llvm::Function *F, const hlsl::DxilModule *M);
+    static ShaderFlags CollectShaderFlags(const llvm::Function *F, const hlsl::DxilModule *M,
+                                          const DxilFunctionSummary &Summary);
     unsigned GetGlobalFlags() const;
     uint64_t GetFeatureInfo() const;
     static uint64_t GetShaderFlagsRawForCollection(); // some flags are collected (eg use 64-bit), some provided (eg allow refactoring)
@@ -40,6 +40,11 @@ public:
   const DxilSignatureElement &GetElement(unsigned idx) const;
   const std::vector<std::unique_ptr<DxilSignatureElement> > &GetElements() const;
 
+  // Removes the elements flagged in Remove and renumbers the rest in order.
+  // Returns the new ID of each old element, or
+  // DxilSignatureElement::kUndefinedID if it was removed.
+  std::vector<unsigned> RemoveElements(const std::vector<bool> &Remove);
+
   // Returns true if all signature elements that should be allocated are allocated
   bool IsFullyAllocated() const;
 
@@ -12,6 +12,8 @@
 #pragma once
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/TrackingMDRef.h"
 #include "dxc/DXIL/DxilCompType.h"
 #include "dxc/DXIL/DxilInterpolationMode.h"
 
@@ -24,6 +26,7 @@ class LLVMContext;
 class Module;
 class Function;
 class MDNode;
+class MDTuple;
 class Type;
 class StructType;
 class StringRef;
@@ -32,6 +35,8 @@ class StringRef;
 
 namespace hlsl {
 
+class DxilMDHelper;
+
 enum class MatrixOrientation { Undefined = 0, RowMajor, ColumnMajor, LastEntry };
 
 struct DxilMatrixAnnotation {
@@ -203,6 +208,20 @@ public:
 
   StructAnnotationMap &GetStructAnnotationMap();
 
+  // Struct annotations loaded from metadata can be decoded on first use
+  // instead of up front.  The metadata tuple keeps its place in the map, so
+  // the annotations are emitted in the same order either way.
+  void AddLazyStructAnnotation(const llvm::StructType *pStructType,
+                               llvm::MDTuple *pMD,
+                               DxilMDHelper *pMDHelper);
+  // Decodes all struct annotations that have not been used yet.
+  void MaterializeStructAnnotations();
+  // Whether the annotation of pStructType is still waiting to be decoded.
+  bool IsStructAnnotationPending(const llvm::StructType *pStructType) const;
+  // Whether decoding a lazily loaded struct annotation failed; the
+  // annotation is dropped in that case.
+  bool HasStructAnnotationLoadErrors() const;
+
   DxilFunctionAnnotation *AddFunctionAnnotation(const llvm::Function *pFunction);
   DxilFunctionAnnotation *GetFunctionAnnotation(const llvm::Function *pFunction);
   const DxilFunctionAnnotation *GetFunctionAnnotation(const llvm::Function *pFunction) const;
@@ -226,12 +245,22 @@ public:
 
 private:
   llvm::Module *m_pModule;
-  StructAnnotationMap m_StructAnnotations;
+  // Decoding a pending struct annotation fills in its entry without
+  // changing what the type system describes, so the const accessors may
+  // do it too.
+  mutable StructAnnotationMap m_StructAnnotations;
   FunctionAnnotationMap m_FunctionAnnotations;
+  // Metadata of struct annotations not decoded yet; their entries in
+  // m_StructAnnotations are null until then.  The references follow the
+  // tuples if passes replace them before they are decoded.
+  mutable llvm::DenseMap<const llvm::StructType *, llvm::TrackingMDRef> m_PendingStructAnnotations;
+  DxilMDHelper *m_pPendingMDHelper;
+  mutable bool m_bStructAnnotationLoadErrors;
 
   DXIL::LowPrecisionMode m_LowPrecisionMode;
 
   llvm::StructType *GetNormFloatType(CompType CT, unsigned NumComps);
+  DxilStructAnnotation *MaterializeStructAnnotation(StructAnnotationMap::iterator it) const;
 };
 
 DXIL::SigPointKind SigPointFromInputQual(DxilParamInputQual Q, DXIL::ShaderKind SK, bool isPC);
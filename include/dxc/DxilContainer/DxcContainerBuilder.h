@@ -23,22 +23,25 @@ namespace hlsl {
   class AbstractMemoryStream;
 }
 
-class DxcContainerBuilder : public IDxcContainerBuilder {
+class DxcContainerBuilder : public IDxcContainerBuilder2 {
 public:
   HRESULT STDMETHODCALLTYPE Load(_In_ IDxcBlob *pDxilContainerHeader) override; // Loads DxilContainer to the builder
   HRESULT STDMETHODCALLTYPE AddPart(_In_ UINT32 fourCC, _In_ IDxcBlob *pSource) override; // Add the given part with fourCC
   HRESULT STDMETHODCALLTYPE RemovePart(_In_ UINT32 fourCC) override;                // Remove the part with fourCC
   HRESULT STDMETHODCALLTYPE SerializeContainer(_Out_ IDxcOperationResult **ppResult) override; // Builds a container of the given container builder state
+  HRESULT STDMETHODCALLTYPE SetPartCompression(_In_ UINT32 MinPartSize) override; // Compress parts of at least MinPartSize bytes on serialization
 
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxcContainerBuilder)
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcContainerBuilder>(this, riid, ppvObject);
+    return DoBasicQueryInterface<IDxcContainerBuilder, IDxcContainerBuilder2>(this, riid, ppvObject);
   }
 
   void Init(const char *warning = nullptr) {
     m_warning = warning;
     m_RequireValidation = false;
+    m_Modified = false;
+    m_MinCompressedPartSize = 0;
   }
 
 protected:
@@ -57,9 +60,12 @@ private:
   CComPtr<IDxcBlob> m_pContainer; 
   const char *m_warning;
   bool m_RequireValidation;
+  bool m_Modified;                  // Parts were added or removed after Load.
+  UINT32 m_MinCompressedPartSize;   // Zero if compression is disabled.
 
   UINT32 ComputeContainerSize();
   HRESULT UpdateContainerHeader(AbstractMemoryStream *pStream, uint32_t containerSize);
   HRESULT UpdateOffsetTable(AbstractMemoryStream *pStream);
   HRESULT UpdateParts(AbstractMemoryStream *pStream);
+  HRESULT CompressContainer(IDxcBlob *pContainer, IDxcBlob **ppResult);
 };
\ No newline at end of file
@@ -16,6 +16,7 @@
 
 #include <stdint.h>
 #include <iterator>
+#include <vector>
 #include "dxc/DXIL/DxilConstants.h"
 #include "dxc/Support/WinAdapter.h"
 
@@ -95,10 +96,38 @@ enum DxilFourCC {
   DFCC_PipelineStateValidation  = DXIL_FOURCC('P', 'S', 'V', '0'),
   DFCC_RuntimeData              = DXIL_FOURCC('R', 'D', 'A', 'T'),
   DFCC_ShaderHash               = DXIL_FOURCC('H', 'A', 'S', 'H'),
+  DFCC_CompressedPart           = DXIL_FOURCC('Z', 'P', 'R', 'T'),
+  DFCC_FunctionIndex            = DXIL_FOURCC('F', 'I', 'D', 'X'),
 };
 
 #undef DXIL_FOURCC
 
+enum class DxilCompressionCodec : uint32_t {
+  Zlib = 1,
+};
+
+/// Payload of a DFCC_CompressedPart. The part replaces the original part in
+/// place; the compressed bytes follow this header.
+struct DxilCompressedPartHeader {
+  uint32_t PartFourCC;       // Four char code of the original part.
+  uint32_t UncompressedSize; // Byte count of the original PartData.
+  uint32_t CompressedSize;   // Byte count of the compressed data.
+  uint32_t Codec;            // DxilCompressionCodec.
+  // Structure is followed by uint8_t CompressedData[CompressedSize], padded
+  // to a multiple of four bytes.
+};
+
+/// Payload of a DFCC_FunctionIndex part. Records where each function body
+/// starts in the bitcode of the DXIL part, so that a lazy loader can seek to
+/// the bodies it needs instead of scanning for them.
+struct DxilFunctionIndexHeader {
+  uint32_t BitcodeSize;   // Byte size of the bitcode the offsets refer to.
+  uint32_t FunctionCount; // Number of function bodies in the bitcode.
+  uint8_t BitcodeDigest[16]; // MD5 of that bitcode; any other is ignored.
+  // Structure is followed by uint64_t BodyBitOffsets[FunctionCount], in the
+  // order the bodies appear in the bitcode.
+};
+
 struct DxilShaderFeatureInfo {
   uint64_t FeatureFlags;
 };
@@ -265,6 +294,17 @@ DxilContainerHeader *IsDxilContainerLike(void *ptr, size_t length);
 /// Checks whether the DXIL container is valid and in-bounds.
 bool IsValidDxilContainer(const DxilContainerHeader *pHeader, size_t length);
 
+/// Checks whether any part of a valid container is a DFCC_CompressedPart.
+/// Part accessors see compressed parts under that FourCC only, so callers
+/// should expand such containers with DecompressDxilContainer first.
+bool IsCompressedDxilContainer(const DxilContainerHeader *pHeader);
+
+/// Expands every DFCC_CompressedPart of a valid container into Result,
+/// reproducing the container given to CompressDxilContainer byte for byte.
+/// Returns false if a part is corrupt or its codec is not available.
+bool DecompressDxilContainer(const DxilContainerHeader *pHeader,
+                             std::vector<char> &Result);
+
 /// Use this type as a unary predicate functor.
 struct DxilPartIsType {
   uint32_t IsFourCC;
@@ -413,6 +453,8 @@ enum class SerializeDxilFlags : uint32_t {
   StripReflectionFromDxilPart = 1 << 3, // Strip Reflection info from DXIL part.
   IncludeReflectionPart       = 1 << 4, // Include reflection in STAT part.
   StripRootSignature          = 1 << 5, // Strip Root Signature from main shader container.
+  IncludeFunctionIndexPart    = 1 << 6, // Include the function index part in library containers.
+  ParallelBitcode             = 1 << 7, // Encode function bodies on multiple threads when re-serializing.
 };
 inline SerializeDxilFlags& operator |=(SerializeDxilFlags& l, const SerializeDxilFlags& r) {
   l = static_cast<SerializeDxilFlags>(static_cast<int>(l) | static_cast<int>(r));
@@ -54,6 +54,13 @@ void SerializeDxilContainerForModule(hlsl::DxilModule *pModule,
                                      DxilShaderHash *pShaderHashOut = nullptr,
                                      AbstractMemoryStream *pReflectionStreamOut = nullptr,
                                      AbstractMemoryStream *pRootSigStreamOut = nullptr);
+/// Writes to Result a copy of the container where every part of at least
+/// MinPartSize bytes that gets smaller is replaced by a DFCC_CompressedPart.
+/// Returns false, leaving Result empty, if no part was compressed, the
+/// codec is not available, or the parts are not laid out contiguously.
+bool CompressDxilContainer(const DxilContainerHeader *pHeader,
+                           uint32_t MinPartSize, std::vector<char> &Result);
+
 void SerializeDxilContainerForRootSignature(hlsl::RootSignatureHandle *pRootSigHandle,
                                      AbstractMemoryStream *pStream);
 
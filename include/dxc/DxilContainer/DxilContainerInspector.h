@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilContainerInspector.h                                                  //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Extracts reflection tables from many DXIL containers at once.             //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "llvm/ADT/ArrayRef.h"
+#include "dxc/DXIL/DxilConstants.h"
+#include "dxc/DxilContainer/DxilContainer.h"
+#include <memory>
+#include <vector>
+
+namespace hlsl {
+
+/// The bytes of a container to inspect.
+struct DxilContainerView {
+  const void *pData;
+  size_t Size;
+};
+
+/// Summary of one container.  The First and Count pairs select its rows in the
+/// flattened tables of DxilContainerInspection.
+struct DxilInspectedContainer {
+  bool Valid;             // False if the bytes are not a valid container.
+  uint32_t PartCount;
+  uint32_t ProgramVersion; // From the DXIL part; 0 without one.
+  bool HasShaderFlags;
+  uint64_t ShaderFlags;   // From the SFI0 part.
+  bool HasHash;
+  DxilShaderHash Hash;    // From the HASH part.
+  DXIL::ShaderKind ShaderKind; // From the PSV part; Invalid without one.
+  uint32_t FirstResource, ResourceCount;
+  uint32_t FirstSignatureElement, SignatureElementCount;
+  uint32_t FirstFunction, FunctionCount;
+};
+
+/// A resource binding from the PSV0 part.
+struct DxilInspectedResource {
+  uint32_t Container;
+  uint32_t ResType;       // PSVResourceType
+  uint32_t Space;
+  uint32_t LowerBound;
+  uint32_t UpperBound;
+};
+
+/// An element of the ISG1, OSG1 or PSG1 part.
+struct DxilInspectedSignatureElement {
+  uint32_t Container;
+  DxilFourCC Signature;   // Part the element belongs to.
+  const char *SemanticName;
+  uint32_t SemanticIndex;
+  uint32_t Stream;
+  uint32_t Register;
+  DxilProgramSigSemantic SystemValue;
+  DxilProgramSigCompType CompType;
+  DxilProgramSigMinPrecision MinPrecision;
+  uint8_t Mask;
+  uint8_t NeverWritesOrAlwaysReadsMask;
+};
+
+/// A function of the RDAT part.
+struct DxilInspectedFunction {
+  uint32_t Container;
+  const char *Name;
+  const char *UnmangledName;
+  DXIL::ShaderKind ShaderKind;
+  uint32_t ShaderStageFlag;
+  uint32_t MinShaderTarget;
+  uint64_t FeatureFlags;
+  uint32_t ResourceCount;
+  uint32_t PayloadSizeInBytes;
+  uint32_t AttributeSizeInBytes;
+};
+
+/// Reflection tables of a batch of containers.  Strings point into the
+/// containers' bytes, which must outlive the result, or into expanded copies
+/// of compressed containers owned by the result.
+struct DxilContainerInspection {
+  std::vector<DxilInspectedContainer> Containers;
+  std::vector<DxilInspectedResource> Resources;
+  std::vector<DxilInspectedSignatureElement> SignatureElements;
+  std::vector<DxilInspectedFunction> Functions;
+  std::vector<std::unique_ptr<std::vector<char>>> ExpandedContainers;
+};
+
+/// Reads the parts of every container in place, spreading the containers
+/// over a thread per core.  The DXIL module is not loaded.  Containers that
+/// are invalid, or whose parts are malformed, are reported with no rows for
+/// those parts rather than failing the batch.
+void InspectDxilContainers(llvm::ArrayRef<DxilContainerView> Containers,
+                           DxilContainerInspection &Result);
+
+} // namespace hlsl
@@ -47,6 +47,9 @@ namespace hlsl {
     //     Major = DXBC_MAJOR_VERSION
     //     Minor = DXBC_MAJOR_VERSION
     // 
+    // Containers with compressed parts are expanded into a copy owned by the
+    // reader, so the parts returned below are always in the standard layout.
+    //
     // Returns S_OK or E_FAIL
     HRESULT Load(_In_ const void* pContainer, _In_ uint32_t containerSizeInBytes);
 
@@ -60,6 +63,7 @@ namespace hlsl {
     const void* m_pContainer = nullptr;
     uint32_t m_uContainerSize = 0;
     const DxilContainerHeader *m_pHeader = nullptr;
+    std::vector<char> m_Decompressed;
 
     bool IsLoaded() const { return m_pHeader != nullptr; }
   };
@@ -90,14 +90,16 @@ public:
   template<typename T>
   const T *Row(uint32_t index) const {
     if (index < m_count && sizeof(T) <= m_stride)
-      return reinterpret_cast<const T*>(m_table + (m_stride * index));
+      return reinterpret_cast<const T*>(m_table + ((size_t)m_stride * index));
     return nullptr;
   }
 };
 
 
 // Index table is a sequence of rows, where each row has a count as a first
-// element followed by the count number of elements pre computing values
+// element followed by the count number of elements pre computing values.
+// Rows that do not fit in the table read as empty, and out of range elements
+// read as UINT_MAX.
 class IndexTableReader {
 private:
   const uint32_t *m_table;
@@ -113,7 +115,7 @@ public:
     IndexRow(const uint32_t *values, uint32_t count)
         : m_values(values), m_count(count) {}
     uint32_t Count() { return m_count; }
-    uint32_t At(uint32_t i) { return m_values[i]; }
+    uint32_t At(uint32_t i) { return i < m_count ? m_values[i] : UINT_MAX; }
   };
 
   IndexTableReader() : m_table(nullptr), m_size(0) {}
@@ -124,7 +126,11 @@ public:
 
   void SetSize(uint32_t size) { m_size = size; }
 
-  IndexRow getRow(uint32_t i) { return IndexRow(&m_table[i] + 1, m_table[i]); }
+  IndexRow getRow(uint32_t i) {
+    if (!m_table || i >= m_size || m_table[i] > m_size - i - 1)
+      return IndexRow(nullptr, 0);
+    return IndexRow(&m_table[i] + 1, m_table[i]);
+  }
 };
 
 class StringTableReader {
@@ -134,10 +140,11 @@ public:
   StringTableReader() : m_table(nullptr), m_size(0) {}
   StringTableReader(const char *table, uint32_t size)
       : m_table(table), m_size(size) {}
+  // Returns an empty string for an offset outside of the table, or if the
+  // table is not null-terminated.
   const char *Get(uint32_t offset) const {
-    _Analysis_assume_(offset < m_size && m_table &&
-                      m_table[m_size - 1] == '\0');
-    (void)m_size; // avoid unused private warning if use above is ignored.
+    if (!m_table || offset >= m_size || m_table[m_size - 1] != '\0')
+      return "";
     return m_table + offset;
   }
 };
@@ -83,11 +83,20 @@ public:
   }
   template <typename T>
   const T *ReadArray(size_t count = 1) {
+    if (count > (Size - Offset) / sizeof(T))
+      throw buffer_overrun{};
     const size_t size = sizeof(T) * count;
     const T* p = Cast<T>(size);
     Offset += size;
     return p;
   }
+  // Reads the records of a table, checking the size without overflowing.
+  const char *ReadTable(const RuntimeDataTableHeader &table) {
+    if (table.RecordStride &&
+        table.RecordCount > (Size - Offset) / table.RecordStride)
+      throw buffer_overrun{};
+    return ReadArray<char>((size_t)table.RecordCount * table.RecordStride);
+  }
 };
 
 DxilRuntimeData::DxilRuntimeData() : DxilRuntimeData(nullptr, 0) {}
@@ -138,22 +147,19 @@ bool DxilRuntimeData::InitFromRDAT(const void *pRDAT, size_t size) {
         }
         case RuntimeDataPartType::ResourceTable: {
           RuntimeDataTableHeader table = PR.Read<RuntimeDataTableHeader>();
-          size_t tableSize = table.RecordCount * table.RecordStride;
-          m_ResourceTableReader.SetResourceInfo(PR.ReadArray<char>(tableSize),
+          m_ResourceTableReader.SetResourceInfo(PR.ReadTable(table),
             table.RecordCount, table.RecordStride);
           break;
         }
         case RuntimeDataPartType::FunctionTable: {
           RuntimeDataTableHeader table = PR.Read<RuntimeDataTableHeader>();
-          size_t tableSize = table.RecordCount * table.RecordStride;
-          m_FunctionTableReader.SetFunctionInfo(PR.ReadArray<char>(tableSize),
+          m_FunctionTableReader.SetFunctionInfo(PR.ReadTable(table),
             table.RecordCount, table.RecordStride);
           break;
         }
         case RuntimeDataPartType::SubobjectTable: {
           RuntimeDataTableHeader table = PR.Read<RuntimeDataTableHeader>();
-          size_t tableSize = table.RecordCount * table.RecordStride;
-          m_SubobjectTableReader.SetSubobjectInfo(PR.ReadArray<char>(tableSize),
+          m_SubobjectTableReader.SetSubobjectInfo(PR.ReadTable(table),
             table.RecordCount, table.RecordStride);
           break;
         }
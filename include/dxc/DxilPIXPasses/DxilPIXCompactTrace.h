@@ -0,0 +1,54 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilPIXCompactTrace.h                                                     //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Declares functions for the compact trace written by the debug             //
+// instrumentation pass, and for expanding it back into the per-instruction  //
+// step trace.                                                               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace llvm {
+class Function;
+class Instruction;
+}  // namespace llvm
+
+namespace pix_dxil {
+namespace PixCompactTrace {
+// In compact mode (hlsl-dxil-debug-instrumentation,compact=1) each invocation
+// writes its start marker, a block record on entry to every basic block, and
+// the usual step records only for values that cannot be recomputed from
+// earlier ones: loads, dx.op results such as wave ops and samples, integer
+// division, and all float arithmetic, whose result depends on the device's
+// denorm mode and on fast-math contraction.  Phi values are recomputed from
+// the block transition.
+
+// Record type of the block record: header, invocation UID, block ordinal.
+// The ordinal is the index of the block in the entry function of the module
+// the pass ran on.
+static constexpr uint32_t BlockRecordType = 250;
+
+// Returns true if the value the full trace records for the instruction (its
+// result, or the value written by an alloca register store) can be recomputed
+// on the host, so that compact mode does not write it.
+bool IsReplayable(llvm::Instruction *pI);
+
+// Expands a compact trace into the records the full instrumentation would
+// have written.  Entry is the entry function of the annotated module the pass
+// ran on, or of its instrumented output.  Records are grouped by invocation,
+// in order of each invocation's start marker.  Returns false if the trace is
+// truncated or does not match the function; the records expanded up to that
+// point are still appended to Steps.
+bool ExpandToStepTrace(llvm::Function &Entry, const uint32_t *pCompact,
+                       size_t DwordCount, std::vector<uint32_t> &Steps);
+}  // namespace PixCompactTrace
+}  // namespace pix_dxil
@@ -373,6 +373,15 @@ bool VerifyRootSignatureWithShaderPSV(_In_ const DxilVersionedRootSignatureDesc
                                       _In_ uint32_t PSVSize,
                                       _In_ llvm::raw_ostream &DiagStream);
 
+// Takes a serialized root signature and PSV data.  The checks that depend
+// only on the root signature run once per process for each distinct
+// serialized root signature.
+bool VerifySerializedRootSignatureWithShaderPSV(
+    _In_reads_bytes_(RootSigSize) const void *pRootSigData,
+    _In_ uint32_t RootSigSize, _In_ DXIL::ShaderKind ShaderKind,
+    _In_reads_bytes_(PSVSize) const void *pPSVData, _In_ uint32_t PSVSize,
+    _In_ llvm::raw_ostream &DiagStream);
+
 // standalone verification
 bool VerifyRootSignature(_In_ const DxilVersionedRootSignatureDesc *pDesc,
                          _In_ llvm::raw_ostream &DiagStream,
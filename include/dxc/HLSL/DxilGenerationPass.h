@@ -20,6 +20,7 @@ class Instruction;
 class PassRegistry;
 class StringRef;
 struct PostDominatorTree;
+class Value;
 }
 
 namespace hlsl {
@@ -27,9 +28,13 @@ class DxilResourceBase;
 class WaveSensitivityAnalysis {
 public:
   static WaveSensitivityAnalysis* create(llvm::PostDominatorTree &PDT);
+  // Also treats thread ids and atomic results as sources, so the results
+  // describe values that may differ between threads of a group.
+  static WaveSensitivityAnalysis* createDivergence(llvm::PostDominatorTree &PDT);
   virtual ~WaveSensitivityAnalysis() { }
   virtual void Analyze(llvm::Function *F) = 0;
   virtual bool IsWaveSensitive(llvm::Instruction *op) = 0;
+  virtual bool IsDivergent(llvm::Value *V) = 0;
 };
 
 class HLSLExtensionsCodegenHelper;
@@ -0,0 +1,45 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilPipelineLink.h                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Links the signatures of the stages of a graphics pipeline, removing       //
+// outputs that the next stage never reads.                                  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "llvm/ADT/ArrayRef.h"
+
+namespace hlsl {
+
+class DxilModule;
+
+struct DxilPipelineLinkStats {
+  unsigned RemovedElements = 0;   // Signature elements removed.
+  unsigned RemovedStores = 0;     // Output stores removed.
+  unsigned RepackedSignatures = 0;
+};
+
+// Links the stages of a pipeline, given in pipeline order (for example VS,
+// HS, DS, GS or VS, PS).  For each adjacent pair of stages:
+//  - producer outputs the consumer never reads, and the components of them
+//    it never reads, are no longer stored, and the computation feeding those
+//    stores is removed;
+//  - producer elements left unused are removed from the signature;
+//  - when the two sides agree on the shape of every linked element, the
+//    consumer input signature is repacked without its unread inputs and the
+//    producer outputs are placed at the same locations.
+// System values consumed by fixed function hardware are always kept.  Pairs
+// are linked from the back of the pipeline, so outputs that only fed removed
+// outputs of a later stage are removed too.  Mesh shader outputs are pruned
+// but not repacked; GS outputs and the amplification payload are left alone.
+// Modified modules have their ViewID state and metadata updated.  Returns
+// true if any module was changed.
+bool LinkPipelineStages(llvm::ArrayRef<DxilModule *> Stages,
+                        DxilPipelineLinkStats *pStats = nullptr);
+
+} // namespace hlsl
@@ -0,0 +1,40 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilSpecializeConstants.h                                                 //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Specializes a DXIL module for known constant buffer values.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "llvm/ADT/ArrayRef.h"
+#include <cstdint>
+
+namespace hlsl {
+
+class DxilModule;
+
+// A 32-bit value at a byte offset of the constant buffer bound at Register
+// in Space.  ByteOffset must be a multiple of 4.
+struct DxilCBufferConstant {
+  unsigned Space;
+  unsigned Register;
+  unsigned ByteOffset;
+  uint32_t Value;
+};
+
+// Replaces the components of cbufferLoadLegacy results that are covered by
+// Constants.  Native 16-bit components take half of a value; min precision
+// ones take a whole value, converted to 16 bits.  64-bit components take two
+// consecutive values and are only replaced when both are given.  Loads
+// through handles whose binding or register index is not a constant are
+// left alone; loads through descriptor heap handles throw, as they have no
+// register to match.  Returns the number of components replaced.
+unsigned SpecializeCBufferLoads(DxilModule &DM,
+                                llvm::ArrayRef<DxilCBufferConstant> Constants);
+
+} // namespace hlsl
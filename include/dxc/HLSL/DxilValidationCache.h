@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilValidationCache.h                                                     //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// In-process cache of containers that have passed validation.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "llvm/ADT/StringRef.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace hlsl {
+
+struct DxilContainerHeader;
+
+// Remembers the containers, and the DXIL programs in them, that this
+// validator build has already validated.
+//
+// Entries are SHA-256 digests of the validator build and the bytes; no
+// bytes are kept.  The least recently used digest is evicted when a set is
+// full.  Nothing is persisted, on purpose: a store on disk would let anyone
+// able to write it mark a container as validated, so entries are lost with
+// the process.
+class DxilValidationCache {
+public:
+  enum class LookupResult {
+    Miss,           // Validate everything.
+    ModuleMatch,    // The program was validated; check the container parts.
+    ContainerMatch  // The container was validated as is.
+  };
+
+  struct Key {
+    uint8_t Module[32];     // Validator build + DXIL/debug DXIL parts.
+    uint8_t Container[32];  // Validator build + all container bytes.
+  };
+
+  // ValidatorBuild identifies the validator, for example its version and
+  // commit; MaxEntries bounds the number of containers and of programs held.
+  DxilValidationCache(llvm::StringRef ValidatorBuild, unsigned MaxEntries);
+
+  // Computes the key of a well-formed container.  Returns false when the
+  // container has no DXIL part and so cannot be cached.
+  bool ComputeKey(const DxilContainerHeader *pContainer, Key &key) const;
+
+  LookupResult Lookup(const Key &key);
+
+  // Records that the container with this key passed validation.
+  void Insert(const Key &key);
+
+private:
+  typedef std::array<uint8_t, 32> Digest;
+  struct DigestHash {
+    size_t operator()(const Digest &D) const {
+      size_t Hash;
+      memcpy(&Hash, D.data(), sizeof(Hash));
+      return Hash;
+    }
+  };
+
+  // Digests from least to most recently used, indexed by value.
+  class DigestSet {
+    std::list<Digest> m_Order;
+    std::unordered_map<Digest, std::list<Digest>::iterator, DigestHash>
+        m_Index;
+
+  public:
+    bool Touch(const uint8_t *pDigest);
+    void Insert(const uint8_t *pDigest, unsigned MaxEntries);
+  };
+
+  std::string m_ValidatorBuild;
+  unsigned m_MaxEntries;
+  std::mutex m_Mutex;
+  DigestSet m_Containers;
+  DigestSet m_Modules;
+};
+
+} // namespace hlsl
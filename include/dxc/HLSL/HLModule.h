@@ -22,6 +22,8 @@
 #include "dxc/DXIL/DxilFunctionProps.h"
 #include "dxc/DXIL/DxilSubobject.h"
 #include "dxc/DXIL/DxilResourceProperties.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/ValueHandle.h"
 #include <memory>
 #include <string>
 #include <vector>
@@ -73,6 +75,73 @@ struct HLOptions {
 
 typedef std::unordered_map<const llvm::Function *, std::unique_ptr<DxilFunctionProps>> DxilFunctionPropsMap;
 
+/// Per-module registry of HL operation functions.
+///
+/// Remembers the opcode group of every function classified so far, so the
+/// per-instruction checks do not look up the group attribute or parse the
+/// function name again, and interns the function created for each
+/// group/opcode/type so that GetOrCreateHLFunction does not build a mangled
+/// name when the function already exists.
+///
+/// Entries are keyed on the function alone. An entry is dropped when its
+/// function is deleted or replaced (RAUW), so a lookup never returns the
+/// replacement; a renamed function keeps its entry and classification.
+class HLOpFunctionRegistry {
+public:
+  struct Groups {
+    HLOpcodeGroup Group;       // Result of GetHLOpcodeGroup.
+    HLOpcodeGroup GroupByName; // Result of GetHLOpcodeGroupByName.
+  };
+
+  HLOpFunctionRegistry() = default;
+  HLOpFunctionRegistry(const HLOpFunctionRegistry &) = delete;
+  HLOpFunctionRegistry &operator=(const HLOpFunctionRegistry &) = delete;
+
+  bool LookupGroups(const llvm::Function *F, Groups &groups) const;
+  void AddGroups(llvm::Function *F, const Groups &groups);
+
+  // Key for a created HL function; the opcode is only part of the key for
+  // groups whose function names include it.
+  static uint64_t GetFunctionKey(HLOpcodeGroup group, unsigned opcode,
+                                 bool waveSensitive);
+  llvm::Function *LookupFunction(llvm::FunctionType *FT, uint64_t key) const;
+  void AddFunction(llvm::FunctionType *FT, uint64_t key, llvm::Function *F);
+
+  // Number of functions with an entry, for testing.
+  size_t GetNumEntries() const { return m_Entries.size(); }
+
+private:
+  typedef std::pair<llvm::FunctionType *, uint64_t> FunctionKey;
+
+  // Forgets its function on deletion and on RAUW.
+  class FunctionVH final : public llvm::CallbackVH {
+    HLOpFunctionRegistry *m_pRegistry;
+    void deleted() override;
+    void allUsesReplacedWith(llvm::Value *) override;
+
+  public:
+    FunctionVH(llvm::Function *F, HLOpFunctionRegistry *pRegistry)
+        : CallbackVH(F), m_pRegistry(pRegistry) {}
+  };
+
+  struct Entry {
+    Entry(llvm::Function *F, HLOpFunctionRegistry *pRegistry);
+    FunctionVH Handle;
+    bool HasGroups = false;
+    Groups FunctionGroups;
+    bool IsInterned = false;
+    FunctionKey Key;
+  };
+
+  Entry *GetEntry(llvm::Function *F);
+  const Entry *FindEntry(const llvm::Function *F) const;
+  void Forget(llvm::Value *V);
+
+  // Nodes are stable, so the handles never move.
+  std::unordered_map<const llvm::Function *, Entry> m_Entries;
+  llvm::DenseMap<FunctionKey, llvm::Function *> m_Functions;
+};
+
 /// Use this class to manipulate HLDXIR of a shader.
 class HLModule {
 public:
@@ -221,6 +290,9 @@ public:
   // DXIL type system.
   DxilTypeSystem &GetTypeSystem();
 
+  // HL operation function registry.
+  HLOpFunctionRegistry &GetHLOpFunctionRegistry();
+
   /// Emit llvm.used array to make sure that optimizations do not remove unreferenced globals.
   void EmitLLVMUsed();
   std::vector<llvm::GlobalVariable* > &GetLLVMUsed();
@@ -306,6 +378,9 @@ private:
   // Type annotations.
   std::unique_ptr<DxilTypeSystem> m_pTypeSystem;
 
+  // HL operation functions.
+  std::unique_ptr<HLOpFunctionRegistry> m_pHLOpFunctions;
+
   // Helpers.
   template<typename T> unsigned AddResource(std::vector<std::unique_ptr<T> > &Vec, std::unique_ptr<T> pRes);
 };
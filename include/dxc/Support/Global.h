@@ -25,6 +25,7 @@ typedef _Return_type_success_(return >= 0) long HRESULT;
 #endif // _WIN32
 
 #include <stdarg.h>
+#include <functional>
 #include <system_error>
 #include "dxc/Support/exception.h"
 #include "dxc/Support/WinAdapter.h"
@@ -74,6 +75,14 @@ private:
   IMalloc *pPrior;
 };
 
+// Runs Task(0) to Task(Count - 1) and returns once all have finished.  Tasks
+// run on the calling thread and on helper threads, of which there are at most
+// one per core beyond the first across all concurrent calls; with none free,
+// or when the caller has installed an allocator other than the default one,
+// the tasks run serially.  Tasks allocate with the caller's allocator.  The
+// first exception thrown by a task is rethrown.
+void DxcParallelFor(unsigned Count, const std::function<void(unsigned)> &Task);
+
 ///////////////////////////////////////////////////////////////////////////////
 // Error handling support.
 void CheckLLVMErrorCode(const std::error_code &ec);
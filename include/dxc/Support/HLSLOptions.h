@@ -106,6 +106,7 @@ public:
   llvm::opt::InputArgList Args = llvm::opt::InputArgList(nullptr, nullptr); // Original arguments.
 
   llvm::StringRef AssemblyCode; // OPT_Fc
+  llvm::StringRef AssemblyFunction; // OPT_Fc_function
   llvm::StringRef DebugFile;    // OPT_Fd
   llvm::StringRef EntryPoint;   // OPT_entrypoint
   llvm::StringRef ExternalFn;   // OPT_external_fn
@@ -120,6 +121,7 @@ public:
   llvm::StringRef OutputRootSigFile; // OPT_Frs
   llvm::StringRef OutputShaderHashFile; // OPT_Fsh
   llvm::StringRef Preprocess; // OPT_P
+  llvm::StringRef DependencyFile; // OPT_MF
   llvm::StringRef TargetProfile; // OPT_target_profile
   llvm::StringRef VariableName; // OPT_Vn
   llvm::StringRef PrivateSource; // OPT_setprivate
@@ -128,6 +130,8 @@ public:
   llvm::StringRef RootSignatureDefine; // OPT_rootsig_define
   llvm::StringRef FloatDenormalMode; // OPT_denorm
   std::vector<std::string> Exports; // OPT_exports
+  std::vector<std::string> LibCacheIncludes; // OPT_lib_cache_include
+  llvm::StringRef LibCacheDir; // OPT_lib_cache_dir
   std::vector<std::string> PreciseOutputs; // OPT_precise_output
   llvm::StringRef DefaultLinkage; // OPT_default_linkage
   unsigned DefaultTextCodePage = DXC_CP_UTF8; // OPT_encoding
@@ -136,6 +140,7 @@ public:
   bool AstDump = false; // OPT_ast_dump
   bool ColorCodeAssembly = false; // OPT_Cc
   bool CodeGenHighLevel = false; // OPT_fcgl
+  bool CodeGenDxilSnapshot = false; // OPT_fsnapshot_dxil
   bool AllowPreserveValues = false; // OPT_preserve_intermediate_values
   bool DebugInfo = false; // OPT__SLASH_Zi
   bool DebugNameForBinary = false; // OPT_Zsb
@@ -169,9 +174,14 @@ public:
   bool PackPrefixStable = false;  // OPT_pack_prefix_stable
   bool PackOptimized = false;  // OPT_pack_optimized
   bool DisplayIncludeProcess = false; // OPT__vi
+  bool ScanDependencies = false; // OPT_M
+  bool WriteDependencies = false; // OPT_MD
+  bool DependenciesAsJson = false; // OPT_Mjson
   bool RecompileFromBinary = false; // OPT _Recompile (Recompiling the DXBC binary file not .hlsl file)
   bool StripDebug = false; // OPT Qstrip_debug
   bool EmbedDebug = false; // OPT Qembed_debug
+  bool FunctionIndex = false; // OPT_Qfunction_index
+  bool ParallelBitcode = false; // OPT_Qparallel_bitcode
   bool StripRootSignature = false; // OPT_Qstrip_rootsignature
   bool StripPrivate = false; // OPT_Qstrip_priv
   bool StripReflection = false; // OPT_Qstrip_reflect
@@ -189,6 +199,8 @@ public:
   bool ResMayAlias = false; // OPT_res_may_alias
   unsigned long ValVerMajor = UINT_MAX, ValVerMinor = UINT_MAX; // OPT_validator_version
   unsigned ScanLimit = 0; // OPT_memdep_block_scan_limit
+  unsigned MemoryBudget = 0; // OPT_memory_budget, in megabytes
+  unsigned TimeBudget = 0; // OPT_time_budget, in milliseconds
 
   // Optimization pass enables, disables and selects
   std::map<std::string, bool> DxcOptimizationToggles; // OPT_opt_enable & OPT_opt_disable
@@ -96,13 +96,14 @@ inline DxcOutputType DxcGetOutputType(DXC_OUT_KIND kind) {
   case DXC_OUT_DISASSEMBLY:
   case DXC_OUT_HLSL:
   case DXC_OUT_TEXT:
+  case DXC_OUT_DEPENDENCIES:
     return DxcOutputType_Text;
   }
   return DxcOutputType_None;
 }
 
 // Update when new results are allowed
-static const unsigned kNumDxcOutputTypes = DXC_OUT_EXTRA_OUTPUTS;
+static const unsigned kNumDxcOutputTypes = DXC_OUT_DEPENDENCIES;
 static const SIZE_T kAutoSize = (SIZE_T)-1;
 static const LPCWSTR DxcOutNoName = nullptr;
 
@@ -120,6 +121,13 @@ struct DxcOutputObject {
     if (!pUnknown)
       return S_OK;
     if (codePage && DxcGetOutputType(kind) == DxcOutputType_Text) {
+      // Null-terminated UTF-8 text can be referenced without a copy.
+      CComPtr<IDxcBlobUtf8> pBlobUtf8;
+      if (codePage == DXC_CP_UTF8 &&
+          SUCCEEDED(pUnknown->QueryInterface(&pBlobUtf8))) {
+        object = pBlobUtf8;
+        return S_OK;
+      }
       CComPtr<IDxcBlob> pBlob;
       IFR(pUnknown->QueryInterface(&pBlob));
       CComPtr<IDxcBlobEncoding> pEncoding;
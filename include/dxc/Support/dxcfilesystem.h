@@ -13,6 +13,8 @@
 
 #include "dxc/dxcapi.h"
 #include "llvm/Support/MSFileSystem.h"
+#include <string>
+#include <vector>
 
 namespace clang {
 class CompilerInstance;
@@ -38,6 +40,12 @@ public:
   virtual void GetStdOutpuHandleStream(IStream **ppResultStream) = 0;
   virtual void WriteStdErrToStream(llvm::raw_string_ostream &s) = 0;
   virtual void EnableDisplayIncludeProcess() = 0;
+  // Reduces the source and every file opened from now on to its
+  // preprocessor directives, for include scanning only.
+  virtual void EnableMinimizedSources() = 0;
+  // Returns the main source followed by every included file, in the order
+  // they were first opened.
+  virtual void GetIncludedFileNames(std::vector<std::wstring> &names) = 0;
   virtual HRESULT CreateStdStreams(_In_ IMalloc *pMalloc) = 0;
   virtual HRESULT RegisterOutputStream(LPCWSTR pName, IStream *pStream) = 0;
 };
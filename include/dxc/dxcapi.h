@@ -187,6 +187,26 @@ IDxcIncludeHandler : public IUnknown {
   DECLARE_CROSS_PLATFORM_UUIDOF(IDxcIncludeHandler)
 };
 
+// Follows a compile as it runs. To receive these calls, pass it to
+// IDxcCompiler9::CompileWithCallback.
+struct __declspec(uuid("b3f6e2a8-4c1d-4e97-a5b0-7d2c9e18f463"))
+IDxcCompileCallback : public IUnknown {
+  // Called with the text of each diagnostic as it is emitted, as it will
+  // appear in the errors output (UTF-8, not null-terminated).
+  virtual void STDMETHODCALLTYPE OnDiagnostic(
+    _In_reads_(textLength) LPCSTR pText, _In_ SIZE_T textLength) = 0;
+
+  // Called as the compile enters a phase: the front end, each optimization
+  // pass, then container assembly and validation.
+  virtual void STDMETHODCALLTYPE OnProgress(_In_z_ LPCSTR pPhase) = 0;
+
+  // Polled between top-level declarations and between passes. Returning
+  // TRUE stops the compile, which then fails with E_ABORT.
+  virtual BOOL STDMETHODCALLTYPE IsCancelled() = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcCompileCallback)
+};
+
 // Structure for supplying bytes or text input to Dxc APIs.
 // Use Encoding = 0 for non-text bytes, ANSI text, or unknown with BOM.
 typedef struct DxcBuffer {
@@ -268,6 +288,7 @@ IDxcOperationResult : public IUnknown {
   // DXC_OUT_DISASSEMBLY - Disassemble()
   // DXC_OUT_HLSL - Compile() with -P
   // DXC_OUT_ROOT_SIGNATURE - Compile() with rootsig_* target
+  // DXC_OUT_DEPENDENCIES - Compile() with -M
   virtual HRESULT STDMETHODCALLTYPE GetResult(_COM_Outptr_result_maybenull_ IDxcBlob **ppResult) = 0;
 
   // GetErrorBuffer Corresponds to DXC_OUT_ERRORS.
@@ -462,6 +483,7 @@ typedef enum DXC_OUT_KIND {
   DXC_OUT_REFLECTION = 8,     // IDxcBlob - RDAT part with reflection data
   DXC_OUT_ROOT_SIGNATURE = 9, // IDxcBlob - Serialized root signature output
   DXC_OUT_EXTRA_OUTPUTS  = 10,// IDxcExtraResults - Extra outputs
+  DXC_OUT_DEPENDENCIES = 11,  // IDxcBlobUtf8 or IDxcBlobUtf16 - Included files, from -M or -MD
 
   DXC_OUT_FORCE_DWORD = 0xFFFFFFFF
 } DXC_OUT_KIND;
@@ -531,6 +553,150 @@ IDxcCompiler4 : public IDxcCompiler3 {
   DECLARE_CROSS_PLATFORM_UUIDOF(IDxcCompiler4)
 };
 
+struct __declspec(uuid("6e0f3b2c-5d1a-4f7e-9b64-2c8d1a9e3f57"))
+IDxcCompiler5 : public IDxcCompiler4 {
+
+  // Disassemble a single function or library export of a program, without
+  // printing or materializing the rest of the module.
+  virtual HRESULT STDMETHODCALLTYPE DisassembleFunction(
+    _In_ const DxcBuffer *pObject,                // Program to disassemble: dxil container or bitcode.
+    _In_ LPCWSTR pFunctionName,                   // Function name, mangled or unmangled export name.
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, disassembly text, and errors
+    ) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcCompiler5)
+};
+
+// One set of defines for IDxcCompiler6::CompilePermutations.
+struct DxcPermutation {
+  const DxcDefine *pDefines;  // Defines added to the shared arguments
+  UINT32 DefineCount;         // Number of defines
+};
+
+struct __declspec(uuid("c4d2a9e1-7b3f-4e86-a05d-93f1e6b8c274"))
+IDxcPermutationResults : public IUnknown {
+  // Number of permutations, in the order they were passed.
+  virtual UINT32 STDMETHODCALLTYPE GetPermutationCount(void) = 0;
+  // Number of compiles actually run; the other permutations reused one.
+  virtual UINT32 STDMETHODCALLTYPE GetCompileCount(void) = 0;
+  // Index of the permutation whose compile is shared by this one.
+  // Equal to Index when this permutation was compiled itself.
+  virtual HRESULT STDMETHODCALLTYPE GetSharedIndex(
+    _In_ UINT32 Index, _Out_ UINT32 *pSharedIndex) = 0;
+  // IDxcResult of the permutation: status, buffer, and errors.
+  virtual HRESULT STDMETHODCALLTYPE GetResult(
+    _In_ UINT32 Index, _In_ REFIID riid, _COM_Outptr_ LPVOID *ppResult) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcPermutationResults)
+};
+
+struct __declspec(uuid("5a8e3f71-2c9d-4b06-8e1a-f47b2d6c9e35"))
+IDxcCompiler6 : public IDxcCompiler5 {
+
+  // Compile one source under several sets of defines. Every permutation is
+  // preprocessed first; permutations whose preprocessed source and
+  // code generation options match share a single compile and result.
+  virtual HRESULT STDMETHODCALLTYPE CompilePermutations(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_opt_count_(argCount) LPCWSTR *pArguments, // Arguments shared by all permutations
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(permutationCount)
+      const DxcPermutation *pPermutations,        // Defines of each permutation
+    _In_ UINT32 permutationCount,                 // Number of permutations
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcPermutationResults
+  ) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcCompiler6)
+};
+
+// A known 32-bit value in a constant buffer, for IDxcCompiler7::Specialize.
+struct DxcCBufferConstant {
+  UINT32 Space;       // Register space of the constant buffer
+  UINT32 Register;    // Register of the constant buffer (the N of bN)
+  UINT32 ByteOffset;  // Offset of the value in the buffer, a multiple of 4
+  UINT32 Value;       // Bits of the value
+};
+
+struct __declspec(uuid("9e2b7c41-6d0a-4f53-b8e7-1a3c5f9d2e84"))
+IDxcCompiler7 : public IDxcCompiler6 {
+
+  // Specialize a compiled shader for known constant buffer values. Loads of
+  // the given values are replaced by constants, the code made dead by them
+  // is removed, and the result is validated into a new container. The
+  // container holds the program and its signatures, without debug info or
+  // reflection.
+  virtual HRESULT STDMETHODCALLTYPE Specialize(
+    _In_ const DxcBuffer *pProgram,               // Compiled DXIL container
+    _In_count_(constantCount)
+      const DxcCBufferConstant *pConstants,       // Known constant buffer values
+    _In_ UINT32 constantCount,                    // Number of values
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, specialized container, and errors
+  ) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcCompiler7)
+};
+
+// One stage of a graphics pipeline, for IDxcCompiler8::CompilePipeline.
+struct DxcPipelineStage {
+  LPCWSTR pEntryPoint;     // Entry point of the stage
+  LPCWSTR pTargetProfile;  // Shader profile of the stage, e.g. vs_6_0
+};
+
+struct __declspec(uuid("3f7c2e95-b41a-4d68-9c0e-5a2d8f61b7c3"))
+IDxcPipelineResults : public IUnknown {
+  // Number of stages, in the order they were passed.
+  virtual UINT32 STDMETHODCALLTYPE GetStageCount(void) = 0;
+  // Whether the stages were linked; false if any of them failed to compile.
+  virtual BOOL STDMETHODCALLTYPE IsLinked(void) = 0;
+  // IDxcResult of the stage: status, buffer, and errors.
+  virtual HRESULT STDMETHODCALLTYPE GetResult(
+    _In_ UINT32 Index, _In_ REFIID riid, _COM_Outptr_ LPVOID *ppResult) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcPipelineResults)
+};
+
+struct __declspec(uuid("b85d1f36-0c7e-4a29-8f43-d6e9a1c2574b"))
+IDxcCompiler8 : public IDxcCompiler7 {
+
+  // Compile the stages of a graphics pipeline from one source, given in
+  // pipeline order (for example VS, HS, DS, GS or VS, PS), and link their
+  // signatures: outputs that the next stage never reads are no longer
+  // written, and the computation feeding them is removed. Linked stages are
+  // validated into new containers holding the program, its signatures and
+  // root signature, without debug info or reflection.
+  virtual HRESULT STDMETHODCALLTYPE CompilePipeline(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_opt_count_(argCount) LPCWSTR *pArguments, // Arguments shared by all stages
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(stageCount)
+      const DxcPipelineStage *pStages,            // Entry point and profile of each stage
+    _In_ UINT32 stageCount,                       // Number of stages
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcPipelineResults
+  ) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcCompiler8)
+};
+
+struct __declspec(uuid("4e1a7c93-6b2d-4f58-9c0e-8a3d5f21b7e6"))
+IDxcCompiler9 : public IDxcCompiler8 {
+
+  // Compile as IDxcCompiler3::Compile does, reporting diagnostics and
+  // progress to pCallback as the compile runs and stopping it once
+  // pCallback asks to.
+  virtual HRESULT STDMETHODCALLTYPE CompileWithCallback(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_opt_count_(argCount) LPCWSTR *pArguments, // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_opt_ IDxcCompileCallback *pCallback,      // Follows the compile as it runs (optional)
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, buffer, and errors
+  ) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcCompiler9)
+};
+
 static const UINT32 DxcValidatorFlags_Default = 0;
 static const UINT32 DxcValidatorFlags_InPlaceEdit = 1;  // Validator is allowed to update shader blob in-place.
 static const UINT32 DxcValidatorFlags_RootSignatureOnly = 2;
@@ -559,6 +725,17 @@ IDxcContainerBuilder : public IUnknown {
   DECLARE_CROSS_PLATFORM_UUIDOF(IDxcContainerBuilder)
 };
 
+struct __declspec(uuid("8a7e1d3c-4b52-4f0e-a6c9-3d1e7b2f5a90"))
+IDxcContainerBuilder2 : public IDxcContainerBuilder {
+  // Makes SerializeContainer replace every part of at least MinPartSize bytes
+  // that gets smaller with a compressed part, for on-disk caches. Containers
+  // with compressed parts are expanded to the original bytes by Load and by
+  // container readers. Zero disables compression, which is the default.
+  virtual HRESULT STDMETHODCALLTYPE SetPartCompression(_In_ UINT32 MinPartSize) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcContainerBuilder2)
+};
+
 struct __declspec(uuid("091f7a26-1c1f-4948-904b-e6e3a8a771d5"))
 IDxcAssembler : public IUnknown {
   // Assemble dxil in ll or llvm bitcode to DXIL container.
@@ -16,6 +16,7 @@
 #define LLVM_BITCODE_BITCODEWRITERPASS_H
 
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Bitcode/ReaderWriter.h" // HLSL Change
 
 namespace llvm {
 class Module;
@@ -29,8 +30,12 @@ class PreservedAnalyses;
 ///
 /// If \c ShouldPreserveUseListOrder, encode use-list order so it can be
 /// reproduced when deserialized.
+///
+/// HLSL Change: If \c ParallelFor is given, it is used to encode the function
+/// blocks of large modules concurrently.
 ModulePass *createBitcodeWriterPass(raw_ostream &Str,
-                                    bool ShouldPreserveUseListOrder = false);
+                                    bool ShouldPreserveUseListOrder = false,
+                                    const BitcodeParallelFor &ParallelFor = nullptr);
 
 /// \brief Pass for writing a module of IR out to a bitcode file.
 ///
@@ -101,6 +101,31 @@ public:
   /// \brief Retrieve the current position in the stream, in bits.
   uint64_t GetCurrentBitNo() const { return GetBufferOffset() * 8 + CurBit; }
 
+  // HLSL Change Starts
+  /// \brief Prepare this writer to emit blocks that will be spliced into
+  /// \p Other at its current position: take its code size and a private copy
+  /// of its BLOCKINFO abbreviations. \p Other is only read, so several
+  /// writers may copy from it concurrently.
+  void CopyBlockState(const BitstreamWriter &Other) {
+    CurCodeSize = Other.CurCodeSize;
+    BlockInfoRecords.clear();
+    BlockInfoRecords.resize(Other.BlockInfoRecords.size());
+    for (size_t i = 0, e = Other.BlockInfoRecords.size(); i != e; ++i) {
+      const BlockInfo &Src = Other.BlockInfoRecords[i];
+      BlockInfoRecords[i].BlockID = Src.BlockID;
+      for (const IntrusiveRefCntPtr<BitCodeAbbrev> &Abbv : Src.Abbrevs)
+        BlockInfoRecords[i].Abbrevs.push_back(new BitCodeAbbrev(*Abbv.get()));
+    }
+  }
+
+  /// \brief Append blocks emitted by a writer prepared with CopyBlockState.
+  /// The stream must be 32-bit aligned, as it is after any block.
+  void AppendBlocks(const SmallVectorImpl<char> &Blocks) {
+    assert(CurBit == 0 && "Not 32-bit aligned");
+    Out.append(Blocks.begin(), Blocks.end());
+  }
+  // HLSL Change Ends
+
   //===--------------------------------------------------------------------===//
   // Basic Primitives for emitting bits to the stream.
   //===--------------------------------------------------------------------===//
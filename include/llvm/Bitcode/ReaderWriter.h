@@ -14,12 +14,15 @@
 #ifndef LLVM_BITCODE_READERWRITER_H
 #define LLVM_BITCODE_READERWRITER_H
 
+#include "llvm/ADT/ArrayRef.h" // HLSL Change
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include <functional> // HLSL Change
 #include <memory>
 #include <string>
+#include <vector> // HLSL Change
 
 namespace llvm {
   class BitstreamWriter;
@@ -29,16 +32,34 @@ namespace llvm {
   class ModulePass;
   class raw_ostream;
 
+  /// HLSL Change: Runs Task(0) to Task(Count - 1), possibly concurrently, and
+  /// returns once all of them have finished.
+  typedef std::function<void(unsigned Count,
+                             const std::function<void(unsigned)> &Task)>
+      BitcodeParallelFor;
+
   /// Read the header of the specified bitcode buffer and prepare for lazy
   /// deserialization of function bodies. If ShouldLazyLoadMetadata is true,
   /// lazily load metadata as well. If successful, this moves Buffer. On
   /// error, this *does not* move Buffer.
+  /// HLSL Change: FunctionBodyBits, as computed by getBitcodeFunctionBodyBits,
+  /// lets function bodies be found without scanning the module for them. It
+  /// is ignored if it does not match the bitcode.
   ErrorOr<std::unique_ptr<Module>>
   getLazyBitcodeModule(std::unique_ptr<MemoryBuffer> &&Buffer,
                        LLVMContext &Context,
                        DiagnosticHandlerFunction DiagnosticHandler = nullptr,
                        bool ShouldLazyLoadMetadata = false,
-                       bool ShouldTrackBitstreamUsage = false);
+                       bool ShouldTrackBitstreamUsage = false,
+                       ArrayRef<uint64_t> FunctionBodyBits = None);
+
+  // HLSL Change Begin
+  /// Collect the bit position of each function body in the specified bitcode
+  /// buffer, in the order the bodies appear. Returns false if the buffer is
+  /// not a well-formed bitcode module.
+  bool getBitcodeFunctionBodyBits(MemoryBufferRef Buffer,
+                                  std::vector<uint64_t> &FunctionBodyBits);
+  // HLSL Change End
 
   /// Read the header of the specified stream and prepare for lazy
   /// deserialization and streaming of function bodies.
@@ -68,8 +89,12 @@ namespace llvm {
   /// If \c ShouldPreserveUseListOrder, encode the use-list order for each \a
   /// Value in \c M.  These will be reconstructed exactly when \a M is
   /// deserialized.
+  ///
+  /// HLSL Change: If \c ParallelFor is given, the function blocks of large
+  /// modules are encoded concurrently through it. The output is the same.
   void WriteBitcodeToFile(const Module *M, raw_ostream &Out,
-                          bool ShouldPreserveUseListOrder = false);
+                          bool ShouldPreserveUseListOrder = false,
+                          const BitcodeParallelFor &ParallelFor = nullptr);
 
   /// isBitcodeWrapper - Return true if the given bytes are the magic bytes
   /// for an LLVM IR bitcode wrapper.
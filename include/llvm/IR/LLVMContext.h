@@ -165,6 +165,23 @@ public:
   /// any global mutex or cannot block the execution in another LLVM context.
   void yield();
 
+  // HLSL Change Begin - pass boundary callback.
+  /// Defines the type of a pass boundary callback.
+  /// \see LLVMContext::setPassBoundaryCallback.
+  typedef void (*PassBoundaryCallbackTy)(LLVMContext *Context,
+                                         StringRef PassName,
+                                         void *OpaqueHandle);
+
+  /// \brief Registers a callback the legacy pass managers call before running
+  /// each pass, with the name of that pass. The callback may throw to abandon
+  /// the pipeline.
+  void setPassBoundaryCallback(PassBoundaryCallbackTy Callback,
+                               void *OpaqueHandle);
+
+  /// \brief Calls the pass boundary callback (if applicable).
+  void passBoundary(StringRef PassName);
+  // HLSL Change End
+
   /// emitError - Emit an error message to the currently installed error handler
   /// with optional location information.  This function returns, so code should
   /// be prepared to drop the erroneous construct on the floor and "not crash".
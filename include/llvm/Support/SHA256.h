@@ -0,0 +1,53 @@
+//===- SHA256.h - SHA-256 implementation ------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the SHA-256 secure hash algorithm (FIPS 180-4).
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_SHA256_H
+#define LLVM_SUPPORT_SHA256_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace llvm {
+
+class SHA256 {
+  uint32_t State[8];
+  uint64_t ByteCount;
+  uint8_t Buffer[64];
+  unsigned BufferOffset;
+
+public:
+  typedef uint8_t SHA256Result[32];
+
+  SHA256();
+
+  /// \brief Updates the hash for the byte stream provided.
+  void update(ArrayRef<uint8_t> Data);
+
+  /// \brief Updates the hash for the StringRef provided.
+  void update(StringRef Str);
+
+  /// \brief Finishes off the hash and puts the result in result.
+  void final(SHA256Result &Result);
+
+  /// \brief Translates the bytes in \p Res to a hex string that is
+  /// deposited into \p Str. The result will be of length 64.
+  static void stringifyResult(SHA256Result &Result, SmallString<64> &Str);
+
+private:
+  void hashBlock(const uint8_t *Block);
+};
+
+}
+
+#endif
@@ -134,6 +134,8 @@ public:
   unsigned ScanLimit = 0; // HLSL Change
   bool EnableGVN = true; // HLSL Change
   bool StructurizeLoopExitsForUnroll; // HLSL Change
+  bool HLSLPauseAtDxil = false; // HLSL Change - stop right after DXIL generation
+  bool HLSLResumeAtDxil = false; // HLSL Change - start right after DXIL generation
 
 private:
   /// ExtensionList - This is list of all of the extensions that are registered.
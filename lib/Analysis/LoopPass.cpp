@@ -243,6 +243,8 @@ bool LPPassManager::runOnFunction(Function &F) {
       dumpRequiredSet(P);
 
       initializeAnalysisImpl(P);
+      // HLSL Change - pass boundary callback
+      CurrentLoop->getHeader()->getContext().passBoundary(P->getPassName());
 
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
@@ -237,6 +237,7 @@ public:
 
   bool ShouldTrackBitstreamUsage = false; // HLSL Change
   BitstreamUseTracker Tracker; // HLSL Change
+  std::vector<uint64_t> FunctionBodyBits; // HLSL Change
 
   bool isDematerializable(const GlobalValue *GV) const override;
   std::error_code materialize(GlobalValue *GV) override;
@@ -365,6 +366,7 @@ private:
   std::error_code parseValueSymbolTable();
   std::error_code parseConstants();
   std::error_code rememberAndSkipFunctionBody();
+  void applyFunctionBodyBits(); // HLSL Change
   /// Save the positions of the Metadata blocks and skip parsing the blocks.
   std::error_code rememberAndSkipMetadata();
   std::error_code parseFunctionBody(Function *F);
@@ -3069,6 +3071,41 @@ std::error_code BitcodeReader::rememberAndSkipFunctionBody() {
   return std::error_code();
 }
 
+// HLSL Change Begin
+/// Returns whether Bit is where the contents of a function block start, just
+/// past the ENTER_SUBBLOCK abbrev and block ID of the enclosing module block.
+static bool isFunctionBlockBody(BitstreamCursor &Stream, uint64_t Bit) {
+  static_assert(bitc::FUNCTION_BLOCK_ID < (1 << (bitc::BlockIDWidth - 1)),
+                "block ID must fit in a single VBR chunk");
+  unsigned HeaderBits = Stream.getAbbrevIDWidth() + bitc::BlockIDWidth;
+  if (Bit < HeaderBits)
+    return false;
+  Stream.JumpToBit(Bit - HeaderBits);
+  return Stream.ReadCode() == bitc::ENTER_SUBBLOCK &&
+         Stream.ReadVBR(bitc::BlockIDWidth) == bitc::FUNCTION_BLOCK_ID;
+}
+
+/// When the caller supplied the position of every function body, record them
+/// all as soon as the first body is reached, so that materializing a function
+/// jumps straight to it rather than resuming the scan of the module. The
+/// positions are only used if they agree with the bitcode seen so far.
+void BitcodeReader::applyFunctionBodyBits() {
+  std::vector<uint64_t> Bits;
+  Bits.swap(FunctionBodyBits);
+  if (Bits.size() != FunctionsWithBodies.size() ||
+      Bits.front() != Stream.GetCurrentBitNo() ||
+      Bits.back() >= (uint64_t)Buffer->getBufferSize() * 8)
+    return;
+  for (size_t i = 1, e = Bits.size(); i != e; ++i)
+    if (Bits[i] <= Bits[i - 1])
+      return;
+
+  // FunctionsWithBodies has been reversed, so the first body is at the back.
+  for (size_t i = 0, e = Bits.size(); i != e; ++i)
+    DeferredFunctionInfo[FunctionsWithBodies[e - 1 - i]] = Bits[i];
+}
+// HLSL Change End
+
 std::error_code BitcodeReader::globalCleanup() {
   // Patch the initializers for globals and aliases up.
   resolveGlobalAndAliasInits();
@@ -3172,6 +3209,8 @@ std::error_code BitcodeReader::parseModule(bool Resume,
           if (std::error_code EC = globalCleanup())
             return EC;
           SeenFirstFunctionBody = true;
+          if (!FunctionBodyBits.empty()) // HLSL Change
+            applyFunctionBodyBits();
         }
 
         if (std::error_code EC = rememberAndSkipFunctionBody())
@@ -4831,6 +4870,12 @@ std::error_code BitcodeReader::materialize(GlobalValue *GV) {
 
   DenseMap<Function*, uint64_t>::iterator DFII = DeferredFunctionInfo.find(F);
   assert(DFII != DeferredFunctionInfo.end() && "Deferred function not found!");
+  // HLSL Change Begin - a position taken from a function index is only
+  // trusted if it follows a function block header; otherwise scan for it.
+  if (DFII->second != 0 && !isFunctionBlockBody(Stream, DFII->second))
+    DFII->second = 0;
+  // HLSL Change End
+
   // If its position is recorded as 0, its body is somewhere in the stream
   // but we haven't seen it yet.
   if (DFII->second == 0)
@@ -5071,7 +5116,8 @@ getLazyBitcodeModuleImpl(std::unique_ptr<MemoryBuffer> &&Buffer,
                          LLVMContext &Context, bool MaterializeAll,
                          DiagnosticHandlerFunction DiagnosticHandler,
                          bool ShouldLazyLoadMetadata = false,
-                         bool ShouldTrackBitstreamUsage = false) // HLSL Change
+                         bool ShouldTrackBitstreamUsage = false, // HLSL Change
+                         ArrayRef<uint64_t> FunctionBodyBits = None) // HLSL Change
 {
   // HLSL Change Begin: Proper memory management with unique_ptr
   // Get the buffer identifier before we transfer the ownership to the bitcode reader,
@@ -5081,6 +5127,7 @@ getLazyBitcodeModuleImpl(std::unique_ptr<MemoryBuffer> &&Buffer,
     std::move(Buffer), Context, DiagnosticHandler);
 
   if (R) R->ShouldTrackBitstreamUsage = ShouldTrackBitstreamUsage; // HLSL Change
+  if (R) R->FunctionBodyBits = FunctionBodyBits; // HLSL Change
   ErrorOr<std::unique_ptr<Module>> Ret =
       getBitcodeModuleImpl(nullptr, BufferIdentifier, std::move(R), Context,
                            MaterializeAll, ShouldLazyLoadMetadata);
@@ -5094,11 +5141,75 @@ getLazyBitcodeModuleImpl(std::unique_ptr<MemoryBuffer> &&Buffer,
 ErrorOr<std::unique_ptr<Module>> llvm::getLazyBitcodeModule(
     std::unique_ptr<MemoryBuffer> &&Buffer, LLVMContext &Context,
     DiagnosticHandlerFunction DiagnosticHandler, bool ShouldLazyLoadMetadata,
-    bool ShouldTrackBitstreamUsage) {
+    bool ShouldTrackBitstreamUsage, ArrayRef<uint64_t> FunctionBodyBits) {
   return getLazyBitcodeModuleImpl(std::move(Buffer), Context, false,
                                   DiagnosticHandler, ShouldLazyLoadMetadata,
-                                  ShouldTrackBitstreamUsage); // HLSL Change
+                                  ShouldTrackBitstreamUsage,
+                                  FunctionBodyBits); // HLSL Change
+}
+
+// HLSL Change Begin
+bool llvm::getBitcodeFunctionBodyBits(MemoryBufferRef Buffer,
+                                      std::vector<uint64_t> &FunctionBodyBits) {
+  FunctionBodyBits.clear();
+  const unsigned char *BufPtr = (const unsigned char *)Buffer.getBufferStart();
+  const unsigned char *BufEnd = BufPtr + Buffer.getBufferSize();
+  if (Buffer.getBufferSize() & 3 || isBitcodeWrapper(BufPtr, BufEnd))
+    return false;
+
+  BitstreamReader StreamFile(BufPtr, BufEnd);
+  BitstreamCursor Stream(StreamFile);
+  if (Stream.Read(8) != 'B' ||
+      Stream.Read(8) != 'C' ||
+      Stream.Read(4) != 0x0 ||
+      Stream.Read(4) != 0xC ||
+      Stream.Read(4) != 0xE ||
+      Stream.Read(4) != 0xD)
+    return false;
+
+  // Find the module block.
+  while (1) {
+    if (Stream.AtEndOfStream())
+      return false;
+    BitstreamEntry Entry =
+        Stream.advance(BitstreamCursor::AF_DontAutoprocessAbbrevs);
+    if (Entry.Kind != BitstreamEntry::SubBlock)
+      return false;
+    if (Entry.ID == bitc::MODULE_BLOCK_ID)
+      break;
+    if (Stream.SkipBlock())
+      return false;
+  }
+  if (Stream.EnterSubBlock(bitc::MODULE_BLOCK_ID))
+    return false;
+
+  // Record each function block at the position the reader remembers it by,
+  // just past its block ID, and skip everything else.
+  while (1) {
+    BitstreamEntry Entry = Stream.advance();
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      return false;
+    case BitstreamEntry::EndBlock:
+      return true;
+    case BitstreamEntry::SubBlock:
+      if (Entry.ID == bitc::BLOCKINFO_BLOCK_ID) {
+        if (Stream.ReadBlockInfoBlock())
+          return false;
+        break;
+      }
+      if (Entry.ID == bitc::FUNCTION_BLOCK_ID)
+        FunctionBodyBits.push_back(Stream.GetCurrentBitNo());
+      if (Stream.SkipBlock())
+        return false;
+      break;
+    case BitstreamEntry::Record:
+      Stream.skipRecord(Entry.ID);
+      break;
+    }
+  }
 }
+// HLSL Change End
 
 ErrorOr<std::unique_ptr<Module>> llvm::getStreamedBitcodeModule(
     StringRef Name, std::unique_ptr<DataStreamer> Streamer,
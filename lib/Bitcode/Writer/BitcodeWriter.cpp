@@ -30,6 +30,7 @@
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm> // HLSL Change
 #include <cctype>
 #include <map>
 using namespace llvm;
@@ -2366,9 +2367,111 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
   Stream.ExitBlock();
 }
 
+// HLSL Change Begin - parallel function block encoding.
+/// Functions with fewer instructions in total than this are always written
+/// serially, and each parallel task gets at least this many.
+static const size_t MinInstructionsPerTask = 8192;
+static const size_t MaxTasks = 16;
+
+/// WriteFunctionsInParallel - Emit the bodies of \p Functions as if by
+/// WriteFunction on each in turn, encoding contiguous runs of them on
+/// separate threads.
+///
+/// Function blocks only depend on the module-level numbering in \p VE, the
+/// BLOCKINFO abbreviations and the current code size, and they start and end
+/// on a word boundary.  Each task therefore works on its own copy of \p VE
+/// and writes into its own buffer, and the buffers are appended in order,
+/// producing exactly the bytes the serial loop would.
+static void WriteFunctionsInParallel(ArrayRef<const Function *> Functions,
+                                     ArrayRef<size_t> InstCounts,
+                                     size_t TaskCount, ValueEnumerator &VE,
+                                     BitstreamWriter &Stream,
+                                     const BitcodeParallelFor &ParallelFor) {
+  // The use-list orders of all functions are on one stack, in function order
+  // from the top.  Hand each function its own entries.
+  std::vector<UseListOrderStack> UseListOrders(Functions.size());
+  if (VE.shouldPreserveUseListOrder()) {
+    for (size_t i = 0, e = Functions.size(); i != e; ++i) {
+      UseListOrderStack &Orders = UseListOrders[i];
+      while (!VE.UseListOrders.empty() &&
+             VE.UseListOrders.back().F == Functions[i]) {
+        Orders.emplace_back(std::move(VE.UseListOrders.back()));
+        VE.UseListOrders.pop_back();
+      }
+      std::reverse(Orders.begin(), Orders.end());
+    }
+  }
+
+  // Split the functions into runs of roughly equal instruction counts.
+  size_t TotalInsts = 0;
+  for (size_t Count : InstCounts)
+    TotalInsts += Count;
+  std::vector<size_t> TaskBegin(1, 0);
+  size_t Insts = 0;
+  for (size_t i = 0, e = Functions.size(); i != e; ++i) {
+    Insts += InstCounts[i];
+    if (TaskBegin.size() < TaskCount &&
+        Insts * TaskCount >= TotalInsts * TaskBegin.size() && i + 1 != e)
+      TaskBegin.push_back(i + 1);
+  }
+  TaskBegin.push_back(Functions.size());
+
+  std::vector<SmallVector<char, 0>> Buffers(TaskBegin.size() - 1);
+  ParallelFor(Buffers.size(), [&](unsigned Task) {
+    ValueEnumerator TaskVE(VE);
+    BitstreamWriter TaskStream(Buffers[Task]);
+    TaskStream.CopyBlockState(Stream);
+    for (size_t i = TaskBegin[Task], e = TaskBegin[Task + 1]; i != e; ++i) {
+      TaskVE.UseListOrders = std::move(UseListOrders[i]);
+      WriteFunction(*Functions[i], TaskVE, TaskStream);
+    }
+  });
+
+  for (const SmallVector<char, 0> &Buffer : Buffers)
+    Stream.AppendBlocks(Buffer);
+}
+
+/// WriteFunctions - Emit all function bodies, in parallel if \p ParallelFor
+/// is given and the module is large enough to benefit.
+static void WriteFunctions(const Module *M, ValueEnumerator &VE,
+                           BitstreamWriter &Stream,
+                           const BitcodeParallelFor &ParallelFor) {
+  std::vector<const Function *> Functions;
+  std::vector<size_t> InstCounts;
+  size_t TotalInsts = 0;
+  if (ParallelFor && Stream.GetCurrentBitNo() % 32 == 0) {
+    for (const Function &F : *M) {
+      if (F.isDeclaration())
+        continue;
+      // Arguments are built lazily; do it here rather than on a task.
+      (void)F.arg_begin();
+      size_t Count = 0;
+      for (const BasicBlock &BB : F)
+        Count += BB.size();
+      Functions.push_back(&F);
+      InstCounts.push_back(Count);
+      TotalInsts += Count;
+    }
+  }
+
+  size_t TaskCount = std::min(std::min(MaxTasks, Functions.size()),
+                              TotalInsts / MinInstructionsPerTask);
+  if (TaskCount > 1) {
+    WriteFunctionsInParallel(Functions, InstCounts, TaskCount, VE, Stream,
+                             ParallelFor);
+    return;
+  }
+
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
+    if (!F->isDeclaration())
+      WriteFunction(*F, VE, Stream);
+}
+// HLSL Change End
+
 /// WriteModule - Emit the specified module to the bitstream.
 static void WriteModule(const Module *M, BitstreamWriter &Stream,
-                        bool ShouldPreserveUseListOrder) {
+                        bool ShouldPreserveUseListOrder,
+                        const BitcodeParallelFor &ParallelFor) { // HLSL Change
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
 
   SmallVector<unsigned, 1> Vals;
@@ -2414,9 +2517,7 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream,
     WriteUseListBlock(nullptr, VE, Stream);
 
   // Emit function bodies.
-  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
-    if (!F->isDeclaration())
-      WriteFunction(*F, VE, Stream);
+  WriteFunctions(M, VE, Stream, ParallelFor); // HLSL Change
 
   Stream.ExitBlock();
 }
@@ -2494,7 +2595,8 @@ static void EmitDarwinBCHeaderAndTrailer(SmallVectorImpl<char> &Buffer,
 /// WriteBitcodeToFile - Write the specified module to the specified output
 /// stream.
 void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
-                              bool ShouldPreserveUseListOrder) {
+                              bool ShouldPreserveUseListOrder,
+                              const BitcodeParallelFor &ParallelFor) { // HLSL Change
   SmallVector<char, 0> Buffer;
   Buffer.reserve(256*1024);
 
@@ -2517,7 +2619,7 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
     Stream.Emit(0xD, 4);
 
     // Emit the module.
-    WriteModule(M, Stream, ShouldPreserveUseListOrder);
+    WriteModule(M, Stream, ShouldPreserveUseListOrder, ParallelFor); // HLSL Change
   }
 
   if (TT.isOSDarwin())
@@ -100,10 +100,13 @@ private:
   unsigned FirstFuncConstantID;
   unsigned FirstInstID;
 
-  ValueEnumerator(const ValueEnumerator &) = delete;
   void operator=(const ValueEnumerator &) = delete;
 public:
   ValueEnumerator(const Module &M, bool ShouldPreserveUseListOrder);
+  // HLSL Change Begin - copy the module-level numbering so that functions can
+  // be incorporated on another thread. UseListOrders is left empty.
+  ValueEnumerator(const ValueEnumerator &VE);
+  // HLSL Change End
 
   void dump() const;
   void print(raw_ostream &OS, const ValueMapType &Map, const char *Name) const;
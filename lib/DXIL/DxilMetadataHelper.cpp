@@ -782,7 +782,8 @@ void DxilMDHelper::EmitDxilTypeSystem(DxilTypeSystem &TypeSystem, vector<GlobalV
 }
 
 void DxilMDHelper::LoadDxilTypeSystemNode(const llvm::MDTuple &MDT,
-                                          DxilTypeSystem &TypeSystem) {
+                                          DxilTypeSystem &TypeSystem,
+                                          bool bLazyStructs) {
 
   unsigned Tag = ConstMDToUint32(MDT.getOperand(0));
   if (Tag == kDxilTypeSystemStructTag) {
@@ -796,6 +797,12 @@ void DxilMDHelper::LoadDxilTypeSystemNode(const llvm::MDTuple &MDT,
           dyn_cast<StructType>(pGV->getType());
       IFTBOOL(pGVType != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
 
+      if (bLazyStructs) {
+        MDTuple *pSAMD = dyn_cast_or_null<MDTuple>(MDT.getOperand(i + 1).get());
+        IFTBOOL(pSAMD != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
+        TypeSystem.AddLazyStructAnnotation(pGVType, pSAMD, this);
+        continue;
+      }
       DxilStructAnnotation *pSA = TypeSystem.AddStructAnnotation(pGVType);
       LoadDxilStructAnnotation(MDT.getOperand(i + 1), *pSA);
     }
@@ -809,7 +816,8 @@ void DxilMDHelper::LoadDxilTypeSystemNode(const llvm::MDTuple &MDT,
   }
 }
 
-void DxilMDHelper::LoadDxilTypeSystem(DxilTypeSystem &TypeSystem) {
+void DxilMDHelper::LoadDxilTypeSystem(DxilTypeSystem &TypeSystem,
+                                      bool bLazyStructs) {
   NamedMDNode *pDxilTypeAnnotationsMD = m_pModule->getNamedMetadata(kDxilTypeSystemMDName);
   if (pDxilTypeAnnotationsMD == nullptr)
     return;
@@ -818,7 +826,7 @@ void DxilMDHelper::LoadDxilTypeSystem(DxilTypeSystem &TypeSystem) {
   for (unsigned i = 0; i < pDxilTypeAnnotationsMD->getNumOperands(); i++) {
     const MDTuple *pTupleMD = dyn_cast<MDTuple>(pDxilTypeAnnotationsMD->getOperand(i));
     IFTBOOL(pTupleMD != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
-    LoadDxilTypeSystemNode(*pTupleMD, TypeSystem);
+    LoadDxilTypeSystemNode(*pTupleMD, TypeSystem, bLazyStructs);
   }
 }
 
@@ -888,6 +896,11 @@ void DxilMDHelper::LoadDxilStructAnnotation(const MDOperand &MDO, DxilStructAnno
   IFTBOOL(MDO.get() != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
   const MDTuple *pTupleMD = dyn_cast<MDTuple>(MDO.get());
   IFTBOOL(pTupleMD != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
+  LoadDxilStructAnnotation(*pTupleMD, SA);
+}
+
+void DxilMDHelper::LoadDxilStructAnnotation(const MDTuple &MDT, DxilStructAnnotation &SA) {
+  const MDTuple *pTupleMD = &MDT;
   if (pTupleMD->getNumOperands() == 1) {
     SA.MarkEmptyStruct();
   }
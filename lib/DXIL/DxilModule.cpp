@@ -115,6 +115,8 @@ DxilModule::DxilModule(Module *pModule)
 , m_ValMinor(0)
 , m_pOP(llvm::make_unique<OP>(pModule->getContext(), pModule))
 , m_pTypeSystem(llvm::make_unique<DxilTypeSystem>(pModule))
+, m_PendingMetadata(0)
+, m_AccessedMetadata(0)
 , m_bDisableOptimizations(false)
 , m_bUseMinPrecision(true) // use min precision by default
 , m_bAllResourcesBound(false)
@@ -166,6 +168,7 @@ void DxilModule::SetShaderModel(const ShaderModel *pSM, bool bUseMinPrecision) {
       llvm::make_unique<DxilEntryProps>(props, m_bUseMinPrecision);
   }
   m_SerializedRootSignature.clear();
+  m_PendingMetadata &= ~(unsigned)LazyMetadata::RootSignature;
 }
 
 const ShaderModel *DxilModule::GetShaderModel() const {
@@ -298,6 +301,20 @@ unsigned DxilModule::GetGlobalFlags() const {
   return Flags;
 }
 
+const DxilFunctionSummary &
+DxilModule::GetFunctionSummary(const llvm::Function *F) const {
+  auto it = m_FunctionSummaries.find(F);
+  if (it != m_FunctionSummaries.end())
+    return it->second;
+  return m_FunctionSummaries
+      .emplace(F, DxilFunctionSummary::Collect(F, this))
+      .first->second;
+}
+
+void DxilModule::ResetFunctionSummaries() {
+  m_FunctionSummaries.clear();
+}
+
 void DxilModule::CollectShaderFlagsForModule(ShaderFlags &Flags) {
   for (Function &F : GetModule()->functions()) {
     ShaderFlags funcFlags = ShaderFlags::CollectShaderFlags(&F, this);
@@ -349,6 +366,7 @@ void DxilModule::CollectShaderFlagsForModule(ShaderFlags &Flags) {
 }
 
 void DxilModule::CollectShaderFlagsForModule() {
+  ResetFunctionSummaries();
   CollectShaderFlagsForModule(m_ShaderFlags);
 
   // This is also where we record the size of the mesh payload for amplification shader output
@@ -943,8 +961,9 @@ static void ConvertUsedResource(std::unordered_set<unsigned> &immResID,
 void DxilModule::RemoveFunction(llvm::Function *F) {
   DXASSERT_NOMSG(F != nullptr);
   m_DxilEntryPropsMap.erase(F);
-  if (m_pTypeSystem.get()->GetFunctionAnnotation(F))
-    m_pTypeSystem.get()->EraseFunctionAnnotation(F);
+  m_FunctionSummaries.erase(F);
+  if (GetTypeSystem().GetFunctionAnnotation(F))
+    GetTypeSystem().EraseFunctionAnnotation(F);
   m_pOP->RemoveFunction(F);
 }
 
@@ -1139,10 +1158,12 @@ const DxilSignature &DxilModule::GetPatchConstOrPrimSignature() const {
 }
 
 const std::vector<uint8_t> &DxilModule::GetSerializedRootSignature() const {
+  MaterializeMetadata(LazyMetadata::RootSignature);
   return m_SerializedRootSignature;
 }
 
 std::vector<uint8_t> &DxilModule::GetSerializedRootSignature() {
+  MaterializeMetadata(LazyMetadata::RootSignature);
   return m_SerializedRootSignature;
 }
 
@@ -1229,6 +1250,8 @@ bool DxilModule::IsEntryThatUsesSignatures(const llvm::Function *F) const {
 }
 
 bool DxilModule::StripRootSignatureFromMetadata() {
+  // Keep the in-memory root signature that an eager load would have kept.
+  MaterializeMetadata(LazyMetadata::RootSignature);
   NamedMDNode *pRootSignatureNamedMD = GetModule()->getNamedMetadata(DxilMDHelper::kDxilRootSignatureMDName);
   if (pRootSignatureNamedMD) {
     GetModule()->eraseNamedMetadata(pRootSignatureNamedMD);
@@ -1238,19 +1261,24 @@ bool DxilModule::StripRootSignatureFromMetadata() {
 }
 
 DxilSubobjects *DxilModule::GetSubobjects() {
+  MaterializeMetadata(LazyMetadata::Subobjects);
   return m_pSubobjects.get();
 }
 const DxilSubobjects *DxilModule::GetSubobjects() const {
+  MaterializeMetadata(LazyMetadata::Subobjects);
   return m_pSubobjects.get();
 }
 DxilSubobjects *DxilModule::ReleaseSubobjects() {
+  MaterializeMetadata(LazyMetadata::Subobjects);
   return m_pSubobjects.release();
 }
 void DxilModule::ResetSubobjects(DxilSubobjects *subobjects) {
+  m_PendingMetadata &= ~(unsigned)LazyMetadata::Subobjects;
   m_pSubobjects.reset(subobjects);
 }
 
 bool DxilModule::StripSubobjectsFromMetadata() {
+  MaterializeMetadata(LazyMetadata::Subobjects);
   NamedMDNode *pSubobjectsNamedMD = GetModule()->getNamedMetadata(DxilMDHelper::kDxilSubobjectsMDName);
   if (pSubobjectsNamedMD) {
     GetModule()->eraseNamedMetadata(pSubobjectsNamedMD);
@@ -1264,23 +1292,28 @@ void DxilModule::UpdateValidatorVersionMetadata() {
 }
 
 void DxilModule::ResetSerializedRootSignature(std::vector<uint8_t> &Value) {
+  m_PendingMetadata &= ~(unsigned)LazyMetadata::RootSignature;
   m_SerializedRootSignature.clear();
   m_SerializedRootSignature.reserve(Value.size());
   m_SerializedRootSignature.assign(Value.begin(), Value.end());
 }
 
 DxilTypeSystem &DxilModule::GetTypeSystem() {
+  MaterializeMetadata(LazyMetadata::TypeSystem);
   return *m_pTypeSystem;
 }
 
 std::vector<unsigned> &DxilModule::GetSerializedViewIdState() {
+  MaterializeMetadata(LazyMetadata::ViewIdState);
   return m_SerializedState;
 }
 const std::vector<unsigned> &DxilModule::GetSerializedViewIdState() const {
+  MaterializeMetadata(LazyMetadata::ViewIdState);
   return m_SerializedState;
 }
 
 void DxilModule::ResetTypeSystem(DxilTypeSystem *pValue) {
+  m_PendingMetadata &= ~(unsigned)LazyMetadata::TypeSystem;
   m_pTypeSystem.reset(pValue);
 }
 
@@ -1352,6 +1385,9 @@ void DxilModule::ClearDxilMetadata(Module &M) {
   // root signature, function properties.
   // Other cases for libs pending.
   // LLVM used is a global variable - handle separately.
+  // Anything not loaded from the metadata yet must be loaded before it goes.
+  if (M.HasDxilModule())
+    M.GetDxilModule().MaterializeDxilMetadata();
   SmallVector<NamedMDNode*, 8> nodes;
   for (NamedMDNode &b : M.named_metadata()) {
     StringRef name = b.getName();
@@ -1376,6 +1412,7 @@ void DxilModule::ClearDxilMetadata(Module &M) {
 }
 
 void DxilModule::EmitDxilMetadata() {
+  MaterializeDxilMetadata();
   m_pMDHelper->EmitDxilVersion(m_DxilMajor, m_DxilMinor);
   m_pMDHelper->EmitValidatorVersion(m_ValMajor, m_ValMinor);
   m_pMDHelper->EmitDxilShaderModel(m_pSM);
@@ -1455,11 +1492,71 @@ bool DxilModule::IsKnownNamedMetaData(llvm::NamedMDNode &Node) {
 }
 
 bool DxilModule::HasMetadataErrors() {
+  // Errors in lazily loaded metadata only surface once it is decoded.
+  MaterializeDxilMetadata();
+  m_pTypeSystem->MaterializeStructAnnotations();
+  m_bMetadataErrors |= m_pTypeSystem->HasStructAnnotationLoadErrors();
   return m_bMetadataErrors;
 }
 
+bool DxilModule::IsMetadataPending(LazyMetadata Kind) const {
+  return (m_PendingMetadata & (unsigned)Kind) != 0;
+}
+
+bool DxilModule::IsMetadataAccessed(LazyMetadata Kind) const {
+  return (m_AccessedMetadata & (unsigned)Kind) != 0;
+}
+
+void DxilModule::MaterializeDxilMetadata() const {
+  MaterializeMetadata(LazyMetadata::TypeSystem);
+  MaterializeMetadata(LazyMetadata::RootSignature);
+  MaterializeMetadata(LazyMetadata::ViewIdState);
+  MaterializeMetadata(LazyMetadata::Subobjects);
+}
+
+void DxilModule::MaterializeMetadata(LazyMetadata Kind) const {
+  m_AccessedMetadata |= (unsigned)Kind;
+  if (!IsMetadataPending(Kind))
+    return;
+  m_PendingMetadata &= ~(unsigned)Kind;
+
+  switch (Kind) {
+  case LazyMetadata::TypeSystem:
+    // Type system is not required for consumption of dxil.  Struct
+    // annotations are decoded as they are used, since most consumers only
+    // need a few.
+    try {
+      m_pMDHelper->LoadDxilTypeSystem(*m_pTypeSystem.get(), /*bLazyStructs*/ true);
+    } catch (hlsl::Exception &) {
+      m_bMetadataErrors = true;
+#ifdef DBG
+      throw;
+#endif
+      m_pTypeSystem->GetStructAnnotationMap().clear();
+      m_pTypeSystem->GetFunctionAnnotationMap().clear();
+    }
+    break;
+  case LazyMetadata::RootSignature:
+    m_pMDHelper->LoadRootSignature(m_SerializedRootSignature);
+    break;
+  case LazyMetadata::ViewIdState:
+    m_pMDHelper->LoadDxilViewIdState(m_SerializedState);
+    break;
+  case LazyMetadata::Subobjects: {
+    std::unique_ptr<DxilSubobjects> pSubobjects(new DxilSubobjects());
+    m_pMDHelper->LoadSubobjects(*pSubobjects);
+    if (pSubobjects->GetSubobjects().size()) {
+      m_pSubobjects.reset(pSubobjects.release());
+    }
+  } break;
+  }
+
+  m_bMetadataErrors |= m_pMDHelper->HasExtraMetadata();
+}
+
 void DxilModule::LoadDxilMetadata() {
   m_bMetadataErrors = false;
+  m_AccessedMetadata = 0;
   m_pMDHelper->LoadDxilVersion(m_DxilMajor, m_DxilMinor);
   m_pMDHelper->LoadValidatorVersion(m_ValMajor, m_ValMinor);
   const ShaderModel *loadedSM;
@@ -1528,12 +1625,8 @@ void DxilModule::LoadDxilMetadata() {
       m_DxilEntryPropsMap[pFunc] = std::move(pEntryProps);
     }
 
-    // Load Subobjects
-    std::unique_ptr<DxilSubobjects> pSubobjects(new DxilSubobjects());
-    m_pMDHelper->LoadSubobjects(*pSubobjects);
-    if (pSubobjects->GetSubobjects().size()) {
-      ResetSubobjects(pSubobjects.release());
-    }
+    // Subobjects are loaded on first access.
+    m_PendingMetadata |= (unsigned)LazyMetadata::Subobjects;
   } else {
     std::unique_ptr<DxilEntryProps> pEntryProps =
         llvm::make_unique<DxilEntryProps>(entryFuncProps, m_bUseMinPrecision);
@@ -1550,21 +1643,11 @@ void DxilModule::LoadDxilMetadata() {
 
   LoadDxilResources(*pEntryResources);
 
-  // Type system is not required for consumption of dxil.
-  try {
-    m_pMDHelper->LoadDxilTypeSystem(*m_pTypeSystem.get());
-  } catch (hlsl::Exception &) {
-    m_bMetadataErrors = true;
-#ifdef DBG
-    throw;
-#endif
-    m_pTypeSystem->GetStructAnnotationMap().clear();
-    m_pTypeSystem->GetFunctionAnnotationMap().clear();
-  }
-
-  m_pMDHelper->LoadRootSignature(m_SerializedRootSignature);
-
-  m_pMDHelper->LoadDxilViewIdState(m_SerializedState);
+  // Most consumers of a loaded module need its entries and resources, but
+  // only some need these, so they are loaded on first access.
+  m_PendingMetadata |= (unsigned)LazyMetadata::TypeSystem |
+                       (unsigned)LazyMetadata::RootSignature |
+                       (unsigned)LazyMetadata::ViewIdState;
 
   m_bMetadataErrors |= m_pMDHelper->HasExtraMetadata();
 }
@@ -1696,7 +1779,7 @@ bool DxilModule::StripReflection() {
     // Keep all structs contained in any we must keep.
     SmallStructSetVector structsToKeep;
     SmallStructSetVector structsToRemove;
-    for (auto &item : m_pTypeSystem->GetStructAnnotationMap()) {
+    for (auto &item : GetTypeSystem().GetStructAnnotationMap()) {
       SmallStructSetVector containedStructs;
       if (!ResourceTypeRequiresTranslation(item.first, containedStructs))
         structsToRemove.insert(item.first);
@@ -1707,18 +1790,18 @@ bool DxilModule::StripReflection() {
     for (auto Ty : structsToKeep)
       structsToRemove.remove(Ty);
     for (auto Ty : structsToRemove) {
-      m_pTypeSystem->GetStructAnnotationMap().erase(Ty);
+      GetTypeSystem().GetStructAnnotationMap().erase(Ty);
     }
   } else {
     // Remove struct annotations.
-    if (!m_pTypeSystem->GetStructAnnotationMap().empty()) {
-      m_pTypeSystem->GetStructAnnotationMap().clear();
+    if (!GetTypeSystem().GetStructAnnotationMap().empty()) {
+      GetTypeSystem().GetStructAnnotationMap().clear();
       bChanged = true;
     }
     if (DXIL::CompareVersions(m_ValMajor, m_ValMinor, 1, 5) >= 0) {
       // Remove function annotations.
-      if (!m_pTypeSystem->GetFunctionAnnotationMap().empty()) {
-        m_pTypeSystem->GetFunctionAnnotationMap().clear();
+      if (!GetTypeSystem().GetFunctionAnnotationMap().empty()) {
+        GetTypeSystem().GetFunctionAnnotationMap().clear();
         bChanged = true;
       }
     }
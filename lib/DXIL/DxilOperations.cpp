@@ -524,6 +524,15 @@ bool OP::IsDxilOpFunc(const llvm::Function *F) {
   // Test for null to allow IsDxilOpFunc(Call.getCalledFunc()) to be resilient to indirect calls
   if (F == nullptr || !F->hasName())
     return false;
+  // Functions created or loaded by the module's OP are in its class map;
+  // anything declared behind its back is still recognized by name.
+  const Module *M = F->getParent();
+  if (M && M->HasDxilModule()) {
+    if (const OP *pOP = M->GetDxilModule().GetOP()) {
+      if (pOP->m_FunctionToOpClass.count(F))
+        return true;
+    }
+  }
   return IsDxilOpFuncName(F->getName());
 }
 
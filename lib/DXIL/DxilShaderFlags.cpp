@@ -263,37 +263,23 @@ DxilResourceProperties GetResourcePropertyFromHandleCall(const hlsl::DxilModule
 }
 
 
-ShaderFlags ShaderFlags::CollectShaderFlags(const Function *F,
-                                           const hlsl::DxilModule *M) {
-  ShaderFlags flag;
-  // Module level options
-  flag.SetUseNativeLowPrecision(!M->GetUseMinPrecision());
-  flag.SetDisableOptimizations(M->GetDisableOptimization());
-  flag.SetAllResourcesBound(M->GetAllResourcesBound());
-
-  bool hasDouble = false;
-  // ddiv dfma drcp d2i d2u i2d u2d.
-  // fma has dxil op. Others should check IR instruction div/cast.
-  bool hasDoubleExtension = false;
-  bool has64Int = false;
-  bool has16 = false;
-  bool hasWaveOps = false;
-  bool hasCheckAccessFully = false;
-  bool hasMSAD = false;
-  bool hasStencilRef = false;
-  bool hasInnerCoverage = false;
-  bool hasViewID = false;
-  bool hasMulticomponentUAVLoads = false;
-  bool hasViewportOrRTArrayIndex = false;
-  bool hasShadingRate = false;
-  bool hasSamplerFeedback = false;
-  bool hasRaytracingTier1_1 = false;
+DxilFunctionSummary::DxilFunctionSummary()
+    : HasDouble(false), HasDoubleExtension(false), Has64Int(false),
+      Has16(false), HasWaveOps(false), HasUAVLoads(false),
+      HasMulticomponentUAVLoads(false) {}
+
+bool DxilFunctionSummary::UsesDerivatives() const {
+  return UsesOp(DXIL::OpCode::Sample) || UsesOp(DXIL::OpCode::SampleBias) ||
+         UsesOp(DXIL::OpCode::SampleCmp) ||
+         UsesOp(DXIL::OpCode::CalculateLOD) ||
+         UsesOp(DXIL::OpCode::DerivCoarseX) ||
+         UsesOp(DXIL::OpCode::DerivCoarseY) ||
+         UsesOp(DXIL::OpCode::DerivFineX) || UsesOp(DXIL::OpCode::DerivFineY);
+}
 
-  // Try to maintain compatibility with a v1.0 validator if that's what we have.
-  uint32_t valMajor, valMinor;
-  M->GetValidatorVersion(valMajor, valMinor);
-  bool hasMulticomponentUAVLoadsBackCompat = valMajor == 1 && valMinor == 0;
-  bool hasViewportOrRTArrayIndexBackCombat = valMajor == 1 && valMinor < 4;
+DxilFunctionSummary DxilFunctionSummary::Collect(const Function *F,
+                                                 const hlsl::DxilModule *M) {
+  DxilFunctionSummary S;
 
   Type *int16Ty = Type::getInt16Ty(F->getContext());
   Type *int64Ty = Type::getInt64Ty(F->getContext());
@@ -301,18 +287,17 @@ ShaderFlags ShaderFlags::CollectShaderFlags(const Function *F,
   for (const BasicBlock &BB : F->getBasicBlockList()) {
     for (const Instruction &I : BB.getInstList()) {
       // Skip none dxil function call.
-      if (const CallInst *CI = dyn_cast<CallInst>(&I)) {
-        if (!OP::IsDxilOpFunc(CI->getCalledFunction()))
-          continue;
-      }
+      const CallInst *CI = dyn_cast<CallInst>(&I);
+      if (CI && !OP::IsDxilOpFunc(CI->getCalledFunction()))
+        continue;
+      if (isa<ExtractElementInst>(&I) ||
+        isa<InsertElementInst>(&I))
+        continue;
       Type *Ty = I.getType();
       bool isDouble = Ty->isDoubleTy();
       bool isHalf = Ty->isHalfTy();
       bool isInt16 = Ty == int16Ty;
       bool isInt64 = Ty == int64Ty;
-      if (isa<ExtractElementInst>(&I) ||
-        isa<InsertElementInst>(&I))
-        continue;
       for (Value *operand : I.operands()) {
         Type *Ty = operand->getType();
         isDouble |= Ty->isDoubleTy();
@@ -320,83 +305,111 @@ ShaderFlags ShaderFlags::CollectShaderFlags(const Function *F,
         isInt16 |= Ty == int16Ty;
         isInt64 |= Ty == int64Ty;
       }
-        if (isDouble) {
-          hasDouble = true;
-          switch (I.getOpcode()) {
-          case Instruction::FDiv:
-          case Instruction::UIToFP:
-          case Instruction::SIToFP:
-          case Instruction::FPToUI:
-          case Instruction::FPToSI:
-            hasDoubleExtension = true;
-            break;
-          }
+      if (isDouble) {
+        S.HasDouble = true;
+        switch (I.getOpcode()) {
+        case Instruction::FDiv:
+        case Instruction::UIToFP:
+        case Instruction::SIToFP:
+        case Instruction::FPToUI:
+        case Instruction::FPToSI:
+          S.HasDoubleExtension = true;
+          break;
         }
+      }
 
-      has16 |= isHalf;
-      has16 |= isInt16;
-      has64Int |= isInt64;
-      if (const CallInst *CI = dyn_cast<CallInst>(&I)) {
-        if (!OP::IsDxilOpFunc(CI->getCalledFunction()))
-          continue;
-        Value *opcodeArg = CI->getArgOperand(DXIL::OperandIndex::kOpcodeIdx);
-        ConstantInt *opcodeConst = dyn_cast<ConstantInt>(opcodeArg);
-        DXASSERT(opcodeConst, "DXIL opcode arg must be immediate");
-        unsigned opcode = opcodeConst->getLimitedValue();
-        DXASSERT(opcode < static_cast<unsigned>(DXIL::OpCode::NumOpCodes),
-          "invalid DXIL opcode");
-        DXIL::OpCode dxilOp = static_cast<DXIL::OpCode>(opcode);
-        if (hlsl::OP::IsDxilOpWave(dxilOp))
-          hasWaveOps = true;
-        switch (dxilOp) {
-        case DXIL::OpCode::CheckAccessFullyMapped:
-          hasCheckAccessFully = true;
-          break;
-        case DXIL::OpCode::Msad:
-          hasMSAD = true;
-          break;
-        case DXIL::OpCode::BufferLoad:
-        case DXIL::OpCode::TextureLoad: {
-          if (hasMulticomponentUAVLoads) continue;
-          // This is the old-style computation (overestimating requirements).
-          Value *resHandle = CI->getArgOperand(DXIL::OperandIndex::kBufferStoreHandleOpIdx);
-          CallInst *handleCall = FindCallToCreateHandle(resHandle);
-          // Check if this is a library handle or general create handle
-          if (handleCall) {
-            DxilResourceProperties RP = GetResourcePropertyFromHandleCall(M, handleCall);
-            if (RP.Class == DXIL::ResourceClass::UAV) {
-              // Validator 1.0 assumes that all uav load is multi component load.
-              if (hasMulticomponentUAVLoadsBackCompat) {
-                hasMulticomponentUAVLoads = true;
-                continue;
-              } else {
-                if (DXIL::IsTyped(RP.Kind) && !RP.Typed.SingleComponent)
-                  hasMulticomponentUAVLoads = true;
-              }
-            }
+      S.Has16 |= isHalf;
+      S.Has16 |= isInt16;
+      S.Has64Int |= isInt64;
+      if (!CI)
+        continue;
+
+      Value *opcodeArg = CI->getArgOperand(DXIL::OperandIndex::kOpcodeIdx);
+      ConstantInt *opcodeConst = dyn_cast<ConstantInt>(opcodeArg);
+      DXASSERT(opcodeConst, "DXIL opcode arg must be immediate");
+      unsigned opcode = opcodeConst->getLimitedValue();
+      DXASSERT(opcode < static_cast<unsigned>(DXIL::OpCode::NumOpCodes),
+        "invalid DXIL opcode");
+      DXIL::OpCode dxilOp = static_cast<DXIL::OpCode>(opcode);
+      S.UsedOps.set(opcode);
+      if (hlsl::OP::IsDxilOpWave(dxilOp))
+        S.HasWaveOps = true;
+      switch (dxilOp) {
+      case DXIL::OpCode::BufferLoad:
+      case DXIL::OpCode::TextureLoad: {
+        if (S.HasMulticomponentUAVLoads) continue;
+        // This is the old-style computation (overestimating requirements).
+        Value *resHandle = CI->getArgOperand(DXIL::OperandIndex::kBufferStoreHandleOpIdx);
+        CallInst *handleCall = FindCallToCreateHandle(resHandle);
+        // Check if this is a library handle or general create handle
+        if (handleCall) {
+          DxilResourceProperties RP = GetResourcePropertyFromHandleCall(M, handleCall);
+          if (RP.Class == DXIL::ResourceClass::UAV) {
+            // Validator 1.0 assumes that all uav load is multi component
+            // load, so record both and let the flags pick.
+            S.HasUAVLoads = true;
+            if (DXIL::IsTyped(RP.Kind) && !RP.Typed.SingleComponent)
+              S.HasMulticomponentUAVLoads = true;
           }
-       } break;
-        case DXIL::OpCode::Fma:
-          hasDoubleExtension |= isDouble;
-          break;
-        case DXIL::OpCode::InnerCoverage:
-          hasInnerCoverage = true;
-          break;
-        case DXIL::OpCode::ViewID:
-          hasViewID = true;
-          break;
-        case DXIL::OpCode::AllocateRayQuery:
-        case DXIL::OpCode::GeometryIndex:
-          hasRaytracingTier1_1 = true;
-          break;
-        default:
-          // Normal opcodes.
-          break;
         }
+      } break;
+      case DXIL::OpCode::Fma:
+        S.HasDoubleExtension |= isDouble;
+        break;
+      default:
+        // Normal opcodes.
+        break;
       }
     }
   }
 
+  return S;
+}
+
+ShaderFlags ShaderFlags::CollectShaderFlags(const Function *F,
+                                           const hlsl::DxilModule *M) {
+  return CollectShaderFlags(F, M, M->GetFunctionSummary(F));
+}
+
+ShaderFlags ShaderFlags::CollectShaderFlags(const Function *F,
+                                           const hlsl::DxilModule *M,
+                                           const DxilFunctionSummary &S) {
+  ShaderFlags flag;
+  // Module level options
+  flag.SetUseNativeLowPrecision(!M->GetUseMinPrecision());
+  flag.SetDisableOptimizations(M->GetDisableOptimization());
+  flag.SetAllResourcesBound(M->GetAllResourcesBound());
+
+  bool hasDouble = S.HasDouble;
+  // ddiv dfma drcp d2i d2u i2d u2d.
+  // fma has dxil op. Others should check IR instruction div/cast.
+  bool hasDoubleExtension = S.HasDoubleExtension;
+  bool has64Int = S.Has64Int;
+  bool has16 = S.Has16;
+  bool hasWaveOps = S.HasWaveOps;
+  bool hasCheckAccessFully = S.UsesOp(DXIL::OpCode::CheckAccessFullyMapped);
+  bool hasMSAD = S.UsesOp(DXIL::OpCode::Msad);
+  bool hasStencilRef = false;
+  bool hasInnerCoverage = S.UsesOp(DXIL::OpCode::InnerCoverage);
+  bool hasViewID = S.UsesOp(DXIL::OpCode::ViewID);
+  bool hasMulticomponentUAVLoads = false;
+  bool hasViewportOrRTArrayIndex = false;
+  bool hasShadingRate = false;
+  bool hasSamplerFeedback = false;
+  bool hasRaytracingTier1_1 = S.UsesOp(DXIL::OpCode::AllocateRayQuery) ||
+                              S.UsesOp(DXIL::OpCode::GeometryIndex);
+
+  // Try to maintain compatibility with a v1.0 validator if that's what we have.
+  uint32_t valMajor, valMinor;
+  M->GetValidatorVersion(valMajor, valMinor);
+  bool hasMulticomponentUAVLoadsBackCompat = valMajor == 1 && valMinor == 0;
+  bool hasViewportOrRTArrayIndexBackCombat = valMajor == 1 && valMinor < 4;
+
+  if (hasMulticomponentUAVLoadsBackCompat)
+    hasMulticomponentUAVLoads = S.HasUAVLoads;
+  else
+    hasMulticomponentUAVLoads = S.HasMulticomponentUAVLoads;
+
   // If this function is a shader, add flags based on signatures
   if (M->HasDxilEntryProps(F)) {
     const DxilEntryProps &entryProps = M->GetDxilEntryProps(F);
@@ -74,6 +74,25 @@ unsigned DxilSignature::AppendElement(std::unique_ptr<DxilSignatureElement> pSE,
   return Id;
 }
 
+std::vector<unsigned>
+DxilSignature::RemoveElements(const std::vector<bool> &Remove) {
+  DXASSERT_NOMSG(Remove.size() == m_Elements.size());
+  std::vector<unsigned> NewIDs(m_Elements.size(),
+                               DxilSignatureElement::kUndefinedID);
+  unsigned NewID = 0;
+  for (unsigned i = 0; i < m_Elements.size(); ++i) {
+    if (Remove[i])
+      continue;
+    NewIDs[i] = NewID;
+    m_Elements[i]->SetID(NewID);
+    if (NewID != i)
+      m_Elements[NewID] = std::move(m_Elements[i]);
+    ++NewID;
+  }
+  m_Elements.resize(NewID);
+  return NewIDs;
+}
+
 DxilSignatureElement &DxilSignature::GetElement(unsigned idx) {
   return *m_Elements[idx];
 }
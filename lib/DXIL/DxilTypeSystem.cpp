@@ -9,6 +9,7 @@
 
 #include "dxc/DXIL/DxilTypeSystem.h"
 #include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilMetadataHelper.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/WinFunctions.h"
 
@@ -204,6 +205,8 @@ const Function *DxilFunctionAnnotation::GetFunction() const {
 //
 DxilTypeSystem::DxilTypeSystem(Module *pModule)
     : m_pModule(pModule),
+      m_pPendingMDHelper(nullptr),
+      m_bStructAnnotationLoadErrors(false),
       m_LowPrecisionMode(DXIL::LowPrecisionMode::Undefined) {}
 
 DxilStructAnnotation *DxilTypeSystem::AddStructAnnotation(const StructType *pStructType, unsigned numTemplateArgs) {
@@ -219,6 +222,8 @@ DxilStructAnnotation *DxilTypeSystem::AddStructAnnotation(const StructType *pStr
 DxilStructAnnotation *DxilTypeSystem::GetStructAnnotation(const StructType *pStructType) {
   auto it = m_StructAnnotations.find(pStructType);
   if (it != m_StructAnnotations.end()) {
+    if (!it->second)
+      return MaterializeStructAnnotation(it);
     return it->second.get();
   } else {
     return nullptr;
@@ -229,6 +234,8 @@ const DxilStructAnnotation *
 DxilTypeSystem::GetStructAnnotation(const StructType *pStructType) const {
   auto it = m_StructAnnotations.find(pStructType);
   if (it != m_StructAnnotations.end()) {
+    if (!it->second)
+      return MaterializeStructAnnotation(it);
     return it->second.get();
   } else {
     return nullptr;
@@ -237,15 +244,84 @@ DxilTypeSystem::GetStructAnnotation(const StructType *pStructType) const {
 
 void DxilTypeSystem::EraseStructAnnotation(const StructType *pStructType) {
   DXASSERT_NOMSG(m_StructAnnotations.count(pStructType));
+  m_PendingStructAnnotations.erase(pStructType);
   m_StructAnnotations.remove_if([pStructType](
       const std::pair<const StructType *, std::unique_ptr<DxilStructAnnotation>>
           &I) { return pStructType == I.first; });
 }
 
 DxilTypeSystem::StructAnnotationMap &DxilTypeSystem::GetStructAnnotationMap() {
+  // Callers walk and edit the map directly, so nothing may be left pending.
+  MaterializeStructAnnotations();
   return m_StructAnnotations;
 }
 
+void DxilTypeSystem::AddLazyStructAnnotation(const StructType *pStructType,
+                                             MDTuple *pMD,
+                                             DxilMDHelper *pMDHelper) {
+  DXASSERT_NOMSG(m_StructAnnotations.find(pStructType) == m_StructAnnotations.end());
+  DXASSERT(m_pPendingMDHelper == nullptr || m_pPendingMDHelper == pMDHelper,
+           "otherwise, pending annotations would be decoded by different helpers");
+  m_StructAnnotations[pStructType] = nullptr;
+  m_PendingStructAnnotations[pStructType].reset(pMD);
+  m_pPendingMDHelper = pMDHelper;
+}
+
+void DxilTypeSystem::MaterializeStructAnnotations() {
+  if (m_PendingStructAnnotations.empty())
+    return;
+  // Decoding may erase entries that fail, so collect the types first.
+  SmallVector<const StructType *, 16> pendingTypes;
+  for (auto &item : m_StructAnnotations) {
+    if (!item.second)
+      pendingTypes.push_back(item.first);
+  }
+  for (const StructType *pStructType : pendingTypes)
+    GetStructAnnotation(pStructType);
+}
+
+bool DxilTypeSystem::IsStructAnnotationPending(
+    const StructType *pStructType) const {
+  return m_PendingStructAnnotations.count(pStructType) != 0;
+}
+
+bool DxilTypeSystem::HasStructAnnotationLoadErrors() const {
+  return m_bStructAnnotationLoadErrors;
+}
+
+DxilStructAnnotation *
+DxilTypeSystem::MaterializeStructAnnotation(StructAnnotationMap::iterator it) const {
+  const StructType *pStructType = it->first;
+  auto pendingIt = m_PendingStructAnnotations.find(pStructType);
+  DXASSERT_NOMSG(pendingIt != m_PendingStructAnnotations.end());
+  const MDTuple *pMD = dyn_cast_or_null<MDTuple>(pendingIt->second.get());
+  m_PendingStructAnnotations.erase(pendingIt);
+
+  unique_ptr<DxilStructAnnotation> pA(new DxilStructAnnotation());
+  pA->m_pStructType = pStructType;
+  pA->m_FieldAnnotations.resize(pStructType->getNumElements());
+  pA->SetNumTemplateArgs(0);
+  try {
+    // The tuple may have been replaced by something else since it was
+    // loaded.
+    IFTBOOL(pMD != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
+    bool bHadExtraMetadata = m_pPendingMDHelper->HasExtraMetadata();
+    m_pPendingMDHelper->LoadDxilStructAnnotation(*pMD, *pA);
+    // Unknown metadata found now would have been reported by an up-front
+    // load as well.
+    if (!bHadExtraMetadata && m_pPendingMDHelper->HasExtraMetadata())
+      m_bStructAnnotationLoadErrors = true;
+  } catch (hlsl::Exception &) {
+    // Like a type system that fails to load up front, drop what could not
+    // be decoded and let the module report metadata errors.
+    m_bStructAnnotationLoadErrors = true;
+    m_StructAnnotations.erase(it);
+    return nullptr;
+  }
+  it->second = std::move(pA);
+  return it->second.get();
+}
+
 DxilFunctionAnnotation *DxilTypeSystem::AddFunctionAnnotation(const Function *pFunction) {
   DXASSERT_NOMSG(m_FunctionAnnotations.find(pFunction) == m_FunctionAnnotations.end());
   DxilFunctionAnnotation *pA = new DxilFunctionAnnotation();
@@ -457,6 +457,7 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   // AssemblyCodeHex not supported (Fx)
   // OutputLibrary not supported (Fl)
   opts.AssemblyCode = Args.getLastArgValue(OPT_Fc);
+  opts.AssemblyFunction = Args.getLastArgValue(OPT_Fc_function);
   opts.DebugFile = Args.getLastArgValue(OPT_Fd);
   opts.ExtractPrivateFile = Args.getLastArgValue(OPT_getprivate);
   opts.Enable16BitTypes = Args.hasFlag(OPT_enable_16bit_types, OPT_INVALID, false);
@@ -472,8 +473,13 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.UseInstructionByteOffsets = Args.hasFlag(OPT_No, OPT_INVALID, false);
   opts.UseHexLiterals = Args.hasFlag(OPT_Lx, OPT_INVALID, false);
   opts.Preprocess = Args.getLastArgValue(OPT_P);
+  opts.ScanDependencies = Args.hasFlag(OPT_M, OPT_INVALID, false);
+  opts.WriteDependencies = Args.hasFlag(OPT_MD, OPT_INVALID, false);
+  opts.DependencyFile = Args.getLastArgValue(OPT_MF);
+  opts.DependenciesAsJson = Args.hasFlag(OPT_Mjson, OPT_INVALID, false);
   opts.AstDump = Args.hasFlag(OPT_ast_dump, OPT_INVALID, false);
   opts.CodeGenHighLevel = Args.hasFlag(OPT_fcgl, OPT_INVALID, false);
+  opts.CodeGenDxilSnapshot = Args.hasFlag(OPT_fsnapshot_dxil, OPT_INVALID, false);
   opts.AllowPreserveValues = Args.hasFlag(OPT_preserve_intermediate_values, OPT_INVALID, false);
   opts.DebugInfo = Args.hasFlag(OPT__SLASH_Zi, OPT_INVALID, false);
   opts.DebugNameForBinary = Args.hasFlag(OPT_Zsb, OPT_INVALID, false);
@@ -548,6 +554,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   }
 
   opts.Exports = Args.getAllArgValues(OPT_exports);
+  opts.LibCacheIncludes = Args.getAllArgValues(OPT_lib_cache_include);
+  opts.LibCacheDir = Args.getLastArgValue(OPT_lib_cache_dir);
 
   opts.DefaultLinkage = Args.getLastArgValue(OPT_default_linkage);
   if (!opts.DefaultLinkage.empty()) {
@@ -559,6 +567,17 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     }
   }
 
+  llvm::StringRef memoryBudget = Args.getLastArgValue(OPT_memory_budget);
+  if (!memoryBudget.empty() && memoryBudget.getAsInteger(10, opts.MemoryBudget)) {
+    errors << "Unsupported value '" << memoryBudget << "' for memory budget.";
+    return 1;
+  }
+  llvm::StringRef timeBudget = Args.getLastArgValue(OPT_time_budget);
+  if (!timeBudget.empty() && timeBudget.getAsInteger(10, opts.TimeBudget)) {
+    errors << "Unsupported value '" << timeBudget << "' for time budget.";
+    return 1;
+  }
+
   // Check options only allowed in shader model >= 6.2FPDenormalMode
   unsigned Major = 0;
   unsigned Minor = 0;
@@ -625,6 +644,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.RecompileFromBinary = Args.hasFlag(OPT_recompile, OPT_INVALID, false);
   opts.StripDebug = Args.hasFlag(OPT_Qstrip_debug, OPT_INVALID, false);
   opts.EmbedDebug = Args.hasFlag(OPT_Qembed_debug, OPT_INVALID, false);
+  opts.FunctionIndex = Args.hasFlag(OPT_Qfunction_index, OPT_INVALID, false);
+  opts.ParallelBitcode = Args.hasFlag(OPT_Qparallel_bitcode, OPT_INVALID, false);
   opts.StripRootSignature = Args.hasFlag(OPT_Qstrip_rootsignature, OPT_INVALID, false);
   opts.StripPrivate = Args.hasFlag(OPT_Qstrip_priv, OPT_INVALID, false);
   opts.StripReflection = Args.hasFlag(OPT_Qstrip_reflect, OPT_INVALID, false);
@@ -690,13 +711,28 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     errors << "Warning: compiler options ignored with Preprocess.";
   }
 
+  if (opts.ScanDependencies && !opts.Preprocess.empty()) {
+    errors << "Cannot specify both -M and -P.";
+    return 1;
+  }
+  if (opts.WriteDependencies && opts.DependencyFile.empty()) {
+    errors << "-MD requires a dependency file to be specified with -MF.";
+    return 1;
+  }
+  if (!opts.DependencyFile.empty() && !opts.ScanDependencies &&
+      !opts.WriteDependencies) {
+    errors << "-MF requires -M or -MD.";
+    return 1;
+  }
+
   if (opts.DumpBin) {
     if (opts.DisplayIncludeProcess || opts.AstDump) {
       errors << "Cannot perform actions related to sources from a binary file.";
       return 1;
     }
     if (opts.AllResourcesBound || opts.AvoidFlowControl ||
-        opts.CodeGenHighLevel || opts.DebugInfo || opts.DefaultColMajor ||
+        opts.CodeGenHighLevel || opts.CodeGenDxilSnapshot ||
+        opts.DebugInfo || opts.DefaultColMajor ||
         opts.DefaultRowMajor || opts.Defines.size() != 0 ||
         opts.DisableOptimizations ||
         !opts.EntryPoint.empty() || !opts.ForceRootSigVer.empty() ||
@@ -709,7 +745,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   // XXX TODO: Sort this out, since it's required for new API, but a separate argument for old APIs.
   if ((flagsToInclude & hlsl::options::DriverOption) &&
       !(flagsToInclude & hlsl::options::RewriteOption) &&
-      opts.TargetProfile.empty() && !opts.DumpBin && opts.Preprocess.empty() && !opts.RecompileFromBinary
+      opts.TargetProfile.empty() && !opts.DumpBin && opts.Preprocess.empty() && !opts.RecompileFromBinary &&
+      !opts.ScanDependencies
       ) {
     // Target profile is required in arguments only for drivers when compiling;
     // APIs take this through an argument.
@@ -778,6 +815,24 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     return 1;
   }
 
+  if (opts.CodeGenHighLevel && opts.CodeGenDxilSnapshot) {
+    errors << "-fcgl mutually exclusive with -fsnapshot-dxil.";
+    return 1;
+  }
+
+  if (!opts.LibCacheIncludes.empty()) {
+    if (opts.DebugInfo || opts.CodeGenHighLevel || opts.CodeGenDxilSnapshot ||
+        opts.AstDump || opts.OptDump ||
+        Args.hasFlag(OPT_spirv, OPT_INVALID, false)) {
+      errors << "-lib-cache-include cannot be used with -Zi, -fcgl, "
+                "-fsnapshot-dxil, -ast-dump, -Odump or -spirv.";
+      return 1;
+    }
+  } else if (!opts.LibCacheDir.empty()) {
+    errors << "-lib-cache-dir requires -lib-cache-include.";
+    return 1;
+  }
+
   addDiagnosticArgs(Args, OPT_W_Group, OPT_W_value_Group, opts.Warnings);
 
 
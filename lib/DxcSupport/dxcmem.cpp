@@ -17,7 +17,13 @@
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/Support/WinFunctions.h"
 #include "llvm/Support/ThreadLocal.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 static llvm::sys::ThreadLocal<IMalloc> *g_ThreadMallocTls;
 static IMalloc *g_pDefaultMalloc;
@@ -91,3 +97,75 @@ DxcThreadMalloc::DxcThreadMalloc(IMalloc *pMallocOrNull) throw() {
 DxcThreadMalloc::~DxcThreadMalloc() {
     DxcSwapThreadMalloc(pPrior, nullptr);
 }
+
+// Helper threads running DxcParallelFor tasks, summed over all callers. The
+// callers' own threads are not counted.
+static std::atomic<unsigned> g_ParallelForHelpers(0);
+
+// Reserves up to Wanted helpers without going over Limit in total, and returns
+// how many were reserved.
+static unsigned AcquireParallelForHelpers(unsigned Wanted, unsigned Limit) {
+  unsigned Current = g_ParallelForHelpers.load();
+  unsigned Taken;
+  do {
+    if (Current >= Limit)
+      return 0;
+    Taken = std::min(Wanted, Limit - Current);
+  } while (!g_ParallelForHelpers.compare_exchange_weak(Current,
+                                                       Current + Taken));
+  return Taken;
+}
+
+void DxcParallelFor(unsigned Count, const std::function<void(unsigned)> &Task) {
+  // A caller-supplied allocator need not be thread-safe, so the tasks are
+  // only spread over other threads while the default one is installed.
+  IMalloc *pMalloc = g_ThreadMallocTls ? DxcGetThreadMallocNoRef() : nullptr;
+  unsigned HelperCount = 0;
+  if (Count > 1 && (pMalloc == nullptr || pMalloc == g_pDefaultMalloc)) {
+    unsigned Limit = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    HelperCount = AcquireParallelForHelpers(Count - 1, Limit);
+  }
+  if (HelperCount == 0) {
+    for (unsigned i = 0; i < Count; ++i)
+      Task(i);
+    return;
+  }
+
+  std::atomic<unsigned> Next(0);
+  std::mutex ErrorMutex;
+  std::exception_ptr Error;
+  auto RunTasks = [&]() {
+    for (unsigned i = Next++; i < Count; i = Next++) {
+      try {
+        Task(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> Lock(ErrorMutex);
+        if (!Error)
+          Error = std::current_exception();
+        Next = Count;
+      }
+    }
+  };
+
+  // Workers keep the caller's allocator installed until they exit, as the
+  // thread's own state is released on the worker.
+  std::vector<std::thread> Workers;
+  try {
+    Workers.reserve(HelperCount);
+    for (unsigned i = 0; i < HelperCount; ++i)
+      Workers.emplace_back([&, pMalloc]() {
+        if (g_ThreadMallocTls)
+          DxcSwapThreadMalloc(pMalloc, nullptr);
+        RunTasks();
+      });
+  } catch (...) {
+    // Run whatever the workers that did start leave over.
+  }
+  RunTasks();
+  for (std::thread &Worker : Workers)
+    Worker.join();
+  g_ParallelForHelpers -= HelperCount;
+
+  if (Error)
+    std::rethrow_exception(Error);
+}
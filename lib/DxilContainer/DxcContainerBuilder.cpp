@@ -13,6 +13,7 @@
 #include "dxc/dxcapi.h"
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/DxilContainer/DxcContainerBuilder.h"
+#include "dxc/DxilContainer/DxilContainerAssembler.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/ErrorCodes.h"
 #include "dxc/Support/FileIOHelper.h"
@@ -36,8 +37,18 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::Load(_In_ IDxcBlob *pSource) {
       IsDxilContainerLike(pSource->GetBufferPointer(),
         pSource->GetBufferSize()),
       E_INVALIDARG);
-    m_pContainer = pSource;
     const DxilContainerHeader *pHeader = (DxilContainerHeader *)pSource->GetBufferPointer();
+    if (IsValidDxilContainer(pHeader, pSource->GetBufferSize()) &&
+        IsCompressedDxilContainer(pHeader)) {
+      // Parts below are pinned to the container, so keep the expanded copy.
+      std::vector<char> expanded;
+      IFTBOOL(DecompressDxilContainer(pHeader, expanded), DXC_E_CONTAINER_INVALID);
+      CComPtr<IDxcBlob> pExpanded;
+      IFT(DxcCreateBlobOnHeapCopy(expanded.data(), (uint32_t)expanded.size(), &pExpanded));
+      pSource = pExpanded;
+      pHeader = (DxilContainerHeader *)pSource->GetBufferPointer();
+    }
+    m_pContainer = pSource;
     for (DxilPartIterator it = begin(pHeader), itEnd = end(pHeader); it != itEnd; ++it) {
       const DxilPartHeader *pPartHeader = *it;
       CComPtr<IDxcBlobEncoding> pBlob;
@@ -72,6 +83,7 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::AddPart(_In_ UINT32 fourCC, _In_
     });
     IFTBOOL(it == m_parts.end(), DXC_E_DUPLICATE_PART);
     m_parts.emplace_back(DxilPart(fourCC, pSource));
+    m_Modified = true;
     if (fourCC == DxilFourCC::DFCC_RootSignature) {
       m_RequireValidation = true;
     }
@@ -94,6 +106,7 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::RemovePart(_In_ UINT32 fourCC) {
         [&](DxilPart part) { return part.m_fourCC == fourCC; });
     IFTBOOL(it != m_parts.end(), DXC_E_MISSING_PART);
     m_parts.erase(it);
+    m_Modified = true;
     return S_OK;
   }
   CATCH_CPP_RETURN_HRESULT();
@@ -134,6 +147,15 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::SerializeContainer(_Out_ IDxcOper
           IFT(hlsl::DxcGetBlobAsUtf8(pValError, m_pMalloc, &pValErrorUtf8));
       }
     }
+    if (m_MinCompressedPartSize != 0 && SUCCEEDED(valHR)) {
+      // An unmodified container is compressed as loaded, which keeps its hash
+      // valid once it is expanded again.
+      CComPtr<IDxcBlob> pCompressed;
+      IFT(CompressContainer(m_pContainer && !m_Modified ? m_pContainer : pResult,
+                            &pCompressed));
+      pResult = pCompressed;
+    }
+
     // Combine existing warnings and errors from validation
     CComPtr<IDxcBlobEncoding> pErrorBlob;
     CDxcMallocHeapPtr<char> errorHeap(m_pMalloc);
@@ -165,6 +187,23 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::SerializeContainer(_Out_ IDxcOper
   CATCH_CPP_RETURN_HRESULT();
 }
 
+HRESULT STDMETHODCALLTYPE DxcContainerBuilder::SetPartCompression(_In_ UINT32 MinPartSize) {
+  m_MinCompressedPartSize = MinPartSize;
+  return S_OK;
+}
+
+HRESULT DxcContainerBuilder::CompressContainer(IDxcBlob *pContainer, IDxcBlob **ppResult) {
+  const DxilContainerHeader *pHeader = (const DxilContainerHeader *)pContainer->GetBufferPointer();
+  std::vector<char> compressed;
+  if (!CompressDxilContainer(pHeader, m_MinCompressedPartSize, compressed)) {
+    // Nothing got smaller or the codec is not available; keep the original.
+    *ppResult = pContainer;
+    pContainer->AddRef();
+    return S_OK;
+  }
+  return DxcCreateBlobOnHeapCopy(compressed.data(), (uint32_t)compressed.size(), ppResult);
+}
+
 UINT32 DxcContainerBuilder::ComputeContainerSize() {
   UINT32 partsSize = 0;
   for (DxilPart part : m_parts) {
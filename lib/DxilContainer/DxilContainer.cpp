@@ -10,6 +10,9 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/DxilContainer/DxilContainer.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compression.h"
 #include <algorithm>
 
 namespace hlsl {
@@ -88,6 +91,82 @@ bool IsValidDxilContainer(const DxilContainerHeader *pHeader, size_t length) {
   return true;
 }
 
+bool IsCompressedDxilContainer(const DxilContainerHeader *pHeader) {
+  return std::any_of(begin(pHeader), end(pHeader),
+                     DxilPartIsType(DFCC_CompressedPart));
+}
+
+bool DecompressDxilContainer(const DxilContainerHeader *pHeader,
+                             std::vector<char> &Result) {
+  Result.clear();
+
+  // Compute the expanded size first so the result is allocated once.
+  uint64_t partsSize = 0;
+  for (DxilPartIterator it = begin(pHeader), E = end(pHeader); it != E; ++it) {
+    const DxilPartHeader *pPart = *it;
+    if (pPart->PartFourCC != DFCC_CompressedPart) {
+      partsSize += pPart->PartSize;
+      continue;
+    }
+    if (pPart->PartSize < sizeof(DxilCompressedPartHeader))
+      return false;
+    const DxilCompressedPartHeader *pCompressed =
+        reinterpret_cast<const DxilCompressedPartHeader *>(
+            GetDxilPartData(pPart));
+    if (pCompressed->Codec != (uint32_t)DxilCompressionCodec::Zlib ||
+        pCompressed->CompressedSize >
+            pPart->PartSize - sizeof(DxilCompressedPartHeader))
+      return false;
+    partsSize += pCompressed->UncompressedSize;
+  }
+  uint64_t containerSize =
+      sizeof(DxilContainerHeader) + GetOffsetTableSize(pHeader->PartCount) +
+      sizeof(DxilPartHeader) * (uint64_t)pHeader->PartCount + partsSize;
+  if (containerSize > DxilContainerMaxSize)
+    return false;
+
+  Result.resize((size_t)containerSize);
+  DxilContainerHeader *pNewHeader =
+      reinterpret_cast<DxilContainerHeader *>(Result.data());
+  *pNewHeader = *pHeader;
+  pNewHeader->ContainerSizeInBytes = (uint32_t)containerSize;
+
+  uint32_t *pOffsets = reinterpret_cast<uint32_t *>(pNewHeader + 1);
+  uint32_t offset = sizeof(DxilContainerHeader) +
+                    GetOffsetTableSize(pHeader->PartCount);
+  llvm::SmallVector<char, 0> uncompressed;
+  for (uint32_t i = 0; i < pHeader->PartCount; ++i) {
+    const DxilPartHeader *pPart = GetDxilContainerPart(pHeader, i);
+    DxilPartHeader *pNewPart =
+        reinterpret_cast<DxilPartHeader *>(Result.data() + offset);
+    pOffsets[i] = offset;
+
+    if (pPart->PartFourCC != DFCC_CompressedPart) {
+      memcpy(pNewPart, pPart, sizeof(DxilPartHeader) + pPart->PartSize);
+    } else {
+      const DxilCompressedPartHeader *pCompressed =
+          reinterpret_cast<const DxilCompressedPartHeader *>(
+              GetDxilPartData(pPart));
+      llvm::StringRef compressedData(
+          reinterpret_cast<const char *>(pCompressed + 1),
+          pCompressed->CompressedSize);
+      if (llvm::zlib::uncompress(compressedData, uncompressed,
+                                 pCompressed->UncompressedSize) !=
+              llvm::zlib::StatusOK ||
+          uncompressed.size() != pCompressed->UncompressedSize) {
+        Result.clear();
+        return false;
+      }
+      pNewPart->PartFourCC = pCompressed->PartFourCC;
+      pNewPart->PartSize = pCompressed->UncompressedSize;
+      memcpy(GetDxilPartData(pNewPart), uncompressed.data(),
+             uncompressed.size());
+    }
+    offset += sizeof(DxilPartHeader) + pNewPart->PartSize;
+  }
+  return true;
+}
+
 const DxilPartHeader *GetDxilPartByType(const DxilContainerHeader *pHeader, DxilFourCC fourCC) {
   if (!IsDxilContainerLike(pHeader, pHeader->ContainerSizeInBytes)) {
     return nullptr;
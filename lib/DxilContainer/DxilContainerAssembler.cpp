@@ -15,6 +15,7 @@
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/MD5.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Transforms/Utils/Cloning.h"
@@ -1482,6 +1483,92 @@ DxilContainerWriter *hlsl::NewDxilContainerWriter() {
   return new DxilContainerWriter_impl();
 }
 
+bool hlsl::CompressDxilContainer(const DxilContainerHeader *pHeader,
+                                 uint32_t MinPartSize,
+                                 std::vector<char> &Result) {
+  Result.clear();
+  if (!llvm::zlib::isAvailable())
+    return false;
+
+  // Only containers laid out the way the writers above lay them out can be
+  // reproduced exactly by DecompressDxilContainer.
+  uint32_t offset = sizeof(DxilContainerHeader) +
+                    (uint32_t)GetOffsetTableSize(pHeader->PartCount);
+  const uint32_t *pOffsets = reinterpret_cast<const uint32_t *>(pHeader + 1);
+  for (uint32_t i = 0; i < pHeader->PartCount; ++i) {
+    if (pOffsets[i] != offset)
+      return false;
+    const DxilPartHeader *pPart = GetDxilContainerPart(pHeader, i);
+    if (pPart->PartFourCC == DFCC_CompressedPart)
+      return false;
+    offset += sizeof(DxilPartHeader) + pPart->PartSize;
+  }
+  if (offset != pHeader->ContainerSizeInBytes)
+    return false;
+
+  // Compress large parts, keeping the result only where it is smaller.
+  std::vector<llvm::SmallVector<char, 0>> compressed(pHeader->PartCount);
+  uint32_t partsSize = 0;
+  bool compressedAny = false;
+  for (uint32_t i = 0; i < pHeader->PartCount; ++i) {
+    const DxilPartHeader *pPart = GetDxilContainerPart(pHeader, i);
+    uint32_t partSize = pPart->PartSize;
+    if (partSize >= MinPartSize) {
+      llvm::StringRef data(GetDxilPartData(pPart), pPart->PartSize);
+      if (llvm::zlib::compress(data, compressed[i],
+                               llvm::zlib::BestSpeedCompression) ==
+              llvm::zlib::StatusOK &&
+          sizeof(DxilCompressedPartHeader) +
+                  PSVALIGN4(compressed[i].size()) < partSize) {
+        partSize = sizeof(DxilCompressedPartHeader) +
+                   PSVALIGN4(compressed[i].size());
+        compressedAny = true;
+      } else {
+        compressed[i].clear();
+      }
+    }
+    partsSize += partSize;
+  }
+  if (!compressedAny)
+    return false;
+
+  uint32_t containerSize = (uint32_t)GetDxilContainerSizeFromParts(
+      pHeader->PartCount, partsSize);
+  Result.resize(containerSize);
+  DxilContainerHeader *pNewHeader =
+      reinterpret_cast<DxilContainerHeader *>(Result.data());
+  // The hash and version are kept so the expanded container is unchanged.
+  *pNewHeader = *pHeader;
+  pNewHeader->ContainerSizeInBytes = containerSize;
+
+  uint32_t *pNewOffsets = reinterpret_cast<uint32_t *>(pNewHeader + 1);
+  offset = sizeof(DxilContainerHeader) +
+           (uint32_t)GetOffsetTableSize(pHeader->PartCount);
+  for (uint32_t i = 0; i < pHeader->PartCount; ++i) {
+    const DxilPartHeader *pPart = GetDxilContainerPart(pHeader, i);
+    DxilPartHeader *pNewPart =
+        reinterpret_cast<DxilPartHeader *>(Result.data() + offset);
+    pNewOffsets[i] = offset;
+    if (compressed[i].empty()) {
+      memcpy(pNewPart, pPart, sizeof(DxilPartHeader) + pPart->PartSize);
+    } else {
+      pNewPart->PartFourCC = DFCC_CompressedPart;
+      pNewPart->PartSize = sizeof(DxilCompressedPartHeader) +
+                           PSVALIGN4(compressed[i].size());
+      DxilCompressedPartHeader *pCompressed =
+          reinterpret_cast<DxilCompressedPartHeader *>(
+              GetDxilPartData(pNewPart));
+      pCompressed->PartFourCC = pPart->PartFourCC;
+      pCompressed->UncompressedSize = pPart->PartSize;
+      pCompressed->CompressedSize = (uint32_t)compressed[i].size();
+      pCompressed->Codec = (uint32_t)DxilCompressionCodec::Zlib;
+      memcpy(pCompressed + 1, compressed[i].data(), compressed[i].size());
+    }
+    offset += sizeof(DxilPartHeader) + pNewPart->PartSize;
+  }
+  return true;
+}
+
 static bool HasDebugInfo(const Module &M) {
   for (Module::const_named_metadata_iterator NMI = M.named_metadata_begin(),
                                              NME = M.named_metadata_end();
@@ -1661,13 +1748,17 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
     }
   }
 
+  BitcodeParallelFor ParallelFor;
+  if (Flags & SerializeDxilFlags::ParallelBitcode)
+    ParallelFor = DxcParallelFor;
+
   // If metadata was stripped, re-serialize the input module.
   CComPtr<AbstractMemoryStream> pInputProgramStream = pModuleBitcode;
   if (bMetadataStripped) {
     pInputProgramStream.Release();
     IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pInputProgramStream));
     raw_stream_ostream outStream(pInputProgramStream.p);
-    WriteBitcodeToFile(pModule->GetModule(), outStream, true);
+    WriteBitcodeToFile(pModule->GetModule(), outStream, true, ParallelFor);
   }
 
   // If we have debug information present, serialize it to a debug part, then use the stripped version as the canonical program version.
@@ -1764,7 +1855,7 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
     pProgramStream.Release();
     IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pProgramStream));
     raw_stream_ostream outStream(pProgramStream.p);
-    WriteBitcodeToFile(pModule->GetModule(), outStream, false);
+    WriteBitcodeToFile(pModule->GetModule(), outStream, false, ParallelFor);
   }
 
   // Compute hash if needed.
@@ -1835,6 +1926,37 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
     memcpy(pShaderHashOut, &HashContent, sizeof(DxilShaderHash));
   }
 
+  // Index the function bodies of libraries so that linkers can load them
+  // on demand.
+  std::vector<uint64_t> FunctionBodyBits;
+  if ((Flags & SerializeDxilFlags::IncludeFunctionIndexPart) &&
+      pModule->GetShaderModel()->IsLib() &&
+      getBitcodeFunctionBodyBits(
+          MemoryBufferRef(StringRef((const char *)pProgramStream->GetPtr(),
+                                    pProgramStream->GetPtrSize()),
+                          ""),
+          FunctionBodyBits)) {
+    DxilFunctionIndexHeader IndexHeader;
+    IndexHeader.BitcodeSize = pProgramStream->GetPtrSize();
+    IndexHeader.FunctionCount = FunctionBodyBits.size();
+    llvm::MD5 md5;
+    md5.update(ArrayRef<uint8_t>(pProgramStream->GetPtr(),
+                                 pProgramStream->GetPtrSize()));
+    md5.final(IndexHeader.BitcodeDigest);
+    writer.AddPart(DFCC_FunctionIndex,
+                   sizeof(IndexHeader) +
+                       FunctionBodyBits.size() * sizeof(uint64_t),
+      [IndexHeader, &FunctionBodyBits]
+      (AbstractMemoryStream *pStream)
+    {
+      IFT(WriteStreamValue(pStream, IndexHeader));
+      ULONG cbWritten;
+      IFT(pStream->Write(FunctionBodyBits.data(),
+                         FunctionBodyBits.size() * sizeof(uint64_t),
+                         &cbWritten));
+    });
+  }
+
   // Compute padded bitcode size.
   uint32_t programInUInt32, programPaddingBytes;
   GetPaddedProgramPartSize(pProgramStream, programInUInt32, programPaddingBytes);
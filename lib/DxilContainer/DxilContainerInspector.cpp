@@ -0,0 +1,230 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilContainerInspector.cpp                                                //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Extracts reflection tables from many DXIL containers at once.             //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/DxilContainer/DxilContainerInspector.h"
+#include "dxc/DxilContainer/DxilPipelineStateValidation.h"
+#include "dxc/DxilContainer/DxilRuntimeReflection.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Containers handed to each task; small enough to balance a batch of
+// differently sized containers, large enough to amortize the merge.
+const size_t kContainersPerTask = 64;
+
+void InspectSignature(uint32_t Index, const DxilContainerHeader *pHeader,
+                      DxilFourCC FourCC, DxilContainerInspection &Rows) {
+  const DxilPartHeader *pPart = GetDxilPartByType(pHeader, FourCC);
+  if (!pPart || pPart->PartSize < sizeof(DxilProgramSignature))
+    return;
+  const char *pData = GetDxilPartData(pPart);
+  uint32_t Size = pPart->PartSize;
+  const DxilProgramSignature *pSig =
+      reinterpret_cast<const DxilProgramSignature *>(pData);
+  if (pSig->ParamOffset > Size ||
+      (Size - pSig->ParamOffset) / sizeof(DxilProgramSignatureElement) <
+          pSig->ParamCount)
+    return;
+
+  const DxilProgramSignatureElement *pElements =
+      reinterpret_cast<const DxilProgramSignatureElement *>(pData +
+                                                            pSig->ParamOffset);
+  for (uint32_t i = 0; i < pSig->ParamCount; ++i) {
+    const DxilProgramSignatureElement &E = pElements[i];
+    const char *SemanticName = "";
+    if (E.SemanticName < Size &&
+        memchr(pData + E.SemanticName, 0, Size - E.SemanticName))
+      SemanticName = pData + E.SemanticName;
+
+    DxilInspectedSignatureElement Row;
+    Row.Container = Index;
+    Row.Signature = FourCC;
+    Row.SemanticName = SemanticName;
+    Row.SemanticIndex = E.SemanticIndex;
+    Row.Stream = E.Stream;
+    Row.Register = E.Register;
+    Row.SystemValue = E.SystemValue;
+    Row.CompType = E.CompType;
+    Row.MinPrecision = E.MinPrecision;
+    Row.Mask = E.Mask;
+    Row.NeverWritesOrAlwaysReadsMask = E.NeverWrites_Mask;
+    Rows.SignatureElements.push_back(Row);
+  }
+}
+
+void InspectPSV(uint32_t Index, const DxilContainerHeader *pHeader,
+                DxilInspectedContainer &C, DxilContainerInspection &Rows) {
+  const DxilPartHeader *pPart =
+      GetDxilPartByType(pHeader, DFCC_PipelineStateValidation);
+  if (!pPart)
+    return;
+  DxilPipelineStateValidation PSV;
+  if (!PSV.InitFromPSV0(GetDxilPartData(pPart), pPart->PartSize))
+    return;
+
+  if (const PSVRuntimeInfo1 *pInfo1 = PSV.GetPSVRuntimeInfo1())
+    if (pInfo1->ShaderStage < (uint8_t)PSVShaderKind::Invalid)
+      C.ShaderKind = (DXIL::ShaderKind)pInfo1->ShaderStage;
+
+  for (uint32_t i = 0; i < PSV.GetBindCount(); ++i) {
+    const PSVResourceBindInfo0 *pBind = PSV.GetPSVResourceBindInfo0(i);
+    DxilInspectedResource Row;
+    Row.Container = Index;
+    Row.ResType = pBind->ResType;
+    Row.Space = pBind->Space;
+    Row.LowerBound = pBind->LowerBound;
+    Row.UpperBound = pBind->UpperBound;
+    Rows.Resources.push_back(Row);
+  }
+}
+
+void InspectRDAT(uint32_t Index, const DxilContainerHeader *pHeader,
+                 DxilContainerInspection &Rows) {
+  const DxilPartHeader *pPart = GetDxilPartByType(pHeader, DFCC_RuntimeData);
+  if (!pPart)
+    return;
+  RDAT::DxilRuntimeData RDAT;
+  if (!RDAT.InitFromRDAT(GetDxilPartData(pPart), pPart->PartSize))
+    return;
+
+  RDAT::FunctionTableReader *pFunctions = RDAT.GetFunctionTableReader();
+  for (uint32_t i = 0; i < pFunctions->GetNumFunctions(); ++i) {
+    RDAT::FunctionReader F = pFunctions->GetItem(i);
+    DxilInspectedFunction Row;
+    Row.Container = Index;
+    Row.Name = F.GetName();
+    Row.UnmangledName = F.GetUnmangledName();
+    Row.ShaderKind = F.GetShaderKind();
+    Row.ShaderStageFlag = F.GetShaderStageFlag();
+    Row.MinShaderTarget = F.GetMinShaderTarget();
+    Row.FeatureFlags = F.GetFeatureFlag();
+    Row.ResourceCount = F.GetNumResources();
+    Row.PayloadSizeInBytes = F.GetPayloadSizeInBytes();
+    Row.AttributeSizeInBytes = F.GetAttributeSizeInBytes();
+    Rows.Functions.push_back(Row);
+  }
+}
+
+void InspectContainer(uint32_t Index, const DxilContainerView &View,
+                      DxilInspectedContainer &C,
+                      DxilContainerInspection &Rows) {
+  memset(&C, 0, sizeof(C));
+  C.ShaderKind = DXIL::ShaderKind::Invalid;
+  C.FirstResource = Rows.Resources.size();
+  C.FirstSignatureElement = Rows.SignatureElements.size();
+  C.FirstFunction = Rows.Functions.size();
+
+  const DxilContainerHeader *pHeader =
+      IsDxilContainerLike(View.pData, View.Size);
+  if (!pHeader || !IsValidDxilContainer(pHeader, View.Size))
+    return;
+  if (IsCompressedDxilContainer(pHeader)) {
+    std::unique_ptr<std::vector<char>> pExpanded(new std::vector<char>());
+    if (!DecompressDxilContainer(pHeader, *pExpanded))
+      return;
+    pHeader = reinterpret_cast<const DxilContainerHeader *>(pExpanded->data());
+    Rows.ExpandedContainers.emplace_back(std::move(pExpanded));
+  }
+
+  C.Valid = true;
+  C.PartCount = pHeader->PartCount;
+  if (const DxilProgramHeader *pProgram =
+          GetDxilProgramHeader(pHeader, DFCC_DXIL))
+    C.ProgramVersion = pProgram->ProgramVersion;
+
+  const DxilPartHeader *pPart = GetDxilPartByType(pHeader, DFCC_FeatureInfo);
+  if (pPart && pPart->PartSize >= sizeof(DxilShaderFeatureInfo)) {
+    DxilShaderFeatureInfo Info;
+    memcpy(&Info, GetDxilPartData(pPart), sizeof(Info));
+    C.HasShaderFlags = true;
+    C.ShaderFlags = Info.FeatureFlags;
+  }
+  pPart = GetDxilPartByType(pHeader, DFCC_ShaderHash);
+  if (pPart && pPart->PartSize >= sizeof(DxilShaderHash)) {
+    memcpy(&C.Hash, GetDxilPartData(pPart), sizeof(C.Hash));
+    C.HasHash = true;
+  }
+
+  InspectPSV(Index, pHeader, C, Rows);
+  InspectSignature(Index, pHeader, DFCC_InputSignature, Rows);
+  InspectSignature(Index, pHeader, DFCC_OutputSignature, Rows);
+  InspectSignature(Index, pHeader, DFCC_PatchConstantSignature, Rows);
+  InspectRDAT(Index, pHeader, Rows);
+
+  C.ResourceCount = Rows.Resources.size() - C.FirstResource;
+  C.SignatureElementCount =
+      Rows.SignatureElements.size() - C.FirstSignatureElement;
+  C.FunctionCount = Rows.Functions.size() - C.FirstFunction;
+}
+
+template <typename T>
+void AppendRows(std::vector<T> &Result, const std::vector<T> &Rows) {
+  Result.insert(Result.end(), Rows.begin(), Rows.end());
+}
+
+} // namespace
+
+void hlsl::InspectDxilContainers(ArrayRef<DxilContainerView> Containers,
+                                 DxilContainerInspection &Result) {
+  Result = DxilContainerInspection();
+  Result.Containers.resize(Containers.size());
+
+  // Each task fills rows of its own, indexed from zero; they are
+  // concatenated in container order afterwards, so the result does not
+  // depend on scheduling.
+  size_t TaskCount =
+      (Containers.size() + kContainersPerTask - 1) / kContainersPerTask;
+  std::vector<DxilContainerInspection> TaskRows(TaskCount);
+  DxcParallelFor((unsigned)TaskCount, [&](unsigned Task) {
+    size_t Begin = Task * kContainersPerTask;
+    size_t End = std::min(Begin + kContainersPerTask, Containers.size());
+    for (size_t i = Begin; i < End; ++i)
+      InspectContainer((uint32_t)i, Containers[i], Result.Containers[i],
+                       TaskRows[Task]);
+  });
+
+  size_t ResourceCount = 0, SignatureElementCount = 0, FunctionCount = 0;
+  for (const DxilContainerInspection &Rows : TaskRows) {
+    ResourceCount += Rows.Resources.size();
+    SignatureElementCount += Rows.SignatureElements.size();
+    FunctionCount += Rows.Functions.size();
+  }
+  Result.Resources.reserve(ResourceCount);
+  Result.SignatureElements.reserve(SignatureElementCount);
+  Result.Functions.reserve(FunctionCount);
+
+  for (size_t Task = 0; Task < TaskCount; ++Task) {
+    DxilContainerInspection &Rows = TaskRows[Task];
+    uint32_t ResourceBase = Result.Resources.size();
+    uint32_t SignatureElementBase = Result.SignatureElements.size();
+    uint32_t FunctionBase = Result.Functions.size();
+    size_t Begin = Task * kContainersPerTask;
+    size_t End = std::min(Begin + kContainersPerTask, Containers.size());
+    for (size_t i = Begin; i < End; ++i) {
+      DxilInspectedContainer &C = Result.Containers[i];
+      C.FirstResource += ResourceBase;
+      C.FirstSignatureElement += SignatureElementBase;
+      C.FirstFunction += FunctionBase;
+    }
+    AppendRows(Result.Resources, Rows.Resources);
+    AppendRows(Result.SignatureElements, Rows.SignatureElements);
+    AppendRows(Result.Functions, Rows.Functions);
+    for (auto &pExpanded : Rows.ExpandedContainers)
+      Result.ExpandedContainers.emplace_back(std::move(pExpanded));
+  }
+}
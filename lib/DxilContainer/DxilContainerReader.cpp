@@ -28,6 +28,14 @@ HRESULT DxilContainerReader::Load(_In_ const void* pContainer, _In_ uint32_t con
   if (!IsValidDxilContainer(pHeader, containerSizeInBytes)) {
     return E_FAIL;
   }
+  if (IsCompressedDxilContainer(pHeader)) {
+    if (!DecompressDxilContainer(pHeader, m_Decompressed)) {
+      return E_FAIL;
+    }
+    pContainer = m_Decompressed.data();
+    containerSizeInBytes = (uint32_t)m_Decompressed.size();
+    pHeader = reinterpret_cast<const DxilContainerHeader *>(pContainer);
+  }
 
   m_pContainer = pContainer;
   m_uContainerSize = containerSizeInBytes;
@@ -12,6 +12,7 @@
 #include "dxc/DXIL/DxilModule.h"
 #include "dxc/DXIL/DxilOperations.h"
 #include "dxc/DXIL/DxilUtil.h"
+#include "dxc/DxilPIXPasses/DxilPIXCompactTrace.h"
 #include "dxc/DxilPIXPasses/DxilPIXPasses.h"
 #include "dxc/DxilPIXPasses/DxilPIXVirtualRegisters.h"
 #include "dxc/HLSL/DxilGenerationPass.h"
@@ -83,6 +84,13 @@ using namespace hlsl;
 // overwritten, the debug session is deemed to have overflowed the UAV. The
 // caller will than allocate a UAV that is twice the size and try again, up to a
 // predefined maximum.
+//
+// With the "compact" option, step records are written only for values that
+// cannot be recomputed from earlier ones (see DxilPIXCompactTrace.h). Each
+// basic block instead writes a record of its ordinal on entry, and phis are
+// only given edge blocks if their incoming values cannot be recomputed. The
+// caller expands the trace with PixCompactTrace::ExpandToStepTrace into the
+// records the full instrumentation would have written.
 
 // Keep these in sync with the same-named value in the debugger application's
 // WinPixShaderUtils.h
@@ -104,6 +112,8 @@ enum DebugShaderModifierRecordType {
   DebugShaderModifierRecordTypeRegisterRelativeIndex0,
   DebugShaderModifierRecordTypeRegisterRelativeIndex1,
   DebugShaderModifierRecordTypeRegisterRelativeIndex2,
+  DebugShaderModifierRecordTypeDXILBlock =
+      pix_dxil::PixCompactTrace::BlockRecordType,
   DebugShaderModifierRecordTypeDXILStepVoid = 251,
   DebugShaderModifierRecordTypeDXILStepFloat = 252,
   DebugShaderModifierRecordTypeDXILStepUint32 = 253,
@@ -143,6 +153,11 @@ struct DebugShaderModifierRecordDXILStepBase {
   uint32_t InstructionOffset;
 };
 
+struct DebugShaderModifierRecordDXILBlock
+    : public DebugShaderModifierRecordHeader {
+  uint32_t BlockOrdinal;
+};
+
 template <typename ReturnType>
 struct DebugShaderModifierRecordDXILStep
     : public DebugShaderModifierRecordDXILStepBase {
@@ -206,6 +221,7 @@ private:
   };
 
   uint64_t m_UAVSize = 1024 * 1024;
+  bool m_Compact = false;
   Value *m_SelectionCriterion = nullptr;
   CallInst *m_HandleForUAV = nullptr;
   Value *m_InvocationId = nullptr;
@@ -261,6 +277,7 @@ private:
                                SystemValueIndices SVIndices);
   void addDebugEntryValue(BuilderContext &BC, Value *TheValue);
   void addInvocationStartMarker(BuilderContext &BC);
+  void addBlockEntryMarker(BuilderContext &BC, std::uint32_t BlockOrdinal);
   void reserveDebugEntrySpace(BuilderContext &BC, uint32_t SpaceInDwords);
   void addStoreStepDebugEntry(BuilderContext &BC, StoreInst *Inst);
   void addStepDebugEntry(BuilderContext &BC, Instruction *Inst);
@@ -280,6 +297,7 @@ void DxilDebugInstrumentation::applyOptions(PassOptions O) {
   GetPassOptionUnsigned(O, "parameter1", &m_Parameters.Parameters[1], 0);
   GetPassOptionUnsigned(O, "parameter2", &m_Parameters.Parameters[2], 0);
   GetPassOptionUInt64(O, "UAVSize", &m_UAVSize, 1024 * 1024);
+  GetPassOptionBool(O, "compact", &m_Compact, false);
 }
 
 uint32_t DxilDebugInstrumentation::UAVDumpingGroundOffset() {
@@ -778,6 +796,19 @@ void DxilDebugInstrumentation::addInvocationStartMarker(BuilderContext &BC) {
   addDebugEntryValue(BC, m_InvocationId);
 }
 
+void DxilDebugInstrumentation::addBlockEntryMarker(BuilderContext &BC,
+                                                   std::uint32_t BlockOrdinal) {
+  DebugShaderModifierRecordDXILBlock marker = {};
+  reserveDebugEntrySpace(BC, sizeof(marker));
+
+  marker.Header.Details.SizeDwords =
+      DebugShaderModifierRecordPayloadSizeDwords(sizeof(marker));
+  marker.Header.Details.Type = DebugShaderModifierRecordTypeDXILBlock;
+  addDebugEntryValue(BC, BC.HlslOP->GetU32Const(marker.Header.u32Header));
+  addDebugEntryValue(BC, m_InvocationId);
+  addDebugEntryValue(BC, BC.HlslOP->GetU32Const(BlockOrdinal));
+}
+
 template <typename ReturnType>
 void DxilDebugInstrumentation::addStepEntryForType(
     DebugShaderModifierRecordType RecordType, BuilderContext &BC,
@@ -967,11 +998,22 @@ bool DxilDebugInstrumentation::runOnModule(Module &M) {
   addInvocationSelectionProlog(BC, SystemValues);
   addInvocationStartMarker(BC);
 
+  auto Fn = DM.GetEntryFunction();
+  auto &Blocks = Fn->getBasicBlockList();
+
+  // The ordinals of the blocks, as the compact trace records them, are their
+  // positions before any edge blocks are added below:
+  std::vector<BasicBlock *> OriginalBlocks;
+  for (auto &CurrentBlock : Blocks) {
+    OriginalBlocks.push_back(&CurrentBlock);
+  }
+  if (m_Compact) {
+    addBlockEntryMarker(BC, 0);
+  }
+
   // Explicitly name new blocks in order to provide stable names for testing purposes
   int NewBlockCounter = 0;
 
-  auto Fn = DM.GetEntryFunction();
-  auto &Blocks = Fn->getBasicBlockList();
   for (auto &CurrentBlock : Blocks) {
     struct ValueAndPhi {
       Value *Val;
@@ -987,6 +1029,9 @@ bool DxilDebugInstrumentation::runOnModule(Module &M) {
         break;
       }
       PHINode &PN = llvm::cast<PHINode>(Inst);
+      if (m_Compact && pix_dxil::PixCompactTrace::IsReplayable(&PN)) {
+        continue;
+      }
       for (unsigned i = 0, e = PN.getNumIncomingValues(); i != e; ++i) {
         BasicBlock *PhiBB = PN.getIncomingBlock(i);
         Value *PhiVal = PN.getIncomingValue(i);
@@ -1039,8 +1084,20 @@ bool DxilDebugInstrumentation::runOnModule(Module &M) {
     }
   }
 
+  if (m_Compact) {
+    for (std::uint32_t Ordinal = 1; Ordinal < OriginalBlocks.size();
+         ++Ordinal) {
+      IRBuilder<> Builder(OriginalBlocks[Ordinal]->getFirstInsertionPt());
+      BuilderContext BC2{BC.M, BC.DM, BC.Ctx, BC.HlslOP, Builder};
+      addBlockEntryMarker(BC2, Ordinal);
+    }
+  }
+
   // Instrument original instructions:
   for (auto &Inst : AllInstructions) {
+    if (m_Compact && pix_dxil::PixCompactTrace::IsReplayable(Inst)) {
+      continue;
+    }
     // Instrumentation goes after the instruction if it is not a terminator.
     // Otherwise, Instrumentation goes prior to the instruction.
     if (!Inst->isTerminator()) {
@@ -0,0 +1,459 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilPIXCompactTrace.cpp                                                   //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Defines functions for the compact trace written by the debug              //
+// instrumentation pass, and for expanding it back into the per-instruction  //
+// step trace.                                                               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/DxilPIXPasses/DxilPIXCompactTrace.h"
+#include "dxc/DxilPIXPasses/DxilPIXVirtualRegisters.h"
+
+#include "dxc/DXIL/DxilConstants.h"
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+
+#include <cstring>
+
+using namespace llvm;
+
+namespace {
+
+// These echo the records written by DxilDebugInstrumentation.cpp.
+enum : uint32_t {
+  RecordTypeInvocationStartMarker = 0,
+  RecordTypeDXILStepVoid = 251,
+  RecordTypeDXILStepFloat = 252,
+  RecordTypeDXILStepUint32 = 253,
+  RecordTypeDXILStepUint64 = 254,
+  RecordTypeDXILStepDouble = 255,
+};
+
+uint32_t RecordType(uint32_t Header) { return (Header >> 8) & 0xFF; }
+
+// Header and UID, followed by the payload counted in the header.
+uint32_t RecordSizeDwords(uint32_t Header) { return 2 + (Header & 0xF); }
+
+uint32_t MakeHeader(uint32_t Type, uint32_t PayloadDwords) {
+  return PayloadDwords | (Type << 8);
+}
+
+bool IsStepRecord(uint32_t Type) {
+  return Type >= RecordTypeDXILStepVoid && Type <= RecordTypeDXILStepDouble;
+}
+
+bool IsTracedType(Type *Ty) {
+  return (Ty->isIntegerTy() && Ty->getIntegerBitWidth() <= 64) ||
+         Ty->isHalfTy() || Ty->isFloatTy() || Ty->isDoubleTy();
+}
+
+// Ray query handles are not written to the trace; see addStepDebugEntry.
+bool IsAllocateRayQuery(Instruction *pI) {
+  auto *Call = dyn_cast<CallInst>(pI);
+  if (Call == nullptr || Call->getNumArgOperands() == 0)
+    return false;
+  auto *Opcode = dyn_cast<ConstantInt>(Call->getArgOperand(0));
+  return Opcode != nullptr &&
+         Opcode->getZExtValue() == (uint64_t)hlsl::DXIL::OpCode::AllocateRayQuery;
+}
+
+// An instruction whose result the full trace records under a register.
+bool IsTracedValue(Instruction *pI, uint32_t *pInstNum, uint32_t *pRegNum) {
+  return !isa<StoreInst>(pI) && IsTracedType(pI->getType()) &&
+         !IsAllocateRayQuery(pI) &&
+         pix_dxil::PixDxilReg::FromInst(pI, pRegNum) &&
+         pix_dxil::PixDxilInstNum::FromInst(pI, pInstNum);
+}
+
+bool IsTracedValue(Instruction *pI) {
+  uint32_t InstNum, RegNum;
+  return IsTracedValue(pI, &InstNum, &RegNum);
+}
+
+// A store the full trace records as a write to an alloca register.
+bool IsTracedStore(Instruction *pI, uint32_t *pInstNum, uint32_t *pRegBase,
+                   Value **pIndex) {
+  auto *St = dyn_cast<StoreInst>(pI);
+  uint32_t RegSize;
+  return St != nullptr &&
+         pix_dxil::PixAllocaRegWrite::FromInst(St, pRegBase, &RegSize,
+                                               pIndex) &&
+         pix_dxil::PixDxilInstNum::FromInst(St, pInstNum);
+}
+
+// True if the host knows the value by the time it is used: a constant, or an
+// instruction whose value is either recorded or replayed.
+bool IsAvailable(Value *V) {
+  if (!IsTracedType(V->getType()))
+    return false;
+  if (isa<ConstantInt>(V) || isa<ConstantFP>(V) || isa<UndefValue>(V))
+    return true;
+  auto *pI = dyn_cast<Instruction>(V);
+  return pI != nullptr && IsTracedValue(pI);
+}
+
+bool AreOperandsAvailable(Instruction *pI) {
+  for (Value *Op : pI->operands())
+    if (!IsAvailable(Op))
+      return false;
+  return true;
+}
+
+// Arithmetic on halves is done in the shader's precision, which the host does
+// not reproduce, and halves are recorded widened to float.
+bool InvolvesHalf(Instruction *pI) {
+  if (pI->getType()->isHalfTy())
+    return true;
+  for (Value *Op : pI->operands())
+    if (Op->getType()->isHalfTy())
+      return true;
+  return false;
+}
+
+// Values are held as the bits the full trace would record: integers
+// zero-extended, halves widened to float.
+typedef DenseMap<const Value *, uint64_t> ValueBits;
+
+uint64_t APFloatBits(APFloat F, Type *Ty) {
+  bool LosesInfo;
+  if (!Ty->isDoubleTy())
+    F.convert(APFloat::IEEEsingle, APFloat::rmNearestTiesToEven, &LosesInfo);
+  return F.bitcastToAPInt().getZExtValue();
+}
+
+bool GetBits(const ValueBits &Bits, Value *V, uint64_t *pBits) {
+  if (auto *CI = dyn_cast<ConstantInt>(V)) {
+    *pBits = CI->getZExtValue();
+    return true;
+  }
+  if (auto *CF = dyn_cast<ConstantFP>(V)) {
+    *pBits = APFloatBits(CF->getValueAPF(), V->getType());
+    return true;
+  }
+  if (isa<UndefValue>(V)) {
+    *pBits = 0;
+    return true;
+  }
+  auto It = Bits.find(V);
+  if (It == Bits.end())
+    return false;
+  *pBits = It->second;
+  return true;
+}
+
+bool CompareInts(CmpInst::Predicate P, const APInt &A, const APInt &B) {
+  switch (P) {
+  case CmpInst::ICMP_EQ: return A == B;
+  case CmpInst::ICMP_NE: return A != B;
+  case CmpInst::ICMP_UGT: return A.ugt(B);
+  case CmpInst::ICMP_UGE: return A.uge(B);
+  case CmpInst::ICMP_ULT: return A.ult(B);
+  case CmpInst::ICMP_ULE: return A.ule(B);
+  case CmpInst::ICMP_SGT: return A.sgt(B);
+  case CmpInst::ICMP_SGE: return A.sge(B);
+  case CmpInst::ICMP_SLT: return A.slt(B);
+  default: return A.sle(B);
+  }
+}
+
+// Recomputes an instruction accepted by IsReplayable, other than a phi.
+bool Evaluate(const ValueBits &Bits, Instruction *pI, uint64_t *pResult) {
+  uint64_t Ops[3] = {};
+  for (unsigned i = 0; i < pI->getNumOperands() && i < 3; ++i)
+    if (!GetBits(Bits, pI->getOperand(i), &Ops[i]))
+      return false;
+
+  Type *Ty = pI->getType();
+  Type *SrcTy = pI->getOperand(0)->getType();
+  unsigned Width = Ty->isIntegerTy() ? Ty->getIntegerBitWidth() : 0;
+  unsigned SrcWidth = SrcTy->isIntegerTy() ? SrcTy->getIntegerBitWidth() : 0;
+
+  APInt Result;
+  switch (pI->getOpcode()) {
+  case Instruction::Select:
+    *pResult = (Ops[0] & 1) ? Ops[1] : Ops[2];
+    return true;
+  case Instruction::Add: Result = APInt(Width, Ops[0]) + APInt(Width, Ops[1]); break;
+  case Instruction::Sub: Result = APInt(Width, Ops[0]) - APInt(Width, Ops[1]); break;
+  case Instruction::Mul: Result = APInt(Width, Ops[0]) * APInt(Width, Ops[1]); break;
+  case Instruction::And: Result = APInt(Width, Ops[0]) & APInt(Width, Ops[1]); break;
+  case Instruction::Or: Result = APInt(Width, Ops[0]) | APInt(Width, Ops[1]); break;
+  case Instruction::Xor: Result = APInt(Width, Ops[0]) ^ APInt(Width, Ops[1]); break;
+  case Instruction::Shl:
+    Result = APInt(Width, Ops[0]).shl((unsigned)(Ops[1] % Width));
+    break;
+  case Instruction::LShr:
+    Result = APInt(Width, Ops[0]).lshr((unsigned)(Ops[1] % Width));
+    break;
+  case Instruction::AShr:
+    Result = APInt(Width, Ops[0]).ashr((unsigned)(Ops[1] % Width));
+    break;
+  case Instruction::ICmp:
+    *pResult = CompareInts(cast<CmpInst>(pI)->getPredicate(),
+                           APInt(SrcWidth, Ops[0]), APInt(SrcWidth, Ops[1]));
+    return true;
+  case Instruction::Trunc:
+  case Instruction::ZExt:
+    Result = APInt(SrcWidth, Ops[0]).zextOrTrunc(Width);
+    break;
+  case Instruction::SExt:
+    Result = APInt(SrcWidth, Ops[0]).sext(Width);
+    break;
+  case Instruction::BitCast:
+    *pResult = Ops[0];
+    return true;
+  default:
+    return false;
+  }
+  *pResult = Result.getZExtValue();
+  return true;
+}
+
+// Appends the step record addStepDebugEntryValue writes for a value.
+void AppendStep(std::vector<uint32_t> &Steps, uint32_t UID, uint32_t InstNum,
+                Type *Ty, uint64_t Bits, uint32_t Ordinal,
+                uint32_t OrdinalIndex) {
+  bool Wide = Ty->isDoubleTy() || (Ty->isIntegerTy() &&
+                                   Ty->getIntegerBitWidth() == 64);
+  uint32_t Type = Ty->isDoubleTy()
+                      ? RecordTypeDXILStepDouble
+                      : Ty->isIntegerTy()
+                            ? (Wide ? RecordTypeDXILStepUint64
+                                    : RecordTypeDXILStepUint32)
+                            : RecordTypeDXILStepFloat;
+  Steps.push_back(MakeHeader(Type, Wide ? 4 : 3));
+  Steps.push_back(UID);
+  Steps.push_back(InstNum);
+  Steps.push_back((uint32_t)Bits);
+  if (Wide)
+    Steps.push_back((uint32_t)(Bits >> 32));
+  Steps.push_back((Ordinal << 16) | (OrdinalIndex & 0xFFFF));
+}
+
+void AppendRecord(std::vector<uint32_t> &Steps, const uint32_t *pRecord) {
+  Steps.insert(Steps.end(), pRecord, pRecord + RecordSizeDwords(pRecord[0]));
+}
+
+// Reads the value of a recorded step back into host form.
+bool GetRecordedBits(const uint32_t *pRecord, uint32_t InstNum, Type *Ty,
+                     uint64_t *pBits) {
+  uint32_t Type = RecordType(pRecord[0]);
+  if (!IsStepRecord(Type) || Type == RecordTypeDXILStepVoid ||
+      pRecord[2] != InstNum)
+    return false;
+  *pBits = pRecord[3];
+  if (Type == RecordTypeDXILStepUint64 || Type == RecordTypeDXILStepDouble)
+    *pBits |= (uint64_t)pRecord[4] << 32;
+  if (Ty->isIntegerTy() && Ty->getIntegerBitWidth() < 64)
+    *pBits &= (UINT64_C(1) << Ty->getIntegerBitWidth()) - 1;
+  return true;
+}
+
+class InvocationExpander {
+public:
+  InvocationExpander(const std::vector<BasicBlock *> &Blocks,
+                     const std::vector<const uint32_t *> &Records,
+                     std::vector<uint32_t> &Steps)
+      : m_Blocks(Blocks), m_Records(Records), m_Steps(Steps) {}
+
+  bool Expand() {
+    while (m_Next < m_Records.size()) {
+      const uint32_t *pRecord = m_Records[m_Next++];
+      uint32_t Type = RecordType(pRecord[0]);
+      if (Type == RecordTypeInvocationStartMarker) {
+        AppendRecord(m_Steps, pRecord);
+      } else if (IsStepRecord(Type)) {
+        // Outside a block, the only steps are phi values recorded on the
+        // edge into the next block.
+        m_PendingPhis.push_back(pRecord);
+      } else if (Type == pix_dxil::PixCompactTrace::BlockRecordType) {
+        if (!ExpandBlock(pRecord[1], pRecord[2]))
+          return false;
+      } else {
+        return false;
+      }
+    }
+    return m_PendingPhis.empty();
+  }
+
+private:
+  const std::vector<BasicBlock *> &m_Blocks;
+  const std::vector<const uint32_t *> &m_Records;
+  std::vector<uint32_t> &m_Steps;
+  size_t m_Next = 0;
+  std::vector<const uint32_t *> m_PendingPhis;
+  BasicBlock *m_PreviousBlock = nullptr;
+  ValueBits m_Bits;
+
+  const uint32_t *NextStepRecord() {
+    if (m_Next == m_Records.size() ||
+        !IsStepRecord(RecordType(m_Records[m_Next][0])))
+      return nullptr;
+    return m_Records[m_Next++];
+  }
+
+  bool ExpandBlock(uint32_t UID, uint32_t Ordinal) {
+    if (Ordinal >= m_Blocks.size())
+      return false;
+    BasicBlock *BB = m_Blocks[Ordinal];
+
+    // Phis read their incoming values before any of them is assigned.
+    std::vector<std::pair<Value *, uint64_t>> PhiValues;
+    size_t PendingPhi = 0;
+    for (Instruction &I : *BB) {
+      auto *Phi = dyn_cast<PHINode>(&I);
+      if (Phi == nullptr)
+        break;
+      uint32_t InstNum, RegNum;
+      if (!IsTracedValue(Phi, &InstNum, &RegNum))
+        continue;
+      uint64_t Bits;
+      if (pix_dxil::PixCompactTrace::IsReplayable(Phi)) {
+        int Incoming = m_PreviousBlock
+                           ? Phi->getBasicBlockIndex(m_PreviousBlock)
+                           : -1;
+        if (Incoming < 0 ||
+            !GetBits(m_Bits, Phi->getIncomingValue(Incoming), &Bits))
+          return false;
+        AppendStep(m_Steps, UID, InstNum, Phi->getType(), Bits, RegNum, 0);
+      } else {
+        if (PendingPhi == m_PendingPhis.size())
+          return false;
+        const uint32_t *pRecord = m_PendingPhis[PendingPhi++];
+        if (!GetRecordedBits(pRecord, InstNum, Phi->getType(), &Bits))
+          return false;
+        AppendRecord(m_Steps, pRecord);
+      }
+      PhiValues.push_back(std::make_pair(Phi, Bits));
+    }
+    if (PendingPhi != m_PendingPhis.size())
+      return false;
+    m_PendingPhis.clear();
+    for (auto &PhiValue : PhiValues)
+      m_Bits[PhiValue.first] = PhiValue.second;
+
+    for (Instruction &I : *BB) {
+      if (isa<PHINode>(&I))
+        continue;
+      uint32_t InstNum, RegNum;
+      Value *Index;
+      if (IsTracedStore(&I, &InstNum, &RegNum, &Index)) {
+        if (pix_dxil::PixCompactTrace::IsReplayable(&I)) {
+          Value *Stored = cast<StoreInst>(&I)->getValueOperand();
+          uint64_t Bits, IndexBits;
+          if (!GetBits(m_Bits, Stored, &Bits) ||
+              !GetBits(m_Bits, Index, &IndexBits))
+            return false;
+          AppendStep(m_Steps, UID, InstNum, Stored->getType(), Bits, RegNum,
+                     (uint32_t)IndexBits);
+        } else {
+          const uint32_t *pRecord = NextStepRecord();
+          if (pRecord == nullptr || pRecord[2] != InstNum)
+            return false;
+          AppendRecord(m_Steps, pRecord);
+        }
+      } else if (IsTracedValue(&I, &InstNum, &RegNum)) {
+        uint64_t Bits;
+        if (pix_dxil::PixCompactTrace::IsReplayable(&I)) {
+          if (!Evaluate(m_Bits, &I, &Bits))
+            return false;
+          AppendStep(m_Steps, UID, InstNum, I.getType(), Bits, RegNum, 0);
+        } else {
+          const uint32_t *pRecord = NextStepRecord();
+          if (pRecord == nullptr ||
+              !GetRecordedBits(pRecord, InstNum, I.getType(), &Bits))
+            return false;
+          AppendRecord(m_Steps, pRecord);
+        }
+        m_Bits[&I] = Bits;
+      }
+    }
+
+    m_PreviousBlock = BB;
+    return true;
+  }
+};
+
+} // namespace
+
+bool pix_dxil::PixCompactTrace::IsReplayable(Instruction *pI) {
+  uint32_t InstNum, RegBase;
+  Value *Index;
+  if (IsTracedStore(pI, &InstNum, &RegBase, &Index))
+    return IsAvailable(cast<StoreInst>(pI)->getValueOperand()) &&
+           IsAvailable(Index);
+
+  if (!IsTracedValue(pI))
+    return false;
+
+  switch (pI->getOpcode()) {
+  case Instruction::PHI:
+  case Instruction::Select:
+    return AreOperandsAvailable(pI);
+  case Instruction::Add:
+  case Instruction::Sub:
+  case Instruction::Mul:
+  case Instruction::Shl:
+  case Instruction::LShr:
+  case Instruction::AShr:
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+  case Instruction::ICmp:
+  case Instruction::Trunc:
+  case Instruction::ZExt:
+  case Instruction::SExt:
+    return AreOperandsAvailable(pI);
+  // Float arithmetic, comparisons and conversions are recorded: the host
+  // cannot reproduce the shader's denorm mode, or the contraction and other
+  // rewrites fast-math flags allow the driver.  Integer division is left to
+  // the hardware's rules for zero and overflow.
+  case Instruction::BitCast:
+    return !InvolvesHalf(pI) && AreOperandsAvailable(pI);
+  default:
+    return false;
+  }
+}
+
+bool pix_dxil::PixCompactTrace::ExpandToStepTrace(
+    Function &Entry, const uint32_t *pCompact, size_t DwordCount,
+    std::vector<uint32_t> &Steps) {
+  std::vector<BasicBlock *> Blocks;
+  for (BasicBlock &BB : Entry)
+    Blocks.push_back(&BB);
+
+  // Records of concurrent invocations are interleaved; each invocation's own
+  // records are in the order it wrote them.
+  std::vector<uint32_t> UIDs;
+  DenseMap<uint32_t, std::vector<const uint32_t *>> RecordsByUID;
+  bool Complete = true;
+  for (size_t i = 0; i < DwordCount;) {
+    if (DwordCount - i < 2 ||
+        DwordCount - i < RecordSizeDwords(pCompact[i])) {
+      Complete = false;
+      break;
+    }
+    uint32_t UID = pCompact[i + 1];
+    auto &Records = RecordsByUID[UID];
+    if (Records.empty())
+      UIDs.push_back(UID);
+    Records.push_back(pCompact + i);
+    i += RecordSizeDwords(pCompact[i]);
+  }
+
+  for (uint32_t UID : UIDs) {
+    InvocationExpander Expander(Blocks, RecordsByUID[UID], Steps);
+    if (!Expander.Expand())
+      Complete = false;
+  }
+  return Complete;
+}
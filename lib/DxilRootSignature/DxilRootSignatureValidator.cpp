@@ -26,6 +26,9 @@
 #include <vector>
 #include <set>
 #include <ios>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include <assert.h> // Needed for DxilPipelineStateValidation.h
 #include "dxc/DxilContainer/DxilPipelineStateValidation.h"
@@ -853,6 +856,74 @@ bool VerifyRootSignatureWithShaderPSV(const DxilVersionedRootSignatureDesc *pDes
   return true;
 }
 
+// Verifiers of root signatures that passed VerifyRootSignature, keyed on the
+// serialized bytes.  VerifyShader only reads a verifier, so entries are
+// shared by all threads and only it runs for later shaders.
+namespace {
+struct VerifiedRootSignatureCache {
+  static const size_t kMaxEntries = 256;
+  std::mutex Mutex;
+  std::unordered_map<string, std::unique_ptr<RootSignatureVerifier>> Entries;
+};
+} // namespace
+
+static VerifiedRootSignatureCache &GetVerifiedRootSignatureCache() {
+  static VerifiedRootSignatureCache Cache;
+  return Cache;
+}
+
+_Use_decl_annotations_
+bool VerifySerializedRootSignatureWithShaderPSV(const void *pRootSigData,
+                                                uint32_t RootSigSize,
+                                                DXIL::ShaderKind ShaderKind,
+                                                const void *pPSVData,
+                                                uint32_t PSVSize,
+                                                llvm::raw_ostream &DiagStream) {
+  VerifiedRootSignatureCache &Cache = GetVerifiedRootSignatureCache();
+  string Key((const char *)pRootSigData, RootSigSize);
+  RootSignatureVerifier *pRSV = nullptr;
+  {
+    std::lock_guard<std::mutex> Lock(Cache.Mutex);
+    auto It = Cache.Entries.find(Key);
+    if (It != Cache.Entries.end())
+      pRSV = It->second.get();
+  }
+
+  // Failing to deserialize is not a verification failure; let it throw.
+  RootSignatureHandle RSH;
+  if (pRSV == nullptr) {
+    RSH.LoadSerialized((const uint8_t *)pRootSigData, RootSigSize);
+    RSH.Deserialize();
+  }
+
+  try {
+    DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
+    std::unique_ptr<RootSignatureVerifier> pNewRSV;
+    if (pRSV == nullptr) {
+      pNewRSV.reset(new RootSignatureVerifier());
+      pNewRSV->VerifyRootSignature(RSH.GetDesc(), DiagPrinter);
+      pRSV = pNewRSV.get();
+
+      // The cached copy outlives this call, so it is allocated on the
+      // default heap rather than with the caller's allocator.
+      std::lock_guard<std::mutex> Lock(Cache.Mutex);
+      if (Cache.Entries.size() < VerifiedRootSignatureCache::kMaxEntries &&
+          Cache.Entries.count(Key) == 0) {
+        DxcThreadMalloc TM(nullptr);
+        Cache.Entries.emplace(
+            Key, std::unique_ptr<RootSignatureVerifier>(
+                     new RootSignatureVerifier(*pNewRSV)));
+      }
+    }
+    pRSV->VerifyShader(GetVisibilityType(ShaderKind), pPSVData, PSVSize,
+                       DiagPrinter);
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
 bool VerifyRootSignature(_In_ const DxilVersionedRootSignatureDesc *pDesc,
                          _In_ llvm::raw_ostream &DiagStream,
                          _In_ bool bAllowReservedRegisterSpace) {
@@ -70,11 +70,14 @@ public:
       // Compute postdominator relation.
       DominatorTreeBase<BasicBlock> PDR(true);
       PDR.recalculate(F);
+      // Shared by every convergent operand in F, so expressions feeding
+      // several samples are walked and marked only once.
+      std::set<Value *> visited;
       for (BasicBlock &bb : F.getBasicBlockList()) {
         for (auto it = bb.begin(); it != bb.end();) {
           Instruction *I = (it++);
           if (Value *V = FindConvergentOperand(I)) {
-            if (PropagateConvergent(V, &F, PDR)) {
+            if (PropagateConvergent(V, &F, PDR, visited)) {
               // TODO: emit warning here.
             }
             bUpdated = true;
@@ -90,7 +93,8 @@ private:
   void MarkConvergent(Value *V, IRBuilder<> &Builder, Module &M);
   Value *FindConvergentOperand(Instruction *I);
   bool PropagateConvergent(Value *V, Function *F,
-                           DominatorTreeBase<BasicBlock> &PostDom);
+                           DominatorTreeBase<BasicBlock> &PostDom,
+                           std::set<Value *> &visited);
   bool PropagateConvergentImpl(Value *V, Function *F,
                            DominatorTreeBase<BasicBlock> &PostDom, std::set<Value*>& visited);
 };
@@ -133,8 +137,8 @@ void DxilConvergentMark::MarkConvergent(Value *V, IRBuilder<> &Builder,
 }
 
 bool DxilConvergentMark::PropagateConvergent(
-    Value *V, Function *F, DominatorTreeBase<BasicBlock> &PostDom) {
-  std::set<Value *> visited;
+    Value *V, Function *F, DominatorTreeBase<BasicBlock> &PostDom,
+    std::set<Value *> &visited) {
   return PropagateConvergentImpl(V, F, PostDom, visited);
 }
 
@@ -151,6 +155,9 @@ bool DxilConvergentMark::PropagateConvergentImpl(Value *V, Function *F,
   // Skip phi which cannot sink.
   if (isa<PHINode>(V))
     return false;
+  // Already marked by an earlier operand.
+  if (IsConvergentMarker(V))
+    return false;
   if (Instruction *I = dyn_cast<Instruction>(V)) {
     BasicBlock *BB = I->getParent();
     if (PostDom.dominates(BB, &F->getEntryBlock())) {
@@ -0,0 +1,450 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilPipelineLink.cpp                                                      //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Links the signatures of the stages of a graphics pipeline, removing       //
+// outputs that the next stage never reads.                                  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilPipelineLink.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilShaderModel.h"
+#include "dxc/DXIL/DxilSignature.h"
+#include "dxc/HLSL/ComputeViewIdState.h"
+#include "dxc/HLSL/DxilPackSignatureElement.h"
+#include "dxc/HLSL/DxilSignatureAllocator.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+#include <algorithm>
+#include <set>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+enum class SigRef { Input, Output, PatchConstOrPrim };
+
+// A dx.op call naming a signature element.  All of these take the signature
+// ID, row and column as the operands after the opcode.
+struct SigCall {
+  CallInst *CI;
+  SigRef Sig;
+  bool IsStore;
+  bool MarksUsage; // Counted in the usage masks of the element.
+};
+
+const unsigned kSigIdOpIdx = 1;
+const unsigned kRowOpIdx = 2;
+const unsigned kColOpIdx = 3;
+const unsigned kAllColumns = 0xF;
+
+bool ClassifySignatureCall(CallInst *CI, SigCall &Call) {
+  switch (OP::GetDxilOpFuncCallInst(CI)) {
+  case DXIL::OpCode::LoadInput:
+    Call = {CI, SigRef::Input, false, true};
+    return true;
+  case DXIL::OpCode::EvalSnapped:
+  case DXIL::OpCode::EvalSampleIndex:
+  case DXIL::OpCode::EvalCentroid:
+  case DXIL::OpCode::AttributeAtVertex:
+    Call = {CI, SigRef::Input, false, false};
+    return true;
+  case DXIL::OpCode::StoreOutput:
+  case DXIL::OpCode::StoreVertexOutput:
+    Call = {CI, SigRef::Output, true, true};
+    return true;
+  case DXIL::OpCode::LoadOutputControlPoint:
+    Call = {CI, SigRef::Output, false, false};
+    return true;
+  case DXIL::OpCode::StorePatchConstant:
+  case DXIL::OpCode::StorePrimitiveOutput:
+    Call = {CI, SigRef::PatchConstOrPrim, true, true};
+    return true;
+  case DXIL::OpCode::LoadPatchConstant:
+    Call = {CI, SigRef::PatchConstOrPrim, false, true};
+    return true;
+  default:
+    return false;
+  }
+}
+
+std::vector<SigCall> CollectSignatureCalls(Module &M) {
+  std::vector<SigCall> Calls;
+  for (Function &F : M.functions()) {
+    if (!OP::IsDxilOpFunc(&F))
+      continue;
+    for (User *U : F.users()) {
+      CallInst *CI = dyn_cast<CallInst>(U);
+      SigCall Call;
+      if (CI && ClassifySignatureCall(CI, Call))
+        Calls.push_back(Call);
+    }
+  }
+  return Calls;
+}
+
+DxilSignature &GetSignature(DxilModule &DM, SigRef Ref) {
+  switch (Ref) {
+  case SigRef::Input:
+    return DM.GetInputSignature();
+  case SigRef::Output:
+    return DM.GetOutputSignature();
+  default:
+    return DM.GetPatchConstOrPrimSignature();
+  }
+}
+
+unsigned GetSigId(CallInst *CI) {
+  return (unsigned)cast<ConstantInt>(CI->getArgOperand(kSigIdOpIdx))
+      ->getLimitedValue();
+}
+
+// Columns of the element accessed by the call, relative to its start column.
+unsigned GetColumnMask(CallInst *CI) {
+  if (ConstantInt *Col = dyn_cast<ConstantInt>(CI->getArgOperand(kColOpIdx)))
+    return 1u << Col->getLimitedValue(3);
+  return kAllColumns;
+}
+
+// Returns the columns of each element of the signature accessed by the calls
+// that load from it, or store to it if IsStore.
+std::vector<unsigned> GetAccessedColumns(ArrayRef<SigCall> Calls, SigRef Ref,
+                                         bool IsStore, unsigned NumElements) {
+  std::vector<unsigned> Masks(NumElements, 0);
+  for (const SigCall &Call : Calls) {
+    if (Call.Sig != Ref || Call.IsStore != IsStore)
+      continue;
+    unsigned ID = GetSigId(Call.CI);
+    if (ID < NumElements)
+      Masks[ID] |= GetColumnMask(Call.CI);
+  }
+  return Masks;
+}
+
+// Finds the element of Sig the runtime links to E: the one with the same
+// semantic name and indices.  Sets Overlap if an element shares only some of
+// the indices of E, in which case the two layouts cannot be matched up.
+DxilSignatureElement *FindLinkedElement(DxilSignature &Sig,
+                                        const DxilSignatureElement &E,
+                                        bool &Overlap) {
+  DxilSignatureElement *Match = nullptr;
+  const std::vector<unsigned> &Indices = E.GetSemanticIndexVec();
+  for (auto &Other : Sig.GetElements()) {
+    if (!Other->GetSemanticName().equals_lower(E.GetSemanticName()))
+      continue;
+    if (Other->GetSemanticIndexVec() == Indices) {
+      Match = Other.get();
+      continue;
+    }
+    for (unsigned Idx : Other->GetSemanticIndexVec()) {
+      if (std::find(Indices.begin(), Indices.end(), Idx) != Indices.end())
+        Overlap = true;
+    }
+  }
+  return Match;
+}
+
+// Returns true if the two elements take the same space under the same packing
+// constraints, so that one can take the location of the other.
+bool HaveSameLayout(DxilSignatureElement &A, DxilSignatureElement &B,
+                    bool UseMinPrecision) {
+  DxilPackElement PA(&A, UseMinPrecision), PB(&B, UseMinPrecision);
+  return PA.GetRows() == PB.GetRows() && PA.GetCols() == PB.GetCols() &&
+         PA.GetInterpretation() == PB.GetInterpretation() &&
+         PA.GetInterpolationMode() == PB.GetInterpolationMode() &&
+         PA.GetDataBitWidth() == PB.GetDataBitWidth();
+}
+
+void EraseCallAndDeadOperands(CallInst *CI) {
+  SmallVector<WeakVH, 8> Operands;
+  for (Value *V : CI->arg_operands())
+    Operands.emplace_back(V);
+  CI->eraseFromParent();
+  for (WeakVH &V : Operands) {
+    if (V)
+      RecursivelyDeleteTriviallyDeadInstructions(V);
+  }
+}
+
+void RenumberCalls(ArrayRef<SigCall> Calls, SigRef Ref,
+                   const std::vector<unsigned> &NewIDs, OP *hlslOP) {
+  for (const SigCall &Call : Calls) {
+    if (Call.Sig != Ref)
+      continue;
+    unsigned NewID = NewIDs[GetSigId(Call.CI)];
+    DXASSERT(NewID != DxilSignatureElement::kUndefinedID,
+             "access to removed signature element");
+    Call.CI->setArgOperand(kSigIdOpIdx, hlslOP->GetU32Const(NewID));
+  }
+}
+
+// Recomputes the usage and dynamic index masks the way DxilFinalizeModule
+// sets them.
+void UpdateUsageMasks(DxilModule &DM) {
+  for (SigRef Ref :
+       {SigRef::Input, SigRef::Output, SigRef::PatchConstOrPrim}) {
+    for (auto &E : GetSignature(DM, Ref).GetElements()) {
+      E->SetUsageMask(0);
+      E->SetDynIdxCompMask(0);
+    }
+  }
+  for (const SigCall &Call : CollectSignatureCalls(*DM.GetModule())) {
+    if (!Call.MarksUsage || !isa<ConstantInt>(Call.CI->getArgOperand(kColOpIdx)))
+      continue;
+    DxilSignatureElement &E =
+        GetSignature(DM, Call.Sig).GetElement(GetSigId(Call.CI));
+    unsigned ColBit = GetColumnMask(Call.CI);
+    E.SetUsageMask(E.GetUsageMask() | ColBit);
+    if (!isa<ConstantInt>(Call.CI->getArgOperand(kRowOpIdx)))
+      E.SetDynIdxCompMask(E.GetDynIdxCompMask() | ColBit);
+  }
+}
+
+typedef std::vector<std::pair<int, int>> SignatureLayout;
+
+SignatureLayout SaveLayout(const DxilSignature &Sig) {
+  SignatureLayout Layout;
+  for (auto &E : Sig.GetElements())
+    Layout.emplace_back(E->GetStartRow(), E->GetStartCol());
+  return Layout;
+}
+
+void RestoreLayout(DxilSignature &Sig, const SignatureLayout &Layout) {
+  for (unsigned i = 0; i < Layout.size(); ++i) {
+    Sig.GetElement(i).SetStartRow(Layout[i].first);
+    Sig.GetElement(i).SetStartCol(Layout[i].second);
+  }
+}
+
+// Places each producer element at the location of the consumer element it is
+// linked to, and packs the remaining ones into the space the consumer leaves
+// free.  Returns false if they do not fit.
+bool PlaceProducerElements(DxilSignature &PSig, DxilSignature &CSig,
+                           ArrayRef<DxilSignatureElement *> Links) {
+  bool UseMinPrecision = PSig.UseMinPrecision();
+  DxilSignatureAllocator Alloc(32, UseMinPrecision);
+  std::vector<DxilPackElement> Placed;
+  Placed.reserve(CSig.GetElements().size());
+  for (auto &CE : CSig.GetElements()) {
+    if (!CE->IsAllocated())
+      continue;
+    Placed.emplace_back(CE.get(), UseMinPrecision);
+    Alloc.PlaceElement(&Placed.back(), CE->GetStartRow(), CE->GetStartCol());
+  }
+
+  std::vector<DxilPackElement> Remaining;
+  for (unsigned i = 0; i < Links.size(); ++i) {
+    DxilSignatureElement &PE = PSig.GetElement(i);
+    if (!DxilSignature::ShouldBeAllocated(PE.GetInterpretation()))
+      continue;
+    const DxilSignatureElement *CE = Links[i];
+    if (CE && CE->IsAllocated()) {
+      PE.SetStartRow(CE->GetStartRow());
+      PE.SetStartCol(CE->GetStartCol());
+    } else {
+      Remaining.emplace_back(&PE, UseMinPrecision);
+    }
+  }
+  for (DxilPackElement &E : Remaining) {
+    E.ClearLocation();
+    if (!Alloc.PackNext(&E, 0, 32))
+      return false;
+  }
+  return true;
+}
+
+// A producer signature and the consumer signature it feeds.
+struct SignatureLink {
+  DxilModule *Producer;
+  SigRef ProducerSig;
+  DxilModule *Consumer;
+  SigRef ConsumerSig;
+  bool CanRepack;
+};
+
+void AddSignatureLinks(DxilModule &P, DxilModule &C,
+                       std::vector<SignatureLink> &Links) {
+  DXIL::ShaderKind PK = P.GetShaderModel()->GetKind();
+  DXIL::ShaderKind CK = C.GetShaderModel()->GetKind();
+  switch (PK) {
+  case DXIL::ShaderKind::Vertex:
+  case DXIL::ShaderKind::Domain:
+    if (CK == DXIL::ShaderKind::Pixel || CK == DXIL::ShaderKind::Geometry ||
+        (PK == DXIL::ShaderKind::Vertex && CK == DXIL::ShaderKind::Hull))
+      Links.push_back({&P, SigRef::Output, &C, SigRef::Input, true});
+    break;
+  case DXIL::ShaderKind::Hull:
+    // Patch constants first: the patch constant function may read output
+    // control points, and those reads go away with the stores they feed.
+    if (CK == DXIL::ShaderKind::Domain) {
+      Links.push_back({&P, SigRef::PatchConstOrPrim, &C,
+                       SigRef::PatchConstOrPrim, true});
+      Links.push_back({&P, SigRef::Output, &C, SigRef::Input, true});
+    }
+    break;
+  case DXIL::ShaderKind::Mesh:
+    // Vertex and primitive outputs share the pixel shader input signature,
+    // so neither can be laid out after it alone.
+    if (CK == DXIL::ShaderKind::Pixel) {
+      Links.push_back({&P, SigRef::Output, &C, SigRef::Input, false});
+      Links.push_back(
+          {&P, SigRef::PatchConstOrPrim, &C, SigRef::Input, false});
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+void LinkSignatures(const SignatureLink &L, std::set<DxilModule *> &Changed,
+                    DxilPipelineLinkStats &Stats) {
+  DxilSignature &PSig = GetSignature(*L.Producer, L.ProducerSig);
+  DxilSignature &CSig = GetSignature(*L.Consumer, L.ConsumerSig);
+  unsigned NumP = PSig.GetElements().size();
+  unsigned NumC = CSig.GetElements().size();
+  bool UseMinPrecision = PSig.UseMinPrecision();
+  bool CanRepack =
+      L.CanRepack && UseMinPrecision == CSig.UseMinPrecision();
+
+  std::vector<SigCall> PCalls = CollectSignatureCalls(*L.Producer->GetModule());
+  std::vector<unsigned> Reads = GetAccessedColumns(
+      CollectSignatureCalls(*L.Consumer->GetModule()), L.ConsumerSig,
+      /*IsStore*/ false, NumC);
+  // Hull shaders can read their own output control points back.
+  std::vector<unsigned> Needed =
+      GetAccessedColumns(PCalls, L.ProducerSig, /*IsStore*/ false, NumP);
+
+  std::vector<DxilSignatureElement *> Links(NumP, nullptr);
+  for (unsigned i = 0; i < NumP; ++i) {
+    DxilSignatureElement &PE = PSig.GetElement(i);
+    bool Overlap = false;
+    DxilSignatureElement *CE = FindLinkedElement(CSig, PE, Overlap);
+    if (CE) {
+      Needed[i] |= Reads[CE->GetID()];
+      CanRepack &= HaveSameLayout(PE, *CE, UseMinPrecision);
+    }
+    // System values may be consumed by fixed function hardware rather than
+    // the next stage.
+    if (Overlap || !PE.GetSemantic()->IsArbitrary())
+      Needed[i] = kAllColumns;
+    CanRepack &= !Overlap;
+    Links[i] = CE;
+  }
+
+  // Stores are never trivially dead, so the calls left in PCalls stay valid
+  // while erasing.
+  unsigned ErasedStores = 0;
+  for (const SigCall &Call : PCalls) {
+    if (Call.Sig != L.ProducerSig || !Call.IsStore)
+      continue;
+    if ((Needed[GetSigId(Call.CI)] & GetColumnMask(Call.CI)) == 0) {
+      EraseCallAndDeadOperands(Call.CI);
+      ++ErasedStores;
+    }
+  }
+
+  std::vector<bool> Remove(NumP);
+  for (unsigned i = 0; i < NumP; ++i)
+    Remove[i] = Needed[i] == 0;
+  unsigned RemovedElements = std::count(Remove.begin(), Remove.end(), true);
+  if (RemovedElements) {
+    std::vector<unsigned> NewIDs = PSig.RemoveElements(Remove);
+    RenumberCalls(CollectSignatureCalls(*L.Producer->GetModule()),
+                  L.ProducerSig, NewIDs, L.Producer->GetOP());
+    std::vector<DxilSignatureElement *> Remaining;
+    for (unsigned i = 0; i < NumP; ++i) {
+      if (!Remove[i])
+        Remaining.push_back(Links[i]);
+    }
+    Links.swap(Remaining);
+  }
+  if (ErasedStores || RemovedElements)
+    Changed.insert(L.Producer);
+  Stats.RemovedStores += ErasedStores;
+  Stats.RemovedElements += RemovedElements;
+  if (!CanRepack)
+    return;
+
+  // Drop consumer inputs nothing writes to any more, then pack what is left
+  // tightly.  Prefix stability only matters for stages compiled separately.
+  std::vector<bool> Unread(NumC);
+  for (unsigned i = 0; i < NumC; ++i) {
+    DxilSignatureElement &CE = CSig.GetElement(i);
+    Unread[i] = CE.GetSemantic()->IsArbitrary() && Reads[i] == 0;
+  }
+  unsigned UnreadInputs = std::count(Unread.begin(), Unread.end(), true);
+  if (UnreadInputs) {
+    for (DxilSignatureElement *&CE : Links) {
+      if (CE && Unread[CE->GetID()])
+        CE = nullptr;
+    }
+    std::vector<unsigned> NewIDs = CSig.RemoveElements(Unread);
+    RenumberCalls(CollectSignatureCalls(*L.Consumer->GetModule()),
+                  L.ConsumerSig, NewIDs, L.Consumer->GetOP());
+    Changed.insert(L.Consumer);
+    Stats.RemovedElements += UnreadInputs;
+  }
+
+  SignatureLayout PLayout = SaveLayout(PSig);
+  SignatureLayout CLayout = SaveLayout(CSig);
+  PackDxilSignature(CSig, DXIL::PackingStrategy::Optimized);
+  if (!CSig.IsFullyAllocated() || !PlaceProducerElements(PSig, CSig, Links)) {
+    RestoreLayout(PSig, PLayout);
+    RestoreLayout(CSig, CLayout);
+    return;
+  }
+  Changed.insert(L.Producer);
+  Changed.insert(L.Consumer);
+  Stats.RepackedSignatures += 2;
+}
+
+} // namespace
+
+namespace hlsl {
+
+bool LinkPipelineStages(ArrayRef<DxilModule *> Stages,
+                        DxilPipelineLinkStats *pStats) {
+  std::vector<SignatureLink> Links;
+  for (unsigned i = Stages.size(); i > 1; --i)
+    AddSignatureLinks(*Stages[i - 2], *Stages[i - 1], Links);
+
+  DxilPipelineLinkStats Stats;
+  std::set<DxilModule *> Changed;
+  for (const SignatureLink &L : Links)
+    LinkSignatures(L, Changed, Stats);
+
+  for (DxilModule *DM : Changed) {
+    for (auto It = DM->GetModule()->begin(); It != DM->GetModule()->end();) {
+      Function *F = &*(It++);
+      if (OP::IsDxilOpFunc(F) && F->user_empty())
+        F->eraseFromParent();
+    }
+    DM->ResetFunctionSummaries();
+    UpdateUsageMasks(*DM);
+    legacy::PassManager PM;
+    PM.add(createComputeViewIdStatePass());
+    PM.run(*DM->GetModule());
+    DM->ReEmitDxilResources();
+  }
+
+  if (pStats)
+    *pStats = Stats;
+  return !Changed.empty();
+}
+
+} // namespace hlsl
@@ -691,6 +691,9 @@ private:
     if (AllocFn->user_empty()) {
       AllocFn->eraseFromParent();
     }
+    // Function summaries were collected with these calls in place.
+    if (!DeadInsts.empty())
+      M.GetDxilModule().ResetFunctionSummaries();
   }
 
   // Convert all uses of dx.break() into per-function load/cmp of dx.break.cond global constant
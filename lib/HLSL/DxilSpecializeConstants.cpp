@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilSpecializeConstants.cpp                                               //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Specializes a DXIL module for known constant buffer values.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilSpecializeConstants.h"
+#include "dxc/DXIL/DxilCBuffer.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+#include <map>
+#include <tuple>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Space, register and byte offset of a 32-bit value.
+typedef std::tuple<unsigned, unsigned, unsigned> ConstantKey;
+typedef std::map<ConstantKey, uint32_t> ConstantMap;
+
+// Finds the space and register of the constant buffer a handle refers to.
+// Throws for a handle created from the descriptor heap, which has no
+// register the given values could be matched against.
+bool GetCBufferRegister(DxilModule &DM, Value *Handle, unsigned &Space,
+                        unsigned &Register) {
+  CallInst *CI = dyn_cast<CallInst>(Handle);
+  if (CI && OP::IsDxilOpFuncCallInst(CI, DXIL::OpCode::AnnotateHandle))
+    CI = dyn_cast<CallInst>(DxilInst_AnnotateHandle(CI).get_res());
+  if (CI && OP::IsDxilOpFuncCallInst(CI, DXIL::OpCode::CreateHandleFromHeap))
+    throw hlsl::Exception(DXC_E_NOT_SUPPORTED,
+                          "cannot specialize a constant buffer loaded through "
+                          "a descriptor heap handle; only constant buffers "
+                          "bound to registers can be specialized");
+  if (!CI || !OP::IsDxilOpFuncCallInst(CI, DXIL::OpCode::CreateHandle))
+    return false;
+
+  DxilInst_CreateHandle CreateHandle(CI);
+  ConstantInt *ResClass =
+      dyn_cast<ConstantInt>(CreateHandle.get_resourceClass());
+  ConstantInt *RangeId = dyn_cast<ConstantInt>(CreateHandle.get_rangeId());
+  ConstantInt *Index = dyn_cast<ConstantInt>(CreateHandle.get_index());
+  if (!ResClass || !RangeId || !Index ||
+      ResClass->getLimitedValue() != (unsigned)DXIL::ResourceClass::CBuffer ||
+      RangeId->getLimitedValue() >= DM.GetCBuffers().size())
+    return false;
+
+  const DxilCBuffer &CB = DM.GetCBuffer(RangeId->getLimitedValue());
+  Space = CB.GetSpaceID();
+  // The index operand is the register itself, not an offset in the range.
+  Register = (unsigned)Index->getLimitedValue();
+  return true;
+}
+
+// Builds the constant of type Ty at ByteOffset of the buffer, or returns null
+// if part of it is not given.  Under min precision a 16-bit component has a
+// dword of its own, holding the 32-bit value it is converted from.
+Constant *GetSpecializedValue(const ConstantMap &Constants, unsigned Space,
+                              unsigned Register, unsigned ByteOffset,
+                              Type *Ty, bool MinPrecision) {
+  if (MinPrecision) {
+    auto It = Constants.find(ConstantKey(Space, Register, ByteOffset));
+    if (It == Constants.end())
+      return nullptr;
+    if (!Ty->isHalfTy())
+      return ConstantInt::get(Ty, It->second & 0xFFFF);
+    APFloat F(APFloat::IEEEsingle, APInt(32, It->second));
+    bool LosesInfo;
+    F.convert(APFloat::IEEEhalf, APFloat::rmNearestTiesToEven, &LosesInfo);
+    return ConstantFP::get(Ty->getContext(), F);
+  }
+
+  unsigned Size = Ty->getPrimitiveSizeInBits() / 8;
+  uint64_t Bits = 0;
+  for (unsigned Offset = 0; Offset < Size; Offset += 4) {
+    unsigned DwordOffset = (ByteOffset + Offset) & ~3u;
+    auto It = Constants.find(ConstantKey(Space, Register, DwordOffset));
+    if (It == Constants.end())
+      return nullptr;
+    uint64_t Dword = It->second;
+    if (Size == 2)
+      Dword = (Dword >> ((ByteOffset & 2) * 8)) & 0xFFFF;
+    Bits |= Dword << (Offset * 8);
+  }
+  Constant *C = ConstantInt::get(Type::getIntNTy(Ty->getContext(), Size * 8),
+                                 Bits);
+  return ConstantExpr::getBitCast(C, Ty);
+}
+
+} // namespace
+
+namespace hlsl {
+
+unsigned SpecializeCBufferLoads(DxilModule &DM,
+                                ArrayRef<DxilCBufferConstant> Constants) {
+  ConstantMap ConstantValues;
+  for (const DxilCBufferConstant &C : Constants)
+    ConstantValues[ConstantKey(C.Space, C.Register, C.ByteOffset & ~3u)] =
+        C.Value;
+
+  unsigned Replaced = 0;
+  for (Function &F : DM.GetModule()->functions()) {
+    if (!OP::IsDxilOpFunc(&F))
+      continue;
+    for (auto UIt = F.user_begin(); UIt != F.user_end();) {
+      CallInst *CI = dyn_cast<CallInst>(*(UIt++));
+      if (!CI ||
+          !OP::IsDxilOpFuncCallInst(CI, DXIL::OpCode::CBufferLoadLegacy))
+        continue;
+      DxilInst_CBufferLoadLegacy Load(CI);
+      ConstantInt *RegIndex = dyn_cast<ConstantInt>(Load.get_regIndex());
+      unsigned Space, Register;
+      if (!RegIndex ||
+          !GetCBufferRegister(DM, Load.get_handle(), Space, Register))
+        continue;
+
+      // The components split the 16-byte row evenly: 8 for native 16-bit
+      // types, 4 for 32-bit and min precision types, 2 for 64-bit ones.
+      unsigned Stride = 16 / CI->getType()->getStructNumElements();
+      for (auto EIt = CI->user_begin(); EIt != CI->user_end();) {
+        ExtractValueInst *EV = dyn_cast<ExtractValueInst>(*(EIt++));
+        if (!EV || EV->getNumIndices() != 1)
+          continue;
+        Type *Ty = EV->getType();
+        unsigned ByteOffset = (unsigned)RegIndex->getLimitedValue() * 16 +
+                              EV->getIndices()[0] * Stride;
+        bool MinPrecision = Stride > Ty->getPrimitiveSizeInBits() / 8;
+        if (Constant *C = GetSpecializedValue(ConstantValues, Space, Register,
+                                              ByteOffset, Ty, MinPrecision)) {
+          EV->replaceAllUsesWith(C);
+          EV->eraseFromParent();
+          ++Replaced;
+        }
+      }
+      if (CI->user_empty())
+        CI->eraseFromParent();
+    }
+  }
+  return Replaced;
+}
+
+} // namespace hlsl
@@ -44,6 +44,7 @@
 #include "llvm/ADT/BitVector.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include <unordered_set>
 #include "llvm/Analysis/LoopInfo.h"
@@ -3667,11 +3668,6 @@ static void CollectFixAddressAccess(Value *V,
   }
 }
 
-static bool IsDivergent(Value *V) {
-  // TODO: return correct result.
-  return false;
-}
-
 static void ValidateTGSMRaceCondition(std::vector<StoreInst *> &fixAddrTGSMList,
                                       ValidationContext &ValCtx) {
   std::unordered_set<Function *> fixAddrTGSMFuncSet;
@@ -3686,6 +3682,9 @@ static void ValidateTGSMRaceCondition(std::vector<StoreInst *> &fixAddrTGSMList,
 
     PostDominatorTree PDT;
     PDT.runOnFunction(F);
+    std::unique_ptr<WaveSensitivityAnalysis> Divergence(
+        WaveSensitivityAnalysis::createDivergence(PDT));
+    Divergence->Analyze(&F);
 
     BasicBlock *Entry = &F.getEntryBlock();
 
@@ -3693,7 +3692,7 @@ static void ValidateTGSMRaceCondition(std::vector<StoreInst *> &fixAddrTGSMList,
       BasicBlock *BB = SI->getParent();
       if (BB->getParent() == &F) {
         if (PDT.dominates(BB, Entry)) {
-          if (IsDivergent(SI->getValueOperand()))
+          if (Divergence->IsDivergent(SI->getValueOperand()))
             ValCtx.EmitInstrError(SI, ValidationRule::InstrTGSMRaceCond);
         }
       }
@@ -3736,7 +3735,12 @@ static void ValidateGlobalVariables(ValidationContext &ValCtx) {
                                            std::to_string(MaxSize) });
   }
 
-  if (!fixAddrTGSMList.empty()) {
+  // Divergent writes are only checked from validator 1.6 on, so containers
+  // built for older validators keep validating.
+  unsigned ValMajor, ValMinor;
+  M.GetValidatorVersion(ValMajor, ValMinor);
+  if (!fixAddrTGSMList.empty() &&
+      DXIL::CompareVersions(ValMajor, ValMinor, 1, 6) >= 0) {
     ValidateTGSMRaceCondition(fixAddrTGSMList, ValCtx);
   }
 }
@@ -5572,6 +5576,8 @@ void GetValidationVersion(_Out_ unsigned *pMajor, _Out_ unsigned *pMinor) {
   // - HASH container part support
   // - Mesh and Amplification shaders
   // - DXR 1.1 & RayQuery support
+  // 1.6 adds:
+  // - Race condition check on divergent writes to groupshared memory
   *pMajor = 1;
   *pMinor = 6;
   // VALRULE-TEXT:END
@@ -5589,6 +5595,11 @@ _Use_decl_annotations_ HRESULT ValidateDxilModule(
     return DXC_E_IR_VERIFICATION_FAILED;
   }
 
+  // Recollect function summaries from the IR being validated rather than
+  // trusting ones cached during codegen. Container part checks that follow
+  // reuse them.
+  pDxilModule->ResetFunctionSummaries();
+
   ValidationContext ValCtx(*pModule, pDebugModule, *pDxilModule);
 
   ValidateBitcode(ValCtx);
@@ -5869,6 +5880,7 @@ HRESULT ValidateDxilContainerParts(llvm::Module *pModule,
     case DFCC_DXIL:
     case DFCC_ShaderDebugInfoDXIL:
     case DFCC_ShaderDebugName:
+    case DFCC_FunctionIndex:
       continue;
 
     case DFCC_ShaderHash:
@@ -5976,13 +5988,13 @@ static HRESULT FindDxilPart(_In_reads_bytes_(ContainerSize) const void *pContain
   return S_OK;
 }
 
-_Use_decl_annotations_
-HRESULT ValidateLoadModule(const char *pIL,
-                           uint32_t ILLength,
-                           unique_ptr<llvm::Module> &pModule,
-                           LLVMContext &Ctx,
-                           llvm::raw_ostream &DiagStream,
-                           unsigned bLazyLoad) {
+static HRESULT ValidateLoadModule(const char *pIL,
+                                  uint32_t ILLength,
+                                  unique_ptr<llvm::Module> &pModule,
+                                  LLVMContext &Ctx,
+                                  llvm::raw_ostream &DiagStream,
+                                  unsigned bLazyLoad,
+                                  ArrayRef<uint64_t> FunctionBodyBits) {
 
   llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
   PrintDiagnosticContext DiagContext(DiagPrinter);
@@ -5995,7 +6007,8 @@ HRESULT ValidateLoadModule(const char *pIL,
   ErrorOr<std::unique_ptr<Module>> loadedModuleResult =
       bLazyLoad == 0?
       llvm::parseBitcodeFile(pBitcodeBuf->getMemBufferRef(), Ctx, nullptr, true /*Track Bitstream*/) :
-      llvm::getLazyBitcodeModule(std::move(pBitcodeBuf), Ctx, nullptr, false, true /*Track Bitstream*/);
+      llvm::getLazyBitcodeModule(std::move(pBitcodeBuf), Ctx, nullptr, false, true /*Track Bitstream*/,
+                                 FunctionBodyBits);
 
   // DXIL disallows some LLVM bitcode constructs, like unaccounted-for sub-blocks.
   // These appear as warnings, which the validator should reject.
@@ -6006,6 +6019,46 @@ HRESULT ValidateLoadModule(const char *pIL,
   return S_OK;
 }
 
+_Use_decl_annotations_
+HRESULT ValidateLoadModule(const char *pIL,
+                           uint32_t ILLength,
+                           unique_ptr<llvm::Module> &pModule,
+                           LLVMContext &Ctx,
+                           llvm::raw_ostream &DiagStream,
+                           unsigned bLazyLoad) {
+  return ValidateLoadModule(pIL, ILLength, pModule, Ctx, DiagStream, bLazyLoad,
+                            None);
+}
+
+// Reads the body positions recorded for the bitcode of the DXIL part, if the
+// container has a function index that matches it. An index left behind when
+// the DXIL part was replaced is ignored.
+static void GetFunctionBodyBits(const void *pContainer, const char *pIL,
+                                uint32_t ILLength,
+                                std::vector<uint64_t> &FunctionBodyBits) {
+  const DxilContainerHeader *pHeader =
+      reinterpret_cast<const DxilContainerHeader *>(pContainer);
+  const DxilPartHeader *pPart = GetDxilPartByType(pHeader, DFCC_FunctionIndex);
+  if (!pPart || pPart->PartSize < sizeof(DxilFunctionIndexHeader))
+    return;
+  const DxilFunctionIndexHeader *pIndex =
+      reinterpret_cast<const DxilFunctionIndexHeader *>(GetDxilPartData(pPart));
+  uint32_t Count = pIndex->FunctionCount;
+  if (pIndex->BitcodeSize != ILLength ||
+      (pPart->PartSize - sizeof(DxilFunctionIndexHeader)) / sizeof(uint64_t) <
+          Count)
+    return;
+  llvm::MD5 md5;
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)pIL, ILLength));
+  llvm::MD5::MD5Result digest;
+  md5.final(digest);
+  if (memcmp(digest, pIndex->BitcodeDigest, sizeof(digest)) != 0)
+    return;
+  // The offsets are only four-byte aligned in the container.
+  FunctionBodyBits.resize(Count);
+  memcpy(FunctionBodyBits.data(), pIndex + 1, Count * sizeof(uint64_t));
+}
+
 HRESULT ValidateDxilBitcode(
   _In_reads_bytes_(ILLength) const char *pIL,
   _In_ uint32_t ILLength,
@@ -6078,7 +6131,13 @@ static HRESULT ValidateLoadModuleFromContainer(
       reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(pPart)), &pIL,
       &ILLength);
 
-  IFR(ValidateLoadModule(pIL, ILLength, pModule, Ctx, DiagStream, bLazyLoad));
+  // Only a lazy load can skip function bodies.
+  std::vector<uint64_t> FunctionBodyBits;
+  if (bLazyLoad)
+    GetFunctionBodyBits(pContainer, pIL, ILLength, FunctionBodyBits);
+
+  IFR(ValidateLoadModule(pIL, ILLength, pModule, Ctx, DiagStream, bLazyLoad,
+                         FunctionBodyBits));
 
   HRESULT hr;
   const DxilPartHeader *pDbgPart = nullptr;
@@ -6127,6 +6186,15 @@ _Use_decl_annotations_
 HRESULT ValidateDxilContainer(const void *pContainer,
                               uint32_t ContainerSize,
                               llvm::raw_ostream &DiagStream) {
+  return ValidateDxilContainer(pContainer, ContainerSize,
+                               /*bSkipModuleValidation*/ false, DiagStream);
+}
+
+_Use_decl_annotations_
+HRESULT ValidateDxilContainer(const void *pContainer,
+                              uint32_t ContainerSize,
+                              bool bSkipModuleValidation,
+                              llvm::raw_ostream &DiagStream) {
   LLVMContext Ctx, DbgCtx;
   std::unique_ptr<llvm::Module> pModule, pDebugModule;
 
@@ -6141,7 +6209,8 @@ HRESULT ValidateDxilContainer(const void *pContainer,
       Ctx, DbgCtx, DiagStream));
 
   // Validate DXIL Module
-  IFR(ValidateDxilModule(pModule.get(), pDebugModule.get()));
+  if (!bSkipModuleValidation)
+    IFR(ValidateDxilModule(pModule.get(), pDebugModule.get()));
 
   if (DiagContext.HasErrors() || DiagContext.HasWarnings()) {
     return DXC_E_IR_VERIFICATION_FAILED;
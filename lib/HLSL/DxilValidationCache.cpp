@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilValidationCache.cpp                                                   //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// In-process cache of containers that have passed validation.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilValidationCache.h"
+#include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/Support/Global.h"
+#include "llvm/Support/SHA256.h"
+
+#include <iterator>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Hashes the DXIL and debug DXIL parts, with their part headers.
+void HashModuleParts(SHA256 &Hash, const DxilContainerHeader *pContainer) {
+  for (DxilPartIterator it = begin(pContainer), E = end(pContainer); it != E;
+       ++it) {
+    const DxilPartHeader *pPart = *it;
+    if (pPart->PartFourCC != DFCC_DXIL &&
+        pPart->PartFourCC != DFCC_ShaderDebugInfoDXIL)
+      continue;
+    Hash.update(ArrayRef<uint8_t>((const uint8_t *)pPart, sizeof(*pPart)));
+    Hash.update(ArrayRef<uint8_t>((const uint8_t *)GetDxilPartData(pPart),
+                                  pPart->PartSize));
+  }
+}
+
+} // namespace
+
+DxilValidationCache::DxilValidationCache(StringRef ValidatorBuild,
+                                         unsigned MaxEntries)
+    : m_ValidatorBuild(ValidatorBuild), m_MaxEntries(MaxEntries) {}
+
+bool DxilValidationCache::ComputeKey(const DxilContainerHeader *pContainer,
+                                     Key &key) const {
+  if (GetDxilPartByType(pContainer, DFCC_DXIL) == nullptr)
+    return false;
+
+  SHA256 ModuleHash, ContainerHash;
+  ModuleHash.update(m_ValidatorBuild);
+  HashModuleParts(ModuleHash, pContainer);
+  ContainerHash.update(m_ValidatorBuild);
+  ContainerHash.update(ArrayRef<uint8_t>((const uint8_t *)pContainer,
+                                         pContainer->ContainerSizeInBytes));
+
+  SHA256::SHA256Result Result;
+  ModuleHash.final(Result);
+  memcpy(key.Module, Result, sizeof(key.Module));
+  ContainerHash.final(Result);
+  memcpy(key.Container, Result, sizeof(key.Container));
+  return true;
+}
+
+DxilValidationCache::LookupResult
+DxilValidationCache::Lookup(const Key &key) {
+  std::lock_guard<std::mutex> Lock(m_Mutex);
+  if (m_Containers.Touch(key.Container))
+    return LookupResult::ContainerMatch;
+  if (m_Modules.Touch(key.Module))
+    return LookupResult::ModuleMatch;
+  return LookupResult::Miss;
+}
+
+void DxilValidationCache::Insert(const Key &key) {
+  // The entries outlive the call, so they are allocated on the default heap
+  // rather than with the caller's allocator.
+  DxcThreadMalloc TM(nullptr);
+  std::lock_guard<std::mutex> Lock(m_Mutex);
+  m_Containers.Insert(key.Container, m_MaxEntries);
+  m_Modules.Insert(key.Module, m_MaxEntries);
+}
+
+bool DxilValidationCache::DigestSet::Touch(const uint8_t *pDigest) {
+  Digest D;
+  memcpy(D.data(), pDigest, D.size());
+  auto It = m_Index.find(D);
+  if (It == m_Index.end())
+    return false;
+  m_Order.splice(m_Order.end(), m_Order, It->second);
+  return true;
+}
+
+void DxilValidationCache::DigestSet::Insert(const uint8_t *pDigest,
+                                            unsigned MaxEntries) {
+  if (Touch(pDigest) || MaxEntries == 0)
+    return;
+  if (m_Index.size() >= MaxEntries) {
+    m_Index.erase(m_Order.front());
+    m_Order.pop_front();
+  }
+  Digest D;
+  memcpy(D.data(), pDigest, D.size());
+  m_Order.push_back(D);
+  m_Index[D] = std::prev(m_Order.end());
+}
@@ -72,7 +72,8 @@ HLModule::HLModule(Module *pModule)
     , m_pOP(llvm::make_unique<OP>(pModule->getContext(), pModule))
     , m_AutoBindingSpace(UINT_MAX)
     , m_DefaultLinkage(DXIL::DefaultLinkage::Default)
-    , m_pTypeSystem(llvm::make_unique<DxilTypeSystem>(pModule)) {
+    , m_pTypeSystem(llvm::make_unique<DxilTypeSystem>(pModule))
+    , m_pHLOpFunctions(llvm::make_unique<HLOpFunctionRegistry>()) {
   DXASSERT_NOMSG(m_pModule != nullptr);
   m_pModule->pfnRemoveGlobal = &HLModule_RemoveGlobal;
   m_pModule->pfnResetHLModule = &HLModule_ResetModule;
@@ -330,6 +331,109 @@ DxilTypeSystem &HLModule::GetTypeSystem() {
   return *m_pTypeSystem;
 }
 
+HLOpFunctionRegistry &HLModule::GetHLOpFunctionRegistry() {
+  return *m_pHLOpFunctions;
+}
+
+//------------------------------------------------------------------------------
+//
+//  HLOpFunctionRegistry methods.
+//
+HLOpFunctionRegistry::Entry::Entry(llvm::Function *F,
+                                   HLOpFunctionRegistry *pRegistry)
+    : Handle(F, pRegistry) {}
+
+void HLOpFunctionRegistry::FunctionVH::deleted() {
+  m_pRegistry->Forget(getValPtr()); // Destroys *this.
+}
+
+void HLOpFunctionRegistry::FunctionVH::allUsesReplacedWith(llvm::Value *) {
+  m_pRegistry->Forget(getValPtr()); // Destroys *this.
+}
+
+void HLOpFunctionRegistry::Forget(llvm::Value *V) {
+  auto it = m_Entries.find(cast<Function>(V));
+  if (it == m_Entries.end())
+    return;
+  if (it->second.IsInterned) {
+    auto fnIt = m_Functions.find(it->second.Key);
+    if (fnIt != m_Functions.end() && fnIt->second == V)
+      m_Functions.erase(fnIt);
+  }
+  m_Entries.erase(it);
+}
+
+const HLOpFunctionRegistry::Entry *
+HLOpFunctionRegistry::FindEntry(const llvm::Function *F) const {
+  auto it = m_Entries.find(F);
+  return it == m_Entries.end() ? nullptr : &it->second;
+}
+
+HLOpFunctionRegistry::Entry *HLOpFunctionRegistry::GetEntry(llvm::Function *F) {
+  auto it = m_Entries.find(F);
+  if (it == m_Entries.end())
+    it = m_Entries.emplace(std::piecewise_construct, std::forward_as_tuple(F),
+                           std::forward_as_tuple(F, this)).first;
+  return &it->second;
+}
+
+bool HLOpFunctionRegistry::LookupGroups(const llvm::Function *F,
+                                        Groups &groups) const {
+  const Entry *pEntry = FindEntry(F);
+  if (pEntry == nullptr || !pEntry->HasGroups)
+    return false;
+  groups = pEntry->FunctionGroups;
+  return true;
+}
+
+void HLOpFunctionRegistry::AddGroups(llvm::Function *F, const Groups &groups) {
+  Entry *pEntry = GetEntry(F);
+  pEntry->HasGroups = true;
+  pEntry->FunctionGroups = groups;
+}
+
+uint64_t HLOpFunctionRegistry::GetFunctionKey(HLOpcodeGroup group,
+                                              unsigned opcode,
+                                              bool waveSensitive) {
+  // Mirrors the names built by GetHLFullName.
+  switch (group) {
+  case HLOpcodeGroup::HLBinOp:
+  case HLOpcodeGroup::HLUnOp:
+  case HLOpcodeGroup::HLMatLoadStore:
+  case HLOpcodeGroup::HLSubscript:
+  case HLOpcodeGroup::HLCast:
+    break;
+  default:
+    opcode = 0;
+    break;
+  }
+  return ((uint64_t)group << 33) | ((uint64_t)waveSensitive << 32) | opcode;
+}
+
+llvm::Function *HLOpFunctionRegistry::LookupFunction(llvm::FunctionType *FT,
+                                                     uint64_t key) const {
+  auto it = m_Functions.find(std::make_pair(FT, key));
+  if (it == m_Functions.end() || FindEntry(it->second) == nullptr)
+    return nullptr;
+  return it->second;
+}
+
+void HLOpFunctionRegistry::AddFunction(llvm::FunctionType *FT, uint64_t key,
+                                       llvm::Function *F) {
+  FunctionKey fnKey = std::make_pair(FT, key);
+  auto fnIt = m_Functions.find(fnKey);
+  if (fnIt != m_Functions.end() && fnIt->second != F) {
+    // Another function held the key; it no longer owns it.
+    auto it = m_Entries.find(fnIt->second);
+    if (it != m_Entries.end())
+      it->second.IsInterned = false;
+  }
+  Entry *pEntry = GetEntry(F);
+  pEntry->IsInterned = true;
+  pEntry->Key = fnKey;
+  m_Functions[fnKey] = F;
+}
+
 DxilTypeSystem *HLModule::ReleaseTypeSystem() {
   return m_pTypeSystem.release();
 }
@@ -10,6 +10,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/HLSL/HLOperations.h"
+#include "dxc/HLSL/HLModule.h"
 #include "dxc/HlslIntrinsicOp.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
@@ -94,8 +95,14 @@ static HLOpcodeGroup GetHLOpcodeGroupInternal(StringRef group) {
   }
   return HLOpcodeGroup::NotHL;
 }
-// GetHLOpGroup by function name.
-HLOpcodeGroup GetHLOpcodeGroupByName(const Function *F) {
+static HLOpFunctionRegistry *GetHLOpFunctionRegistry(const Function *F) {
+  const Module *M = F->getParent();
+  if (M == nullptr || !M->HasHLModule())
+    return nullptr;
+  return &M->GetHLModule().GetHLOpFunctionRegistry();
+}
+
+static HLOpcodeGroup ClassifyHLFunctionByName(const Function *F) {
   StringRef name = F->getName();
 
   if (!name.startswith(HLPrefix)) {
@@ -111,16 +118,36 @@ HLOpcodeGroup GetHLOpcodeGroupByName(const Function *F) {
   return GetHLOpcodeGroupInternal(group);
 }
 
-HLOpcodeGroup GetHLOpcodeGroup(llvm::Function *F) {
+static HLOpFunctionRegistry::Groups ClassifyHLFunction(Function *F) {
+  HLOpFunctionRegistry::Groups groups;
+  groups.GroupByName = ClassifyHLFunctionByName(F);
   llvm::StringRef name = GetHLOpcodeGroupNameByAttr(F);
-  HLOpcodeGroup result = GetHLOpcodeGroupInternal(name);
-  if (result == HLOpcodeGroup::NotHL) {
-    result = name.empty() ? result : HLOpcodeGroup::HLExtIntrinsic;
-  }
-  if (result == HLOpcodeGroup::NotHL) {
-    result = GetHLOpcodeGroupByName(F);
+  groups.Group = GetHLOpcodeGroupInternal(name);
+  if (groups.Group == HLOpcodeGroup::NotHL) {
+    groups.Group = name.empty() ? groups.GroupByName : HLOpcodeGroup::HLExtIntrinsic;
   }
-  return result;
+  return groups;
+}
+
+// Classifies F once and then answers from the module's registry, if any.
+static HLOpFunctionRegistry::Groups GetHLOpcodeGroups(const Function *F) {
+  HLOpFunctionRegistry *pRegistry = GetHLOpFunctionRegistry(F);
+  HLOpFunctionRegistry::Groups groups;
+  if (pRegistry && pRegistry->LookupGroups(F, groups))
+    return groups;
+  groups = ClassifyHLFunction(const_cast<Function *>(F));
+  if (pRegistry)
+    pRegistry->AddGroups(const_cast<Function *>(F), groups);
+  return groups;
+}
+
+// GetHLOpGroup by function name.
+HLOpcodeGroup GetHLOpcodeGroupByName(const Function *F) {
+  return GetHLOpcodeGroups(F).GroupByName;
+}
+
+HLOpcodeGroup GetHLOpcodeGroup(llvm::Function *F) {
+  return GetHLOpcodeGroups(F).Group;
 }
 
 llvm::StringRef GetHLOpcodeGroupNameByAttr(llvm::Function *F) {
@@ -480,6 +507,37 @@ static void SetHLFunctionAttribute(Function *F, HLOpcodeGroup group,
 }
 
 
+static Function *CreateHLFunction(Module &M, FunctionType *funcTy,
+                                  HLOpcodeGroup group, StringRef *groupName,
+                                  StringRef *fnName, unsigned opcode,
+                                  bool waveSensitive) {
+  std::string mangledName;
+  raw_string_ostream mangledNameStr(mangledName);
+  if (group == HLOpcodeGroup::HLExtIntrinsic) {
+    assert(groupName && "else intrinsic should have been rejected");
+    assert(fnName && "else intrinsic should have been rejected");
+    mangledNameStr << *groupName;
+    mangledNameStr << '.';
+    mangledNameStr << *fnName;
+  }
+  else {
+    mangledNameStr << GetHLFullName(group, opcode);
+    // Need to add wave sensitivity to name to prevent clashes with non-wave intrinsic
+    if (waveSensitive)
+        mangledNameStr << "wave";
+    mangledNameStr << '.';
+    funcTy->print(mangledNameStr);
+  }
+
+  mangledNameStr.flush();
+
+  Function *F = cast<Function>(M.getOrInsertFunction(mangledName, funcTy));
+  if (group == HLOpcodeGroup::HLExtIntrinsic) {
+    F->addFnAttr(hlsl::HLPrefix, *groupName);
+  }
+  return F;
+}
+
 Function *GetOrCreateHLFunction(Module &M, FunctionType *funcTy,
                                 HLOpcodeGroup group, unsigned opcode) {
   AttributeSet attribs;
@@ -503,29 +561,21 @@ Function *GetOrCreateHLFunction(Module &M, FunctionType *funcTy,
                                 HLOpcodeGroup group, StringRef *groupName,
                                 StringRef *fnName, unsigned opcode,
                                 const AttributeSet &attribs) {
-  std::string mangledName;
-  raw_string_ostream mangledNameStr(mangledName);
-  if (group == HLOpcodeGroup::HLExtIntrinsic) {
-    assert(groupName && "else intrinsic should have been rejected");
-    assert(fnName && "else intrinsic should have been rejected");
-    mangledNameStr << *groupName;
-    mangledNameStr << '.';
-    mangledNameStr << *fnName;
-  }
-  else {
-    mangledNameStr << GetHLFullName(group, opcode);
-    // Need to add wave sensitivity to name to prevent clashes with non-wave intrinsic
-    if(attribs.hasAttribute(AttributeSet::FunctionIndex, HLWaveSensitive))
-        mangledNameStr << "wave";
-    mangledNameStr << '.';
-    funcTy->print(mangledNameStr);
-  }
-
-  mangledNameStr.flush();
-
-  Function *F = cast<Function>(M.getOrInsertFunction(mangledName, funcTy));
-  if (group == HLOpcodeGroup::HLExtIntrinsic) {
-    F->addFnAttr(hlsl::HLPrefix, *groupName);
+  bool waveSensitive =
+      attribs.hasAttribute(AttributeSet::FunctionIndex, HLWaveSensitive);
+  HLOpFunctionRegistry *pRegistry =
+      M.HasHLModule() && group != HLOpcodeGroup::HLExtIntrinsic
+          ? &M.GetHLModule().GetHLOpFunctionRegistry()
+          : nullptr;
+  uint64_t key = HLOpFunctionRegistry::GetFunctionKey(group, opcode, waveSensitive);
+  Function *F = pRegistry ? pRegistry->LookupFunction(funcTy, key) : nullptr;
+  if (F == nullptr) {
+    F = CreateHLFunction(M, funcTy, group, groupName, fnName, opcode,
+                         waveSensitive);
+    if (pRegistry) {
+      pRegistry->AddFunction(funcTy, key, F);
+      pRegistry->AddGroups(F, {group, group});
+    }
   }
 
   SetHLFunctionAttribute(F, group, opcode);
@@ -535,7 +585,7 @@ Function *GetOrCreateHLFunction(Module &M, FunctionType *funcTy,
     F->addFnAttr(Attribute::ReadNone);
   if (attribs.hasAttribute(AttributeSet::FunctionIndex, Attribute::ReadOnly))
     F->addFnAttr(Attribute::ReadOnly);
-  if (attribs.hasAttribute(AttributeSet::FunctionIndex, HLWaveSensitive))
+  if (waveSensitive)
     F->addFnAttr(HLWaveSensitive, "y");
 
   return F;
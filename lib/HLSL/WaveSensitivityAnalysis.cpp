@@ -51,6 +51,13 @@ namespace hlsl {
 // active lanes are modified.
 // To avoid unexpected result, validation will fail if gradient operations
 // are dependent on wave-sensitive data or control flow.
+//
+// The same sparse propagation also answers thread divergence queries: seeded
+// with thread ids, wave and atomic results instead of wave operations only,
+// it finds values that may differ between threads of a group.
+//
+// Results are cached per function: Analyze() on a function that was already
+// analyzed is a no-op.
 
 class WaveSensitivityAnalyzer : public WaveSensitivityAnalysis {
 private:
@@ -60,27 +67,47 @@ private:
     Unknown
   };
   PostDominatorTree *pPDT;
+  bool TrackDivergence;
+  Function *AnalyzedFunction = nullptr;
   map<Instruction *, WaveSensitivity> InstState;
   map<BasicBlock *, WaveSensitivity> BBState;
   std::vector<Instruction *> InstWorkList;
   std::vector<BasicBlock *> BBWorkList;
   bool CheckBBState(BasicBlock *BB, WaveSensitivity WS);
   WaveSensitivity GetInstState(Instruction *I);
+  bool IsSource(OP::OpCode opcode);
+  void Propagate();
   void UpdateBlock(BasicBlock *BB, WaveSensitivity WS);
   void UpdateInst(Instruction *I, WaveSensitivity WS);
   void VisitInst(Instruction *I);
 public:
-  WaveSensitivityAnalyzer(PostDominatorTree &PDT) : pPDT(&PDT) {}
+  WaveSensitivityAnalyzer(PostDominatorTree &PDT, bool TrackDivergence)
+      : pPDT(&PDT), TrackDivergence(TrackDivergence) {}
   void Analyze(Function *F);
   bool IsWaveSensitive(Instruction *op);
+  bool IsDivergent(Value *V);
 };
 
 WaveSensitivityAnalysis* WaveSensitivityAnalysis::create(PostDominatorTree &PDT) {
-  return new WaveSensitivityAnalyzer(PDT);
+  return new WaveSensitivityAnalyzer(PDT, /*TrackDivergence*/ false);
+}
+
+WaveSensitivityAnalysis *
+WaveSensitivityAnalysis::createDivergence(PostDominatorTree &PDT) {
+  return new WaveSensitivityAnalyzer(PDT, /*TrackDivergence*/ true);
 }
 
 void WaveSensitivityAnalyzer::Analyze(Function *F) {
+  if (AnalyzedFunction == F)
+    return;
+  DXASSERT(AnalyzedFunction == nullptr,
+           "else analyzer is reused across functions with a single PDT");
+  AnalyzedFunction = F;
   UpdateBlock(&F->getEntryBlock(), KnownNotSensitive);
+  Propagate();
+}
+
+void WaveSensitivityAnalyzer::Propagate() {
   while (!InstWorkList.empty() || !BBWorkList.empty()) {
     // Process the instruction work list.
     while (!InstWorkList.empty()) {
@@ -157,19 +184,45 @@ void WaveSensitivityAnalyzer::UpdateInst(Instruction *I, WaveSensitivity WS) {
   }
 }
 
+bool WaveSensitivityAnalyzer::IsSource(OP::OpCode opcode) {
+  if (OP::IsDxilOpWave(opcode))
+    return true;
+  if (!TrackDivergence)
+    return false;
+
+  switch (opcode) {
+  case OP::OpCode::ThreadId:
+  case OP::OpCode::ThreadIdInGroup:
+  case OP::OpCode::FlattenedThreadIdInGroup:
+  case OP::OpCode::AtomicBinOp:
+  case OP::OpCode::AtomicCompareExchange:
+    return true;
+  default:
+    return false;
+  }
+}
+
 void WaveSensitivityAnalyzer::VisitInst(Instruction *I) {
   unsigned firstArg = 0;
   if (CallInst *CI = dyn_cast<CallInst>(I)) {
     if (OP::IsDxilOpFuncCallInst(CI)) {
       firstArg = 1;
       OP::OpCode opcode = OP::GetDxilOpFuncCallInst(CI);
-      if (OP::IsDxilOpWave(opcode)) {
+      if (IsSource(opcode)) {
         UpdateInst(I, KnownSensitive);
         return;
       }
     }
   }
 
+  // Every thread gets back a different old value from an atomic on shared
+  // memory.
+  if (TrackDivergence &&
+      (isa<AtomicRMWInst>(I) || isa<AtomicCmpXchgInst>(I))) {
+    UpdateInst(I, KnownSensitive);
+    return;
+  }
+
 
   if (CheckBBState(I->getParent(), KnownSensitive)) {
     UpdateInst(I, KnownSensitive);
@@ -215,4 +268,13 @@ bool WaveSensitivityAnalyzer::IsWaveSensitive(Instruction *op) {
   return (*c).second == KnownSensitive;
 }
 
+bool WaveSensitivityAnalyzer::IsDivergent(Value *V) {
+  // Constants and arguments are treated as uniform, and values in cycles
+  // that never saw a sensitive input stay Unknown; none of them are reported.
+  Instruction *I = dyn_cast<Instruction>(V);
+  if (!I)
+    return false;
+  return GetInstState(I) == KnownSensitive;
+}
+
 } // namespace hlsl
@@ -169,6 +169,19 @@ void LLVMContext::yield() {
     pImpl->YieldCallback(this, pImpl->YieldOpaqueHandle);
 }
 
+// HLSL Change Start
+void LLVMContext::setPassBoundaryCallback(PassBoundaryCallbackTy Callback,
+                                          void *OpaqueHandle) {
+  pImpl->PassBoundaryCallback = Callback;
+  pImpl->PassBoundaryOpaqueHandle = OpaqueHandle;
+}
+
+void LLVMContext::passBoundary(StringRef PassName) {
+  if (pImpl->PassBoundaryCallback)
+    pImpl->PassBoundaryCallback(this, PassName, pImpl->PassBoundaryOpaqueHandle);
+}
+// HLSL Change End
+
 void LLVMContext::emitError(const Twine &ErrorStr) {
   diagnose(DiagnosticInfoInlineAsm(ErrorStr));
 }
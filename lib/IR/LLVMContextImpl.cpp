@@ -44,6 +44,8 @@ LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
   RespectDiagnosticFilters = false;
   YieldCallback = nullptr;
   YieldOpaqueHandle = nullptr;
+  PassBoundaryCallback = nullptr; // HLSL Change
+  PassBoundaryOpaqueHandle = nullptr; // HLSL Change
   NamedStructTypesUniqueID = 0;
 }
 
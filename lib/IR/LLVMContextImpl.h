@@ -937,6 +937,9 @@ public:
   LLVMContext::YieldCallbackTy YieldCallback;
   void *YieldOpaqueHandle;
 
+  LLVMContext::PassBoundaryCallbackTy PassBoundaryCallback; // HLSL Change
+  void *PassBoundaryOpaqueHandle; // HLSL Change
+
   typedef DenseMap<APInt, ConstantInt *, DenseMapAPIntKeyInfo> IntMapTy;
   IntMapTy IntConstants;
 
@@ -1559,6 +1559,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     dumpRequiredSet(FP);
 
     initializeAnalysisImpl(FP);
+    F.getContext().passBoundary(FP->getPassName()); // HLSL Change
 
     {
       PassManagerPrettyStackEntry X(FP, F);
@@ -1635,6 +1636,7 @@ MPPassManager::runOnModule(Module &M) {
     dumpRequiredSet(MP);
 
     initializeAnalysisImpl(MP);
+    M.getContext().passBoundary(MP->getPassName()); // HLSL Change
 
     {
       PassManagerPrettyStackEntry X(MP, M);
@@ -0,0 +1,146 @@
+//===- SHA256.cpp - SHA-256 implementation --------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the SHA-256 secure hash algorithm (FIPS 180-4).
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/SHA256.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstring>
+
+using namespace llvm;
+
+static const uint32_t RoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static inline uint32_t rotr(uint32_t X, unsigned N) {
+  return (X >> N) | (X << (32 - N));
+}
+
+SHA256::SHA256() : ByteCount(0), BufferOffset(0) {
+  State[0] = 0x6a09e667;
+  State[1] = 0xbb67ae85;
+  State[2] = 0x3c6ef372;
+  State[3] = 0xa54ff53a;
+  State[4] = 0x510e527f;
+  State[5] = 0x9b05688c;
+  State[6] = 0x1f83d9ab;
+  State[7] = 0x5be0cd19;
+}
+
+void SHA256::hashBlock(const uint8_t *Block) {
+  uint32_t W[64];
+  for (unsigned I = 0; I < 16; ++I)
+    W[I] = (uint32_t)Block[I * 4] << 24 | (uint32_t)Block[I * 4 + 1] << 16 |
+           (uint32_t)Block[I * 4 + 2] << 8 | (uint32_t)Block[I * 4 + 3];
+  for (unsigned I = 16; I < 64; ++I) {
+    uint32_t S0 = rotr(W[I - 15], 7) ^ rotr(W[I - 15], 18) ^ (W[I - 15] >> 3);
+    uint32_t S1 = rotr(W[I - 2], 17) ^ rotr(W[I - 2], 19) ^ (W[I - 2] >> 10);
+    W[I] = W[I - 16] + S0 + W[I - 7] + S1;
+  }
+
+  uint32_t A = State[0], B = State[1], C = State[2], D = State[3];
+  uint32_t E = State[4], F = State[5], G = State[6], H = State[7];
+  for (unsigned I = 0; I < 64; ++I) {
+    uint32_t S1 = rotr(E, 6) ^ rotr(E, 11) ^ rotr(E, 25);
+    uint32_t Ch = (E & F) ^ (~E & G);
+    uint32_t T1 = H + S1 + Ch + RoundConstants[I] + W[I];
+    uint32_t S0 = rotr(A, 2) ^ rotr(A, 13) ^ rotr(A, 22);
+    uint32_t Maj = (A & B) ^ (A & C) ^ (B & C);
+    uint32_t T2 = S0 + Maj;
+    H = G;
+    G = F;
+    F = E;
+    E = D + T1;
+    D = C;
+    C = B;
+    B = A;
+    A = T1 + T2;
+  }
+
+  State[0] += A;
+  State[1] += B;
+  State[2] += C;
+  State[3] += D;
+  State[4] += E;
+  State[5] += F;
+  State[6] += G;
+  State[7] += H;
+}
+
+void SHA256::update(ArrayRef<uint8_t> Data) {
+  const uint8_t *Ptr = Data.data();
+  size_t Size = Data.size();
+  ByteCount += Size;
+
+  if (BufferOffset != 0) {
+    size_t Fill = std::min<size_t>(Size, 64 - BufferOffset);
+    memcpy(Buffer + BufferOffset, Ptr, Fill);
+    BufferOffset += Fill;
+    Ptr += Fill;
+    Size -= Fill;
+    if (BufferOffset < 64)
+      return;
+    hashBlock(Buffer);
+    BufferOffset = 0;
+  }
+
+  for (; Size >= 64; Ptr += 64, Size -= 64)
+    hashBlock(Ptr);
+
+  memcpy(Buffer, Ptr, Size);
+  BufferOffset = Size;
+}
+
+void SHA256::update(StringRef Str) {
+  ArrayRef<uint8_t> SVal((const uint8_t *)Str.data(), Str.size());
+  update(SVal);
+}
+
+void SHA256::final(SHA256Result &Result) {
+  uint64_t BitCount = ByteCount * 8;
+
+  // Pad with a one bit, zeros up to the last eight bytes of a block, then
+  // the message length in bits.
+  Buffer[BufferOffset++] = 0x80;
+  if (BufferOffset > 56) {
+    memset(Buffer + BufferOffset, 0, 64 - BufferOffset);
+    hashBlock(Buffer);
+    BufferOffset = 0;
+  }
+  memset(Buffer + BufferOffset, 0, 56 - BufferOffset);
+  for (unsigned I = 0; I < 8; ++I)
+    Buffer[56 + I] = (uint8_t)(BitCount >> (56 - I * 8));
+  hashBlock(Buffer);
+
+  for (unsigned I = 0; I < 8; ++I) {
+    Result[I * 4] = (uint8_t)(State[I] >> 24);
+    Result[I * 4 + 1] = (uint8_t)(State[I] >> 16);
+    Result[I * 4 + 2] = (uint8_t)(State[I] >> 8);
+    Result[I * 4 + 3] = (uint8_t)State[I];
+  }
+}
+
+void SHA256::stringifyResult(SHA256Result &Result, SmallString<64> &Str) {
+  raw_svector_ostream Res(Str);
+  for (int i = 0; i < 32; ++i)
+    Res << format("%.2x", Result[i]);
+}
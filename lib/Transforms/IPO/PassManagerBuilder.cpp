@@ -190,6 +190,7 @@ void PassManagerBuilder::populateFunctionPassManager(
     FPM.add(new TargetLibraryInfoWrapperPass(*LibraryInfo));
 
   if (OptLevel == 0) return;
+  if (HLSLResumeAtDxil) return; // HLSL Change - ran before the snapshot
 
   addInitialAliasAnalysisPasses(FPM);
 
@@ -207,14 +208,8 @@ void PassManagerBuilder::populateFunctionPassManager(
 }
 
 // HLSL Change Starts
-static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, bool OnlyWarnOnUnrollFail, bool StructurizeLoopExitsForUnroll, hlsl::HLSLExtensionsCodegenHelper *ExtHelper, legacy::PassManagerBase &MPM) {
-
-  // Don't do any lowering if we're targeting high-level.
-  if (HLSLHighLevel) {
-    MPM.add(createHLEmitMetadataPass());
-    return;
-  }
-
+// Passes up to and including DXIL generation.
+static void addHLSLHighLevelPasses(unsigned OptLevel, hlsl::HLSLExtensionsCodegenHelper *ExtHelper, legacy::PassManagerBase &MPM) {
   MPM.add(createDxilCleanupAddrSpaceCastPass());
 
   MPM.add(createHLPreprocessPass());
@@ -274,6 +269,30 @@ static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, bool OnlyWarnOn
   MPM.add(createInvalidateUndefResourcesPass());
 
   MPM.add(createDxilGenerationPass(NoOpt, ExtHelper));
+}
+
+static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, bool OnlyWarnOnUnrollFail, bool StructurizeLoopExitsForUnroll, hlsl::HLSLExtensionsCodegenHelper *ExtHelper, bool PauseAtDxil, bool ResumeAtDxil, legacy::PassManagerBase &MPM) {
+
+  // Don't do any lowering if we're targeting high-level.
+  if (HLSLHighLevel) {
+    MPM.add(createHLEmitMetadataPass());
+    return;
+  }
+
+  // A snapshot taken at the DXIL boundary has already been through the
+  // high-level passes; reload its DxilModule and carry on from there.
+  if (ResumeAtDxil)
+    MPM.add(createResumePassesPass());
+  else
+    addHLSLHighLevelPasses(OptLevel, ExtHelper, MPM);
+
+  // Emit the DxilModule metadata so the module can be written as a snapshot.
+  if (PauseAtDxil) {
+    MPM.add(createPausePassesPass());
+    return;
+  }
+
+  bool NoOpt = OptLevel == 0;
 
   // Propagate precise attribute.
   MPM.add(createDxilPrecisePropagatePass());
@@ -319,45 +338,51 @@ void PassManagerBuilder::populateModulePassManager(
   // If all optimizations are disabled, just run the always-inline pass and,
   // if enabled, the function merging pass.
   if (OptLevel == 0) {
-    if (!HLSLHighLevel) {
-      MPM.add(createHLEnsureMetadataPass()); // HLSL Change - rehydrate metadata from high-level codegen
-    }
+    // HLSL Change - a snapshot taken at the DXIL boundary has already been
+    // through everything ahead of DXIL generation.
+    if (!HLSLResumeAtDxil) {
+      if (!HLSLHighLevel) {
+        MPM.add(createHLEnsureMetadataPass()); // HLSL Change - rehydrate metadata from high-level codegen
+      }
 
-    MPM.add(createDxilRewriteOutputArgDebugInfoPass()); // Fix output argument types.
+      MPM.add(createDxilRewriteOutputArgDebugInfoPass()); // Fix output argument types.
 
-    if (!HLSLHighLevel)
-      MPM.add(createDxilInsertPreservesPass(HLSLAllowPreserveValues)); // HLSL Change - insert preserve instructions
+      if (!HLSLHighLevel)
+        MPM.add(createDxilInsertPreservesPass(HLSLAllowPreserveValues)); // HLSL Change - insert preserve instructions
 
-    if (Inliner) {
-      MPM.add(createHLLegalizeParameter()); // HLSL Change - legalize parameters
-                                            // before inline.
-      MPM.add(Inliner);
-      Inliner = nullptr;
-    }
+      if (Inliner) {
+        MPM.add(createHLLegalizeParameter()); // HLSL Change - legalize parameters
+                                              // before inline.
+        MPM.add(Inliner);
+        Inliner = nullptr;
+      }
 
-    // FIXME: The BarrierNoopPass is a HACK! The inliner pass above implicitly
-    // creates a CGSCC pass manager, but we don't want to add extensions into
-    // that pass manager. To prevent this we insert a no-op module pass to reset
-    // the pass manager to get the same behavior as EP_OptimizerLast in non-O0
-    // builds. The function merging pass is 
-    if (MergeFunctions)
-      MPM.add(createMergeFunctionsPass());
-    else if (!Extensions.empty()) // HLSL Change - GlobalExtensions not considered
-      MPM.add(createBarrierNoopPass());
+      // FIXME: The BarrierNoopPass is a HACK! The inliner pass above implicitly
+      // creates a CGSCC pass manager, but we don't want to add extensions into
+      // that pass manager. To prevent this we insert a no-op module pass to reset
+      // the pass manager to get the same behavior as EP_OptimizerLast in non-O0
+      // builds. The function merging pass is 
+      if (MergeFunctions)
+        MPM.add(createMergeFunctionsPass());
+      else if (!Extensions.empty()) // HLSL Change - GlobalExtensions not considered
+        MPM.add(createBarrierNoopPass());
 
-    if (!HLSLHighLevel)
-      MPM.add(createDxilPreserveToSelectPass()); // HLSL Change - lower preserve instructions to selects
+      if (!HLSLHighLevel)
+        MPM.add(createDxilPreserveToSelectPass()); // HLSL Change - lower preserve instructions to selects
 
-    addExtensionsToPM(EP_EnabledOnOptLevel0, MPM);
+      addExtensionsToPM(EP_EnabledOnOptLevel0, MPM);
+    }
 
     // HLSL Change Begins.
     addHLSLPasses(HLSLHighLevel, OptLevel,
       this->HLSLOnlyWarnOnUnrollFail,
       this->StructurizeLoopExitsForUnroll,
       this->HLSLExtensionsCodeGen,
+      this->HLSLPauseAtDxil,
+      this->HLSLResumeAtDxil,
       MPM);
 
-    if (!HLSLHighLevel) {
+    if (!HLSLHighLevel && !HLSLPauseAtDxil) {
       MPM.add(createDxilConvergentClearPass());
       MPM.add(createDxilRemoveDeadBlocksPass());
       MPM.add(createDxilNoOptSimplifyInstructionsPass());
@@ -380,21 +405,25 @@ void PassManagerBuilder::populateModulePassManager(
     return;
   }
 
-  if (!HLSLHighLevel) {
+  if (!HLSLHighLevel && !HLSLResumeAtDxil) {
     MPM.add(createHLEnsureMetadataPass()); // HLSL Change - rehydrate metadata from high-level codegen
   }
 
   // HLSL Change Begins
 
-  MPM.add(createDxilRewriteOutputArgDebugInfoPass()); // Fix output argument types.
+  if (!HLSLResumeAtDxil) {
+    MPM.add(createDxilRewriteOutputArgDebugInfoPass()); // Fix output argument types.
 
-  MPM.add(createHLLegalizeParameter()); // legalize parameters before inline.
-  MPM.add(createAlwaysInlinerPass(/*InsertLifeTime*/false));
+    MPM.add(createHLLegalizeParameter()); // legalize parameters before inline.
+    MPM.add(createAlwaysInlinerPass(/*InsertLifeTime*/false));
+  }
   if (Inliner) {
     delete Inliner;
     Inliner = nullptr;
   }
-  addHLSLPasses(HLSLHighLevel, OptLevel, this->HLSLOnlyWarnOnUnrollFail, this->StructurizeLoopExitsForUnroll, HLSLExtensionsCodeGen, MPM); // HLSL Change
+  addHLSLPasses(HLSLHighLevel, OptLevel, this->HLSLOnlyWarnOnUnrollFail, this->StructurizeLoopExitsForUnroll, HLSLExtensionsCodeGen, HLSLPauseAtDxil, HLSLResumeAtDxil, MPM); // HLSL Change
+  if (HLSLPauseAtDxil)
+    return;
   // HLSL Change Ends
 
   // Add LibraryInfo if we have some.
@@ -14,6 +14,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
@@ -585,7 +586,10 @@ struct MemcpySplitter {
 public:
   MemcpySplitter(llvm::LLVMContext &context, DxilTypeSystem &typeSys)
       : m_context(context), m_typeSys(typeSys) {}
-  void Split(llvm::Function &F);
+  void Split(llvm::Function &F, ArrayRef<MemCpyInst *> MemCpys);
+
+  typedef MapVector<Function *, SmallVector<MemCpyInst *, 4>> FunctionMemCpyMap;
+  static void CollectMemCpysByFunction(Module &M, FunctionMemCpyMap &MemCpys);
 
   static void PatchMemCpyWithZeroIdxGEP(Module &M);
   static void PatchMemCpyWithZeroIdxGEP(MemCpyInst *MI, const DataLayout &DL);
@@ -1050,24 +1054,28 @@ void MemcpySplitter::SplitMemCpy(MemCpyInst *MI, const DataLayout &DL,
   DeleteMemcpy(MI);
 }
 
-void MemcpySplitter::Split(llvm::Function &F) {
-  const DataLayout &DL = F.getParent()->getDataLayout();
-  SmallVector<Function *, 2> memcpys;
-  for (Function &Fn : F.getParent()->functions()) {
-    if (Fn.getIntrinsicID() == Intrinsic::memcpy) {
-      memcpys.emplace_back(&Fn);
+// Bucket memcpy calls by their function, keeping declaration and use order,
+// so each function is cleaned up without rescanning the whole module.
+void MemcpySplitter::CollectMemCpysByFunction(Module &M,
+                                              FunctionMemCpyMap &MemCpys) {
+  for (Function &Fn : M.functions()) {
+    if (Fn.getIntrinsicID() != Intrinsic::memcpy)
+      continue;
+    for (User *U : Fn.users()) {
+      MemCpyInst *MI = cast<MemCpyInst>(U);
+      MemCpys[MI->getParent()->getParent()].emplace_back(MI);
     }
   }
-  for (Function *memcpy : memcpys) {
-    for (auto U = memcpy->user_begin(); U != memcpy->user_end();) {
-      MemCpyInst *MI = cast<MemCpyInst>(*(U++));
-      if (MI->getParent()->getParent() != &F)
-        continue;
-      // Matrix is treated as scalar type, will not use memcpy.
-      // So use nullptr for fieldAnnotation should be safe here.
-      SplitMemCpy(MI, DL, /*fieldAnnotation*/ nullptr, m_typeSys,
-                  /*bEltMemCpy*/ false);
-    }
+}
+
+void MemcpySplitter::Split(llvm::Function &F, ArrayRef<MemCpyInst *> MemCpys) {
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  for (MemCpyInst *MI : MemCpys) {
+    DXASSERT_NOMSG(MI->getParent()->getParent() == &F);
+    // Matrix is treated as scalar type, will not use memcpy.
+    // So use nullptr for fieldAnnotation should be safe here.
+    SplitMemCpy(MI, DL, /*fieldAnnotation*/ nullptr, m_typeSys,
+                /*bEltMemCpy*/ false);
   }
 }
 
@@ -1113,10 +1121,11 @@ bool markPrecise(Function &F) {
   return Changed;
 }
 
-bool Cleanup(Function &F, DxilTypeSystem &typeSys) {
+bool Cleanup(Function &F, DxilTypeSystem &typeSys,
+             ArrayRef<MemCpyInst *> MemCpys) {
   // change rest memcpy into ld/st.
   MemcpySplitter splitter(F.getContext(), typeSys);
-  splitter.Split(F);
+  splitter.Split(F, MemCpys);
   return markPrecise(F);
 }
 } // namespace
@@ -1656,12 +1665,20 @@ bool SROAGlobalAndAllocas(HLModule &HLM, bool bHasDbgInfo) {
   for (GlobalVariable *GV : staticGVs)
     WorkList.push(GV);
 
-  DenseMap<Function *, DominatorTree> domTreeMap;
+  // Dominator trees are built on first use. Only allocas that reach memcpy
+  // lowering or scalar replacement need one, and SROA keeps the CFG intact.
+  DenseMap<Function *, std::unique_ptr<DominatorTree>> domTreeMap;
+  auto GetDomTree = [&domTreeMap](Function *F) -> DominatorTree & {
+    std::unique_ptr<DominatorTree> &DT = domTreeMap[F];
+    if (!DT) {
+      DT = llvm::make_unique<DominatorTree>();
+      DT->recalculate(*F);
+    }
+    return *DT;
+  };
   for (Function &F : M) {
     if (F.isDeclaration())
       continue;
-    // Collect domTree.
-    domTreeMap[&F].recalculate(F);
 
     // Scan the entry basic block, adding allocas to the worklist.
     BasicBlock &BB = F.getEntryBlock();
@@ -1704,7 +1721,7 @@ bool SROAGlobalAndAllocas(HLModule &HLM, bool bHasDbgInfo) {
       }
       Function *F = AI->getParent()->getParent();
       const bool bAllowReplace = true;
-      DominatorTree &DT = domTreeMap[F];
+      DominatorTree &DT = GetDomTree(F);
       if (SROA_Helper::LowerMemcpy(AI, /*annotation*/ nullptr, typeSys, DL, &DT,
                                    bAllowReplace)) {
         Changed = true;
@@ -1905,10 +1922,14 @@ bool SROAGlobalAndAllocas(HLModule &HLM, bool bHasDbgInfo) {
   // Remove unused internal global.
   RemoveUnusedInternalGlobalVariable(M);
   // Cleanup memcpy for allocas and mark precise.
+  MemcpySplitter::FunctionMemCpyMap MemCpys;
+  MemcpySplitter::CollectMemCpysByFunction(M, MemCpys);
   for (Function &F : M) {
     if (F.isDeclaration())
       continue;
-    Cleanup(F, typeSys);
+    auto it = MemCpys.find(&F);
+    Cleanup(F, typeSys, it != MemCpys.end() ? ArrayRef<MemCpyInst *>(it->second)
+                                            : ArrayRef<MemCpyInst *>());
   }
 
   return true;
@@ -155,6 +155,9 @@ public:
   unsigned RootSigMajor;
   unsigned RootSigMinor;
   bool IsHLSLLibrary;
+  // Sorted unmangled internal names selected by -exports for a library.
+  // Other functions are only emitted when referenced; empty emits all.
+  std::vector<std::string> HLSLLibraryExportNames;
   bool UseMinPrecision; // use min precision, not native precision.
   bool EnableDX9CompatMode;
   bool EnableFXCCompatMode;
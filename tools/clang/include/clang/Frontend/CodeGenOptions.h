@@ -178,6 +178,9 @@ public:
   std::string HLSLProfile;
   /// Whether to target high-level DXIL.
   bool HLSLHighLevel = false;
+  /// Whether to stop right after DXIL generation, leaving a snapshot that a
+  /// later compile can resume from.
+  bool HLSLPauseAtDxil = false;
   /// Whether we allow preserve intermediate values
   bool HLSLAllowPreserveValues = false;
   /// Whether we fail compilation if loop fails to unroll
@@ -216,6 +219,12 @@ public:
   std::vector<std::string> HLSLLibraryExports;
   /// ExportShadersOnly limits library export functions to shaders
   bool ExportShadersOnly = false;
+  /// Include files whose functions are provided by a linked library; bodies
+  /// defined in them are skipped and emitted as external declarations.
+  std::vector<std::string> HLSLLibraryCacheIncludes;
+  /// Profile a library is compiled to be linked to.  The entry function takes
+  /// its shader stage from it when it has no shader attribute.
+  std::string HLSLLinkProfile;
   /// DefaultLinkage Internal, External, or Default.  If Default, default
   /// function linkage is determined by library target.
   hlsl::DXIL::DefaultLinkage DefaultLinkage = hlsl::DXIL::DefaultLinkage::Default;
@@ -228,6 +237,8 @@ public:
   std::map<std::string, std::string> HLSLOptimizationSelects;
   /// Debug option to print IR after every pass
   bool HLSLPrintAfterAll = false;
+  /// Encode the function bodies of large modules on multiple threads.
+  bool HLSLParallelBitcode = false;
   // HLSL Change Ends
 
   // SPIRV Change Starts
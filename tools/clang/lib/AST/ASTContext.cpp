@@ -8505,8 +8505,18 @@ bool ASTContext::DeclMustBeEmitted(const Decl *D) {
       return false;
     // HLSL Change Starts
     // Don't just return true because of visibility, unless building a library
+    if (getLangOpts().IsHLSLLibrary) {
+      // With -exports, functions that are not exported are deferred and only
+      // emitted if an exported function references them.
+      const std::vector<std::string> &Exports =
+          getLangOpts().HLSLLibraryExportNames;
+      return Exports.empty() || !FD->getIdentifier() ||
+             isa<CXXMethodDecl>(FD) || IsPatchConstantFunctionDecl(FD) ||
+             std::binary_search(Exports.begin(), Exports.end(),
+                                FD->getName());
+    }
     return FD->getName() == getLangOpts().HLSLEntryFunction ||
-           IsPatchConstantFunctionDecl(FD) || getLangOpts().IsHLSLLibrary;
+           IsPatchConstantFunctionDecl(FD);
     // HLSL Change Ends
   }
   
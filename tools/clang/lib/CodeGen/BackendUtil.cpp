@@ -43,6 +43,7 @@
 #include <memory>
 #include "dxc/HLSL/DxilGenerationPass.h" // HLSL Change
 #include "dxc/HLSL/HLMatrixLowerPass.h"  // HLSL Change
+#include "dxc/Support/Global.h"          // HLSL Change
 
 using namespace clang;
 using namespace llvm;
@@ -340,6 +341,13 @@ void EmitAssemblyHelper::CreatePasses() {
                         CodeGenOpts.HLSLOptimizationToggles.count("structurize-loop-exits-for-unroll") &&
                         CodeGenOpts.HLSLOptimizationToggles.find("structurize-loop-exits-for-unroll")->second;
 
+  // A module snapshot taken at the DXIL boundary picks up right after DXIL
+  // generation; anything else starts from the high-level module.
+  StringRef HLSLPause, HLSLResume;
+  hlsl::GetPauseResumePasses(*TheModule, HLSLPause, HLSLResume);
+  PMBuilder.HLSLResumeAtDxil = HLSLResume == "hlsl-dxilload";
+  PMBuilder.HLSLPauseAtDxil = CodeGenOpts.HLSLPauseAtDxil;
+
   // HLSL Change - end
 
   PMBuilder.DisableUnitAtATime = !CodeGenOpts.UnitAtATime;
@@ -683,7 +691,10 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
 
   case Backend_EmitBC:
     getPerModulePasses()->add(
-        createBitcodeWriterPass(*OS, CodeGenOpts.EmitLLVMUseLists));
+        createBitcodeWriterPass(*OS, CodeGenOpts.EmitLLVMUseLists,
+                                CodeGenOpts.HLSLParallelBitcode // HLSL Change
+                                    ? DxcParallelFor
+                                    : BitcodeParallelFor()));
     break;
 
   case Backend_EmitLL:
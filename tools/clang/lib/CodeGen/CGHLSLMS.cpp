@@ -1298,6 +1298,21 @@ void CGMSHLSLRuntime::AddHLSLFunctionInfo(Function *F, const FunctionDecl *FD) {
         DiagnosticsEngine::Error, "Ray function cannot be used as a global entry point");
       Diags.Report(Attr->getLocation(), DiagID);
     }
+  } else if (!CGM.getCodeGenOpts().HLSLLinkProfile.empty() &&
+             FD->getNameAsString() == CGM.getCodeGenOpts().HLSLEntryFunction) {
+    // Library compiled to be linked to a single target: the entry function
+    // is a shader of the stage of that target.
+    const ShaderModel *LinkSM = ShaderModel::GetByName(
+        CGM.getCodeGenOpts().HLSLLinkProfile.c_str());
+    funcProps->shaderKind = LinkSM->GetKind();
+    isCS = LinkSM->IsCS();
+    isGS = LinkSM->IsGS();
+    isHS = LinkSM->IsHS();
+    isDS = LinkSM->IsDS();
+    isVS = LinkSM->IsVS();
+    isPS = LinkSM->IsPS();
+    isMS = LinkSM->IsMS();
+    isAS = LinkSM->IsAS();
   }
 
   // Save patch constant function to patchConstantFunctionMap.
@@ -21,13 +21,62 @@
 #include "clang/Parse/ParseHLSL.h" // root sig would be in Parser if part of lang
 #include "dxc/dxcapi.h"
 
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/Global.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
 using namespace llvm;
 
+namespace {
+// Serialized root signatures that compiled without errors, shared by every
+// compile in the process.  Keyed on version, flags and the root signature
+// string; entries are allocated on the default heap.
+struct CompiledRootSignatureCache {
+  static const size_t kMaxEntries = 256;
+  std::mutex Mutex;
+  std::unordered_map<std::string, CComPtr<IDxcBlob>> Entries;
+};
+
+CompiledRootSignatureCache &GetCompiledRootSignatureCache() {
+  static CompiledRootSignatureCache Cache;
+  return Cache;
+}
+
+std::string GetRootSignatureKey(StringRef rootSigStr,
+                                hlsl::DxilRootSignatureVersion rootSigVer,
+                                hlsl::DxilRootSignatureCompilationFlags flags) {
+  std::string Key;
+  Key.reserve(rootSigStr.size() + 2);
+  Key.push_back((char)rootSigVer);
+  Key.push_back((char)flags);
+  Key.append(rootSigStr.begin(), rootSigStr.end());
+  return Key;
+}
+} // namespace
+
 void clang::CompileRootSignature(
     StringRef rootSigStr, DiagnosticsEngine &Diags, SourceLocation SLoc,
     hlsl::DxilRootSignatureVersion rootSigVer,
     hlsl::DxilRootSignatureCompilationFlags flags,
     hlsl::RootSignatureHandle *pRootSigHandle) {
+  // Root signatures with errors are not cached, so that their diagnostics
+  // are reported by every compile.
+  CompiledRootSignatureCache &Cache = GetCompiledRootSignatureCache();
+  std::string Key = GetRootSignatureKey(rootSigStr, rootSigVer, flags);
+  {
+    std::lock_guard<std::mutex> Lock(Cache.Mutex);
+    auto It = Cache.Entries.find(Key);
+    if (It != Cache.Entries.end()) {
+      pRootSigHandle->LoadSerialized(
+          (const uint8_t *)It->second->GetBufferPointer(),
+          It->second->GetBufferSize());
+      return;
+    }
+  }
+
   std::string OSStr;
   llvm::raw_string_ostream OS(OSStr);
   hlsl::DxilVersionedRootSignatureDesc *D = nullptr;
@@ -44,6 +93,15 @@ void clang::CompileRootSignature(
       hlsl::DeleteRootSignature(D);
     } else {
       pRootSigHandle->Assign(D, pSignature);
+
+      std::lock_guard<std::mutex> Lock(Cache.Mutex);
+      if (Cache.Entries.size() < CompiledRootSignatureCache::kMaxEntries) {
+        DxcThreadMalloc TM(nullptr);
+        CComPtr<IDxcBlob> pCopy;
+        IFT(hlsl::DxcCreateBlobOnHeapCopy(pSignature->GetBufferPointer(),
+                                          pSignature->GetBufferSize(), &pCopy));
+        Cache.Entries.emplace(Key, pCopy);
+      }
     }
   }
 }
\ No newline at end of file
@@ -21,6 +21,8 @@
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendDiagnostic.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h" // HLSL Change
+#include "clang/Lex/MacroInfo.h" // HLSL Change
+#include "clang/Lex/PPCallbacks.h" // HLSL Change
 #include "clang/Lex/Preprocessor.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Bitcode/ReaderWriter.h"
@@ -40,6 +42,155 @@ using namespace clang;
 using namespace llvm;
 
 namespace clang {
+// HLSL Change Starts - functions from cached library includes
+namespace {
+/// Matches files against the includes listed in HLSLLibraryCacheIncludes.
+class LibraryCacheIncludeMatcher {
+public:
+  explicit LibraryCacheIncludeMatcher(const std::vector<std::string> &Includes)
+      : Includes(Includes) {}
+
+  /// Returns the index of the listed include that FE is, or -1.
+  int GetIndex(const FileEntry *FE) {
+    auto It = Indices.find(FE);
+    if (It != Indices.end())
+      return It->second;
+    // The include may have been found through any include path, so match
+    // the listed name against the trailing components of the file name.
+    std::string Name = NormalizeIncludePath(FE->getName());
+    int Result = -1;
+    for (unsigned i = 0; i < Includes.size(); ++i) {
+      std::string Suffix = NormalizeIncludePath(Includes[i]);
+      if (Name == Suffix || StringRef(Name).endswith("/" + Suffix)) {
+        Result = i;
+        break;
+      }
+    }
+    Indices[FE] = Result;
+    return Result;
+  }
+
+  /// Returns true if Loc is in a listed include, or in a file it includes.
+  bool IsInInclude(SourceManager &SM, SourceLocation Loc) {
+    Loc = SM.getExpansionLoc(Loc);
+    while (Loc.isValid()) {
+      FileID FID = SM.getFileID(Loc);
+      if (const FileEntry *FE = SM.getFileEntryForID(FID)) {
+        if (GetIndex(FE) >= 0)
+          return true;
+      }
+      Loc = SM.getIncludeLoc(FID);
+    }
+    return false;
+  }
+
+private:
+  const std::vector<std::string> &Includes;
+  llvm::DenseMap<const FileEntry *, int> Indices;
+
+  static std::string NormalizeIncludePath(StringRef Path) {
+    std::string Result;
+    for (char C : Path)
+      Result.push_back(C == '\\' ? '/' : C);
+    size_t Pos;
+    while ((Pos = Result.find("/./")) != std::string::npos)
+      Result.erase(Pos, 2);
+    if (StringRef(Result).startswith("./"))
+      Result.erase(0, 2);
+    return Result;
+  }
+};
+
+/// The cached library is compiled from a file that includes the listed
+/// headers in order and nothing else, with the shader's command line. Its
+/// key does not cover anything the shader itself declares, so a shader may
+/// only put other listed includes, in the listed order, before each one.
+/// Anything else, such as a #define or a static global ahead of the include,
+/// could change how the header's function bodies are parsed, and is
+/// rejected.
+class LibraryCacheIncludeChecker : public PPCallbacks {
+public:
+  LibraryCacheIncludeChecker(CompilerInstance &CI)
+      : CI(CI), Includes(CI.getCodeGenOpts().HLSLLibraryCacheIncludes),
+        Matcher(Includes) {}
+
+  void FileChanged(SourceLocation Loc, FileChangeReason Reason,
+                   SrcMgr::CharacteristicKind FileType,
+                   FileID PrevFID) override {
+    if (Reason != EnterFile)
+      return;
+    SourceManager &SM = CI.getSourceManager();
+    FileID FID = SM.getFileID(Loc);
+    const FileEntry *FE = SM.getFileEntryForID(FID);
+    int Index = FE ? Matcher.GetIndex(FE) : -1;
+    if (Index < 0)
+      return;
+    // Includes nested in a listed include are compiled into the library in
+    // the same context.
+    SourceLocation IncludeLoc = SM.getIncludeLoc(FID);
+    if (IncludeLoc.isInvalid() || Matcher.IsInInclude(SM, IncludeLoc))
+      return;
+    // Entering it again is harmless; its guard decides what is parsed.
+    if ((unsigned)Index < NextIndex)
+      return;
+
+    DiagnosticsEngine &Diags = CI.getDiagnostics();
+    if ((unsigned)Index != NextIndex) {
+      Diags.Report(IncludeLoc, Diags.getCustomDiagID(
+                                   DiagnosticsEngine::Error,
+                                   "-lib-cache-include '%0' must be included "
+                                   "after '%1', as they are listed"))
+          << Includes[Index] << Includes[NextIndex];
+    }
+    NextIndex = Index + 1;
+
+    Preprocessor &PP = CI.getPreprocessor();
+    for (const auto &Macro : PP.macros(false)) {
+      const MacroDirective *MD =
+          PP.getLocalMacroDirectiveHistory(Macro.first);
+      if (MD && IsFromShader(MD->getLocation())) {
+        Diags.Report(MD->getLocation(),
+                     Diags.getCustomDiagID(
+                         DiagnosticsEngine::Error,
+                         "macro '%0' is changed before -lib-cache-include "
+                         "'%1', which is compiled without it"))
+            << Macro.first->getName() << Includes[Index];
+      }
+    }
+    if (!CI.hasASTContext())
+      return;
+    for (const Decl *D : CI.getASTContext().getTranslationUnitDecl()->decls()) {
+      if (!D->isImplicit() && IsFromShader(D->getLocation())) {
+        Diags.Report(D->getLocation(),
+                     Diags.getCustomDiagID(
+                         DiagnosticsEngine::Error,
+                         "declaration before -lib-cache-include '%0', which "
+                         "is compiled without it"))
+            << Includes[Index];
+      }
+    }
+  }
+
+private:
+  CompilerInstance &CI;
+  const std::vector<std::string> &Includes;
+  LibraryCacheIncludeMatcher Matcher;
+  unsigned NextIndex = 0;
+
+  // Locations in a source file other than the listed includes; predefined
+  // and command-line macros have no file and are part of the library key.
+  bool IsFromShader(SourceLocation Loc) {
+    if (Loc.isInvalid())
+      return false;
+    SourceManager &SM = CI.getSourceManager();
+    SourceLocation FileLoc = SM.getExpansionLoc(Loc);
+    return SM.getFileEntryForID(SM.getFileID(FileLoc)) != nullptr &&
+           !Matcher.IsInInclude(SM, FileLoc);
+  }
+};
+} // namespace
+// HLSL Change Ends
+
   class BackendConsumer : public ASTConsumer {
     virtual void anchor();
     DiagnosticsEngine &Diags;
@@ -71,7 +222,8 @@ namespace clang {
           Context(nullptr), LLVMIRGeneration("LLVM IR Generation Time"),
           Gen(CreateLLVMCodeGen(Diags, InFile, HeaderSearchOpts, PPOpts,
                                 CodeGenOpts, C, CoverageInfo)),
-          LinkModule(LinkModule) {
+          LinkModule(LinkModule),
+          LibraryCacheIncludes(CodeGenOpts.HLSLLibraryCacheIncludes) { // HLSL Change
       llvm::TimePassesIsEnabled = TimePasses;
     }
 
@@ -138,6 +290,31 @@ namespace clang {
         LLVMIRGeneration.stopTimer();
     }
 
+    // HLSL Change Starts - functions from cached library includes
+    // Free functions defined in an include listed in HLSLLibraryCacheIncludes
+    // are provided by a library linked later, so their bodies are skipped and
+    // only declarations are emitted.  Functions the library would not export
+    // (static, inline, templates, methods) keep their bodies.
+    bool shouldSkipFunctionBody(Decl *D) override {
+      if (CodeGenOpts.HLSLLibraryCacheIncludes.empty())
+        return false;
+      const FunctionDecl *FD = dyn_cast<FunctionDecl>(D);
+      if (!FD || isa<CXXMethodDecl>(FD) || FD->isInlineSpecified() ||
+          FD->getStorageClass() == SC_Static ||
+          FD->getDescribedFunctionTemplate() || FD->isTemplateInstantiation() ||
+          !FD->getDeclContext()->isFileContext())
+        return false;
+
+      return LibraryCacheIncludes.IsInInclude(Context->getSourceManager(),
+                                              FD->getLocation());
+    }
+
+  private:
+    LibraryCacheIncludeMatcher LibraryCacheIncludes;
+
+  public:
+    // HLSL Change Ends
+
     void HandleTranslationUnit(ASTContext &C) override {
       {
         PrettyStackTraceString CrashInfo("Per-file LLVM IR generation");
@@ -721,6 +898,12 @@ CodeGenAction::CreateASTConsumer(CompilerInstance &CI, StringRef InFile) {
     LinkModuleToUse = ModuleOrErr.get().release();
   }
 
+  // HLSL Change Starts - functions from cached library includes
+  if (!CI.getCodeGenOpts().HLSLLibraryCacheIncludes.empty())
+    CI.getPreprocessor().addPPCallbacks(
+        llvm::make_unique<LibraryCacheIncludeChecker>(CI));
+  // HLSL Change Ends
+
   CoverageSourceInfo *CoverageInfo = nullptr;
   // Add the preprocessor callback only when the coverage mapping is generated.
   if (CI.getCodeGenOpts().CoverageMapping) {
@@ -0,0 +1,153 @@
+//===--- FusedVisitor.h - Fused Visitor ---------------------------*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LIB_SPIRV_FUSEDVISITOR_H
+#define LLVM_CLANG_LIB_SPIRV_FUSEDVISITOR_H
+
+#include "clang/SPIRV/SpirvVisitor.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace clang {
+namespace spirv {
+
+/// \brief Runs several visitors in a single walk of the module.
+///
+/// Every construct is handed to each visitor in turn, in the order the
+/// visitors were given, before the walk moves on. This is only equivalent to
+/// running the visitors one after the other if no visitor depends on what an
+/// earlier one does to constructs that come later in the walk.
+///
+/// A visitor returning false stops only that visitor; the walk goes on while
+/// any visitor is still running.
+class FusedVisitor : public Visitor {
+public:
+  FusedVisitor(SpirvContext &spvCtx, const SpirvCodeGenOptions &opts,
+               llvm::ArrayRef<Visitor *> visitors)
+      : Visitor(opts, spvCtx), visitors(visitors.begin(), visitors.end()) {}
+
+  bool visit(SpirvModule *m, Phase phase) override {
+    return forEachVisitor([=](Visitor *v) { return v->visit(m, phase); });
+  }
+  bool visit(SpirvFunction *f, Phase phase) override {
+    return forEachVisitor([=](Visitor *v) { return v->visit(f, phase); });
+  }
+  bool visit(SpirvBasicBlock *bb, Phase phase) override {
+    return forEachVisitor([=](Visitor *v) { return v->visit(bb, phase); });
+  }
+
+#define DEFINE_VISIT_METHOD(cls)                                               \
+  bool visit(cls *i) override {                                                \
+    return forEachVisitor([=](Visitor *v) { return v->visit(i); });            \
+  }
+
+  DEFINE_VISIT_METHOD(SpirvCapability)
+  DEFINE_VISIT_METHOD(SpirvExtension)
+  DEFINE_VISIT_METHOD(SpirvExtInstImport)
+  DEFINE_VISIT_METHOD(SpirvMemoryModel)
+  DEFINE_VISIT_METHOD(SpirvEntryPoint)
+  DEFINE_VISIT_METHOD(SpirvExecutionMode)
+  DEFINE_VISIT_METHOD(SpirvString)
+  DEFINE_VISIT_METHOD(SpirvSource)
+  DEFINE_VISIT_METHOD(SpirvModuleProcessed)
+  DEFINE_VISIT_METHOD(SpirvDecoration)
+  DEFINE_VISIT_METHOD(SpirvVariable)
+
+  DEFINE_VISIT_METHOD(SpirvFunctionParameter)
+  DEFINE_VISIT_METHOD(SpirvLoopMerge)
+  DEFINE_VISIT_METHOD(SpirvSelectionMerge)
+  DEFINE_VISIT_METHOD(SpirvBranching)
+  DEFINE_VISIT_METHOD(SpirvBranch)
+  DEFINE_VISIT_METHOD(SpirvBranchConditional)
+  DEFINE_VISIT_METHOD(SpirvKill)
+  DEFINE_VISIT_METHOD(SpirvReturn)
+  DEFINE_VISIT_METHOD(SpirvSwitch)
+  DEFINE_VISIT_METHOD(SpirvUnreachable)
+
+  DEFINE_VISIT_METHOD(SpirvAccessChain)
+  DEFINE_VISIT_METHOD(SpirvAtomic)
+  DEFINE_VISIT_METHOD(SpirvBarrier)
+  DEFINE_VISIT_METHOD(SpirvBinaryOp)
+  DEFINE_VISIT_METHOD(SpirvBitFieldExtract)
+  DEFINE_VISIT_METHOD(SpirvBitFieldInsert)
+  DEFINE_VISIT_METHOD(SpirvConstantBoolean)
+  DEFINE_VISIT_METHOD(SpirvConstantInteger)
+  DEFINE_VISIT_METHOD(SpirvConstantFloat)
+  DEFINE_VISIT_METHOD(SpirvConstantComposite)
+  DEFINE_VISIT_METHOD(SpirvConstantNull)
+  DEFINE_VISIT_METHOD(SpirvCompositeConstruct)
+  DEFINE_VISIT_METHOD(SpirvCompositeExtract)
+  DEFINE_VISIT_METHOD(SpirvCompositeInsert)
+  DEFINE_VISIT_METHOD(SpirvEmitVertex)
+  DEFINE_VISIT_METHOD(SpirvEndPrimitive)
+  DEFINE_VISIT_METHOD(SpirvExtInst)
+  DEFINE_VISIT_METHOD(SpirvFunctionCall)
+  DEFINE_VISIT_METHOD(SpirvNonUniformBinaryOp)
+  DEFINE_VISIT_METHOD(SpirvNonUniformElect)
+  DEFINE_VISIT_METHOD(SpirvNonUniformUnaryOp)
+  DEFINE_VISIT_METHOD(SpirvImageOp)
+  DEFINE_VISIT_METHOD(SpirvImageQuery)
+  DEFINE_VISIT_METHOD(SpirvImageSparseTexelsResident)
+  DEFINE_VISIT_METHOD(SpirvImageTexelPointer)
+  DEFINE_VISIT_METHOD(SpirvLoad)
+  DEFINE_VISIT_METHOD(SpirvCopyObject)
+  DEFINE_VISIT_METHOD(SpirvSampledImage)
+  DEFINE_VISIT_METHOD(SpirvSelect)
+  DEFINE_VISIT_METHOD(SpirvSpecConstantBinaryOp)
+  DEFINE_VISIT_METHOD(SpirvSpecConstantUnaryOp)
+  DEFINE_VISIT_METHOD(SpirvStore)
+  DEFINE_VISIT_METHOD(SpirvUnaryOp)
+  DEFINE_VISIT_METHOD(SpirvVectorShuffle)
+  DEFINE_VISIT_METHOD(SpirvArrayLength)
+  DEFINE_VISIT_METHOD(SpirvRayTracingOpNV)
+  DEFINE_VISIT_METHOD(SpirvDemoteToHelperInvocationEXT)
+  DEFINE_VISIT_METHOD(SpirvDebugInfoNone)
+  DEFINE_VISIT_METHOD(SpirvDebugSource)
+  DEFINE_VISIT_METHOD(SpirvDebugCompilationUnit)
+  DEFINE_VISIT_METHOD(SpirvDebugFunctionDeclaration)
+  DEFINE_VISIT_METHOD(SpirvDebugFunction)
+  DEFINE_VISIT_METHOD(SpirvDebugLocalVariable)
+  DEFINE_VISIT_METHOD(SpirvDebugGlobalVariable)
+  DEFINE_VISIT_METHOD(SpirvDebugOperation)
+  DEFINE_VISIT_METHOD(SpirvDebugExpression)
+  DEFINE_VISIT_METHOD(SpirvDebugDeclare)
+  DEFINE_VISIT_METHOD(SpirvDebugLexicalBlock)
+  DEFINE_VISIT_METHOD(SpirvDebugScope)
+  DEFINE_VISIT_METHOD(SpirvDebugTypeBasic)
+  DEFINE_VISIT_METHOD(SpirvDebugTypeArray)
+  DEFINE_VISIT_METHOD(SpirvDebugTypeVector)
+  DEFINE_VISIT_METHOD(SpirvDebugTypeFunction)
+  DEFINE_VISIT_METHOD(SpirvDebugTypeComposite)
+  DEFINE_VISIT_METHOD(SpirvDebugTypeMember)
+  DEFINE_VISIT_METHOD(SpirvDebugTypeTemplate)
+  DEFINE_VISIT_METHOD(SpirvDebugTypeTemplateParameter)
+
+  DEFINE_VISIT_METHOD(SpirvRayQueryOpKHR)
+#undef DEFINE_VISIT_METHOD
+
+private:
+  /// Calls visitFn on each visitor that is still running and drops the ones
+  /// that return false. Returns false once no visitor is left.
+  template <typename VisitFn> bool forEachVisitor(VisitFn visitFn) {
+    for (auto iter = visitors.begin(); iter != visitors.end();) {
+      if (visitFn(*iter))
+        ++iter;
+      else
+        iter = visitors.erase(iter);
+    }
+    return !visitors.empty();
+  }
+
+  llvm::SmallVector<Visitor *, 4> visitors;
+};
+
+} // end namespace spirv
+} // end namespace clang
+
+#endif // LLVM_CLANG_LIB_SPIRV_FUSEDVISITOR_H
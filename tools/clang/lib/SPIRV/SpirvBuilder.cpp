@@ -11,6 +11,7 @@
 #include "CapabilityVisitor.h"
 #include "DebugTypeVisitor.h"
 #include "EmitVisitor.h"
+#include "FusedVisitor.h"
 #include "LiteralTypeVisitor.h"
 #include "LowerTypeVisitor.h"
 #include "NonUniformVisitor.h"
@@ -1225,11 +1226,13 @@ std::vector<uint32_t> SpirvBuilder::takeModule() {
 
   mod->invokeVisitor(&literalTypeVisitor, true);
 
-  // Propagate NonUniform decorations
-  mod->invokeVisitor(&nonUniformVisitor);
-
-  // Lower types
-  mod->invokeVisitor(&lowerTypeVisitor);
+  // Propagate NonUniform decorations and lower types. Neither looks at what
+  // the other changes, so they share one walk of the module.
+  {
+    Visitor *visitors[] = {&nonUniformVisitor, &lowerTypeVisitor};
+    FusedVisitor fusedVisitor(context, spirvOptions, visitors);
+    mod->invokeVisitor(&fusedVisitor);
+  }
 
   // Generate debug types (if needed)
   if (spirvOptions.debugInfoRich) {
@@ -1243,16 +1246,19 @@ std::vector<uint32_t> SpirvBuilder::takeModule() {
   // Add necessary capabilities and extensions
   mod->invokeVisitor(&capabilityVisitor);
 
-  // Propagate RelaxedPrecision decorations
-  mod->invokeVisitor(&relaxedPrecisionVisitor);
+  // Propagate RelaxedPrecision decorations, and remove BufferBlock decoration
+  // if necessary (this decoration is deprecated after SPIR-V 1.3). The first
+  // only reads AST types and the second only rewrites SPIR-V pointer types,
+  // so they share one walk of the module.
+  {
+    Visitor *visitors[] = {&relaxedPrecisionVisitor, &removeBufferBlockVisitor};
+    FusedVisitor fusedVisitor(context, spirvOptions, visitors);
+    mod->invokeVisitor(&fusedVisitor);
+  }
 
   // Propagate NoContraction decorations
   mod->invokeVisitor(&preciseVisitor, true);
 
-  // Remove BufferBlock decoration if necessary (this decoration is deprecated
-  // after SPIR-V 1.3).
-  mod->invokeVisitor(&removeBufferBlockVisitor);
-
   // Emit SPIR-V
   mod->invokeVisitor(&emitVisitor);
 
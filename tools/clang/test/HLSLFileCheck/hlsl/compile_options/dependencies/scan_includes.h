@@ -0,0 +1,3 @@
+float4 Tint(float4 color) {
+  return color * float4(0.5, 0.5, 0.5, 1);
+}
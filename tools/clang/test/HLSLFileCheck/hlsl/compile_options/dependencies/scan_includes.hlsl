@@ -0,0 +1,24 @@
+// RUN: %dxc -T ps_6_0 -E main -M %s | FileCheck %s
+// RUN: %dxc -T ps_6_0 -E main -M -MF scan_includes.d %s | FileCheck %s -check-prefixes=CHECK,FILE
+// RUN: %dxc -T ps_6_0 -E main -M -Mjson %s | FileCheck %s -check-prefix=JSON
+// RUN: %dxc -T ps_6_0 -E main -MD -MF scan_includes.d %s | FileCheck %s -check-prefixes=CHECK,MD,FILE
+
+// -M lists the files read instead of compiling; -MD lists them after the
+// program. Either list goes to the file -MF names.
+// MD: define void @main()
+// FILE: ; dependency file scan_includes.d
+// CHECK: scan_includes.hlsl: \
+// CHECK-NEXT: scan_includes.hlsl \
+// CHECK-NEXT: scan_includes.h{{$}}
+
+// JSON: "target": "{{.*}}scan_includes.hlsl",
+// JSON-NEXT: "dependencies": [
+// JSON-NEXT: "{{.*}}scan_includes.hlsl",
+// JSON-NEXT: "{{.*}}scan_includes.h"
+// JSON-NEXT: ]
+
+#include "scan_includes.h"
+
+float4 main(float4 color : COLOR) : SV_Target {
+  return Tint(color);
+}
@@ -0,0 +1,19 @@
+// RUN: %dxc -Emain -Tps_6_0 %s | %opt -S -dxil-annotate-with-virtual-regs -hlsl-dxil-debug-instrumentation,compact=1 | %FileCheck %s
+
+// Check that the entry block's record (header 0xFA01) follows the invocation
+// start marker:
+// CHECK: %IncrementForThisInvocation1 = mul i32 12, %OffsetMultiplicand
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_DebugUAV_Handle, i32 %{{[^,]+}}, i32 undef, i32 64001,
+
+// Check that loaded values are recorded, but arithmetic on them is not:
+// CHECK: [[Y:%[0-9]+]] = call float @dx.op.loadInput.f32(i32 4, i32 0, i32 0, i8 1, i32 undef)
+// CHECK: call void @dx.op.bufferStore.f32(i32 69, %dx.types.Handle %PIX_DebugUAV_Handle, i32 %{{[^,]+}}, i32 undef, float [[Y]],
+// CHECK: [[MUL:%[0-9]+]] = fmul fast float
+// CHECK-NOT: bufferStore.f32({{.*}}float [[MUL]],
+// CHECK: [[ADD:%[0-9]+]] = fadd fast float
+// CHECK-NOT: bufferStore.f32({{.*}}float [[ADD]],
+// CHECK: ret void
+
+float4 main(float4 pos : SV_Position) : SV_Target {
+  return pos.x * pos.y + 1;
+}
@@ -0,0 +1,8 @@
+
+float Shade(float f) {
+  return sin(f) * 2;
+}
+
+static float Scale(float f) {
+  return f * 3;
+}
@@ -0,0 +1,21 @@
+// RUN: %dxc -E main -T ps_6_0 -lib-cache-include lib_cache_include.h %s | FileCheck %s
+// RUN: %dxc -T lib_6_3 -lib-cache-include lib_cache_include.h %s | FileCheck %s -check-prefix=LIB
+
+// Functions defined in the cached include are compiled into a separate
+// library and linked into the shader.
+// CHECK: define void @main()
+// CHECK-DAG: call float @dx.op.unary.f32(i32 13
+// CHECK-DAG: fmul fast float %{{.*}}, 3.000000e+00
+// CHECK-NOT: define {{.*}}Shade
+
+// Compiling a library with the include only declares its free functions.
+// LIB-DAG: declare float @"\01?Shade@@YAMM@Z"(float)
+// LIB-DAG: define void @main()
+// LIB-NOT: define {{.*}}Shade
+
+#include "lib_cache_include.h"
+
+[shader("pixel")]
+float main(float f : IN) : SV_Target {
+  return Shade(f) + Scale(f);
+}
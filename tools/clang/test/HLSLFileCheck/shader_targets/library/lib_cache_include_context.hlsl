@@ -0,0 +1,24 @@
+// RUN: %dxc -E main -T ps_6_0 -lib-cache-include lib_cache_include.h -DDEFINE_FIRST %s | FileCheck %s -check-prefix=MACRO
+// RUN: %dxc -E main -T ps_6_0 -lib-cache-include lib_cache_include.h -DDECLARE_FIRST %s | FileCheck %s -check-prefix=DECL
+// RUN: %dxc -E main -T ps_6_0 -lib-cache-include lib_cache_include.h -DSHADE_SCALE=2 %s | FileCheck %s
+
+// The cached library is compiled from the include alone, so the shader may
+// not define macros or declare anything before it. Command-line macros are
+// part of the library's key and are allowed.
+// MACRO: error: macro 'SHADE_SCALE' is changed before -lib-cache-include 'lib_cache_include.h', which is compiled without it
+// DECL: error: declaration before -lib-cache-include 'lib_cache_include.h', which is compiled without it
+// CHECK: define void @main()
+
+#ifdef DEFINE_FIRST
+#define SHADE_SCALE 2
+#endif
+#ifdef DECLARE_FIRST
+static float g_scale = 2;
+#endif
+
+#include "lib_cache_include.h"
+
+[shader("pixel")]
+float main(float f : IN) : SV_Target {
+  return Shade(f) + Scale(f);
+}
@@ -0,0 +1,36 @@
+// RUN: %dxc -T lib_6_3 -exports RayGen;Exported -fcgl %s | FileCheck %s
+// RUN: %dxc -T lib_6_3 -exports RayGen;Exported -fcgl %s | FileCheck %s -check-prefix=SKIP
+
+// Functions that are not exported and not referenced by an export are never
+// emitted, not just removed after codegen.
+// CHECK-DAG: define void @"\01?RayGen@@YAXXZ"()
+// CHECK-DAG: define {{.*}}@"\01?Exported@@YAMM@Z"(float
+// CHECK-DAG: define {{.*}}@"\01?Helper@@YAMM@Z"(float
+// SKIP-NOT: Unreferenced
+// SKIP-NOT: Missed
+
+struct Payload { float4 color; };
+
+RWByteAddressBuffer U0;
+
+float Helper(float f) {
+  return f * 2;
+}
+
+float Exported(float f) {
+  return Helper(f) + 1;
+}
+
+float Unreferenced(float f) {
+  return sin(f);
+}
+
+[shader("raygeneration")]
+void RayGen() {
+  U0.Store(0, asuint(Exported(1.0)));
+}
+
+[shader("miss")]
+void Missed(inout Payload payload) {
+  payload.color = Unreferenced(payload.color.x);
+}
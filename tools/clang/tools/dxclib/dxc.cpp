@@ -351,6 +351,24 @@ int DxcContext::ActOnBlob(IDxcBlob *pBlob, IDxcBlob *pDebugBlob, LPCWSTR pDebugB
       IFT(m_dxcSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
       std::string Message = "Disassembly failed";
       IFT(pLibrary->CreateBlobWithEncodingOnHeapCopy((LPBYTE)&Message[0], Message.size(), CP_ACP, &pDisassembleResult));
+  } else if (!m_Opts.AssemblyFunction.empty()) {
+      CComPtr<IDxcCompiler5> pCompiler;
+      IFT(CreateInstance(CLSID_DxcCompiler, &pCompiler));
+      DxcBuffer Buffer = { pBlob->GetBufferPointer(), pBlob->GetBufferSize(), 0 };
+      CComPtr<IDxcResult> pResult;
+      IFT(pCompiler->DisassembleFunction(
+          &Buffer, StringRefUtf16(m_Opts.AssemblyFunction), IID_PPV_ARGS(&pResult)));
+      HRESULT status;
+      IFT(pResult->GetStatus(&status));
+      if (FAILED(status)) {
+        CComPtr<IDxcBlobEncoding> pErrors;
+        IFT(pResult->GetErrorBuffer(&pErrors));
+        WriteBlobToConsole(pErrors, STD_ERROR_HANDLE);
+        return 1;
+      }
+      CComPtr<IDxcBlob> pDisassembly;
+      IFT(pResult->GetResult(&pDisassembly));
+      IFT(pDisassembly.QueryInterface(&pDisassembleResult));
   } else {
       CComPtr<IDxcCompiler> pCompiler;
       IFT(CreateInstance(CLSID_DxcCompiler, &pCompiler));
@@ -895,7 +913,14 @@ int DxcContext::Compile() {
   if (SUCCEEDED(status) || m_Opts.AstDump || m_Opts.OptDump) {
     CComPtr<IDxcBlob> pProgram;
     IFT(pCompileResult->GetResult(&pProgram));
-    if (pProgram.p != nullptr) {
+    if (pProgram.p != nullptr && m_Opts.ScanDependencies) {
+      // With -M the result is the dependency list rather than a program.
+      if (m_Opts.DependencyFile.empty())
+        WriteBlobToConsole(pProgram, STD_OUTPUT_HANDLE);
+      else
+        WriteBlobToFile(pProgram, m_Opts.DependencyFile, m_Opts.DefaultTextCodePage);
+    }
+    else if (pProgram.p != nullptr) {
       ActOnBlob(pProgram.p, pDebugBlob, outputPDBPath.c_str());
 
       // Now write out extra parts
@@ -904,6 +929,7 @@ int DxcContext::Compile() {
         WriteDxcOutputToFile(DXC_OUT_ROOT_SIGNATURE, pResult, m_Opts.DefaultTextCodePage);
         WriteDxcOutputToFile(DXC_OUT_SHADER_HASH, pResult, m_Opts.DefaultTextCodePage);
         WriteDxcOutputToFile(DXC_OUT_REFLECTION, pResult, m_Opts.DefaultTextCodePage);
+        WriteDxcOutputToFile(DXC_OUT_DEPENDENCIES, pResult, m_Opts.DefaultTextCodePage);
         WriteDxcExtraOuputs(pResult);
       }
     }
@@ -18,6 +18,7 @@
 #include "dxcetw.h"
 #endif
 #include "dxillib.h"
+#include "dxccompilebudget.h"
 
 namespace hlsl {
 HRESULT SetupRegistryPassForHLSL();
@@ -45,6 +46,45 @@ void  __CRTDECL operator delete (void* ptr) throw() {
 void  __CRTDECL operator delete (void* ptr, const std::nothrow_t& nothrow_constant) throw() {
   DxcGetThreadMallocNoRef()->Free(ptr);
 }
+#else
+// operator new and friends.  The thread allocator cannot be used here, as
+// the C++ runtime frees some of the blocks this library allocates and the
+// other way around, so these stay with malloc and only charge the budget of
+// the compile running on the thread.  dxcompiler.map keeps them out of the
+// exported symbols, so that they do not replace the host's.
+void *operator new(std::size_t size) {
+  void *ptr = dxcutil::DxcCompileBudget::AllocateOnThread(size);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+void *operator new[](std::size_t size) {
+  return ::operator new(size);
+}
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return dxcutil::DxcCompileBudget::AllocateOnThread(size);
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return dxcutil::DxcCompileBudget::AllocateOnThread(size);
+}
+void operator delete(void *ptr) noexcept {
+  dxcutil::DxcCompileBudget::FreeOnThread(ptr);
+}
+void operator delete[](void *ptr) noexcept {
+  dxcutil::DxcCompileBudget::FreeOnThread(ptr);
+}
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+  dxcutil::DxcCompileBudget::FreeOnThread(ptr);
+}
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  dxcutil::DxcCompileBudget::FreeOnThread(ptr);
+}
+void operator delete(void *ptr, std::size_t) noexcept {
+  dxcutil::DxcCompileBudget::FreeOnThread(ptr);
+}
+void operator delete[](void *ptr, std::size_t) noexcept {
+  dxcutil::DxcCompileBudget::FreeOnThread(ptr);
+}
 #endif
 
 static HRESULT InitMaybeFail() throw() {
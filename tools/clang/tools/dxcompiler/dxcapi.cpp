@@ -34,12 +34,14 @@ DEFINE_CROSS_PLATFORM_UUIDOF(IDxcOperationResult)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcAssembler)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcBlob)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcIncludeHandler)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompileCallback)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler2)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcVersionInfo)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcVersionInfo2)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcValidator)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcContainerBuilder)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcContainerBuilder2)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcOptimizerPass)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcOptimizer)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcRewriter)
@@ -53,6 +55,14 @@ DEFINE_CROSS_PLATFORM_UUIDOF(IDxcUtils)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcResult)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcExtraOutputs)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler3)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler4)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler5)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler6)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler7)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcPermutationResults)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler8)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcPipelineResults)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler9)
 
 HRESULT CreateDxcCompiler(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcDiaDataSource(_In_ REFIID riid, _Out_ LPVOID *ppv);
@@ -131,6 +141,12 @@ static HRESULT ThreadMallocDxcCreateInstance(
   else if (IsEqualCLSID(rclsid, CLSID_DxcIntelliSense)) {
     hr = CreateDxcIntelliSense(riid, ppv);
   }
+  else if (IsEqualCLSID(rclsid, CLSID_DxcLinker)) {
+    hr = CreateDxcLinker(riid, ppv);
+  }
+  else if (IsEqualCLSID(rclsid, CLSID_DxcContainerBuilder)) {
+    hr = CreateDxcContainerBuilder(riid, ppv);
+  }
 // Note: The following targets are not yet enabled for non-Windows platforms.
 #ifdef _WIN32
   else if (IsEqualCLSID(rclsid, CLSID_DxcRewriter)) {
@@ -142,12 +158,6 @@ static HRESULT ThreadMallocDxcCreateInstance(
   else if (IsEqualCLSID(rclsid, CLSID_DxcContainerReflection)) {
     hr = CreateDxcContainerReflection(riid, ppv);
   }
-  else if (IsEqualCLSID(rclsid, CLSID_DxcLinker)) {
-    hr = CreateDxcLinker(riid, ppv);
-  }
-  else if (IsEqualCLSID(rclsid, CLSID_DxcContainerBuilder)) {
-    hr = CreateDxcContainerBuilder(riid, ppv);
-  }
 #endif
   else {
     hr = REGDB_E_CLASSNOTREG;
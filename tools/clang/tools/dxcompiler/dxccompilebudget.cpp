@@ -0,0 +1,205 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilebudget.cpp                                                      //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Implements the memory and time budget of a compile.                       //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxccompilebudget.h"
+#include "dxc/Support/ErrorCodes.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/Compiler.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace dxcutil {
+
+// The time budget is checked on this many allocations, besides the checks
+// at the start of each pass and phase.
+static const unsigned TimeCheckAllocInterval = 4096;
+
+// The budget charged by operator new and delete on this thread.
+static LLVM_THREAD_LOCAL DxcCompileBudget *g_pThreadBudget;
+
+DxcCompileBudget::DxcCompileBudget(IMalloc *pMalloc, uint64_t memoryLimit,
+                                   unsigned timeLimitMs)
+    : m_dwRef(0), m_pMalloc(pMalloc), m_MemoryLimit(memoryLimit),
+      m_TimeLimit(timeLimitMs), m_Start(std::chrono::steady_clock::now()),
+      m_MemoryUsed(0), m_AllocCount(0), m_MemoryExceeded(false),
+      m_TimeExceeded(false), m_Phase("front end") {}
+
+HRESULT DxcCompileBudget::Create(IMalloc *pMalloc, uint64_t memoryLimit,
+                                 unsigned timeLimitMs,
+                                 DxcCompileBudget **ppBudget) {
+  *ppBudget = nullptr;
+  void *P = pMalloc->Alloc(sizeof(DxcCompileBudget));
+  if (P == nullptr)
+    return E_OUTOFMEMORY;
+  DxcCompileBudget *pBudget;
+  try {
+    pBudget = new (P) DxcCompileBudget(pMalloc, memoryLimit, timeLimitMs);
+  } catch (...) {
+    pMalloc->Free(P);
+    return E_OUTOFMEMORY;
+  }
+  pBudget->AddRef();
+  *ppBudget = pBudget;
+  return S_OK;
+}
+
+bool DxcCompileBudget::IsOverTime() const {
+  return m_TimeLimit.count() != 0 &&
+         std::chrono::steady_clock::now() - m_Start > m_TimeLimit;
+}
+
+uint64_t DxcCompileBudget::GetMemoryUsed() const {
+  int64_t used = m_MemoryUsed;
+  return used > 0 ? (uint64_t)used : 0;
+}
+
+bool DxcCompileBudget::CanAllocate(size_t cb) {
+  if (m_MemoryLimit != 0 && GetMemoryUsed() + cb > m_MemoryLimit) {
+    m_MemoryExceeded = true;
+    return false;
+  }
+  if (++m_AllocCount % TimeCheckAllocInterval == 0 && IsOverTime()) {
+    m_TimeExceeded = true;
+    return false;
+  }
+  return true;
+}
+
+#ifndef _WIN32
+void DxcCompileBudget::TrackBlock(void *pv, size_t cb) {
+  std::lock_guard<std::mutex> lock(m_BlocksMutex);
+  size_t &size = m_BlockSizes[pv];
+  m_MemoryUsed += (int64_t)cb - (int64_t)size;
+  size = cb;
+}
+
+void DxcCompileBudget::UntrackBlock(void *pv) {
+  std::lock_guard<std::mutex> lock(m_BlocksMutex);
+  auto it = m_BlockSizes.find(pv);
+  if (it == m_BlockSizes.end())
+    return;
+  m_MemoryUsed -= it->second;
+  m_BlockSizes.erase(it);
+}
+
+void *DxcCompileBudget::AllocateOnThread(size_t cb) {
+  DxcCompileBudget *pBudget = g_pThreadBudget;
+  if (pBudget && !pBudget->CanAllocate(cb))
+    return nullptr;
+  void *P = malloc(cb ? cb : 1);
+  if (P && pBudget)
+    pBudget->TrackBlock(P, cb);
+  return P;
+}
+
+void DxcCompileBudget::FreeOnThread(void *pv) {
+  if (pv && g_pThreadBudget)
+    g_pThreadBudget->UntrackBlock(pv);
+  free(pv);
+}
+#endif
+
+DxcCompileBudget::ThreadScope::ThreadScope(DxcCompileBudget *pBudget)
+    : m_pPrior(g_pThreadBudget) {
+  g_pThreadBudget = pBudget;
+}
+
+DxcCompileBudget::ThreadScope::~ThreadScope() { g_pThreadBudget = m_pPrior; }
+
+void *DxcCompileBudget::Alloc(SIZE_T cb) {
+  if (!CanAllocate(cb))
+    return nullptr;
+  void *P = m_pMalloc->Alloc(cb);
+  if (P) {
+#ifdef _WIN32
+    m_MemoryUsed += m_pMalloc->GetSize(P);
+#else
+    TrackBlock(P, cb);
+#endif
+  }
+  return P;
+}
+
+void *DxcCompileBudget::Realloc(void *pv, SIZE_T cb) {
+#ifdef _WIN32
+  SIZE_T oldSize = pv ? m_pMalloc->GetSize(pv) : 0;
+  if (m_MemoryLimit != 0 && cb > oldSize &&
+      GetMemoryUsed() + (cb - oldSize) > m_MemoryLimit) {
+    m_MemoryExceeded = true;
+    return nullptr;
+  }
+  void *P = m_pMalloc->Realloc(pv, cb);
+  if (P)
+    m_MemoryUsed += (int64_t)m_pMalloc->GetSize(P) - (int64_t)oldSize;
+  else if (cb == 0)
+    m_MemoryUsed -= oldSize;
+  return P;
+#else
+  // The old block may not have been allocated under the budget, so the
+  // whole new size is checked against it.
+  if (!CanAllocate(cb))
+    return nullptr;
+  void *P = m_pMalloc->Realloc(pv, cb);
+  if (P || cb == 0)
+    UntrackBlock(pv);
+  if (P)
+    TrackBlock(P, cb);
+  return P;
+#endif
+}
+
+void DxcCompileBudget::Free(void *pv) {
+  if (pv) {
+#ifdef _WIN32
+    m_MemoryUsed -= m_pMalloc->GetSize(pv);
+#else
+    UntrackBlock(pv);
+#endif
+  }
+  m_pMalloc->Free(pv);
+}
+
+#ifdef _WIN32
+SIZE_T DxcCompileBudget::GetSize(void *pv) { return m_pMalloc->GetSize(pv); }
+
+int DxcCompileBudget::DidAlloc(void *pv) { return m_pMalloc->DidAlloc(pv); }
+
+void DxcCompileBudget::HeapMinimize(void) { m_pMalloc->HeapMinimize(); }
+#endif
+
+void DxcCompileBudget::EnterPhase(StringRef name) {
+  Check();
+  std::lock_guard<std::mutex> lock(m_PhaseMutex);
+  m_Phase = name;
+}
+
+void DxcCompileBudget::Check() {
+  if (m_MemoryLimit != 0 && GetMemoryUsed() > m_MemoryLimit)
+    m_MemoryExceeded = true;
+  if (IsOverTime())
+    m_TimeExceeded = true;
+  if (IsExceeded())
+    throw hlsl::Exception(DXC_E_COMPILE_BUDGET_EXCEEDED, GetExceededMessage());
+}
+
+std::string DxcCompileBudget::GetExceededMessage() {
+  std::lock_guard<std::mutex> lock(m_PhaseMutex);
+  if (m_MemoryExceeded)
+    return (Twine("compilation exceeded its memory budget of ") +
+            Twine(m_MemoryLimit >> 20) + " MB in " + m_Phase)
+        .str();
+  return (Twine("compilation exceeded its time budget of ") +
+          Twine(m_TimeLimit.count()) + " ms in " + m_Phase)
+      .str();
+}
+
+} // namespace dxcutil
@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilebudget.h                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the memory and time budget of a compile.                         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/microcom.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#ifndef _WIN32
+#include <new>
+#include <unordered_map>
+#endif
+
+namespace dxcutil {
+
+#ifndef _WIN32
+// Allocates with malloc, so that the containers of the budget do not go
+// through the operator new that charges it.
+template <typename T> struct DxcMallocAllocator {
+  typedef T value_type;
+  DxcMallocAllocator() {}
+  template <typename U> DxcMallocAllocator(const DxcMallocAllocator<U> &) {}
+  T *allocate(size_t n) {
+    T *p = (T *)malloc(n * sizeof(T));
+    if (p == nullptr)
+      throw std::bad_alloc();
+    return p;
+  }
+  void deallocate(T *p, size_t) { free(p); }
+  template <typename U> bool operator==(const DxcMallocAllocator<U> &) const {
+    return true;
+  }
+  template <typename U> bool operator!=(const DxcMallocAllocator<U> &) const {
+    return false;
+  }
+};
+#endif
+
+// Holds a compile to the memory and time budgets it was given.
+//
+// Installed as the thread allocator for the compile, it keeps count of the
+// memory the compile holds and refuses allocations past the memory budget.
+// Off Windows most of the compile allocates with operator new rather than
+// through the thread allocator, so the operator new and delete of this
+// library charge the budget the compile's ThreadScope installs instead.  The
+// passes and phases of the compile check both budgets as they start, and an
+// exceeded budget throws an hlsl::Exception naming the phase that was
+// running.
+class DxcCompileBudget : public IMalloc {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  uint64_t m_MemoryLimit;           // Bytes, or zero for no limit.
+  std::chrono::milliseconds m_TimeLimit; // Zero for no limit.
+  std::chrono::steady_clock::time_point m_Start;
+  std::atomic<int64_t> m_MemoryUsed;
+  std::atomic<unsigned> m_AllocCount;
+  std::atomic<bool> m_MemoryExceeded;
+  std::atomic<bool> m_TimeExceeded;
+  std::mutex m_PhaseMutex;
+  std::string m_Phase;
+#ifndef _WIN32
+  // Sizes of the blocks allocated under the budget and not yet freed; there
+  // is no IMalloc::GetSize here, and blocks allocated before the budget, or
+  // by the C++ runtime, must not be taken off its count when freed.
+  typedef std::unordered_map<
+      void *, size_t, std::hash<void *>, std::equal_to<void *>,
+      DxcMallocAllocator<std::pair<void *const, size_t>>> BlockSizeMap;
+  std::mutex m_BlocksMutex;
+  BlockSizeMap m_BlockSizes;
+
+  void TrackBlock(void *pv, size_t cb);
+  void UntrackBlock(void *pv);
+#endif
+
+  bool IsOverTime() const;
+  uint64_t GetMemoryUsed() const;
+  // Returns false, marking the budget exceeded, if an allocation of cb bytes
+  // would go over the memory budget or the time budget has run out.
+  bool CanAllocate(size_t cb);
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DxcCompileBudget(IMalloc *pMalloc, uint64_t memoryLimit,
+                   unsigned timeLimitMs);
+
+  // Creates a budget over pMalloc; a limit of zero is not enforced.
+  static HRESULT Create(_In_ IMalloc *pMalloc, uint64_t memoryLimit,
+                        unsigned timeLimitMs,
+                        _COM_Outptr_ DxcCompileBudget **ppBudget);
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid,
+                                           void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(_In_ SIZE_T cb) override;
+  void *STDMETHODCALLTYPE Realloc(_In_opt_ void *pv, _In_ SIZE_T cb) override;
+  void STDMETHODCALLTYPE Free(_In_opt_ void *pv) override;
+#ifdef _WIN32
+  SIZE_T STDMETHODCALLTYPE GetSize(_In_opt_ void *pv) override;
+  int STDMETHODCALLTYPE DidAlloc(_In_opt_ void *pv) override;
+  void STDMETHODCALLTYPE HeapMinimize(void) override;
+#endif
+
+  // Makes a budget the one charged by operator new and delete on this
+  // thread, and restores the previous one when it goes out of scope.  A null
+  // budget charges nothing.
+  class ThreadScope {
+    DxcCompileBudget *m_pPrior;
+
+  public:
+    explicit ThreadScope(DxcCompileBudget *pBudget);
+    ~ThreadScope();
+  };
+
+#ifndef _WIN32
+  // operator new and delete of this library: malloc and free, charging the
+  // budget of the thread's ThreadScope.  AllocateOnThread returns null when
+  // the budget refuses the allocation.
+  static void *AllocateOnThread(size_t cb);
+  static void FreeOnThread(void *pv);
+#endif
+
+  // Checks the budgets against the phase running so far, then makes name
+  // the running phase.
+  void EnterPhase(llvm::StringRef name);
+
+  // Throws if a budget has been exceeded.
+  void Check();
+
+  // True once a budget has been exceeded; an allocation failure is then
+  // reported through GetExceededMessage rather than as out of memory.
+  bool IsExceeded() const { return m_MemoryExceeded || m_TimeExceeded; }
+  std::string GetExceededMessage();
+};
+
+} // namespace dxcutil
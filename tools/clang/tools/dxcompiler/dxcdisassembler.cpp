@@ -31,6 +31,7 @@
 #include "llvm/IR/ValueSymbolTable.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include <assert.h> // Needed for DxilPipelineStateValidation.h
 #include "dxc/DxilContainer/DxilPipelineStateValidation.h"
 #include "dxc/DxilContainer/DxilContainer.h"
@@ -58,7 +59,7 @@ bool SigElementHasStream(const DxilProgramSignatureElement &pSignature) {
 }
 
 void PrintSignature(LPCSTR pName, const DxilProgramSignature *pSignature,
-                           bool bIsInput, raw_string_ostream &OS,
+                           bool bIsInput, raw_ostream &OS,
                            StringRef comment) {
   OS << comment << "\n"
      << comment << " " << pName << " signature:\n"
@@ -272,7 +273,7 @@ void PrintSignature(LPCSTR pName, const DxilProgramSignature *pSignature,
   OS << comment << "\n";
 }
 
-void PintCompMaskNameCompact(raw_string_ostream &OS, unsigned CompMask) {
+void PintCompMaskNameCompact(raw_ostream &OS, unsigned CompMask) {
   char Mask[5];
   memset(Mask, '\0', sizeof(Mask));
   unsigned idx = 0;
@@ -288,7 +289,7 @@ void PintCompMaskNameCompact(raw_string_ostream &OS, unsigned CompMask) {
 }
 
 void PrintDxilSignature(LPCSTR pName, const DxilSignature &Signature,
-                               raw_string_ostream &OS, StringRef comment) {
+                               raw_ostream &OS, StringRef comment) {
   const std::vector<std::unique_ptr<DxilSignatureElement>> &sigElts =
       Signature.GetElements();
   if (sigElts.size() == 0)
@@ -347,7 +348,7 @@ PCSTR g_pFeatureInfoNames[] = {
 static_assert(_countof(g_pFeatureInfoNames) == ShaderFeatureInfoCount, "g_pFeatureInfoNames needs to be updated");
 
 void PrintFeatureInfo(const DxilShaderFeatureInfo *pFeatureInfo,
-                             raw_string_ostream &OS, StringRef comment) {
+                             raw_ostream &OS, StringRef comment) {
   uint64_t featureFlags = pFeatureInfo->FeatureFlags;
   if (!featureFlags)
     return;
@@ -361,7 +362,7 @@ void PrintFeatureInfo(const DxilShaderFeatureInfo *pFeatureInfo,
 }
 
 void PrintResourceFormat(DxilResourceBase &res, unsigned alignment,
-                                raw_string_ostream &OS) {
+                                raw_ostream &OS) {
   switch (res.GetClass()) {
   case DxilResourceBase::Class::CBuffer:
   case DxilResourceBase::Class::Sampler:
@@ -391,7 +392,7 @@ void PrintResourceFormat(DxilResourceBase &res, unsigned alignment,
 }
 
 void PrintResourceDim(DxilResourceBase &res, unsigned alignment,
-                             raw_string_ostream &OS) {
+                             raw_ostream &OS) {
   switch (res.GetClass()) {
   case DxilResourceBase::Class::CBuffer:
   case DxilResourceBase::Class::Sampler:
@@ -434,7 +435,7 @@ void PrintResourceDim(DxilResourceBase &res, unsigned alignment,
   }
 }
 
-void PrintResourceBinding(DxilResourceBase &res, raw_string_ostream &OS,
+void PrintResourceBinding(DxilResourceBase &res, raw_ostream &OS,
                                  StringRef comment) {
   OS << comment << " " << left_justify(res.GetGlobalName(), 31);
 
@@ -460,7 +461,7 @@ void PrintResourceBinding(DxilResourceBase &res, raw_string_ostream &OS,
     OS << right_justify("unbounded", 6) << "\n";
 }
 
-void PrintResourceBindings(DxilModule &M, raw_string_ostream &OS,
+void PrintResourceBindings(DxilModule &M, raw_ostream &OS,
                                   StringRef comment) {
   OS << comment << "\n"
      << comment << " Resource Bindings:\n"
@@ -527,7 +528,7 @@ void PrintInputsContributingToOutputs(
   }
 }
 
-void PrintViewIdState(DxilModule &M, raw_string_ostream &OS,
+void PrintViewIdState(DxilModule &M, raw_ostream &OS,
                              StringRef comment) {
   if (!M.GetModule()->getNamedMetadata("dx.viewIdState"))
     return;
@@ -655,7 +656,7 @@ static const char *HitGroupTypeToString(DXIL::HitGroupType type) {
 }
 
 template <typename _T>
-void PrintFlags(raw_string_ostream &OS, uint32_t Flags) {
+void PrintFlags(raw_ostream &OS, uint32_t Flags) {
   if (!Flags) {
     OS << "0";
     return;
@@ -671,7 +672,7 @@ void PrintFlags(raw_string_ostream &OS, uint32_t Flags) {
 }
 
 void PrintSubobjects(const DxilSubobjects &subobjects,
-                     raw_string_ostream &OS,
+                     raw_ostream &OS,
                      StringRef comment) {
   if (subobjects.GetSubobjects().empty())
     return;
@@ -788,7 +789,7 @@ void PrintSubobjects(const DxilSubobjects &subobjects,
 }
 
 void PrintStructLayout(StructType *ST, DxilTypeSystem &typeSys, const DataLayout *DL,
-                       raw_string_ostream &OS, StringRef comment,
+                       raw_ostream &OS, StringRef comment,
                        StringRef varName, unsigned offset,
                        unsigned indent, unsigned arraySize,
                        unsigned sizeOfStruct = 0);
@@ -828,7 +829,7 @@ void PrintTypeAndName(llvm::Type *Ty, DxilFieldAnnotation &annotation,
 
 void PrintFieldLayout(llvm::Type *Ty, DxilFieldAnnotation &annotation,
                       DxilTypeSystem &typeSys, const DataLayout* DL,
-                      raw_string_ostream &OS,
+                      raw_ostream &OS,
                       StringRef comment, unsigned offset,
                       unsigned indent, unsigned offsetIndent,
                       unsigned sizeToPrint = 0) {
@@ -898,7 +899,7 @@ void PrintFieldLayout(llvm::Type *Ty, DxilFieldAnnotation &annotation,
 
 // null DataLayout => assume constant buffer layout
 void PrintStructLayout(StructType *ST, DxilTypeSystem &typeSys, const DataLayout *DL,
-                       raw_string_ostream &OS, StringRef comment,
+                       raw_ostream &OS, StringRef comment,
                        StringRef varName, unsigned offset,
                        unsigned indent, unsigned offsetIndent,
                        unsigned sizeOfStruct) {
@@ -946,7 +947,7 @@ void PrintStructLayout(StructType *ST, DxilTypeSystem &typeSys, const DataLayout
 void PrintStructBufferDefinition(DxilResource *buf,
                                         DxilTypeSystem &typeSys,
                                         const DataLayout &DL,
-                                        raw_string_ostream &OS,
+                                        raw_ostream &OS,
                                         StringRef comment) {
   const unsigned offsetIndent = 50;
 
@@ -993,7 +994,7 @@ void PrintStructBufferDefinition(DxilResource *buf,
 }
 
 void PrintTBufferDefinition(DxilResource *buf, DxilTypeSystem &typeSys,
-                                   raw_string_ostream &OS, StringRef comment) {
+                                   raw_ostream &OS, StringRef comment) {
   const unsigned offsetIndent = 50;
   llvm::Type *Ty = buf->GetGlobalSymbol()->getType()->getPointerElementType();
   // For TextureBuffer<> buf[2], the array size is in Resource binding count
@@ -1019,7 +1020,7 @@ void PrintTBufferDefinition(DxilResource *buf, DxilTypeSystem &typeSys,
 }
 
 void PrintCBufferDefinition(DxilCBuffer *buf, DxilTypeSystem &typeSys,
-                                   raw_string_ostream &OS, StringRef comment) {
+                                   raw_ostream &OS, StringRef comment) {
   const unsigned offsetIndent = 50;
   llvm::Type *Ty = buf->GetGlobalSymbol()->getType()->getPointerElementType();
   // For ConstantBuffer<> buf[2], the array size is in Resource binding count
@@ -1045,7 +1046,7 @@ void PrintCBufferDefinition(DxilCBuffer *buf, DxilTypeSystem &typeSys,
   OS << comment << "\n";
 }
 
-void PrintBufferDefinitions(DxilModule &M, raw_string_ostream &OS,
+void PrintBufferDefinitions(DxilModule &M, raw_ostream &OS,
                                    StringRef comment) {
   OS << comment << "\n"
      << comment << " Buffer Definitions:\n"
@@ -1501,7 +1502,7 @@ public:
 
 void PrintPipelineStateValidationRuntimeInfo(const char *pBuffer,
                                                     DXIL::ShaderKind shaderKind,
-                                                    raw_string_ostream &OS,
+                                                    raw_ostream &OS,
                                                     StringRef comment) {
   OS << comment << "\n"
      << comment << " Pipeline Runtime Information: \n"
@@ -1998,27 +1999,76 @@ HRESULT Decompile(IDxcBlob *pProgram, raw_string_ostream &Stream) {
   return S_OK;
 }
 
-HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
-  CComPtr<IDxcBlob> pPdbContainerBlob;
+// The program found in a blob handed to the disassembler.
+struct DisassemblyInput {
+  CComPtr<IDxcBlob> pPdbContainerBlob; // Keeps a PDB's container alive.
+  const DxilContainerHeader *pContainer = nullptr; // Null for bare programs.
+  const DxilProgramHeader *pProgramHeader = nullptr;
+  const char *pIL = nullptr;
+  uint32_t ILLength = 0;
+};
+
+// Finds the bitcode to disassemble in pProgram, which may be a PDB, a
+// container or a program with or without its program header.  Containers
+// use their debug module when bPreferDebugModule is set and it is present,
+// and their DXIL part otherwise.
+static HRESULT GetDisassemblyInput(IDxcBlob *pProgram, bool bPreferDebugModule,
+                                   DisassemblyInput &Input) {
   {
     CComPtr<IStream> pStream;
     IFR(hlsl::CreateReadOnlyBlobStream(pProgram, &pStream));
-    if (SUCCEEDED(hlsl::pdb::LoadDataFromStream(DxcGetThreadMallocNoRef(), pStream, &pPdbContainerBlob))) {
-      pProgram = pPdbContainerBlob;
+    if (SUCCEEDED(hlsl::pdb::LoadDataFromStream(DxcGetThreadMallocNoRef(), pStream, &Input.pPdbContainerBlob))) {
+      pProgram = Input.pPdbContainerBlob;
     }
   }
 
-  const char *pIL = (const char *)pProgram->GetBufferPointer();
-  uint32_t pILLength = pProgram->GetBufferSize();
-  const char *pReflectionIL = nullptr;
-  uint32_t pReflectionILLength = 0;
-  const DxilPartHeader *pRDATPart = nullptr;
-  if (const DxilContainerHeader *pContainer =
-          IsDxilContainerLike(pIL, pILLength)) {
-    if (!IsValidDxilContainer(pContainer, pILLength)) {
+  Input.pIL = (const char *)pProgram->GetBufferPointer();
+  Input.ILLength = pProgram->GetBufferSize();
+  Input.pContainer = IsDxilContainerLike(Input.pIL, Input.ILLength);
+  if (const DxilContainerHeader *pContainer = Input.pContainer) {
+    if (!IsValidDxilContainer(pContainer, Input.ILLength)) {
       return DXC_E_CONTAINER_INVALID;
     }
 
+    DxilFourCC First = bPreferDebugModule ? DFCC_ShaderDebugInfoDXIL : DFCC_DXIL;
+    DxilFourCC Second = bPreferDebugModule ? DFCC_DXIL : DFCC_ShaderDebugInfoDXIL;
+    DxilPartIterator it = std::find_if(begin(pContainer), end(pContainer),
+                                       DxilPartIsType(First));
+    if (it == end(pContainer)) {
+      it = std::find_if(begin(pContainer), end(pContainer),
+                        DxilPartIsType(Second));
+    }
+    if (it == end(pContainer)) {
+      return DXC_E_CONTAINER_MISSING_DXIL;
+    }
+
+    Input.pProgramHeader =
+        reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(*it));
+    if (!IsValidDxilProgramHeader(Input.pProgramHeader, (*it)->PartSize)) {
+      return DXC_E_CONTAINER_INVALID;
+    }
+    GetDxilProgramBitcode(Input.pProgramHeader, &Input.pIL, &Input.ILLength);
+  } else {
+    const DxilProgramHeader *pProgramHeader =
+        reinterpret_cast<const DxilProgramHeader *>(Input.pIL);
+    if (IsValidDxilProgramHeader(pProgramHeader, Input.ILLength)) {
+      Input.pProgramHeader = pProgramHeader;
+      GetDxilProgramBitcode(pProgramHeader, &Input.pIL, &Input.ILLength);
+    }
+  }
+  return S_OK;
+}
+
+HRESULT Disassemble(IDxcBlob *pProgram, raw_ostream &Stream) {
+  DisassemblyInput Input;
+  IFR(GetDisassemblyInput(pProgram, /*bPreferDebugModule*/ true, Input));
+
+  const char *pIL = Input.pIL;
+  uint32_t pILLength = Input.ILLength;
+  const char *pReflectionIL = nullptr;
+  uint32_t pReflectionILLength = 0;
+  const DxilPartHeader *pRDATPart = nullptr;
+  if (const DxilContainerHeader *pContainer = Input.pContainer) {
     DxilPartIterator it = std::find_if(begin(pContainer), end(pContainer),
                                        DxilPartIsType(DFCC_FeatureInfo));
     if (it != end(pContainer)) {
@@ -2076,32 +2126,12 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
       Stream << "\n";
     }
 
-    it = std::find_if(begin(pContainer), end(pContainer),
-                      DxilPartIsType(DFCC_DXIL));
-
-    DxilPartIterator dbgit =
-        std::find_if(begin(pContainer), end(pContainer),
-                     DxilPartIsType(DFCC_ShaderDebugInfoDXIL));
-    // Use dbg module if exist.
-    if (dbgit != end(pContainer))
-      it = dbgit;
-
-    if (it == end(pContainer)) {
-      return DXC_E_CONTAINER_MISSING_DXIL;
-    }
-
-    const DxilProgramHeader *pProgramHeader =
-        reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(*it));
-    if (!IsValidDxilProgramHeader(pProgramHeader, (*it)->PartSize)) {
-      return DXC_E_CONTAINER_INVALID;
-    }
-
     it = std::find_if(begin(pContainer), end(pContainer),
                       DxilPartIsType(DFCC_PipelineStateValidation));
     if (it != end(pContainer)) {
       PrintPipelineStateValidationRuntimeInfo(
           GetDxilPartData(*it),
-          GetVersionShaderType(pProgramHeader->ProgramVersion), Stream,
+          GetVersionShaderType(Input.pProgramHeader->ProgramVersion), Stream,
           /*comment*/ ";");
     }
 
@@ -2112,8 +2142,6 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
       pRDATPart = *it;
     }
 
-    GetDxilProgramBitcode(pProgramHeader, &pIL, &pILLength);
-
     it = std::find_if(begin(pContainer), end(pContainer),
                       DxilPartIsType(DFCC_ShaderStatistics));
     if (it != end(pContainer)) {
@@ -2124,13 +2152,6 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
         GetDxilProgramBitcode(pReflectionProgramHeader, &pReflectionIL, &pReflectionILLength);
       }
     }
-
-  } else {
-    const DxilProgramHeader *pProgramHeader =
-        reinterpret_cast<const DxilProgramHeader *>(pIL);
-    if (IsValidDxilProgramHeader(pProgramHeader, pILLength)) {
-      GetDxilProgramBitcode(pProgramHeader, &pIL, &pILLength);
-    }
   }
 
   std::string DiagStr;
@@ -2201,4 +2222,44 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
   Stream.flush();
   return S_OK;
 }
+
+HRESULT DisassembleFunction(IDxcBlob *pProgram, StringRef FunctionName,
+                            raw_ostream &Stream) {
+  // Prefer the program part over the debug module: only the requested
+  // function is materialized, but module-level metadata is always read.
+  DisassemblyInput Input;
+  IFR(GetDisassemblyInput(pProgram, /*bPreferDebugModule*/ false, Input));
+
+  std::string DiagStr;
+  llvm::LLVMContext llvmContext;
+  std::unique_ptr<llvm::MemoryBuffer> pBitcodeBuf(
+      llvm::MemoryBuffer::getMemBuffer(
+          llvm::StringRef(Input.pIL, Input.ILLength), "", false));
+  std::unique_ptr<llvm::Module> pModule(dxilutil::LoadModuleFromBitcodeLazy(
+      std::move(pBitcodeBuf), llvmContext, DiagStr));
+  if (pModule.get() == nullptr) {
+    return DXC_E_IR_VERIFICATION_FAILED;
+  }
+
+  // Accept either the symbol name or, for library exports, the unmangled name.
+  llvm::Function *F = pModule->getFunction(FunctionName);
+  if (F == nullptr) {
+    for (llvm::Function &Candidate : pModule->functions()) {
+      if (dxilutil::DemangleFunctionName(Candidate.getName()) == FunctionName) {
+        F = &Candidate;
+        break;
+      }
+    }
+  }
+  IFTBOOLMSG(F != nullptr, E_INVALIDARG,
+             "function to disassemble not found in program");
+  if (F->isMaterializable()) {
+    IFTBOOL(!F->materialize(), DXC_E_IR_VERIFICATION_FAILED);
+  }
+
+  DxcAssemblyAnnotationWriter w;
+  F->print(Stream, &w);
+  Stream.flush();
+  return S_OK;
+}
 }
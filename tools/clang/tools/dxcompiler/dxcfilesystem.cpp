@@ -191,6 +191,135 @@ void MakeAbsoluteOrCurDirRelativeW(LPCWSTR &Path, std::wstring &PathStorage) {
   }
 }
 
+/// Returns the length of a backslash-newline sequence at p, or 0 if none.
+size_t EscapedNewlineLength(const char *p, const char *e) {
+  if (p[0] != '\\' || p + 1 == e)
+    return 0;
+  if (p[1] == '\n')
+    return 2;
+  if (p[1] == '\r' && p + 2 < e && p[2] == '\n')
+    return 3;
+  return 0;
+}
+
+/// Reduces source text to its preprocessor directives. Everything else is
+/// dropped, but every newline is kept so that line numbers (and with them
+/// __LINE__ and diagnostic locations) are unchanged. Comments and string
+/// literals are tracked so that a '#' or comment marker inside them is not
+/// mistaken for a directive.
+void MinimizeToDirectives(StringRef Text, std::string &Out) {
+  Out.clear();
+  Out.reserve(Text.size() / 4);
+  const char *p = Text.begin(), *e = Text.end();
+  bool atLineStart = true;  // Only whitespace or comments seen so far.
+  bool inDirective = false; // Copying the current logical line.
+  bool inBlockComment = false;
+  while (p < e) {
+    char c = *p;
+    if (inBlockComment) {
+      if (c == '*' && p + 1 < e && p[1] == '/') {
+        inBlockComment = false;
+        if (inDirective)
+          Out.append("*/");
+        p += 2;
+        continue;
+      }
+      if (inDirective || c == '\n')
+        Out.push_back(c);
+      ++p;
+      continue;
+    }
+    if (size_t len = EscapedNewlineLength(p, e)) {
+      // A continuation joins lines, so the logical line state carries over.
+      if (inDirective)
+        Out.append(p, len);
+      else
+        Out.push_back('\n');
+      p += len;
+      continue;
+    }
+    if (c == '\n') {
+      Out.push_back('\n');
+      atLineStart = true;
+      inDirective = false;
+      ++p;
+      continue;
+    }
+    if (c == '/' && p + 1 < e && p[1] == '*') {
+      inBlockComment = true;
+      if (inDirective)
+        Out.append("/*");
+      p += 2;
+      continue;
+    }
+    if (c == '/' && p + 1 < e && p[1] == '/') {
+      for (p += 2; p < e && *p != '\n';) {
+        if (size_t len = EscapedNewlineLength(p, e)) {
+          Out.push_back('\n');
+          p += len;
+        } else {
+          ++p;
+        }
+      }
+      continue;
+    }
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v') {
+      if (inDirective)
+        Out.push_back(c);
+      ++p;
+      continue;
+    }
+    if (atLineStart && c == '#') {
+      atLineStart = false;
+      inDirective = true;
+      Out.push_back(c);
+      ++p;
+      continue;
+    }
+    atLineStart = false;
+    if (c == '"' || c == '\'') {
+      if (inDirective)
+        Out.push_back(c);
+      for (++p; p < e && *p != c && *p != '\n';) {
+        size_t len = EscapedNewlineLength(p, e);
+        if (len) {
+          if (!inDirective) {
+            Out.push_back('\n');
+            p += len;
+            continue;
+          }
+        } else {
+          len = (*p == '\\' && p + 1 < e && p[1] != '\n') ? 2 : 1;
+        }
+        if (inDirective)
+          Out.append(p, len);
+        p += len;
+      }
+      if (p < e && *p == c) {
+        if (inDirective)
+          Out.push_back(c);
+        ++p;
+      }
+      continue;
+    }
+    if (inDirective)
+      Out.push_back(c);
+    ++p;
+  }
+}
+
+HRESULT MinimizeBlobToDirectives(IDxcBlobUtf8 *pBlob, IDxcBlobUtf8 **ppResult) {
+  std::string minimized;
+  MinimizeToDirectives(
+      StringRef(pBlob->GetStringPointer(), pBlob->GetStringLength()),
+      minimized);
+  CComPtr<IDxcBlobEncoding> pEncoding;
+  IFR(DxcCreateBlobWithEncodingOnHeapCopy(minimized.c_str(),
+                                          (UINT32)minimized.size() + 1,
+                                          CP_UTF8, &pEncoding));
+  return DxcGetBlobAsUtf8(pEncoding, DxcGetThreadMallocNoRef(), ppResult);
+}
+
 }
 
 namespace dxcutil {
@@ -229,6 +358,7 @@ private:
   CComPtr<IDxcIncludeHandler> m_includeLoader;
   std::vector<std::wstring> m_searchEntries;
   bool m_bDisplayIncludeProcess;
+  bool m_bMinimizeSources;
 
   // Some constraints of the current design: opening the same file twice
   // will return the same handle/structure, and thus the same file pointer.
@@ -298,6 +428,13 @@ private:
         if (FAILED(hlsl::DxcGetBlobAsUtf8(fileBlob, DxcGetThreadMallocNoRef(), &fileBlobUtf8))) {
           return ERROR_UNHANDLED_EXCEPTION;
         }
+        if (m_bMinimizeSources) {
+          CComPtr<IDxcBlobUtf8> minimizedBlob;
+          if (FAILED(MinimizeBlobToDirectives(fileBlobUtf8, &minimizedBlob))) {
+            return ERROR_UNHANDLED_EXCEPTION;
+          }
+          fileBlobUtf8 = minimizedBlob;
+        }
         CComPtr<IStream> fileStream;
         if (FAILED(hlsl::CreateReadOnlyBlobStream(fileBlobUtf8, &fileStream))) {
           return ERROR_UNHANDLED_EXCEPTION;
@@ -336,7 +473,8 @@ private:
 public:
   DxcArgsFileSystemImpl(_In_ IDxcBlobUtf8 *pSource, LPCWSTR pSourceName, _In_opt_ IDxcIncludeHandler* pHandler)
       : m_pSource(pSource), m_pSourceName(pSourceName), m_pOutputStreamName(nullptr),
-        m_includeLoader(pHandler), m_bDisplayIncludeProcess(false) {
+        m_includeLoader(pHandler), m_bDisplayIncludeProcess(false),
+        m_bMinimizeSources(false) {
     MakeAbsoluteOrCurDirRelativeW(m_pSourceName, m_pAbsSourceName);
     IFT(CreateReadOnlyBlobStream(m_pSource, &m_pSourceStream));
     m_includedFiles.push_back(IncludedFile(std::wstring(m_pSourceName), m_pSource, m_pSourceStream));
@@ -344,6 +482,23 @@ public:
   void EnableDisplayIncludeProcess() override {
     m_bDisplayIncludeProcess = true;
   }
+  void EnableMinimizedSources() override {
+    DXASSERT(m_includedFiles.size() == 1, "else files already opened");
+    m_bMinimizeSources = true;
+    CComPtr<IDxcBlobUtf8> pMinimized;
+    IFT(MinimizeBlobToDirectives(m_pSource, &pMinimized));
+    m_pSource = pMinimized;
+    m_pSourceStream.Release();
+    IFT(CreateReadOnlyBlobStream(m_pSource, &m_pSourceStream));
+    m_includedFiles[0].Blob = m_pSource;
+    m_includedFiles[0].BlobStream = m_pSourceStream;
+  }
+  void GetIncludedFileNames(std::vector<std::wstring> &names) override {
+    names.clear();
+    names.reserve(m_includedFiles.size());
+    for (const IncludedFile &file : m_includedFiles)
+      names.push_back(file.Name);
+  }
   void WriteStdErrToStream(raw_string_ostream &s) override {
     s.write((char*)m_pStdErrStream->GetPtr(), m_pStdErrStream->GetPtrSize());
     s.flush();
@@ -506,12 +506,37 @@ public:
   GetPDBContents(_In_ IDxcBlob *pPDBBlob, _COM_Outptr_ IDxcBlob **ppHash,
                  _COM_Outptr_ IDxcBlob **ppContainer) override
   {
+    if (ppHash == nullptr || ppContainer == nullptr)
+      return E_POINTER;
+    *ppHash = nullptr;
+    *ppContainer = nullptr;
     DxcThreadMalloc TM(m_pMalloc);
 
     try {
+      // Outputs are only handed out once the container is known to be
+      // usable, so a failure leaves them null and releases what was loaded.
       CComPtr<IStream> pStream;
+      CComPtr<IDxcBlob> pHash, pContainer;
       IFR(hlsl::CreateReadOnlyBlobStream(pPDBBlob, &pStream));
-      IFR(hlsl::pdb::LoadDataFromStream(m_pMalloc, pStream, ppHash, ppContainer));
+      IFR(hlsl::pdb::LoadDataFromStream(m_pMalloc, pStream, &pHash, &pContainer));
+
+      // Hand out the standard layout if the embedded container was stored
+      // with compressed parts.
+      const hlsl::DxilContainerHeader *pHeader = hlsl::IsDxilContainerLike(
+          pContainer->GetBufferPointer(), pContainer->GetBufferSize());
+      if (pHeader &&
+          hlsl::IsValidDxilContainer(pHeader, pContainer->GetBufferSize()) &&
+          hlsl::IsCompressedDxilContainer(pHeader)) {
+        std::vector<char> expanded;
+        IFTBOOL(hlsl::DecompressDxilContainer(pHeader, expanded),
+                DXC_E_CONTAINER_INVALID);
+        CComPtr<IDxcBlob> pExpanded;
+        IFT(hlsl::DxcCreateBlobOnHeapCopy(expanded.data(),
+                                          (UINT32)expanded.size(), &pExpanded));
+        pContainer = pExpanded;
+      }
+      *ppHash = pHash.Detach();
+      *ppContainer = pContainer.Detach();
       return S_OK;
     }
     CATCH_CPP_RETURN_HRESULT();
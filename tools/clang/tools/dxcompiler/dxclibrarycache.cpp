@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxclibrarycache.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Implements the cache of libraries compiled for -lib-cache-include.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/Unicode.h"
+#include "dxclibrarycache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Path.h"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+struct LibraryCache {
+  std::mutex Mutex;
+  // Keyed by directory and fingerprint.
+  std::map<std::pair<std::string, std::string>, CComPtr<IDxcBlob>> Libraries;
+};
+
+LibraryCache &GetLibraryCache() {
+  static LibraryCache Cache;
+  return Cache;
+}
+
+std::string GetLibraryPath(StringRef Dir, StringRef Fingerprint) {
+  SmallString<128> Path(Dir);
+  llvm::sys::path::append(Path, Twine(Fingerprint) + ".dxlib");
+  return Path.str();
+}
+
+// Anything that is not a container with a DXIL part, such as a file
+// truncated by a crashed writer, is ignored and recompiled.
+bool IsLibraryContainer(IDxcBlob *pBlob) {
+  const DxilContainerHeader *pContainer =
+      IsDxilContainerLike(pBlob->GetBufferPointer(), pBlob->GetBufferSize());
+  return pContainer &&
+         IsValidDxilContainer(pContainer, pBlob->GetBufferSize()) &&
+         GetDxilPartByType(pContainer, DFCC_DXIL) != nullptr;
+}
+
+bool ReadLibrary(const std::string &Path, IDxcBlob **ppLibrary) {
+  try {
+    std::wstring WidePath = Unicode::UTF8ToUTF16StringOrThrow(Path.c_str());
+    void *pData = nullptr;
+    DWORD DataSize = 0;
+    ReadBinaryFile(GetGlobalHeapMalloc(), WidePath.c_str(), &pData, &DataSize);
+    CComPtr<IDxcBlob> pLibrary;
+    if (FAILED(DxcCreateBlobOnMalloc(pData, GetGlobalHeapMalloc(), DataSize,
+                                     &pLibrary))) {
+      GetGlobalHeapMalloc()->Free(pData);
+      return false;
+    }
+    if (!IsLibraryContainer(pLibrary))
+      return false;
+    *ppLibrary = pLibrary.Detach();
+    return true;
+  } catch (...) {
+    return false;
+  }
+}
+
+// The library is written under a unique name and renamed into place, so
+// concurrent compiles in other processes never read a partial file.
+void WriteLibrary(const std::string &Path, IDxcBlob *pLibrary) {
+  try {
+    std::string TempPath =
+        (Twine(Path) + "." +
+         Twine(std::hash<std::thread::id>()(std::this_thread::get_id())) +
+         "." +
+         Twine(std::chrono::steady_clock::now().time_since_epoch().count()) +
+         ".tmp")
+            .str();
+    std::wstring WidePath = Unicode::UTF8ToUTF16StringOrThrow(Path.c_str());
+    std::wstring WideTempPath =
+        Unicode::UTF8ToUTF16StringOrThrow(TempPath.c_str());
+    WriteBinaryFile(WideTempPath.c_str(), pLibrary->GetBufferPointer(),
+                    pLibrary->GetBufferSize());
+#ifdef _WIN32
+    if (!MoveFileExW(WideTempPath.c_str(), WidePath.c_str(),
+                     MOVEFILE_REPLACE_EXISTING))
+      DeleteFileW(WideTempPath.c_str());
+#else
+    if (std::rename(TempPath.c_str(), Path.c_str()) != 0)
+      std::remove(TempPath.c_str());
+#endif
+  } catch (...) {
+  }
+}
+
+} // namespace
+
+namespace dxcutil {
+
+bool LookupCachedLibrary(StringRef Fingerprint, StringRef Dir,
+                         IDxcBlob **ppLibrary) {
+  *ppLibrary = nullptr;
+  LibraryCache &Cache = GetLibraryCache();
+  {
+    std::lock_guard<std::mutex> Lock(Cache.Mutex);
+    auto It = Cache.Libraries.find(std::make_pair(Dir.str(), Fingerprint.str()));
+    if (It != Cache.Libraries.end()) {
+      *ppLibrary = It->second;
+      (*ppLibrary)->AddRef();
+      return true;
+    }
+  }
+
+  if (Dir.empty())
+    return false;
+  CComPtr<IDxcBlob> pLibrary;
+  if (!ReadLibrary(GetLibraryPath(Dir, Fingerprint), &pLibrary))
+    return false;
+
+  std::lock_guard<std::mutex> Lock(Cache.Mutex);
+  CComPtr<IDxcBlob> &Entry =
+      Cache.Libraries[std::make_pair(Dir.str(), Fingerprint.str())];
+  if (!Entry)
+    Entry = pLibrary;
+  *ppLibrary = Entry;
+  (*ppLibrary)->AddRef();
+  return true;
+}
+
+void StoreCachedLibrary(StringRef Fingerprint, StringRef Dir,
+                        IDxcBlob *pLibrary) {
+  // Keep a copy on the global heap; the compiled blob belongs to the
+  // allocator of the compiler object that produced it.
+  CComPtr<IDxcBlob> pCopy;
+  IFT(DxcCreateBlobOnHeapCopy(pLibrary->GetBufferPointer(),
+                              pLibrary->GetBufferSize(), &pCopy));
+  {
+    LibraryCache &Cache = GetLibraryCache();
+    std::lock_guard<std::mutex> Lock(Cache.Mutex);
+    CComPtr<IDxcBlob> &Entry =
+        Cache.Libraries[std::make_pair(Dir.str(), Fingerprint.str())];
+    if (Entry)
+      return;
+    Entry = pCopy;
+  }
+
+  if (!Dir.empty())
+    WriteLibrary(GetLibraryPath(Dir, Fingerprint), pCopy);
+}
+
+} // namespace dxcutil
@@ -0,0 +1,34 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxclibrarycache.h                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the cache of libraries compiled for -lib-cache-include.          //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/dxcapi.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace dxcutil {
+
+// Libraries are shared by every compiler object in the process and keyed by
+// a fingerprint of their preprocessed source and options.  When a directory
+// is given, they are also read from and written to it so that they persist
+// across processes; libraries read from different directories are kept
+// apart.  Both functions are safe to call from several threads.
+
+// Returns true and the library if one was stored for the fingerprint.
+bool LookupCachedLibrary(llvm::StringRef Fingerprint, llvm::StringRef Dir,
+                         _COM_Outptr_ IDxcBlob **ppLibrary);
+
+// Stores a compiled library for the fingerprint.  Failures to write to the
+// directory are ignored; the library is then only cached in memory.
+void StoreCachedLibrary(llvm::StringRef Fingerprint, llvm::StringRef Dir,
+                        _In_ IDxcBlob *pLibrary);
+
+} // namespace dxcutil
@@ -127,11 +127,9 @@ DxcLinker::RegisterLibrary(_In_opt_ LPCWSTR pLibName, // Name of the library.
   try {
     std::unique_ptr<llvm::Module> pModule, pDebugModule;
 
-    CComPtr<IMalloc> pMalloc;
     CComPtr<AbstractMemoryStream> pDiagStream;
 
-    IFT(CoGetMalloc(1, &pMalloc));
-    IFT(CreateMemoryStream(pMalloc, &pDiagStream));
+    IFT(CreateMemoryStream(m_pMalloc, &pDiagStream));
 
     raw_stream_ostream DiagStream(pDiagStream);
 
@@ -179,12 +177,10 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
 
   HRESULT hr = S_OK;
   try {
-    CComPtr<IMalloc> pMalloc;
     CComPtr<IDxcBlob> pOutputBlob;
     CComPtr<AbstractMemoryStream> pDiagStream;
 
-    IFT(CoGetMalloc(1, &pMalloc));
-    IFT(CreateMemoryStream(pMalloc, &pOutputStream));
+    IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
 
     // Read and validate options.
     int argCountInt;
@@ -206,7 +202,7 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
 
     std::string warnings;
     //llvm::raw_string_ostream w(warnings);
-    IFT(CreateMemoryStream(pMalloc, &pDiagStream));
+    IFT(CreateMemoryStream(m_pMalloc, &pDiagStream));
     raw_stream_ostream DiagStream(pDiagStream);
     llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
     PrintDiagnosticContext DiagContext(DiagPrinter);
@@ -252,7 +248,9 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
 
         raw_stream_ostream outStream(pOutputStream.p);
         // Create bitcode of M.
-        WriteBitcodeToFile(pM.get(), outStream);
+        WriteBitcodeToFile(pM.get(), outStream, false,
+                           opts.ParallelBitcode ? DxcParallelFor
+                                                : BitcodeParallelFor());
         outStream.flush();
 
         // Always save debug info. If lib has debug info, the link result will
@@ -266,10 +264,13 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
         if (opts.DebugNameForSource) {
           SerializeFlags |= SerializeDxilFlags::DebugNameDependOnSource;
         }
+        if (opts.ParallelBitcode) {
+          SerializeFlags |= SerializeDxilFlags::ParallelBitcode;
+        }
         // Validation.
         HRESULT valHR = S_OK;
         dxcutil::AssembleInputs inputs(
-          std::move(pM), pOutputBlob, pMalloc, SerializeFlags,
+          std::move(pM), pOutputBlob, m_pMalloc, SerializeFlags,
           pOutputStream,
           opts.DebugInfo, opts.DebugFile, &Diag);
         if (needsValidation) {
@@ -297,7 +298,8 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
       }
     }
     DiagStream.flush();
-    CComPtr<IStream> pStream = pDiagStream;
+    CComPtr<IStream> pStream;
+    IFT(pDiagStream.QueryInterface(&pStream));
     dxcutil::CreateOperationResultFromOutputs(pOutputBlob, pStream, warnings,
                                               hasErrorOccurred, ppResult);
   }
@@ -14,16 +14,22 @@
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TargetOptions.h"
 #include "clang/Basic/TargetInfo.h"
+#include "clang/Basic/Version.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Lex/HLSLMacroExpander.h"
 #include "clang/Frontend/ASTUnit.h"
+#include "clang/Frontend/MultiplexConsumer.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Sema/SemaHLSL.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "clang/Frontend/FrontendActions.h"
+#include "clang/CodeGen/BackendUtil.h"
 #include "clang/CodeGen/CodeGenAction.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/SHA256.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/HLSL/HLSLExtensionsCodegenHelper.h"
 #include "dxc/DxilRootSignature/DxilRootSignature.h"
@@ -33,6 +39,12 @@
 #include "dxc/DxilContainer/DxilContainerAssembler.h"
 #include "dxc/dxcapi.internal.h"
 #include "dxc/DXIL/DxilPDB.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilUtil.h"
+#include "dxc/HLSL/DxilExportMap.h"
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilPipelineLink.h"
+#include "dxc/HLSL/DxilSpecializeConstants.h"
 
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/Support/Global.h"
@@ -47,6 +59,8 @@
 #endif
 #include "dxillib.h"
 #include "dxcompileradapter.h"
+#include "dxccompilebudget.h"
+#include "dxclibrarycache.h"
 #include <algorithm>
 #include <cfloat>
 
@@ -56,10 +70,6 @@
 #endif
 // SPIRV change ends
 
-#ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
-#include "clang/Basic/Version.h"
-#endif // SUPPORT_QUERY_GIT_COMMIT_INFO
-
 #define CP_UTF16 1200
 
 using namespace llvm;
@@ -73,6 +83,12 @@ DEFINE_CROSS_PLATFORM_UUIDOF(IDxcLangExtensions2)
 // This declaration is used for the locally-linked validator.
 HRESULT CreateDxcValidator(_In_ REFIID riid, _Out_ LPVOID *ppv);
 
+// This declaration is used to link the libraries of -lib-cache-include.
+HRESULT CreateDxcLinker(_In_ REFIID riid, _Out_ LPVOID *ppv);
+
+// This declaration is used to optimize specialized programs.
+HRESULT CreateDxcOptimizer(_In_ REFIID riid, _Out_ LPVOID *ppv);
+
 // This internal call allows the validator to avoid having to re-deserialize
 // the module. It trusts that the caller didn't make any changes and is
 // kept internal because the layout of the module class may change based
@@ -413,7 +429,242 @@ static void CreateDefineStrings(
   }
 }
 
-class DxcCompiler : public IDxcCompiler4,
+static void WriteMakeEscaped(StringRef Path, raw_ostream &OS) {
+  for (char c : Path) {
+    if (c == ' ' || c == '#')
+      OS << '\\';
+    else if (c == '$')
+      OS << '$';
+    OS << c;
+  }
+}
+
+static void WriteJsonEscaped(StringRef Str, raw_ostream &OS) {
+  OS << '"';
+  for (unsigned char c : Str) {
+    if (c == '"' || c == '\\')
+      OS << '\\' << c;
+    else if (c < 0x20)
+      OS << llvm::format("\\u%04x", c);
+    else
+      OS << c;
+  }
+  OS << '"';
+}
+
+// Writes the files read for the target as a make rule (which ninja also
+// reads as a depfile), or as a JSON object with -Mjson.
+static void WriteDependencyList(const hlsl::options::DxcOpts &opts,
+                                StringRef target,
+                                const std::vector<std::wstring> &files,
+                                raw_ostream &OS) {
+  if (opts.DependenciesAsJson) {
+    OS << "{\n  \"target\": ";
+    WriteJsonEscaped(target, OS);
+    OS << ",\n  \"dependencies\": [";
+    for (size_t i = 0; i < files.size(); ++i) {
+      OS << (i ? ",\n    " : "\n    ");
+      WriteJsonEscaped(Unicode::UTF16ToUTF8StringOrThrow(files[i].c_str()), OS);
+    }
+    OS << "\n  ]\n}\n";
+    return;
+  }
+  WriteMakeEscaped(target, OS);
+  OS << ':';
+  for (const std::wstring &file : files) {
+    OS << " \\\n  ";
+    WriteMakeEscaped(Unicode::UTF16ToUTF8StringOrThrow(file.c_str()), OS);
+  }
+  OS << '\n';
+}
+
+// Follows a compile through its phases on behalf of its budget and of the
+// IDxcCompileCallback of its caller, and stops it when either asks to.
+class DxcCompileMonitor {
+private:
+  dxcutil::DxcCompileBudget *m_pBudget;
+  IDxcCompileCallback *m_pCallback;
+
+public:
+  DxcCompileMonitor(dxcutil::DxcCompileBudget *pBudget,
+                    IDxcCompileCallback *pCallback)
+      : m_pBudget(pBudget), m_pCallback(pCallback) {}
+
+  bool IsActive() const { return m_pBudget || m_pCallback; }
+
+  // Throws once a budget is exceeded or the caller cancels the compile.
+  void Check() {
+    if (m_pBudget)
+      m_pBudget->Check();
+    if (m_pCallback && m_pCallback->IsCancelled())
+      throw hlsl::Exception(E_ABORT, "compilation cancelled");
+  }
+
+  // Checks the phase run so far, then reports name as the running phase.
+  void EnterPhase(StringRef name) {
+    if (m_pBudget)
+      m_pBudget->EnterPhase(name);
+    if (m_pCallback) {
+      if (m_pCallback->IsCancelled())
+        throw hlsl::Exception(E_ABORT, "compilation cancelled");
+      m_pCallback->OnProgress(name.str().c_str());
+    }
+  }
+
+  // Enters a phase for each pass run in the context.
+  void WatchPasses(llvm::LLVMContext &Ctx) {
+    if (!IsActive())
+      return;
+    Ctx.setPassBoundaryCallback(
+        [](llvm::LLVMContext *, StringRef passName, void *pMonitor) {
+          ((DxcCompileMonitor *)pMonitor)->EnterPhase(passName);
+        },
+        this);
+  }
+};
+
+// Prints diagnostics to the errors output and streams the text of each one
+// to the caller as it is printed.
+class StreamingDiagnosticPrinter : public TextDiagnosticPrinter {
+private:
+  raw_string_ostream &m_OS;
+  IDxcCompileCallback *m_pCallback;
+  size_t m_Streamed;
+
+public:
+  StreamingDiagnosticPrinter(raw_string_ostream &OS, DiagnosticOptions *pOpts,
+                             IDxcCompileCallback *pCallback)
+      : TextDiagnosticPrinter(OS, pOpts), m_OS(OS), m_pCallback(pCallback),
+        m_Streamed(OS.str().size()) {}
+
+  void HandleDiagnostic(DiagnosticsEngine::Level Level,
+                        const Diagnostic &Info) override {
+    TextDiagnosticPrinter::HandleDiagnostic(Level, Info);
+    const std::string &text = m_OS.str();
+    if (text.size() > m_Streamed)
+      m_pCallback->OnDiagnostic(text.data() + m_Streamed,
+                                text.size() - m_Streamed);
+    m_Streamed = text.size();
+  }
+};
+
+// Checks the compile between top-level declarations.
+class MonitoringASTConsumer : public ASTConsumer {
+private:
+  DxcCompileMonitor &m_Monitor;
+
+public:
+  MonitoringASTConsumer(DxcCompileMonitor &monitor) : m_Monitor(monitor) {}
+
+  bool HandleTopLevelDecl(DeclGroupRef D) override {
+    m_Monitor.Check();
+    return true;
+  }
+};
+
+// Emits bitcode as EmitBCAction does, checking the compile between top-level
+// declarations when it is monitored.
+class MonitoredEmitBCAction : public EmitBCAction {
+private:
+  DxcCompileMonitor &m_Monitor;
+
+protected:
+  std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &CI,
+                                                 StringRef InFile) override {
+    std::unique_ptr<ASTConsumer> pConsumer =
+        EmitBCAction::CreateASTConsumer(CI, InFile);
+    if (!pConsumer || !m_Monitor.IsActive())
+      return pConsumer;
+    std::vector<std::unique_ptr<ASTConsumer>> consumers;
+    consumers.push_back(llvm::make_unique<MonitoringASTConsumer>(m_Monitor));
+    consumers.push_back(std::move(pConsumer));
+    return llvm::make_unique<MultiplexConsumer>(std::move(consumers));
+  }
+
+public:
+  MonitoredEmitBCAction(llvm::LLVMContext *pContext,
+                        DxcCompileMonitor &monitor)
+      : EmitBCAction(pContext), m_Monitor(monitor) {}
+};
+
+HRESULT CreateDxcUtils(_In_ REFIID riid, _Out_ LPVOID *ppv);
+
+// Results of IDxcCompiler6::CompilePermutations; permutations that shared a
+// compile hold references to the same IDxcResult.
+class DxcPermutationResults : public IDxcPermutationResults {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+
+public:
+  std::vector<CComPtr<IDxcResult>> Results;
+  std::vector<UINT32> SharedIndices;
+  UINT32 CompileCount = 0;
+
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcPermutationResults)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcPermutationResults>(this, iid, ppvObject);
+  }
+
+  UINT32 STDMETHODCALLTYPE GetPermutationCount() override {
+    return (UINT32)Results.size();
+  }
+  UINT32 STDMETHODCALLTYPE GetCompileCount() override {
+    return CompileCount;
+  }
+  HRESULT STDMETHODCALLTYPE GetSharedIndex(_In_ UINT32 Index,
+                                           _Out_ UINT32 *pSharedIndex) override {
+    if (pSharedIndex == nullptr || Index >= SharedIndices.size())
+      return E_INVALIDARG;
+    *pSharedIndex = SharedIndices[Index];
+    return S_OK;
+  }
+  HRESULT STDMETHODCALLTYPE GetResult(_In_ UINT32 Index, _In_ REFIID riid,
+                                      _COM_Outptr_ LPVOID *ppResult) override {
+    if (ppResult == nullptr)
+      return E_INVALIDARG;
+    *ppResult = nullptr;
+    if (Index >= Results.size())
+      return E_INVALIDARG;
+    return Results[Index]->QueryInterface(riid, ppResult);
+  }
+};
+
+// Results of IDxcCompiler8::CompilePipeline, one per stage.
+class DxcPipelineResults : public IDxcPipelineResults {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+
+public:
+  std::vector<CComPtr<IDxcResult>> Results;
+  bool Linked = false;
+
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcPipelineResults)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcPipelineResults>(this, iid, ppvObject);
+  }
+
+  UINT32 STDMETHODCALLTYPE GetStageCount() override {
+    return (UINT32)Results.size();
+  }
+  BOOL STDMETHODCALLTYPE IsLinked() override {
+    return Linked;
+  }
+  HRESULT STDMETHODCALLTYPE GetResult(_In_ UINT32 Index, _In_ REFIID riid,
+                                      _COM_Outptr_ LPVOID *ppResult) override {
+    if (ppResult == nullptr)
+      return E_INVALIDARG;
+    *ppResult = nullptr;
+    if (Index >= Results.size())
+      return E_INVALIDARG;
+    return Results[Index]->QueryInterface(riid, ppResult);
+  }
+};
+
+class DxcCompiler : public IDxcCompiler9,
                     public IDxcLangExtensions2,
                     public IDxcContainerEvent,
 #ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
@@ -448,6 +699,11 @@ public:
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
     HRESULT hr = DoBasicQueryInterface<
+      IDxcCompiler9,
+      IDxcCompiler8,
+      IDxcCompiler7,
+      IDxcCompiler6,
+      IDxcCompiler5,
       IDxcCompiler4,
       IDxcLangExtensions,
       IDxcLangExtensions2,
@@ -540,6 +796,48 @@ public:
     _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
     _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, buffer, and errors
   ) override {
+    return CompileImpl(pSource, pArguments, argCount, pIncludeHandler,
+                       nullptr, nullptr, riid, ppResult);
+  }
+
+  // Compile as Compile does, following the compile through pCallback.
+  HRESULT STDMETHODCALLTYPE CompileWithCallback(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_opt_count_(argCount) LPCWSTR *pArguments, // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_opt_ IDxcCompileCallback *pCallback,      // Follows the compile as it runs (optional)
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, buffer, and errors
+  ) override {
+    return CompileImpl(pSource, pArguments, argCount, pIncludeHandler,
+                       pCallback, nullptr, riid, ppResult);
+  }
+
+  // Returns a failed result carrying msg as its errors, or hr if even that
+  // cannot be created.
+  static HRESULT CreateErrorResult(HRESULT hr, const std::string &msg,
+                                   REFIID riid, _Out_ LPVOID *ppResult) {
+    CComPtr<IDxcResult> pResult;
+    if (SUCCEEDED(DxcResult::Create(hr, DXC_OUT_NONE, {
+            DxcOutputObject::ErrorOutput(CP_UTF8, msg.c_str(), msg.size())
+          }, &pResult)) &&
+        SUCCEEDED(pResult->QueryInterface(riid, ppResult))) {
+      return S_OK;
+    }
+    return hr;
+  }
+
+  // Compile, optionally compiling a library target to be linked to a single
+  // shader target afterwards.
+  HRESULT CompileImpl(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_opt_count_(argCount) LPCWSTR *pArguments, // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_opt_ IDxcCompileCallback *pCallback,      // Follows the compile as it runs (optional)
+    _In_opt_ LPCSTR pLinkProfile,                 // Profile the library will be linked to, if any
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, buffer, and errors
+  ) {
     if (pSource == nullptr ||
         (argCount > 0 && pArguments == nullptr))
       return E_INVALIDARG;
@@ -556,6 +854,7 @@ public:
     bool bCompileStarted = false;
     bool bPreprocessStarted = false;
     DxilShaderHash ShaderHashContent;
+    CComPtr<dxcutil::DxcCompileBudget> pBudget;
     DxcThreadMalloc TM(m_pMalloc);
 
     try {
@@ -585,8 +884,27 @@ public:
         }
       }
 
+      // A budgeted compile allocates through its budget from here on.
+      if (opts.MemoryBudget != 0 || opts.TimeBudget != 0) {
+        IFT(dxcutil::DxcCompileBudget::Create(
+            m_pMalloc, (uint64_t)opts.MemoryBudget << 20, opts.TimeBudget,
+            &pBudget));
+      }
+      DxcThreadMalloc TMBudget(pBudget ? (IMalloc *)pBudget.p : m_pMalloc.p);
+      dxcutil::DxcCompileBudget::ThreadScope budgetScope(pBudget);
+
+      DxcCompileMonitor monitor(pBudget, pCallback);
+
       bool isPreprocessing = !opts.Preprocess.empty();
-      if (isPreprocessing) {
+      bool isScanning = opts.ScanDependencies;
+      if (!opts.LibCacheIncludes.empty() && !isPreprocessing && !isScanning &&
+          !opts.IsLibraryProfile() && !opts.TargetProfile.startswith("rootsig")) {
+        IFT(CompileWithLibraryCache(pSource, opts, pIncludeHandler, pCallback,
+                                    riid, ppResult));
+        hr = S_OK;
+        goto Cleanup;
+      }
+      if (isPreprocessing || isScanning) {
         DxcEtw_DXCompilerPreprocess_Start();
         bPreprocessStarted = true;
       } else {
@@ -611,13 +929,31 @@ public:
                             CP_UTF8);
       LPCWSTR pObjectName = (!isPreprocessing && opts.OutputObject.empty()) ?
                             nullptr : pUtf16OutputName.m_psz;
+      CA2W pUtf16DependencyName(opts.DependencyFile.str().c_str(), CP_UTF8);
+      if (isScanning)
+        pObjectName = opts.DependencyFile.empty() ?
+                      nullptr : pUtf16DependencyName.m_psz;
       IFT(primaryOutput.SetName(pObjectName));
 
+      // A module snapshot from -fcgl or -fsnapshot-dxil resumes the pipeline
+      // where it stopped instead of starting from source.  Bitcode can be
+      // nothing else; ResumeFromSnapshot rejects bitcode without the pause
+      // point this compiler marks its snapshots with.
+      bool isSnapshot = !isPreprocessing && !isScanning &&
+                        llvm::isBitcode((const unsigned char *)pSource->Ptr,
+                                        (const unsigned char *)pSource->Ptr + pSource->Size);
+
       // Wrap source in blob
       CComPtr<IDxcBlobEncoding> pSourceEncoding;
-      IFT(hlsl::DxcCreateBlob(pSource->Ptr, pSource->Size,
-        true, false, pSource->Encoding != 0, pSource->Encoding,
-        nullptr, &pSourceEncoding));
+      if (isSnapshot) {
+        // Only the file system sees this; the snapshot is loaded directly.
+        IFT(hlsl::DxcCreateBlob("", 0, true, false, true, CP_UTF8, nullptr,
+                                &pSourceEncoding));
+      } else {
+        IFT(hlsl::DxcCreateBlob(pSource->Ptr, pSource->Size,
+          true, false, pSource->Encoding != 0, pSource->Encoding,
+          nullptr, &pSourceEncoding));
+      }
 
  #ifdef ENABLE_SPIRV_CODEGEN
       // We want to embed the preprocessed source code in the final SPIR-V if
@@ -625,14 +961,16 @@ public:
       // first for such case. Then we invoke the compilation process over the
       // preprocessed source code, so that line numbers are consistent with the
       // embedded source code.
-      if (!isPreprocessing && opts.GenSPIRV && opts.DebugInfo) {
+      if (!isPreprocessing && !isScanning && opts.GenSPIRV && opts.DebugInfo) {
         CComPtr<IDxcResult> pSrcCodeResult;
         std::vector<LPCWSTR> PreprocessArgs;
         PreprocessArgs.reserve(argCount + 1);
         PreprocessArgs.assign(pArguments, pArguments + argCount);
         PreprocessArgs.push_back(L"-P");
         PreprocessArgs.push_back(L"preprocessed.hlsl");
-        IFT(Compile(pSource, PreprocessArgs.data(), PreprocessArgs.size(), pIncludeHandler, IID_PPV_ARGS(&pSrcCodeResult)));
+        IFT(CompileImpl(pSource, PreprocessArgs.data(), PreprocessArgs.size(),
+                        pIncludeHandler, pCallback, nullptr,
+                        IID_PPV_ARGS(&pSrcCodeResult)));
         HRESULT status;
         IFT(pSrcCodeResult->GetStatus(&status));
         if (SUCCEEDED(status)) {
@@ -660,14 +998,21 @@ public:
         primaryOutput.kind = DXC_OUT_TEXT;
       else if (isPreprocessing)
         primaryOutput.kind = DXC_OUT_HLSL;
+      else if (isScanning)
+        primaryOutput.kind = DXC_OUT_DEPENDENCIES;
 
       IFT(pResult->SetOutputName(DXC_OUT_REFLECTION, opts.OutputReflectionFile));
       IFT(pResult->SetOutputName(DXC_OUT_SHADER_HASH, opts.OutputShaderHashFile));
       IFT(pResult->SetOutputName(DXC_OUT_ERRORS, opts.OutputWarningsFile));
       IFT(pResult->SetOutputName(DXC_OUT_ROOT_SIGNATURE, opts.OutputRootSigFile));
+      if (opts.WriteDependencies)
+        IFT(pResult->SetOutputName(DXC_OUT_DEPENDENCIES, opts.DependencyFile));
 
       if (opts.DisplayIncludeProcess)
         msfPtr->EnableDisplayIncludeProcess();
+      // Scanning only needs the directives, so skip lexing everything else.
+      if (isScanning)
+        msfPtr->EnableMinimizedSources();
 
       IFT(msfPtr->RegisterOutputStream(L"output.bc", pOutputStream));
       IFT(msfPtr->CreateStdStreams(m_pMalloc));
@@ -684,9 +1029,14 @@ public:
       llvm::LLVMContext llvmContext; // LLVMContext should outlive CompilerInstance
       CompilerInstance compiler;
       std::unique_ptr<TextDiagnosticPrinter> diagPrinter =
-          llvm::make_unique<TextDiagnosticPrinter>(w, &compiler.getDiagnosticOpts());
+          pCallback ? llvm::make_unique<StreamingDiagnosticPrinter>(
+                          w, &compiler.getDiagnosticOpts(), pCallback)
+                    : llvm::make_unique<TextDiagnosticPrinter>(
+                          w, &compiler.getDiagnosticOpts());
       SetupCompilerForCompile(compiler, &m_langExtensionsHelper, pUtf8SourceName, diagPrinter.get(), defines, opts, pArguments, argCount);
       msfPtr->SetupForCompilerInstance(compiler);
+      monitor.WatchPasses(llvmContext);
+      monitor.EnterPhase("front end");
 
       // The clang entry point (cc1_main) would now create a compiler invocation
       // from arguments, but depending on the Preprocess option, we either compile
@@ -728,6 +1078,13 @@ public:
           action.EndSourceFile();
         }
         outStream.flush();
+      } else if (isScanning) {
+        FrontendInputFile file(pUtf8SourceName, IK_HLSL);
+        clang::PreprocessOnlyAction action;
+        if (action.BeginSourceFile(compiler, file)) {
+          action.Execute();
+          action.EndSourceFile();
+        }
       } else {
         compiler.getLangOpts().HLSLEntryFunction =
           compiler.getCodeGenOpts().HLSLEntryFunction = pUtf8EntryPoint;
@@ -743,14 +1100,19 @@ public:
         }
         compiler.getLangOpts().IsHLSLLibrary = opts.IsLibraryProfile();
 
-        // Clear entry function if library target
-        if (compiler.getLangOpts().IsHLSLLibrary)
-          compiler.getLangOpts().HLSLEntryFunction =
+        // Clear entry function if library target, unless the library is
+        // linked to a single target, whose entry keeps its name and stage.
+        if (compiler.getLangOpts().IsHLSLLibrary) {
+          compiler.getLangOpts().HLSLEntryFunction = "";
+          if (pLinkProfile)
+            compiler.getCodeGenOpts().HLSLLinkProfile = pLinkProfile;
+          else
             compiler.getCodeGenOpts().HLSLEntryFunction = "";
+        }
 
         // NOTE: this calls the validation component from dxil.dll; the built-in
         // validator can be used as a fallback.
-        produceFullContainer = !opts.CodeGenHighLevel && !opts.AstDump && !opts.OptDump && rootSigMajor == 0;
+        produceFullContainer = !opts.CodeGenHighLevel && !opts.CodeGenDxilSnapshot && !opts.AstDump && !opts.OptDump && rootSigMajor == 0;
         needsValidation = produceFullContainer && !opts.DisableValidation;
 
         if (compiler.getCodeGenOpts().HLSLProfile == "lib_6_x") {
@@ -786,11 +1148,16 @@ public:
         outStream.flush();
       }
       else if (opts.OptDump) {
-        EmitOptDumpAction action(&llvmContext);
-        FrontendInputFile file(pUtf8SourceName, IK_HLSL);
-        action.BeginSourceFile(compiler, file);
-        action.Execute();
-        action.EndSourceFile();
+        if (isSnapshot) {
+          ResumeFromSnapshot(compiler, pSource, llvmContext, Backend_EmitPasses,
+                             pUtf8SourceName);
+        } else {
+          EmitOptDumpAction action(&llvmContext);
+          FrontendInputFile file(pUtf8SourceName, IK_HLSL);
+          action.BeginSourceFile(compiler, file);
+          action.Execute();
+          action.EndSourceFile();
+        }
         outStream.flush();
       }
       else if (rootSigMajor) {
@@ -824,7 +1191,7 @@ public:
       }
       // SPIRV change starts
 #ifdef ENABLE_SPIRV_CODEGEN
-      else if (!isPreprocessing && opts.GenSPIRV) {
+      else if (!isPreprocessing && !isScanning && opts.GenSPIRV) {
         // Since SpirvOptions is passed to the SPIR-V CodeGen as a whole
         // structure, we need to copy a few non-spirv-specific options into the
         // structure.
@@ -847,14 +1214,21 @@ public:
       }
 #endif
       // SPIRV change ends
-      else if (!isPreprocessing) {
-        EmitBCAction action(&llvmContext);
+      else if (!isPreprocessing && !isScanning) {
+        MonitoredEmitBCAction action(&llvmContext, monitor);
         FrontendInputFile file(pUtf8SourceName, IK_HLSL);
+        std::unique_ptr<llvm::Module> pModule;
         bool compileOK;
-        if (action.BeginSourceFile(compiler, file)) {
+        if (isSnapshot) {
+          pModule = ResumeFromSnapshot(compiler, pSource, llvmContext,
+                                       Backend_EmitBC, pUtf8SourceName);
+          compileOK = pModule && !compiler.getDiagnostics().hasErrorOccurred();
+        }
+        else if (action.BeginSourceFile(compiler, file)) {
           action.Execute();
           action.EndSourceFile();
           compileOK = !compiler.getDiagnostics().hasErrorOccurred();
+          pModule = action.takeModule();
         }
         else {
           compileOK = false;
@@ -888,10 +1262,18 @@ public:
         if (opts.StripRootSignature) {
           SerializeFlags |= SerializeDxilFlags::StripRootSignature;
         }
+        if (opts.FunctionIndex) {
+          SerializeFlags |= SerializeDxilFlags::IncludeFunctionIndexPart;
+        }
+        if (opts.ParallelBitcode) {
+          SerializeFlags |= SerializeDxilFlags::ParallelBitcode;
+        }
 
         // Don't do work to put in a container if an error has occurred
-        // Do not create a container when there is only a a high-level representation in the module.
-        if (compileOK && !opts.CodeGenHighLevel) {
+        // Do not create a container when there is only a a high-level representation in the module,
+        // or when the module is a snapshot to resume from.
+        if (compileOK && !opts.CodeGenHighLevel && !opts.CodeGenDxilSnapshot) {
+          monitor.EnterPhase("container assembly and validation");
           HRESULT valHR = S_OK;
           CComPtr<AbstractMemoryStream> pReflectionStream;
           CComPtr<AbstractMemoryStream> pRootSigStream;
@@ -899,7 +1281,7 @@ public:
           IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pRootSigStream));
 
           dxcutil::AssembleInputs inputs(
-                action.takeModule(), pOutputBlob, m_pMalloc, SerializeFlags,
+                std::move(pModule), pOutputBlob, m_pMalloc, SerializeFlags,
                 pOutputStream, opts.IsDebugInfoEnabled(),
                 opts.GetPDBName(), &compiler.getDiagnostics(),
                 &ShaderHashContent, pReflectionStream, pRootSigStream);
@@ -950,7 +1332,25 @@ public:
             IFT(hlsl::DxcCreateBlobOnHeapCopy(&ShaderHashContent, (UINT32)sizeof(ShaderHashContent), &pHashBlob));
             IFT(pResult->SetOutputObject(DXC_OUT_SHADER_HASH, pHashBlob));
           } // SUCCEEDED(valHR)
-        } // compileOK && !opts.CodeGenHighLevel
+        } // compileOK && !opts.CodeGenHighLevel && !opts.CodeGenDxilSnapshot
+      }
+
+      if (isScanning || opts.WriteDependencies) {
+        std::vector<std::wstring> files;
+        msfPtr->GetIncludedFileNames(files);
+        StringRef target = opts.OutputObject.empty() ?
+                           StringRef(pUtf8SourceName) : opts.OutputObject;
+        if (isScanning) {
+          WriteDependencyList(opts, target, files, outStream);
+          outStream.flush();
+        } else {
+          std::string dependencies;
+          raw_string_ostream dependencyStream(dependencies);
+          WriteDependencyList(opts, target, files, dependencyStream);
+          dependencyStream.flush();
+          IFT(pResult->SetOutputString(DXC_OUT_DEPENDENCIES, dependencies.c_str(),
+                                       dependencies.size()));
+        }
       }
 
       // Add std err to warnings.
@@ -993,17 +1393,13 @@ public:
       hr = S_OK;
     } catch (std::bad_alloc &) {
       hr = E_OUTOFMEMORY;
+      // An allocation refused by the budget reports the budget instead.
+      if (pBudget && pBudget->IsExceeded())
+        hr = CreateErrorResult(DXC_E_COMPILE_BUDGET_EXCEEDED,
+                               pBudget->GetExceededMessage(), riid, ppResult);
     } catch (hlsl::Exception &e) {
       _Analysis_assume_(DXC_FAILED(e.hr));
-      CComPtr<IDxcResult> pResult;
-      hr = e.hr;
-      if (SUCCEEDED(DxcResult::Create(e.hr, DXC_OUT_NONE, {
-              DxcOutputObject::ErrorOutput(CP_UTF8,
-                e.msg.c_str(), e.msg.size())
-            }, &pResult)) &&
-          SUCCEEDED(pResult->QueryInterface(riid, ppResult))) {
-        hr = S_OK;
-      }
+      hr = CreateErrorResult(e.hr, e.msg, riid, ppResult);
     } catch (...) {
       hr = E_FAIL;
     }
@@ -1022,6 +1418,602 @@ public:
     _In_ const DxcBuffer *pObject,                // Program to disassemble: dxil container or bitcode.
     _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, disassembly text, and errors
     ) override {
+    return DisassembleImpl(pObject, nullptr, riid, ppResult);
+  }
+
+  // Disassemble a single function of a program.
+  virtual HRESULT STDMETHODCALLTYPE DisassembleFunction(
+    _In_ const DxcBuffer *pObject,                // Program to disassemble: dxil container or bitcode.
+    _In_ LPCWSTR pFunctionName,                   // Function name, mangled or unmangled export name.
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, disassembly text, and errors
+    ) override {
+    if (pFunctionName == nullptr || *pFunctionName == L'\0')
+      return E_INVALIDARG;
+    return DisassembleImpl(pObject, pFunctionName, riid, ppResult);
+  }
+
+  // Compile one source under several sets of defines, compiling each
+  // distinct preprocessed source only once.
+  HRESULT STDMETHODCALLTYPE CompilePermutations(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_opt_count_(argCount) LPCWSTR *pArguments, // Arguments shared by all permutations
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(permutationCount)
+      const DxcPermutation *pPermutations,        // Defines of each permutation
+    _In_ UINT32 permutationCount,                 // Number of permutations
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcPermutationResults
+  ) override {
+    if (pSource == nullptr || ppResult == nullptr ||
+        (argCount > 0 && pArguments == nullptr) ||
+        (permutationCount > 0 && pPermutations == nullptr))
+      return E_INVALIDARG;
+
+    *ppResult = nullptr;
+    DxcThreadMalloc TM(m_pMalloc);
+
+    try {
+      CComPtr<IDxcUtils> pUtils;
+      IFT(CreateDxcUtils(IID_PPV_ARGS(&pUtils)));
+
+      // The defines only reach code generation through the preprocessed
+      // source, except when the output records the defines or macros
+      // themselves: the debug info keeps the arguments, and the root
+      // signature define is looked up as a macro.
+      bool definesAffectOutput = true;
+      {
+        int argCountInt;
+        IFT(UIntToInt(argCount, &argCountInt));
+        hlsl::options::MainArgs mainArgs(argCountInt, pArguments, 0);
+        hlsl::options::DxcOpts opts;
+        std::string errors;
+        raw_string_ostream errorStream(errors);
+        if (0 == hlsl::options::ReadDxcOpts(hlsl::options::getHlslOptTable(),
+                                            hlsl::options::CompilerFlags,
+                                            mainArgs, opts, errorStream)) {
+          definesAffectOutput = opts.IsDebugInfoEnabled() ||
+                                opts.DebugNameForSource ||
+                                !opts.RootSignatureDefine.empty();
+        }
+      }
+
+      CComPtr<DxcPermutationResults> pResults =
+          DxcPermutationResults::Alloc(m_pMalloc);
+      IFTOOM(pResults.p);
+      pResults->Results.resize(permutationCount);
+      pResults->SharedIndices.resize(permutationCount);
+
+      std::map<std::string, UINT32> compiledFingerprints;
+      LPCWSTR PreprocessArgs[] = { L"-P", L"preprocessed.hlsl" };
+      for (UINT32 i = 0; i < permutationCount; ++i) {
+        const DxcPermutation &permutation = pPermutations[i];
+        if (permutation.DefineCount > 0 && permutation.pDefines == nullptr)
+          throw hlsl::Exception(E_INVALIDARG);
+
+        CComPtr<IDxcCompilerArgs> pArgs;
+        IFT(pUtils->BuildArguments(nullptr, nullptr, nullptr,
+                                   pArguments, argCount,
+                                   permutation.pDefines,
+                                   permutation.DefineCount, &pArgs));
+
+        // Fingerprint the shared arguments and the preprocessed source,
+        // including any preprocessor diagnostics so they are reported
+        // exactly as an individual compile would.
+        CComPtr<IDxcCompilerArgs> pPreprocessArgs;
+        IFT(pUtils->BuildArguments(nullptr, nullptr, nullptr,
+                                   pArguments, argCount,
+                                   permutation.pDefines,
+                                   permutation.DefineCount, &pPreprocessArgs));
+        IFT(pPreprocessArgs->AddArguments(PreprocessArgs, _countof(PreprocessArgs)));
+        CComPtr<IDxcResult> pPreprocessResult;
+        IFT(Compile(pSource, pPreprocessArgs->GetArguments(),
+                    pPreprocessArgs->GetCount(), pIncludeHandler,
+                    IID_PPV_ARGS(&pPreprocessResult)));
+
+        llvm::MD5 md5;
+        for (UINT32 a = 0; a < argCount; ++a)
+          md5.update(ArrayRef<uint8_t>((const uint8_t *)pArguments[a],
+                                       (wcslen(pArguments[a]) + 1) * sizeof(WCHAR)));
+        if (definesAffectOutput) {
+          for (UINT32 a = 0; a < pArgs->GetCount(); ++a)
+            md5.update(ArrayRef<uint8_t>((const uint8_t *)pArgs->GetArguments()[a],
+                                         (wcslen(pArgs->GetArguments()[a]) + 1) * sizeof(WCHAR)));
+        }
+        DXC_OUT_KIND fingerprintKinds[] = { DXC_OUT_HLSL, DXC_OUT_ERRORS };
+        for (DXC_OUT_KIND kind : fingerprintKinds) {
+          CComPtr<IDxcBlob> pBlob;
+          if (pPreprocessResult->HasOutput(kind) &&
+              SUCCEEDED(pPreprocessResult->GetOutput(kind, IID_PPV_ARGS(&pBlob), nullptr)) &&
+              pBlob) {
+            md5.update(ArrayRef<uint8_t>((const uint8_t *)pBlob->GetBufferPointer(),
+                                         pBlob->GetBufferSize()));
+          }
+          md5.update((uint8_t)kind);
+        }
+        llvm::MD5::MD5Result md5Result;
+        md5.final(md5Result);
+        SmallString<32> fingerprint;
+        llvm::MD5::stringifyResult(md5Result, fingerprint);
+
+        auto it = compiledFingerprints.find(fingerprint.str());
+        if (it != compiledFingerprints.end()) {
+          pResults->SharedIndices[i] = it->second;
+          pResults->Results[i] = pResults->Results[it->second];
+          continue;
+        }
+
+        IFT(Compile(pSource, pArgs->GetArguments(), pArgs->GetCount(),
+                    pIncludeHandler, IID_PPV_ARGS(&pResults->Results[i])));
+        pResults->SharedIndices[i] = i;
+        ++pResults->CompileCount;
+        compiledFingerprints[fingerprint.str()] = i;
+      }
+
+      return pResults->QueryInterface(riid, ppResult);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  // Specialize a compiled shader for known constant buffer values.
+  HRESULT STDMETHODCALLTYPE Specialize(
+    _In_ const DxcBuffer *pProgram,               // Compiled DXIL container
+    _In_count_(constantCount)
+      const DxcCBufferConstant *pConstants,       // Known constant buffer values
+    _In_ UINT32 constantCount,                    // Number of values
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, specialized container, and errors
+  ) override {
+    if (pProgram == nullptr || pProgram->Ptr == nullptr || ppResult == nullptr ||
+        (constantCount > 0 && pConstants == nullptr))
+      return E_INVALIDARG;
+    if (!(IsEqualIID(riid, __uuidof(IDxcResult)) ||
+          IsEqualIID(riid, __uuidof(IDxcOperationResult))))
+      return E_INVALIDARG;
+
+    *ppResult = nullptr;
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      DefaultFPEnvScope fpEnvScope;
+
+      ::llvm::sys::fs::MSFileSystem *msfPtr;
+      IFT(CreateMSFileSystemForDisk(&msfPtr));
+      std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+      ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+      IFTLLVM(pts.error_code());
+
+      std::string diagStr;
+      LLVMContext Ctx;
+      std::unique_ptr<llvm::Module> pM =
+          LoadContainerProgram(pProgram->Ptr, pProgram->Size, Ctx, diagStr);
+      if (pM) {
+        std::vector<hlsl::DxilCBufferConstant> constants(constantCount);
+        for (UINT32 i = 0; i < constantCount; ++i) {
+          constants[i] = { pConstants[i].Space, pConstants[i].Register,
+                           pConstants[i].ByteOffset, pConstants[i].Value };
+        }
+        unsigned replaced = 0;
+        try {
+          replaced = hlsl::SpecializeCBufferLoads(pM->GetOrCreateDxilModule(),
+                                                  constants);
+        } catch (hlsl::Exception &e) {
+          // Programs that cannot be specialized are reported, not thrown.
+          diagStr = e.msg;
+          pM.reset();
+        }
+        if (replaced)
+          pM = OptimizeSpecializedProgram(std::move(pM), Ctx, diagStr);
+      }
+
+      CComPtr<IDxcOperationResult> pResult;
+      AssembleProgram(std::move(pM), diagStr, &pResult);
+      return pResult->QueryInterface(riid, ppResult);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  // Compile the stages of a pipeline and link their signatures.
+  HRESULT STDMETHODCALLTYPE CompilePipeline(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_opt_count_(argCount) LPCWSTR *pArguments, // Arguments shared by all stages
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(stageCount)
+      const DxcPipelineStage *pStages,            // Entry point and profile of each stage
+    _In_ UINT32 stageCount,                       // Number of stages
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcPipelineResults
+  ) override {
+    if (pSource == nullptr || ppResult == nullptr ||
+        (argCount > 0 && pArguments == nullptr) ||
+        stageCount == 0 || pStages == nullptr)
+      return E_INVALIDARG;
+
+    *ppResult = nullptr;
+    DxcThreadMalloc TM(m_pMalloc);
+
+    try {
+      CComPtr<DxcPipelineResults> pResults =
+          DxcPipelineResults::Alloc(m_pMalloc);
+      IFTOOM(pResults.p);
+      pResults->Results.resize(stageCount);
+
+      bool allCompiled = true;
+      for (UINT32 i = 0; i < stageCount; ++i) {
+        const DxcPipelineStage &stage = pStages[i];
+        if (stage.pEntryPoint == nullptr || stage.pTargetProfile == nullptr)
+          throw hlsl::Exception(E_INVALIDARG);
+        std::vector<LPCWSTR> args(pArguments, pArguments + argCount);
+        args.insert(args.end(), { L"-E", stage.pEntryPoint,
+                                  L"-T", stage.pTargetProfile });
+        IFT(Compile(pSource, args.data(), (UINT32)args.size(),
+                    pIncludeHandler, IID_PPV_ARGS(&pResults->Results[i])));
+        HRESULT status;
+        IFT(pResults->Results[i]->GetStatus(&status));
+        allCompiled &= SUCCEEDED(status);
+      }
+      // Stages that failed to compile are reported as they are.
+      if (!allCompiled)
+        return pResults->QueryInterface(riid, ppResult);
+
+      DefaultFPEnvScope fpEnvScope;
+
+      ::llvm::sys::fs::MSFileSystem *msfPtr;
+      IFT(CreateMSFileSystemForDisk(&msfPtr));
+      std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+      ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+      IFTLLVM(pts.error_code());
+
+      LLVMContext Ctx;
+      std::vector<std::unique_ptr<llvm::Module>> modules(stageCount);
+      std::vector<DxilModule *> stages(stageCount);
+      for (UINT32 i = 0; i < stageCount; ++i) {
+        CComPtr<IDxcBlob> pObject;
+        IFT(pResults->Results[i]->GetOutput(DXC_OUT_OBJECT,
+                                            IID_PPV_ARGS(&pObject), nullptr));
+        std::string diagStr;
+        modules[i] = LoadContainerProgram(pObject->GetBufferPointer(),
+                                          pObject->GetBufferSize(), Ctx,
+                                          diagStr);
+        IFTBOOL(modules[i], DXC_E_CONTAINER_INVALID);
+        stages[i] = &modules[i]->GetDxilModule();
+      }
+
+      // Unchanged stages keep their compiled containers, with debug info and
+      // reflection.
+      if (hlsl::LinkPipelineStages(stages)) {
+        for (UINT32 i = 0; i < stageCount; ++i) {
+          CComPtr<IDxcOperationResult> pLinked;
+          AssembleProgram(std::move(modules[i]), "", &pLinked);
+          pResults->Results[i].Release();
+          IFT(pLinked.QueryInterface(&pResults->Results[i]));
+        }
+      }
+      pResults->Linked = true;
+      return pResults->QueryInterface(riid, ppResult);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  // Loads the program of a DXIL container, expanding a container stored with
+  // compressed parts.  The root signature, kept only in its own part, is
+  // carried over to the module.  Returns null, with the error in diagStr, if
+  // the bitcode does not load.
+  static std::unique_ptr<llvm::Module>
+  LoadContainerProgram(const void *pData, size_t size, LLVMContext &Ctx,
+                       std::string &diagStr) {
+    const DxilContainerHeader *pHeader = IsDxilContainerLike(pData, size);
+    IFTBOOL(pHeader && IsValidDxilContainer(pHeader, size),
+            DXC_E_CONTAINER_INVALID);
+    std::vector<char> expanded;
+    if (IsCompressedDxilContainer(pHeader)) {
+      IFTBOOL(DecompressDxilContainer(pHeader, expanded),
+              DXC_E_CONTAINER_INVALID);
+      pHeader = (const DxilContainerHeader *)expanded.data();
+    }
+    const DxilProgramHeader *pProgramHeader =
+        GetDxilProgramHeader(pHeader, DFCC_DXIL);
+    IFTBOOL(pProgramHeader, DXC_E_CONTAINER_MISSING_DXIL);
+    const char *pBitcode;
+    uint32_t bitcodeLength;
+    GetDxilProgramBitcode(pProgramHeader, &pBitcode, &bitcodeLength);
+
+    std::unique_ptr<llvm::Module> pM = dxilutil::LoadModuleFromBitcode(
+        llvm::StringRef(pBitcode, bitcodeLength), Ctx, diagStr);
+    if (pM) {
+      DxilModule &DM = pM->GetOrCreateDxilModule();
+      if (const DxilPartHeader *pRootSigPart =
+              GetDxilPartByType(pHeader, DFCC_RootSignature)) {
+        const uint8_t *pPart = (const uint8_t *)GetDxilPartData(pRootSigPart);
+        std::vector<uint8_t> rootSig(pPart, pPart + pRootSigPart->PartSize);
+        DM.ResetSerializedRootSignature(rootSig);
+      }
+    }
+    return pM;
+  }
+
+  // Reruns the tail of the optimization pipeline, from constant propagation
+  // on, over a program whose constant buffer loads were specialized.  The
+  // passes are run by name through the optimizer, as dxopt runs them.
+  // Returns null, with the error in diagStr, if the result does not load.
+  static std::unique_ptr<llvm::Module>
+  OptimizeSpecializedProgram(std::unique_ptr<llvm::Module> pM,
+                             LLVMContext &Ctx, std::string &diagStr) {
+    LPCWSTR passes[] = {
+      L"-hlsl-dxilload", L"-sccp", L"-instcombine", L"-simplifycfg",
+      L"-dxil-loop-deletion", L"-instcombine", L"-dxil-erase-dead-region",
+      L"-dce", L"-dxil-remove-dead-blocks", L"-dce", L"-hlsl-dxilfinalize",
+      L"-viewid-state", L"-dxil-dfe", L"-hlsl-dxilemit"
+    };
+
+    // The root signature is kept out of the module metadata, so it does not
+    // survive the trip through bitcode on its own.
+    std::vector<uint8_t> rootSig = pM->GetDxilModule().GetSerializedRootSignature();
+
+    CComPtr<AbstractMemoryStream> pBitcodeStream;
+    CComPtr<IDxcBlob> pBitcode;
+    IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pBitcodeStream));
+    {
+      raw_stream_ostream outStream(pBitcodeStream.p);
+      WriteBitcodeToFile(pM.get(), outStream);
+    }
+    IFT(pBitcodeStream.QueryInterface(&pBitcode));
+    pM.reset();
+
+    CComPtr<IDxcOptimizer> pOptimizer;
+    CComPtr<IDxcBlob> pOptimized;
+    IFT(CreateDxcOptimizer(IID_PPV_ARGS(&pOptimizer)));
+    IFT(pOptimizer->RunOptimizer(pBitcode, passes, _countof(passes),
+                                 &pOptimized, nullptr));
+
+    pM = dxilutil::LoadModuleFromBitcode(
+        llvm::StringRef((const char *)pOptimized->GetBufferPointer(),
+                        pOptimized->GetBufferSize()),
+        Ctx, diagStr);
+    if (!pM)
+      diagStr = "cannot load the specialized program";
+    else if (!rootSig.empty())
+      pM->GetOrCreateDxilModule().ResetSerializedRootSignature(rootSig);
+    return pM;
+  }
+
+  // Validates a module into a new container holding the program and its
+  // signatures, without debug info or reflection.  A null module reports
+  // loadError instead.
+  void AssembleProgram(std::unique_ptr<llvm::Module> pM,
+                       const std::string &loadError,
+                       _COM_Outptr_ IDxcOperationResult **ppResult) {
+    CComPtr<IDxcBlob> pOutputBlob;
+    CComPtr<AbstractMemoryStream> pOutputStream;
+    CComPtr<AbstractMemoryStream> pDiagStream;
+    IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
+    IFT(CreateMemoryStream(m_pMalloc, &pDiagStream));
+    raw_stream_ostream DiagStream(pDiagStream);
+
+    bool hasErrorOccurred = true;
+    if (pM) {
+      raw_stream_ostream outStream(pOutputStream.p);
+      WriteBitcodeToFile(pM.get(), outStream);
+      outStream.flush();
+
+      const IntrusiveRefCntPtr<clang::DiagnosticIDs> Diags(
+          new clang::DiagnosticIDs);
+      IntrusiveRefCntPtr<clang::DiagnosticOptions> DiagOpts =
+          new clang::DiagnosticOptions();
+      clang::TextDiagnosticPrinter *DiagClient =
+          new clang::TextDiagnosticPrinter(DiagStream, &*DiagOpts);
+      clang::DiagnosticsEngine Diag(Diags, &*DiagOpts, DiagClient);
+
+      dxcutil::AssembleInputs inputs(std::move(pM), pOutputBlob, m_pMalloc,
+                                     SerializeDxilFlags::None, pOutputStream,
+                                     false, "", &Diag);
+      dxcutil::ValidateAndAssembleToContainer(inputs);
+      hasErrorOccurred = Diag.hasErrorOccurred();
+    } else {
+      DiagStream << "error: " << loadError << "\n";
+    }
+    DiagStream.flush();
+
+    CComPtr<IStream> pStream;
+    IFT(pDiagStream.QueryInterface(&pStream));
+    dxcutil::CreateOperationResultFromOutputs(
+        hasErrorOccurred ? nullptr : pOutputBlob.p, pStream, "",
+        hasErrorOccurred, ppResult);
+  }
+
+  // Renders the parsed arguments back to wide strings, leaving out the
+  // options in Excluded.
+  static void RenderArgsExcept(const llvm::opt::InputArgList &Args,
+                               ArrayRef<unsigned> Excluded,
+                               std::vector<std::wstring> &outArgs) {
+    llvm::opt::ArgStringList argStrings;
+    for (const llvm::opt::Arg *A : Args) {
+      if (std::any_of(Excluded.begin(), Excluded.end(), [A](unsigned id) {
+            return A->getOption().matches(id);
+          }))
+        continue;
+      A->renderAsInput(Args, argStrings);
+    }
+    for (const char *argString : argStrings)
+      outArgs.emplace_back(Unicode::UTF8ToUTF16StringOrThrow(argString));
+  }
+
+  static std::vector<LPCWSTR> GetArgPointers(const std::vector<std::wstring> &args) {
+    std::vector<LPCWSTR> argPointers;
+    for (const std::wstring &arg : args)
+      argPointers.push_back(arg.c_str());
+    return argPointers;
+  }
+
+  // Compile a shader whose -lib-cache-include headers are compiled once into
+  // a library shared by every shader with the same headers and options, then
+  // link the two.  Only the shader's own functions are compiled each time.
+  HRESULT CompileWithLibraryCache(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_ hlsl::options::DxcOpts &opts,            // Parsed options of the shader compile
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_opt_ IDxcCompileCallback *pCallback,      // Follows the compile as it runs (optional)
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, buffer, and errors
+  ) {
+    using namespace hlsl::options;
+    // Both halves are compiled as offline libraries, which the linker can
+    // link to any target.
+    LPCWSTR libTargetW = L"lib_6_x";
+
+    // The validator version is only meaningful for the final link; libraries
+    // are always compiled for it.
+    const unsigned shaderExcluded[] = { OPT_target_profile, OPT_validator_version,
+                                        OPT_MD, OPT_MF };
+    // Drop everything that names this particular shader so that the
+    // library, and its key, are shared between shaders.
+    const unsigned libraryExcluded[] = {
+      OPT_target_profile, OPT_validator_version, OPT_MD, OPT_MF,
+      OPT_lib_cache_include, OPT_lib_cache_dir, OPT_INPUT, OPT_entrypoint,
+      OPT_Fo, OPT_Fc, OPT_Fh, OPT_Fe, OPT_Fd, OPT_Fre, OPT_Frs, OPT_Fsh,
+      OPT_Vn };
+
+    // The library source lives next to the shader so that its includes
+    // resolve the same way.
+    SmallString<128> libSourceName(opts.InputFile);
+    llvm::sys::path::remove_filename(libSourceName);
+    llvm::sys::path::append(libSourceName, "lib-cache-include.hlsl");
+    std::string libSource;
+    for (const std::string &include : opts.LibCacheIncludes)
+      libSource += "#include \"" + include + "\"\n";
+    DxcBuffer libBuffer = { libSource.c_str(), libSource.size(), DXC_CP_UTF8 };
+
+    std::vector<std::wstring> libArgs;
+    RenderArgsExcept(opts.Args, libraryExcluded, libArgs);
+    libArgs.emplace_back(Unicode::UTF8ToUTF16StringOrThrow(libSourceName.c_str()));
+    libArgs.emplace_back(L"-T");
+    libArgs.emplace_back(libTargetW);
+    libArgs.emplace_back(L"-Qfunction_index");
+
+    // Key the library by its arguments and preprocessed source.  Nothing the
+    // shader declares before the includes is covered; the front end rejects
+    // shaders that do so.
+    std::vector<std::wstring> preprocessArgs(libArgs);
+    preprocessArgs.emplace_back(L"-P");
+    preprocessArgs.emplace_back(L"preprocessed.hlsl");
+    std::vector<LPCWSTR> preprocessArgPointers = GetArgPointers(preprocessArgs);
+    CComPtr<IDxcResult> pPreprocessResult;
+    IFT(CompileImpl(&libBuffer, preprocessArgPointers.data(),
+                    preprocessArgPointers.size(), pIncludeHandler, pCallback,
+                    nullptr, IID_PPV_ARGS(&pPreprocessResult)));
+    HRESULT status;
+    IFT(pPreprocessResult->GetStatus(&status));
+    if (FAILED(status))
+      return pPreprocessResult->QueryInterface(riid, ppResult);
+
+    llvm::SHA256 sha;
+    for (const std::wstring &arg : libArgs)
+      sha.update(ArrayRef<uint8_t>((const uint8_t *)arg.c_str(),
+                                   (arg.size() + 1) * sizeof(WCHAR)));
+    CComPtr<IDxcBlob> pPreprocessed;
+    IFT(pPreprocessResult->GetOutput(DXC_OUT_HLSL, IID_PPV_ARGS(&pPreprocessed), nullptr));
+    sha.update(ArrayRef<uint8_t>((const uint8_t *)pPreprocessed->GetBufferPointer(),
+                                 pPreprocessed->GetBufferSize()));
+    const uint8_t dxilVersion[] = { DXIL::kDxilMajor, DXIL::kDxilMinor };
+    sha.update(dxilVersion);
+#ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
+    sha.update(getGitCommitHash());
+#endif // SUPPORT_QUERY_GIT_COMMIT_INFO
+    llvm::SHA256::SHA256Result shaResult;
+    sha.final(shaResult);
+    SmallString<64> fingerprint;
+    llvm::SHA256::stringifyResult(shaResult, fingerprint);
+
+    CComPtr<IDxcBlob> pLibrary;
+    if (!dxcutil::LookupCachedLibrary(fingerprint, opts.LibCacheDir, &pLibrary)) {
+      std::vector<LPCWSTR> libArgPointers = GetArgPointers(libArgs);
+      CComPtr<IDxcResult> pLibraryResult;
+      IFT(CompileImpl(&libBuffer, libArgPointers.data(), libArgPointers.size(),
+                      pIncludeHandler, pCallback, nullptr,
+                      IID_PPV_ARGS(&pLibraryResult)));
+      IFT(pLibraryResult->GetStatus(&status));
+      if (FAILED(status))
+        return pLibraryResult->QueryInterface(riid, ppResult);
+      CComPtr<IDxcBlob> pCompiled;
+      IFT(pLibraryResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pCompiled), nullptr));
+      dxcutil::StoreCachedLibrary(fingerprint, opts.LibCacheDir, pCompiled);
+      pLibrary = pCompiled;
+    }
+
+    // Compile the shader as a library too, skipping the bodies the cached
+    // library provides.
+    std::vector<std::wstring> shaderArgs;
+    RenderArgsExcept(opts.Args, shaderExcluded, shaderArgs);
+    shaderArgs.emplace_back(L"-T");
+    shaderArgs.emplace_back(libTargetW);
+    std::vector<LPCWSTR> shaderArgPointers = GetArgPointers(shaderArgs);
+    CComPtr<IDxcResult> pShaderResult;
+    IFT(CompileImpl(pSource, shaderArgPointers.data(), shaderArgPointers.size(),
+                    pIncludeHandler, pCallback, opts.TargetProfile.str().c_str(),
+                    IID_PPV_ARGS(&pShaderResult)));
+    IFT(pShaderResult->GetStatus(&status));
+    if (FAILED(status))
+      return pShaderResult->QueryInterface(riid, ppResult);
+    CComPtr<IDxcBlob> pShaderLibrary;
+    IFT(pShaderResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pShaderLibrary), nullptr));
+
+    CComPtr<IDxcLinker> pLinker;
+    IFT(CreateDxcLinker(IID_PPV_ARGS(&pLinker)));
+    IFT(pLinker->RegisterLibrary(L"shader", pShaderLibrary));
+    IFT(pLinker->RegisterLibrary(L"lib-cache", pLibrary));
+    std::vector<std::wstring> linkArgs;
+    if (opts.DisableValidation)
+      linkArgs.emplace_back(L"-Vd");
+    if (opts.ValVerMajor != UINT_MAX) {
+      linkArgs.emplace_back(L"-validator-version");
+      linkArgs.emplace_back(std::to_wstring(opts.ValVerMajor) + L"." +
+                            std::to_wstring(opts.ValVerMinor));
+    }
+    std::vector<LPCWSTR> linkArgPointers = GetArgPointers(linkArgs);
+    LPCWSTR libNames[] = { L"shader", L"lib-cache" };
+    std::wstring entryW = Unicode::UTF8ToUTF16StringOrThrow(
+        opts.EntryPoint.empty() ? "main" : opts.EntryPoint.str().c_str());
+    std::wstring targetW =
+        Unicode::UTF8ToUTF16StringOrThrow(opts.TargetProfile.str().c_str());
+    CComPtr<IDxcOperationResult> pLinkResult;
+    IFT(pLinker->Link(entryW.c_str(), targetW.c_str(), libNames,
+                      _countof(libNames), linkArgPointers.data(),
+                      linkArgPointers.size(), &pLinkResult));
+    IFT(pLinkResult->GetStatus(&status));
+
+    // Report the shader compile's warnings along with the link's messages.
+    std::string errors;
+    CComPtr<IDxcBlobUtf8> pShaderErrors;
+    if (SUCCEEDED(pShaderResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&pShaderErrors), nullptr)) &&
+        pShaderErrors)
+      errors.append(pShaderErrors->GetStringPointer(), pShaderErrors->GetStringLength());
+    CComPtr<IDxcBlobEncoding> pLinkErrors;
+    if (SUCCEEDED(pLinkResult->GetErrorBuffer(&pLinkErrors)) && pLinkErrors) {
+      CComPtr<IDxcBlobUtf8> pLinkErrorsUtf8;
+      IFT(hlsl::DxcGetBlobAsUtf8(pLinkErrors, m_pMalloc, &pLinkErrorsUtf8));
+      errors.append(pLinkErrorsUtf8->GetStringPointer(), pLinkErrorsUtf8->GetStringLength());
+    }
+
+    CComPtr<DxcResult> pResult = DxcResult::Alloc(m_pMalloc);
+    IFTOOM(pResult.p);
+    IFT(pResult->SetEncoding(opts.DefaultTextCodePage));
+    CComPtr<IDxcBlob> pObject;
+    if (SUCCEEDED(status))
+      IFT(pLinkResult->GetResult(&pObject));
+    DxcOutputObject primaryOutput;
+    if (pObject) {
+      primaryOutput = DxcOutputObject::DataOutput(DXC_OUT_OBJECT, pObject,
+                                                  opts.OutputObject);
+      IFT(pResult->SetOutput(primaryOutput));
+    }
+    IFT(pResult->SetOutputString(DXC_OUT_ERRORS, errors.c_str(), errors.size()));
+    IFT(pResult->SetStatusAndPrimaryResult(status, pObject ? DXC_OUT_OBJECT : DXC_OUT_NONE));
+    return pResult->QueryInterface(riid, ppResult);
+  }
+
+  HRESULT DisassembleImpl(
+    _In_ const DxcBuffer *pObject,                // Program to disassemble: dxil container or bitcode.
+    _In_opt_ LPCWSTR pFunctionName,               // Only disassemble this function, if provided.
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, disassembly text, and errors
+    ) {
     if (pObject == nullptr || ppResult == nullptr)
       return E_INVALIDARG;
     if (!(IsEqualIID(riid, __uuidof(IDxcResult)) ||
@@ -1044,16 +2036,34 @@ public:
       ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
       IFTLLVM(pts.error_code());
 
-      std::string StreamStr;
-      raw_string_ostream Stream(StreamStr);
+      // The listing is printed straight into the memory stream that backs
+      // the result rather than accumulated in a string and copied.
+      CComPtr<AbstractMemoryStream> pOutputStream;
+      IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
+      raw_stream_ostream Stream(pOutputStream);
 
       CComPtr<IDxcBlobEncoding> pProgram;
       IFT(hlsl::DxcCreateBlob(pObject->Ptr, pObject->Size, true, false, false, 0, nullptr, &pProgram))
-      IFC(dxcutil::Disassemble(pProgram, Stream));
+      if (pFunctionName) {
+        CW2A pUtf8FunctionName(pFunctionName, CP_UTF8);
+        IFC(dxcutil::DisassembleFunction(pProgram, pUtf8FunctionName.m_psz, Stream));
+      } else {
+        IFC(dxcutil::Disassemble(pProgram, Stream));
+      }
+      Stream << '\0';
+      Stream.flush();
+
+      // Reference the null-terminated listing in place instead of copying it.
+      CComPtr<IDxcBlob> pDisassemblyBlob;
+      CComPtr<IDxcBlobEncoding> pDisassemblyEncoding;
+      CComPtr<IDxcBlobUtf8> pDisassembly;
+      IFT(pOutputStream.QueryInterface(&pDisassemblyBlob));
+      IFT(DxcCreateBlobWithEncodingSet(m_pMalloc, pDisassemblyBlob, CP_UTF8,
+                                       &pDisassemblyEncoding));
+      IFT(DxcGetBlobAsUtf8(pDisassemblyEncoding, m_pMalloc, &pDisassembly));
 
       IFT(DxcResult::Create(S_OK, DXC_OUT_DISASSEMBLY, {
-          DxcOutputObject::StringOutput(DXC_OUT_DISASSEMBLY,
-            CP_UTF8, StreamStr.c_str(), StreamStr.size(), DxcOutNoName)
+          DxcOutputObject::DataOutput(DXC_OUT_DISASSEMBLY, CP_UTF8, pDisassembly)
         }, &pResult));
       IFT(pResult->QueryInterface(riid, ppResult));
 
@@ -1078,6 +2088,78 @@ public:
     return hr;
   }
 
+  // Loads a module snapshot written by -fcgl or -fsnapshot-dxil and runs the
+  // rest of the pipeline on it, as the IR input path of CodeGenAction does.
+  // Returns the module, or null after reporting why it could not be loaded
+  // or resumed.
+  static std::unique_ptr<llvm::Module>
+  ResumeFromSnapshot(CompilerInstance &compiler, _In_ const DxcBuffer *pSource,
+                     llvm::LLVMContext &llvmContext, BackendAction action,
+                     _In_ LPCSTR pMainFile) {
+    llvm::ErrorOr<std::unique_ptr<llvm::Module>> pModule =
+        llvm::parseBitcodeFile(
+            llvm::MemoryBufferRef(
+                StringRef((const char *)pSource->Ptr, pSource->Size),
+                pMainFile),
+            llvmContext);
+    if (std::error_code ec = pModule.getError()) {
+      unsigned diagID = compiler.getDiagnostics().getCustomDiagID(
+          clang::DiagnosticsEngine::Error, "cannot load module snapshot: %0");
+      compiler.getDiagnostics().Report(diagID) << ec.message();
+      return nullptr;
+    }
+    if (!IsResumableSnapshot(compiler, *pModule.get()))
+      return nullptr;
+
+    raw_pwrite_stream *OS = compiler.createDefaultOutputFile(
+        true, pMainFile, action == Backend_EmitPasses ? "passes.txt" : "bc");
+    if (!OS)
+      return nullptr;
+    EmitBackendOutput(compiler.getDiagnostics(), compiler.getCodeGenOpts(),
+                      compiler.getTargetOpts(), compiler.getLangOpts(), "",
+                      pModule.get().get(), action, OS);
+    compiler.clearOutputFiles(/*EraseFiles*/ false);
+    return std::move(pModule.get());
+  }
+
+  // Whether M is a snapshot this compiler can resume: it must be paused at
+  // one of the snapshot points, and the passes ahead of the pause must be
+  // this compiler's, as recorded in llvm.ident.  Reports why not otherwise.
+  static bool IsResumableSnapshot(CompilerInstance &compiler, llvm::Module &M) {
+    StringRef pause, resume;
+    hlsl::GetPauseResumePasses(M, pause, resume);
+    if (resume != "hlsl-hlensure" && resume != "hlsl-dxilload") {
+      unsigned diagID = compiler.getDiagnostics().getCustomDiagID(
+          clang::DiagnosticsEngine::Error,
+          "input is LLVM bitcode but not a module snapshot; only modules "
+          "written by -fcgl or -fsnapshot-dxil can be compiled");
+      compiler.getDiagnostics().Report(diagID);
+      return false;
+    }
+
+    std::string version = getClangFullVersion();
+    StringRef snapshotVersion;
+    if (NamedMDNode *pIdent = M.getNamedMetadata("llvm.ident")) {
+      if (pIdent->getNumOperands() > 0 &&
+          pIdent->getOperand(0)->getNumOperands() > 0) {
+        if (MDString *pVersion =
+                dyn_cast<MDString>(pIdent->getOperand(0)->getOperand(0)))
+          snapshotVersion = pVersion->getString();
+      }
+    }
+    if (snapshotVersion != version) {
+      unsigned diagID = compiler.getDiagnostics().getCustomDiagID(
+          clang::DiagnosticsEngine::Error,
+          "module snapshot was written by compiler '%0' and cannot be "
+          "resumed by compiler '%1'");
+      compiler.getDiagnostics().Report(diagID)
+          << (snapshotVersion.empty() ? StringRef("unknown") : snapshotVersion)
+          << version;
+      return false;
+    }
+    return true;
+  }
+
   void SetupCompilerForCompile(CompilerInstance &compiler,
                                _In_ DxcLangExtensionsHelper *helper,
                                _In_ LPCSTR pMainFile, _In_ TextDiagnosticPrinter *diagPrinter,
@@ -1198,6 +2280,7 @@ public:
       compiler.getCodeGenOpts().UnrollLoops = true;
 
     compiler.getCodeGenOpts().HLSLHighLevel = Opts.CodeGenHighLevel;
+    compiler.getCodeGenOpts().HLSLPauseAtDxil = Opts.CodeGenDxilSnapshot;
     compiler.getCodeGenOpts().HLSLAllowPreserveValues = Opts.AllowPreserveValues;
     compiler.getCodeGenOpts().HLSLOnlyWarnOnUnrollFail = Opts.EnableFXCCompatMode;
     compiler.getCodeGenOpts().HLSLResMayAlias = Opts.ResMayAlias;
@@ -1214,6 +2297,7 @@ public:
     compiler.getCodeGenOpts().HLSLPreciseOutputs = Opts.PreciseOutputs;
     compiler.getCodeGenOpts().MainFileName = pMainFile;
     compiler.getCodeGenOpts().HLSLPrintAfterAll = Opts.PrintAfterAll;
+    compiler.getCodeGenOpts().HLSLParallelBitcode = Opts.ParallelBitcode;
 
     // Translate signature packing options
     if (Opts.PackPrefixStable)
@@ -1250,9 +2334,32 @@ public:
     // processed export names from -exports option:
     compiler.getCodeGenOpts().HLSLLibraryExports = Opts.Exports;
 
+    // Let codegen skip bodies that no export can reach. Parse errors are
+    // reported by codegen, so just keep every function in that case.
+    if (!Opts.Exports.empty()) {
+      hlsl::dxilutil::ExportMap exportMap;
+      std::string errors;
+      llvm::raw_string_ostream os(errors);
+      std::vector<std::string> &names =
+          compiler.getLangOpts().HLSLLibraryExportNames;
+      if (exportMap.ParseExports(Opts.Exports, os)) {
+        for (auto &it : exportMap)
+          names.emplace_back(hlsl::dxilutil::DemangleFunctionName(it.getKey()));
+        std::sort(names.begin(), names.end());
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+      }
+    }
+
     // only export shader functions for library
     compiler.getCodeGenOpts().ExportShadersOnly = Opts.ExportShadersOnly;
 
+    // Functions defined in -lib-cache-include files are left to the library
+    // this one is linked with; only their declarations are parsed.
+    if (Opts.IsLibraryProfile() && !Opts.LibCacheIncludes.empty()) {
+      compiler.getCodeGenOpts().HLSLLibraryCacheIncludes = Opts.LibCacheIncludes;
+      compiler.getFrontendOpts().SkipFunctionBodies = true;
+    }
+
     if (Opts.DefaultLinkage.empty()) {
       compiler.getCodeGenOpts().DefaultLinkage = DXIL::DefaultLinkage::Default;
     } else if (Opts.DefaultLinkage.equals_lower("internal")) {
@@ -1364,8 +2471,6 @@ HRESULT STDMETHODCALLTYPE DxcCompilerAdapter::Disassemble(
   return hr;
 }
 
-HRESULT CreateDxcUtils(_In_ REFIID riid, _Out_ LPVOID *ppv);
-
 HRESULT STDMETHODCALLTYPE DxcCompilerAdapter::CompileWithDebug(
   _In_ IDxcBlob *pSource,                       // Source text to compile
   _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
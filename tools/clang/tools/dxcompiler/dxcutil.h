@@ -24,6 +24,7 @@ namespace llvm {
 class LLVMContext;
 class MemoryBuffer;
 class Module;
+class raw_ostream;
 class raw_string_ostream;
 class Twine;
 } // namespace llvm
@@ -68,7 +69,9 @@ HRESULT ValidateRootSignatureInContainer(
     IDxcBlob *pRootSigContainer, clang::DiagnosticsEngine *pDiag = nullptr);
 void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor);
 void AssembleToContainer(AssembleInputs &inputs);
-HRESULT Disassemble(IDxcBlob *pProgram, llvm::raw_string_ostream &Stream);
+HRESULT Disassemble(IDxcBlob *pProgram, llvm::raw_ostream &Stream);
+HRESULT DisassembleFunction(IDxcBlob *pProgram, llvm::StringRef FunctionName,
+                            llvm::raw_ostream &Stream);
 HRESULT Decompile(IDxcBlob *pProgram, llvm::raw_string_ostream &Stream);
 void ReadOptsAndValidate(hlsl::options::MainArgs &mainArgs,
                          hlsl::options::DxcOpts &opts,
@@ -24,6 +24,11 @@
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/dxcapi.impl.h"
 #include "dxc/DxilRootSignature/DxilRootSignature.h"
+#include "dxc/HLSL/DxilValidationCache.h"
+#include "llvm/ADT/Twine.h"
+
+#include <cstdlib>
+#include <cstring>
 
 #ifdef _WIN32
 #include "dxcetw.h"
@@ -53,6 +58,30 @@ struct DiagRestore {
   }
 };
 
+// Returns the process-wide validation cache, or null unless it was enabled by
+// setting DXC_VALIDATION_CACHE.  Entries are digests held in memory only and
+// keyed on this validator build, so they never outlive the validator that
+// made them.
+static DxilValidationCache *GetValidationCache() {
+  static DxilValidationCache *s_pCache = []() -> DxilValidationCache * {
+    const char *pEnabled = std::getenv("DXC_VALIDATION_CACHE");
+    if (pEnabled == nullptr || *pEnabled == '\0' ||
+        std::strcmp(pEnabled, "0") == 0)
+      return nullptr;
+    unsigned ValMajor, ValMinor;
+    GetValidationVersion(&ValMajor, &ValMinor);
+    std::string Build =
+        (Twine(ValMajor) + "." + Twine(ValMinor)).str();
+#ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
+    Build += (Twine(".") + Twine(clang::getGitCommitCount()) + "." +
+              clang::getGitCommitHash()).str();
+#endif // SUPPORT_QUERY_GIT_COMMIT_INFO
+    DxcThreadMalloc TM(nullptr);
+    return new DxilValidationCache(Build, /*MaxEntries*/ 64);
+  }();
+  return s_pCache;
+}
+
 class DxcValidator : public IDxcValidator,
 #ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
                      public IDxcVersionInfo2
@@ -70,6 +99,10 @@ private:
     _In_ llvm::Module *pDebugModule,              // Debug module to validate, if available
     _In_ AbstractMemoryStream *pDiagStream);
 
+  HRESULT RunCachedContainerValidation(
+    _In_ IDxcBlob *pShader,                       // Container to validate.
+    _In_ llvm::raw_ostream &DiagStream);
+
   HRESULT RunRootSignatureValidation(
     _In_ IDxcBlob *pShader,                       // Shader to validate.
     _In_ AbstractMemoryStream *pDiagStream);
@@ -225,7 +258,7 @@ HRESULT DxcValidator::RunValidation(
     if (Flags & DxcValidatorFlags_ModuleOnly) {
       return ValidateDxilBitcode((const char*)pShader->GetBufferPointer(), (uint32_t)pShader->GetBufferSize(), DiagStream);
     } else {
-      return ValidateDxilContainer(pShader->GetBufferPointer(), pShader->GetBufferSize(), DiagStream);
+      return RunCachedContainerValidation(pShader, DiagStream);
     }
   }
 
@@ -247,6 +280,35 @@ HRESULT DxcValidator::RunValidation(
   return S_OK;
 }
 
+HRESULT DxcValidator::RunCachedContainerValidation(
+  _In_ IDxcBlob *pShader,
+  _In_ llvm::raw_ostream &DiagStream) {
+  DxilValidationCache *pCache = GetValidationCache();
+  const void *pContainer = pShader->GetBufferPointer();
+  uint32_t ContainerSize = (uint32_t)pShader->GetBufferSize();
+  const DxilContainerHeader *pHeader =
+    IsDxilContainerLike(pContainer, ContainerSize);
+  DxilValidationCache::Key CacheKey;
+  if (pCache == nullptr || !IsValidDxilContainer(pHeader, ContainerSize) ||
+      !pCache->ComputeKey(pHeader, CacheKey)) {
+    return ValidateDxilContainer(pContainer, ContainerSize, DiagStream);
+  }
+
+  DxilValidationCache::LookupResult Found = pCache->Lookup(CacheKey);
+  if (Found == DxilValidationCache::LookupResult::ContainerMatch)
+    return S_OK;
+
+  // Only successful validations are cached, so failures always rerun and
+  // produce their diagnostics.
+  HRESULT hr = ValidateDxilContainer(
+    pContainer, ContainerSize,
+    /*bSkipModuleValidation*/ Found == DxilValidationCache::LookupResult::ModuleMatch,
+    DiagStream);
+  if (SUCCEEDED(hr))
+    pCache->Insert(CacheKey);
+  return hr;
+}
+
 HRESULT DxcValidator::RunRootSignatureValidation(
   _In_ IDxcBlob *pShader,
   _In_ AbstractMemoryStream *pDiagStream) {
@@ -266,18 +328,17 @@ HRESULT DxcValidator::RunRootSignatureValidation(
     IFRBOOL(pPSVPart, DXC_E_MISSING_PART);
   }
   try {
-    RootSignatureHandle RSH;
-    RSH.LoadSerialized((const uint8_t*)GetDxilPartData(pRSPart), pRSPart->PartSize);
-    RSH.Deserialize();
     raw_stream_ostream DiagStream(pDiagStream);
     if (pProgramHeader) {
-      IFRBOOL(VerifyRootSignatureWithShaderPSV(RSH.GetDesc(),
-                                               GetVersionShaderType(pProgramHeader->ProgramVersion),
-                                               GetDxilPartData(pPSVPart),
-                                               pPSVPart->PartSize,
-                                               DiagStream),
+      IFRBOOL(VerifySerializedRootSignatureWithShaderPSV(
+                  GetDxilPartData(pRSPart), pRSPart->PartSize,
+                  GetVersionShaderType(pProgramHeader->ProgramVersion),
+                  GetDxilPartData(pPSVPart), pPSVPart->PartSize, DiagStream),
               DXC_E_INCORRECT_ROOT_SIGNATURE);
     } else {
+      RootSignatureHandle RSH;
+      RSH.LoadSerialized((const uint8_t*)GetDxilPartData(pRSPart), pRSPart->PartSize);
+      RSH.Deserialize();
       IFRBOOL(VerifyRootSignature(RSH.GetDesc(), DiagStream, false),
               DXC_E_INCORRECT_ROOT_SIGNATURE);
     }
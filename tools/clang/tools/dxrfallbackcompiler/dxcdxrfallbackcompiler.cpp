@@ -32,6 +32,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/MSFileSystem.h"
 #include "llvm/Support/SourceMgr.h"
@@ -39,6 +40,9 @@
 
 #include "dxc/HLSL/DxilFallbackLayerPass.h"
 
+#include <deque>
+#include <map>
+
 using namespace llvm;
 using namespace hlsl;
 
@@ -135,6 +139,37 @@ private:
 
   // Only used for test purposes when exports aren't explicitly listed
   std::unique_ptr<DxrFallbackCompiler::IntToFuncNameMap> m_pCachedMap;
+
+  // Results of previous Compile() calls, keyed by a hash of the libraries,
+  // shader names and attribute size. Rebuilding a pipeline whose shaders have
+  // not changed returns the cached library, shader infos and warnings instead
+  // of running the state function transform again. Oldest entries are evicted
+  // first.
+  //
+  // This is a whole-pipeline cache: changing any library misses, and there is
+  // no per-function cache of transformed state functions. State functions
+  // are not self-contained. Their state ids index the pipeline's list of
+  // shader names and are only fixed up after every shader has been
+  // transformed. They also reference the linked runtime and the pipeline's
+  // resources by value, in an LLVMContext that lives for a single Compile()
+  // call. Reusing one would mean serializing it, relinking it into the next
+  // module and renumbering its states, which is a full link step of its own.
+  struct CompileCacheEntry
+  {
+    CComPtr<IDxcBlob> pResult;
+    std::vector<DxcShaderInfo> shaderInfo;
+    std::string diagnostics;
+  };
+  static const size_t kMaxCompileCacheEntries = 32;
+  std::map<std::string, CompileCacheEntry> m_compileCache;
+  std::deque<std::string> m_compileCacheOrder;
+
+  static std::string hashCompileInputs(DxcShaderBytecode *pShaderLibs, UINT32 libCount,
+                                       const LPCWSTR *pShaderNames, UINT32 shaderCount,
+                                       UINT32 maxAttributeSize);
+  void addToCompileCache(const std::string &key, IDxcBlob *pResult,
+                         const DxcShaderInfo *pShaderInfo, UINT32 shaderCount,
+                         AbstractMemoryStream *pDiagStream);
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
     DXC_MICROCOM_TM_CTOR(DxcDxrFallbackCompiler)
@@ -583,6 +618,61 @@ HRESULT STDMETHODCALLTYPE DxcDxrFallbackCompiler::Link(
     return hr;
 }
 
+std::string DxcDxrFallbackCompiler::hashCompileInputs(
+  DxcShaderBytecode *pShaderLibs, UINT32 libCount,
+  const LPCWSTR *pShaderNames, UINT32 shaderCount,
+  UINT32 maxAttributeSize)
+{
+  // Sizes are hashed ahead of each variable length input so that different
+  // splits of the same bytes produce different keys.
+  MD5 hash;
+  unsigned int valMajor = 0, valMinor = 0;
+  dxcutil::GetValidatorVersion(&valMajor, &valMinor);
+  uint32_t header[] = { valMajor, valMinor, libCount, shaderCount, maxAttributeSize };
+  hash.update(ArrayRef<uint8_t>((const uint8_t *)header, sizeof(header)));
+  for (UINT32 i = 0; i < libCount; ++i)
+  {
+    uint64_t size = pShaderLibs[i].Size;
+    hash.update(ArrayRef<uint8_t>((const uint8_t *)&size, sizeof(size)));
+    hash.update(ArrayRef<uint8_t>((const uint8_t *)pShaderLibs[i].pData, pShaderLibs[i].Size));
+  }
+  for (UINT32 i = 0; i < shaderCount; ++i)
+  {
+    std::string name = ws2s(pShaderNames[i]);
+    uint64_t size = name.size();
+    hash.update(ArrayRef<uint8_t>((const uint8_t *)&size, sizeof(size)));
+    hash.update(name);
+  }
+
+  MD5::MD5Result result;
+  hash.final(result);
+  SmallString<32> hex;
+  MD5::stringifyResult(result, hex);
+  return hex.str();
+}
+
+void DxcDxrFallbackCompiler::addToCompileCache(
+  const std::string &key, IDxcBlob *pResult,
+  const DxcShaderInfo *pShaderInfo, UINT32 shaderCount,
+  AbstractMemoryStream *pDiagStream)
+{
+  if (m_compileCache.count(key))
+    return;
+
+  if (m_compileCacheOrder.size() >= kMaxCompileCacheEntries)
+  {
+    m_compileCache.erase(m_compileCacheOrder.front());
+    m_compileCacheOrder.pop_front();
+  }
+
+  CompileCacheEntry &entry = m_compileCache[key];
+  entry.pResult = pResult;
+  entry.shaderInfo.assign(pShaderInfo, pShaderInfo + shaderCount);
+  entry.diagnostics.assign((const char *)pDiagStream->GetPtr(),
+                           pDiagStream->GetPtrSize());
+  m_compileCacheOrder.push_back(key);
+}
+
 HRESULT STDMETHODCALLTYPE DxcDxrFallbackCompiler::Compile(
   _In_count_(libCount) DxcShaderBytecode *pShaderLibs,
   UINT32 libCount,
@@ -605,6 +695,32 @@ HRESULT STDMETHODCALLTYPE DxcDxrFallbackCompiler::Compile(
   LLVMContext context;
   try
   {
+    // The called shader map is rebuilt by every compile in test mode, so only
+    // cache compiles with explicitly listed shaders. Compiles with debug
+    // output always run in full, so that their module dumps are written.
+    bool useCache = !m_findCalledShaders && !m_debugOutput;
+    std::string cacheKey;
+    if (useCache)
+    {
+      cacheKey = hashCompileInputs(pShaderLibs, libCount, pShaderNames, shaderCount, maxAttributeSize);
+      auto it = m_compileCache.find(cacheKey);
+      if (it != m_compileCache.end())
+      {
+        const CompileCacheEntry &entry = it->second;
+        std::copy(entry.shaderInfo.begin(), entry.shaderInfo.end(), pShaderInfo);
+
+        CComPtr<AbstractMemoryStream> pDiagStream;
+        IFT(CreateMemoryStream(TM.GetInstalledAllocator(), &pDiagStream));
+        ULONG cbWritten;
+        IFT(pDiagStream->Write(entry.diagnostics.data(),
+                               (ULONG)entry.diagnostics.size(), &cbWritten));
+        CComPtr<IStream> pStream = pDiagStream;
+        std::string warnings;
+        dxcutil::CreateOperationResultFromOutputs(entry.pResult, pStream, warnings, false, ppResult);
+        return S_OK;
+      }
+    }
+
     std::vector<CComPtr<IDxcBlobEncoding>> pLibs(libCount);
     for (UINT i = 0; i < libCount; i++)
     {
@@ -741,6 +857,9 @@ HRESULT STDMETHODCALLTYPE DxcDxrFallbackCompiler::Compile(
         pShaderInfo[i].StackSize = shaderStackSizes[i];
         pShaderInfo[i].Type = shaderTypes[i];
     }
+
+    if (useCache && pResultBlob && !hasErrors)
+      addToCompileCache(cacheKey, pResultBlob, pShaderInfo, shaderCount, pDiagStream);
   }
   CATCH_CPP_ASSIGN_HRESULT();
 
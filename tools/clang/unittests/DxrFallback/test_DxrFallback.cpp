@@ -293,6 +293,64 @@ public:
     return runTest(pComputeShader, shaderIds[0].Identifier, input, expectedOutput);
   }
 
+  // Compiles the current files twice with one compiler, which must reuse the
+  // first result, then again with the file at changedIdx built without
+  // optimizations, which must not.
+  //
+  // Returns the number of failures.
+  int runCacheTest(const std::vector<std::string>& shaderNames, size_t changedIdx, const std::string& changedFile)
+  {
+    CComPtr<IDxcDxrFallbackCompiler> pCompiler;
+    IFT(m_dxrFallbackSupport.CreateInstance(CLSID_DxcDxrFallbackCompiler, &pCompiler));
+    IFT(pCompiler->SetFindCalledShaders(false));
+    IFT(pCompiler->SetDebugOutput(0));
+
+    std::vector<std::wstring> shaderNamesW(shaderNames.size());
+    std::vector<LPCWSTR> shaderNamePtrs(shaderNames.size());
+    for (size_t i = 0; i < shaderNames.size(); ++i)
+    {
+      shaderNamesW[i] = s2ws(shaderNames[i]);
+      shaderNamePtrs[i] = shaderNamesW[i].c_str();
+    }
+
+    auto compile = [&](const std::vector<IDxcBlob*>& libs, std::vector<DxcShaderInfo>& shaderIds) {
+      std::vector<DxcShaderBytecode> bytecode(libs.size());
+      for (size_t i = 0; i < libs.size(); i++)
+        bytecode[i] = { (LPBYTE)libs[i]->GetBufferPointer(), (UINT32)libs[i]->GetBufferSize() };
+      shaderIds.resize(shaderNames.size());
+      CComPtr<IDxcOperationResult> pCompileResult;
+      IFT(pCompiler->Compile(
+        bytecode.data(), (UINT32)bytecode.size(),
+        shaderNamePtrs.data(), shaderIds.data(), (UINT32)shaderNamePtrs.size(), 32,
+        &pCompileResult));
+      CComPtr<IDxcBlob> pResult;
+      pCompileResult->GetResult(&pResult);
+      return pResult;
+    };
+
+    int numFailed = 0;
+    std::vector<DxcShaderInfo> firstIds, secondIds, changedIds;
+    CComPtr<IDxcBlob> pFirst = compile(m_inputBlobPtrs, firstIds);
+    CComPtr<IDxcBlob> pSecond = compile(m_inputBlobPtrs, secondIds);
+    bool hit = pFirst && pFirst == pSecond;
+    for (size_t i = 0; hit && i < shaderNames.size(); ++i)
+      hit = firstIds[i].Identifier == secondIds[i].Identifier && firstIds[i].StackSize == secondIds[i].StackSize;
+    std::cout << "unchanged libraries: " << (hit ? "PASSED" : "FAILED") << "\n";
+    numFailed += hit ? 0 : 1;
+
+    CComPtr<IDxcBlob> pChangedLib;
+    LPCWSTR args[] = { L"-Od" };
+    CompileToDxilFromFile(m_dxcSupport, s2ws(m_path + changedFile).c_str(), L"", L"lib_6_3", args, _countof(args), nullptr, 0, &pChangedLib);
+    std::vector<IDxcBlob*> changedLibs(m_inputBlobPtrs);
+    changedLibs[changedIdx] = pChangedLib;
+    CComPtr<IDxcBlob> pChanged = compile(changedLibs, changedIds);
+    bool miss = pChanged && pChanged != pFirst;
+    std::cout << "changed library: " << (miss ? "PASSED" : "FAILED") << "\n";
+    numFailed += miss ? 0 : 1;
+
+    return numFailed;
+  }
+
   void compileTest(const std::vector<std::string>& shaderNames, const std::string& entryName)
   {
     std::vector<DxcShaderInfo> shaderIds(shaderNames.size());
@@ -886,6 +944,7 @@ int main(int argc, const char* argv[])
 
       tester.setFiles({ "testShader5.hlsl" });
       numFailed += tester.runSingleTest({ "raygen", "ch1", "ch2", "miss1", "miss2", "Fallback_TraceRay" }, {1002, 1005, 1007, 1009, 1009}, {-99, 100,0, -99,101,1, -99,102,2, -99,103,3, 2, 1, 0, -99,103,4, 0, 21111});
+      numFailed += tester.runCacheTest({ "raygen", "ch1", "ch2", "miss1", "miss2", "Fallback_TraceRay" }, 0, "testShader5.hlsl");
     }
 
     if (1)
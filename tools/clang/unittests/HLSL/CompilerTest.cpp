@@ -24,8 +24,8 @@
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/dxcapi.h"
-#include "dxc/dxcpix.h"
 #ifdef _WIN32
+#include "dxc/dxcpix.h"
 #include <atlfile.h>
 #include "dia2.h"
 #endif
@@ -104,6 +104,54 @@ public:
   }
 };
 
+// Records what the compile streams to it, and cancels the compile once a
+// number of phases have been entered.
+class TestCompileCallback : public IDxcCompileCallback {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  std::vector<std::string> Diagnostics;
+  std::vector<std::string> Phases;
+  size_t CancelAfterPhases = SIZE_MAX;
+  TestCompileCallback() : m_dwRef(0) { }
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override {
+    return DoBasicQueryInterface<IDxcCompileCallback>(this, iid, ppvObject);
+  }
+
+  void STDMETHODCALLTYPE OnDiagnostic(LPCSTR pText, SIZE_T textLength) override {
+    Diagnostics.emplace_back(pText, textLength);
+  }
+  void STDMETHODCALLTYPE OnProgress(LPCSTR pPhase) override {
+    Phases.emplace_back(pPhase);
+  }
+  BOOL STDMETHODCALLTYPE IsCancelled() override {
+    return Phases.size() >= CancelAfterPhases;
+  }
+};
+
+// Takes memory of the host's own on the compile thread as the compile
+// starts, as the host or another of its threads might.
+class HeapTakingCallback : public IDxcCompileCallback {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  std::vector<std::unique_ptr<char[]>> Blocks;
+  HeapTakingCallback() : m_dwRef(0) { }
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override {
+    return DoBasicQueryInterface<IDxcCompileCallback>(this, iid, ppvObject);
+  }
+
+  void STDMETHODCALLTYPE OnDiagnostic(LPCSTR, SIZE_T) override { }
+  void STDMETHODCALLTYPE OnProgress(LPCSTR) override {
+    // 256 MB in blocks small enough to come from the heap.
+    while (Blocks.size() < 64 * 1024) {
+      Blocks.emplace_back(new char[4096]);
+      Blocks.back()[0] = 1;
+    }
+  }
+  BOOL STDMETHODCALLTYPE IsCancelled() override { return FALSE; }
+};
+
 #ifdef _WIN32
 class CompilerTest {
 #else
@@ -121,7 +169,16 @@ public:
   TEST_METHOD(CompileWhenDefinesManyThenApplied)
   TEST_METHOD(CompileWhenEmptyThenFails)
   TEST_METHOD(CompileWhenIncorrectThenFails)
+  TEST_METHOD(CompileWhenOverBudgetThenFails)
+  TEST_METHOD(CompileWhenMemoryBudgetThenOwnAllocationsCounted)
+  TEST_METHOD(CompileWhenCallbackThenStreamsAndCancels)
   TEST_METHOD(CompileWhenWorksThenDisassembleWorks)
+  TEST_METHOD(CompileWhenWorksThenDisassembleFunctionWorks)
+  TEST_METHOD(CompilePermutationsWhenSamePreprocessedThenCompiledOnce)
+  TEST_METHOD(SpecializeWhenConstantKnownThenLoadFolded)
+  TEST_METHOD(SpecializeWhenMinPrecisionThenDwordsRead)
+  TEST_METHOD(SpecializeWhenHeapConstantBufferThenFails)
+  TEST_METHOD(CompileWhenSnapshotThenResumeWorks)
   TEST_METHOD(CompileWhenDebugWorksThenStripDebug)
   TEST_METHOD(CompileWhenWorksThenAddRemovePrivate)
   TEST_METHOD(CompileThenAddCustomDebugName)
@@ -136,6 +193,8 @@ public:
   TEST_METHOD(CompileWhenIncludeFlagsThenIncludeUsed)
   TEST_METHOD(CompileWhenIncludeMissingThenFail)
   TEST_METHOD(CompileWhenIncludeHasPathThenOK)
+  TEST_METHOD(CompileWhenScanDependenciesThenIncludesListed)
+  TEST_METHOD(CompileWhenLibCacheIncludeThenHitsAndMisses)
   TEST_METHOD(CompileWhenIncludeEmptyThenOK)
 
   TEST_METHOD(CompileWhenODumpThenPassConfig)
@@ -768,6 +827,158 @@ TEST_F(CompilerTest, CompileWhenIncorrectThenFails) {
   // WEX::Logging::Log::Comment(errorStringW.m_psz);
 }
 
+TEST_F(CompilerTest, CompileWhenOverBudgetThenFails) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main(float4 pos : SV_Position) : SV_Target {\n"
+                     "  float4 r = pos;\n"
+                     "  [unroll] for (int i = 0; i < 4096; ++i)\n"
+                     "    r = sin(r * i) + cos(r + i);\n"
+                     "  return r;\n"
+                     "}",
+                     &pSource);
+
+  // A generous budget does not get in the way.
+  {
+    LPCWSTR args[] = { L"-time-budget", L"600000" };
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_0", args, _countof(args),
+                                        nullptr, 0, nullptr, &pResult));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+  }
+
+  // An exhausted one stops the compile with an error naming the budget.
+  {
+    LPCWSTR args[] = { L"-time-budget", L"1" };
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_0", args, _countof(args),
+                                        nullptr, 0, nullptr, &pResult));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_ARE_EQUAL(DXC_E_COMPILE_BUDGET_EXCEEDED, status);
+
+    CComPtr<IDxcBlobEncoding> pErrorBuffer;
+    VERIFY_SUCCEEDED(pResult->GetErrorBuffer(&pErrorBuffer));
+    std::string errorString(BlobToUtf8(pErrorBuffer));
+    VERIFY_ARE_NOT_EQUAL(std::string::npos,
+                         errorString.find("exceeded its time budget of 1 ms"));
+  }
+}
+
+// The memory budget counts what the compile allocates, as it allocates it,
+// and not what the rest of the process takes meanwhile.
+TEST_F(CompilerTest, CompileWhenMemoryBudgetThenOwnAllocationsCounted) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompiler9> pCompiler9;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCompiler9));
+  CreateBlobFromText("float4 main(float4 pos : SV_Position) : SV_Target {\n"
+                     "  float4 r = pos;\n"
+                     "  [unroll] for (int i = 0; i < 64; ++i)\n"
+                     "    r = sin(r * i) + cos(r + i);\n"
+                     "  return r;\n"
+                     "}",
+                     &pSource);
+  DxcBuffer buffer = { pSource->GetBufferPointer(), pSource->GetBufferSize(), 0 };
+  auto compile = [&](LPCWSTR megabytes, IDxcCompileCallback *pCallback) {
+    LPCWSTR args[] = { L"-T", L"ps_6_0", L"-memory-budget", megabytes };
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler9->CompileWithCallback(
+        &buffer, args, _countof(args), nullptr, pCallback,
+        IID_PPV_ARGS(&pResult)));
+    return pResult;
+  };
+  auto getStatus = [](IDxcOperationResult *pResult) {
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    return status;
+  };
+
+  // The host's 256 MB do not count against a budget of 128 MB.
+  {
+    CComPtr<HeapTakingCallback> pCallback = new HeapTakingCallback();
+    VERIFY_SUCCEEDED(getStatus(compile(L"128", pCallback)));
+    VERIFY_ARE_EQUAL(64u * 1024u, pCallback->Blocks.size());
+  }
+
+  // A budget too small for the front end fails it with an error naming the
+  // budget rather than as out of memory.
+  CComPtr<IDxcOperationResult> pResult = compile(L"1", nullptr);
+  VERIFY_ARE_EQUAL(DXC_E_COMPILE_BUDGET_EXCEEDED, getStatus(pResult));
+  CComPtr<IDxcBlobEncoding> pErrorBuffer;
+  VERIFY_SUCCEEDED(pResult->GetErrorBuffer(&pErrorBuffer));
+  std::string errorString(BlobToUtf8(pErrorBuffer));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos,
+                       errorString.find("exceeded its memory budget of 1 MB"));
+
+  // The exceeded budget does not outlive its compile.
+  VERIFY_SUCCEEDED(getStatus(compile(L"128", nullptr)));
+}
+
+TEST_F(CompilerTest, CompileWhenCallbackThenStreamsAndCancels) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompiler9> pCompiler9;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCompiler9));
+  CreateBlobFromText("float4 main(float4 pos : SV_Position) : SV_Target {\n"
+                     "  float2 xy = pos;\n"
+                     "  return float4(xy, 0, 1);\n"
+                     "}",
+                     &pSource);
+  LPCWSTR args[] = { L"-T", L"ps_6_0" };
+  DxcBuffer buffer = { pSource->GetBufferPointer(), pSource->GetBufferSize(), 0 };
+
+  // Diagnostics and phases arrive as the compile runs.
+  {
+    CComPtr<TestCompileCallback> pCallback = new TestCompileCallback();
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler9->CompileWithCallback(
+        &buffer, args, _countof(args), nullptr, pCallback,
+        IID_PPV_ARGS(&pResult)));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+    VERIFY_IS_FALSE(pCallback->Diagnostics.empty());
+    VERIFY_ARE_NOT_EQUAL(std::string::npos,
+                         pCallback->Diagnostics[0].find("implicit truncation"));
+    VERIFY_IS_TRUE(pCallback->Phases.size() > 2);
+    VERIFY_ARE_EQUAL(std::string("front end"), pCallback->Phases.front());
+    VERIFY_IS_TRUE(std::find(pCallback->Phases.begin(), pCallback->Phases.end(),
+                             "container assembly and validation") !=
+                   pCallback->Phases.end());
+  }
+
+  // Cancelling stops the compile at the next pass.
+  {
+    CComPtr<TestCompileCallback> pCallback = new TestCompileCallback();
+    pCallback->CancelAfterPhases = 2;
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler9->CompileWithCallback(
+        &buffer, args, _countof(args), nullptr, pCallback,
+        IID_PPV_ARGS(&pResult)));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_ARE_EQUAL(E_ABORT, status);
+    VERIFY_ARE_EQUAL(2U, pCallback->Phases.size());
+
+    CComPtr<IDxcBlobEncoding> pErrorBuffer;
+    VERIFY_SUCCEEDED(pResult->GetErrorBuffer(&pErrorBuffer));
+    std::string errorString(BlobToUtf8(pErrorBuffer));
+    VERIFY_ARE_NOT_EQUAL(std::string::npos,
+                         errorString.find("compilation cancelled"));
+  }
+}
+
 TEST_F(CompilerTest, CompileWhenWorksThenDisassembleWorks) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -796,6 +1007,295 @@ TEST_F(CompilerTest, CompileWhenWorksThenDisassembleWorks) {
   // WEX::Logging::Log::Comment(disassembleStringW.m_psz);
 }
 
+TEST_F(CompilerTest, CompileWhenWorksThenDisassembleFunctionWorks) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("export float KeepMe(float a) { return a * 2; }\n"
+                     "export float SkipMe(float a) { return a + 3; }",
+                     &pSource);
+
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"",
+                                      L"lib_6_3", nullptr, 0, nullptr, 0,
+                                      nullptr, &pResult));
+  HRESULT result;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&result));
+  VERIFY_SUCCEEDED(result);
+
+  CComPtr<IDxcBlob> pProgram;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  CComPtr<IDxcCompiler5> pCompiler5;
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCompiler5));
+  DxcBuffer buffer = { pProgram->GetBufferPointer(), pProgram->GetBufferSize(), 0 };
+
+  CComPtr<IDxcResult> pDisassembleResult;
+  VERIFY_SUCCEEDED(pCompiler5->DisassembleFunction(
+      &buffer, L"KeepMe", IID_PPV_ARGS(&pDisassembleResult)));
+  VERIFY_SUCCEEDED(pDisassembleResult->GetStatus(&result));
+  VERIFY_SUCCEEDED(result);
+  CComPtr<IDxcBlobUtf8> pDisassembly;
+  VERIFY_SUCCEEDED(pDisassembleResult->GetOutput(
+      DXC_OUT_DISASSEMBLY, IID_PPV_ARGS(&pDisassembly), nullptr));
+  std::string disassembleString(pDisassembly->GetStringPointer(),
+                                pDisassembly->GetStringLength());
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, disassembleString.find("KeepMe"));
+  VERIFY_ARE_EQUAL(std::string::npos, disassembleString.find("SkipMe"));
+
+  // Unknown functions fail with an error rather than a partial listing.
+  pDisassembleResult.Release();
+  VERIFY_SUCCEEDED(pCompiler5->DisassembleFunction(
+      &buffer, L"Missing", IID_PPV_ARGS(&pDisassembleResult)));
+  VERIFY_SUCCEEDED(pDisassembleResult->GetStatus(&result));
+  VERIFY_FAILED(result);
+}
+
+TEST_F(CompilerTest, CompilePermutationsWhenSamePreprocessedThenCompiledOnce) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompiler6> pCompiler6;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCompiler6));
+  CreateBlobFromText("#ifdef BRIGHT\n"
+                     "float4 main() : SV_Target { return 1; }\n"
+                     "#else\n"
+                     "float4 main() : SV_Target { return 0; }\n"
+                     "#endif",
+                     &pSource);
+
+  // The second permutation defines a macro that is never used, so it
+  // preprocesses exactly like the first.
+  DxcDefine unusedDefine = { L"UNUSED", L"1" };
+  DxcDefine brightDefine = { L"BRIGHT", nullptr };
+  DxcPermutation permutations[] = {
+    { nullptr, 0 }, { &unusedDefine, 1 }, { &brightDefine, 1 }
+  };
+  LPCWSTR args[] = { L"-T", L"ps_6_0" };
+  DxcBuffer buffer = { pSource->GetBufferPointer(), pSource->GetBufferSize(), 0 };
+
+  CComPtr<IDxcPermutationResults> pResults;
+  VERIFY_SUCCEEDED(pCompiler6->CompilePermutations(
+      &buffer, args, _countof(args), permutations, _countof(permutations),
+      nullptr, IID_PPV_ARGS(&pResults)));
+  VERIFY_ARE_EQUAL(3u, pResults->GetPermutationCount());
+  VERIFY_ARE_EQUAL(2u, pResults->GetCompileCount());
+
+  UINT32 sharedIndex;
+  VERIFY_SUCCEEDED(pResults->GetSharedIndex(1, &sharedIndex));
+  VERIFY_ARE_EQUAL(0u, sharedIndex);
+  VERIFY_SUCCEEDED(pResults->GetSharedIndex(2, &sharedIndex));
+  VERIFY_ARE_EQUAL(2u, sharedIndex);
+
+  for (UINT32 i = 0; i < _countof(permutations); ++i) {
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pResults->GetResult(i, IID_PPV_ARGS(&pResult)));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+  }
+  VERIFY_FAILED(pResults->GetSharedIndex(3, &sharedIndex));
+}
+
+TEST_F(CompilerTest, SpecializeWhenConstantKnownThenLoadFolded) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompiler7> pCompiler7;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCompiler7));
+  CreateBlobFromText("cbuffer C : register(b2, space1) { uint mode; float scale; }\n"
+                     "float4 main(float4 pos : SV_Position) : SV_Target {\n"
+                     "  if (mode == 1) return sin(pos) * scale;\n"
+                     "  return pos * scale;\n"
+                     "}",
+                     &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", nullptr, 0, nullptr, 0,
+                                      nullptr, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  // Only mode is known; scale is still loaded from the buffer.
+  DxcCBufferConstant constants[] = { { 1, 2, 0, 0 } };
+  DxcBuffer buffer = { pProgram->GetBufferPointer(), pProgram->GetBufferSize(), 0 };
+  CComPtr<IDxcResult> pSpecialized;
+  VERIFY_SUCCEEDED(pCompiler7->Specialize(&buffer, constants,
+                                          _countof(constants),
+                                          IID_PPV_ARGS(&pSpecialized)));
+  HRESULT status;
+  VERIFY_SUCCEEDED(pSpecialized->GetStatus(&status));
+  VERIFY_SUCCEEDED(status);
+
+  CComPtr<IDxcBlob> pSpecializedProgram;
+  VERIFY_SUCCEEDED(pSpecialized->GetOutput(DXC_OUT_OBJECT,
+                                           IID_PPV_ARGS(&pSpecializedProgram),
+                                           nullptr));
+  CComPtr<IDxcBlobEncoding> pDisassembly;
+  VERIFY_SUCCEEDED(pCompiler->Disassemble(pSpecializedProgram, &pDisassembly));
+  std::string disassembly(BlobToUtf8(pDisassembly));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, disassembly.find("@dx.op.cbufferLoadLegacy"));
+  VERIFY_ARE_EQUAL(std::string::npos, disassembly.find("@dx.op.unary.f32(i32 13"));
+
+  // A truncated program is rejected.
+  CComPtr<IDxcResult> pTruncated;
+  buffer.Size /= 2;
+  VERIFY_FAILED(pCompiler7->Specialize(&buffer, constants, _countof(constants),
+                                       IID_PPV_ARGS(&pTruncated)));
+}
+
+// Min precision values have a dword each in the constant buffer, holding the
+// 32-bit value; native 16-bit values are packed two to a dword.
+TEST_F(CompilerTest, SpecializeWhenMinPrecisionThenDwordsRead) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompiler7> pCompiler7;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCompiler7));
+  auto specialize = [&](const char *program, LPCWSTR shaderModel,
+                        std::vector<LPCWSTR> arguments,
+                        const std::vector<DxcCBufferConstant> &constants) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlob> pProgram;
+    CreateBlobFromText(program, &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        shaderModel, arguments.data(),
+                                        arguments.size(), nullptr, 0, nullptr,
+                                        &pResult));
+    CheckOperationSucceeded(pResult, &pProgram);
+
+    DxcBuffer buffer = { pProgram->GetBufferPointer(), pProgram->GetBufferSize(), 0 };
+    CComPtr<IDxcResult> pSpecialized;
+    VERIFY_SUCCEEDED(pCompiler7->Specialize(&buffer, constants.data(),
+                                            constants.size(),
+                                            IID_PPV_ARGS(&pSpecialized)));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pSpecialized->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+    CComPtr<IDxcBlob> pSpecializedProgram;
+    VERIFY_SUCCEEDED(pSpecialized->GetOutput(DXC_OUT_OBJECT,
+                                             IID_PPV_ARGS(&pSpecializedProgram),
+                                             nullptr));
+    std::string disassembly = DisassembleProgram(m_dllSupport, pSpecializedProgram);
+    VERIFY_ARE_EQUAL(std::string::npos, disassembly.find("@dx.op.cbufferLoadLegacy"));
+    return disassembly;
+  };
+
+  std::string minPrecision = specialize(
+    "cbuffer C : register(b0) { min16float h; min16int i; float f; min16float h2; };\n"
+    "float4 main() : SV_Target { return float4(h, i, f, h2); }\n",
+    L"ps_6_0", {},
+    { { 0, 0, 0, 0x3FC00000 },     // 1.5
+      { 0, 0, 4, 0xFFFFFFFD },     // -3
+      { 0, 0, 8, 0x40000000 },     // 2.0
+      { 0, 0, 12, 0x3E800000 } }); // 0.25
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, minPrecision.find("float 1.500000e+00"));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, minPrecision.find("float -3.000000e+00"));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, minPrecision.find("float 2.000000e+00"));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, minPrecision.find("float 2.500000e-01"));
+
+  std::string native = specialize(
+    "cbuffer C : register(b0) { half a; half b; };\n"
+    "float4 main() : SV_Target { return float4(a, b, 0, 0); }\n",
+    L"ps_6_2", { L"-enable-16bit-types" },
+    { { 0, 0, 0, 0x34003E00 } });  // 1.5, then 0.25
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, native.find("float 1.500000e+00"));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, native.find("float 2.500000e-01"));
+}
+
+// Constant buffers created from the descriptor heap have no register to
+// match the given values against.
+TEST_F(CompilerTest, SpecializeWhenHeapConstantBufferThenFails) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompiler7> pCompiler7;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCompiler7));
+  CreateBlobFromText("cbuffer C : register(b0) { uint mode; }\n"
+                     "float4 main(float4 pos : SV_Position) : SV_Target {\n"
+                     "  if (mode == 1) return sin(pos);\n"
+                     "  return pos;\n"
+                     "}",
+                     &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_6", nullptr, 0, nullptr, 0,
+                                      nullptr, &pResult));
+  CheckOperationSucceeded(pResult, &pProgram);
+
+  // Load the buffer through a heap handle instead of its binding.
+  std::string disassembly = DisassembleProgram(m_dllSupport, pProgram);
+  size_t pos = disassembly.find("call %dx.types.Handle @dx.op.createHandle(");
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, pos);
+  disassembly.replace(pos, disassembly.find('\n', pos) - pos,
+                      "call %dx.types.Handle @dx.op.createHandleFromHeap("
+                      "i32 216, i32 0, i1 false)");
+  disassembly += "\ndeclare %dx.types.Handle "
+                 "@dx.op.createHandleFromHeap(i32, i32, i1) #0\n";
+  CComPtr<IDxcBlobEncoding> pHeapModule;
+  CComPtr<IDxcBlob> pHeapProgram;
+  Utf8ToBlob(m_dllSupport, disassembly.c_str(), &pHeapModule);
+  AssembleToContainer(m_dllSupport, pHeapModule, &pHeapProgram);
+
+  DxcCBufferConstant constants[] = { { 0, 0, 0, 1 } };
+  DxcBuffer buffer = { pHeapProgram->GetBufferPointer(),
+                       pHeapProgram->GetBufferSize(), 0 };
+  CComPtr<IDxcResult> pSpecialized;
+  VERIFY_SUCCEEDED(pCompiler7->Specialize(&buffer, constants,
+                                          _countof(constants),
+                                          IID_PPV_ARGS(&pSpecialized)));
+  std::string errors = VerifyOperationFailed(pSpecialized);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, errors.find("descriptor heap"));
+}
+
+TEST_F(CompilerTest, CompileWhenSnapshotThenResumeWorks) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main(float4 pos : SV_Position) : SV_Target {\n"
+                     "  return sin(pos) * 2;\n"
+                     "}",
+                     &pSource);
+
+  // Each snapshot resumes into a complete program.
+  LPCWSTR snapshotArgs[] = { L"-fcgl", L"-fsnapshot-dxil" };
+  for (LPCWSTR snapshotArg : snapshotArgs) {
+    CComPtr<IDxcOperationResult> pSnapshotResult;
+    CComPtr<IDxcBlob> pSnapshot;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_0", &snapshotArg, 1, nullptr, 0,
+                                        nullptr, &pSnapshotResult));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pSnapshotResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+    VERIFY_SUCCEEDED(pSnapshotResult->GetResult(&pSnapshot));
+
+    CComPtr<IDxcBlobEncoding> pSnapshotSource;
+    CreateBlobPinned(pSnapshot->GetBufferPointer(), pSnapshot->GetBufferSize(),
+                     CP_UTF8, &pSnapshotSource);
+    CComPtr<IDxcOperationResult> pResumeResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSnapshotSource, L"source.hlsl",
+                                        L"main", L"ps_6_0", nullptr, 0,
+                                        nullptr, 0, nullptr, &pResumeResult));
+    VERIFY_SUCCEEDED(pResumeResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+
+    CComPtr<IDxcBlob> pResumed;
+    CComPtr<IDxcBlobEncoding> pResumedDisassembly;
+    VERIFY_SUCCEEDED(pResumeResult->GetResult(&pResumed));
+    VERIFY_SUCCEEDED(pCompiler->Disassemble(pResumed, &pResumedDisassembly));
+    std::string disassembly(BlobToUtf8(pResumedDisassembly));
+    VERIFY_ARE_NOT_EQUAL(std::string::npos, disassembly.find("@dx.op.unary.f32(i32 13"));
+    VERIFY_ARE_NOT_EQUAL(std::string::npos, disassembly.find("@dx.op.storeOutput"));
+  }
+}
+
 #ifdef _WIN32 // Container builder unsupported
 
 TEST_F(CompilerTest, CompileWhenDebugWorksThenStripDebug) {
@@ -1106,6 +1606,190 @@ TEST_F(CompilerTest, CompileWhenIncludeAbsoluteThenLoadAbsolute) {
 #endif
 }
 
+TEST_F(CompilerTest, CompileWhenScanDependenciesThenIncludesListed) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  // The body does not compile; a scan must only look at the directives.
+  CreateBlobFromText(
+    "#include \"helper.h\"\r\n"
+    "/* #include \"commented.h\" */\r\n"
+    "float4 main() : SV_Target { return \"#include \\\"string.h\\\"\"; }", &pSource);
+
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("float f = undeclared;\n#define ZERO 0");
+
+  LPCWSTR args[] = { L"-M", L"-Mjson" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"", args, _countof(args), nullptr, 0, pInclude, &pResult));
+  HRESULT status;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_SUCCEEDED(status);
+  VERIFY_ARE_EQUAL_WSTR(L"./helper.h;", pInclude->GetAllFileNames().c_str());
+
+  CComPtr<IDxcBlob> pDependencies;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pDependencies));
+  std::string dependencies = BlobToUtf8(pDependencies);
+  VERIFY_IS_TRUE(dependencies.find("\"target\": \"source.hlsl\"") != std::string::npos);
+  VERIFY_IS_TRUE(dependencies.find("\"./helper.h\"") != std::string::npos);
+  VERIFY_IS_TRUE(dependencies.find("commented.h") == std::string::npos);
+}
+
+TEST_F(CompilerTest, CompileWhenLibCacheIncludeThenHitsAndMisses) {
+  ::llvm::sys::fs::MSFileSystem *msfPtr;
+  VERIFY_SUCCEEDED(CreateMSFileSystemForDisk(&msfPtr));
+  std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+  ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+  IFTLLVM(pts.error_code());
+
+  CComPtr<IDxcLibrary> pLibrary;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+  CComPtr<IDxcIncludeHandler> pIncludeHandler;
+  VERIFY_SUCCEEDED(pLibrary->CreateIncludeHandler(&pIncludeHandler));
+
+  // The header and two cache directories go in fresh directories, so the
+  // process-wide cache starts empty for them.
+  llvm::SmallString<128> tempDir;
+  llvm::sys::path::system_temp_directory(true, tempDir);
+  auto makeDir = [&](llvm::SmallString<128> &dir) {
+    llvm::SmallString<128> prefix(tempDir);
+    llvm::sys::path::append(prefix, "dxc-lib-cache");
+    VERIFY_IS_FALSE(llvm::sys::fs::createUniqueDirectory(prefix, dir));
+  };
+  llvm::SmallString<128> headerDir, cacheDir, otherCacheDir;
+  makeDir(headerDir);
+  makeDir(cacheDir);
+  makeDir(otherCacheDir);
+  llvm::SmallString<128> headerPath(headerDir);
+  llvm::sys::path::append(headerPath, "lib_cache_test.h");
+  {
+    std::ofstream header(headerPath.c_str());
+    header << "float Shade(float f) {\n"
+              "#if SHADE_SIN\n"
+              "  return sin(f) * 2;\n"
+              "#else\n"
+              "  return cos(f) * 2;\n"
+              "#endif\n"
+              "}\n";
+  }
+  auto listLibraries = [](llvm::StringRef dir) {
+    std::vector<std::string> files;
+    std::error_code ec;
+    for (llvm::sys::fs::directory_iterator it(dir, ec), end; !ec && it != end;
+         it.increment(ec)) {
+      if (llvm::sys::path::extension(it->path()) == ".dxlib")
+        files.push_back(it->path());
+    }
+    return files;
+  };
+
+  const char *shader =
+    "#include \"lib_cache_test.h\"\n"
+    "[shader(\"pixel\")]\n"
+    "float main(float f : IN) : SV_Target { return Shade(f); }\n";
+  // Compiles with a new compiler object each time, as separate compiles
+  // sharing the cache would.
+  auto compile = [&](const char *program, llvm::StringRef cache, LPCWSTR shadeSin) {
+    CComPtr<IDxcCompiler> pCompiler;
+    VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+    CComPtr<IDxcBlobEncoding> pSource;
+    CreateBlobFromText(program, &pSource);
+    std::wstring includeDir = Unicode::UTF8ToUTF16StringOrThrow(headerDir.c_str());
+    std::wstring cacheDirW = Unicode::UTF8ToUTF16StringOrThrow(cache.str().c_str());
+    std::vector<LPCWSTR> args = {
+      L"-lib-cache-include", L"lib_cache_test.h", L"-lib-cache-dir",
+      cacheDirW.c_str(), L"-I", includeDir.c_str() };
+    std::vector<DxcDefine> defines;
+    if (shadeSin)
+      defines.push_back({ L"SHADE_SIN", shadeSin });
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"hlsl.hlsl", L"main",
+                                        L"ps_6_0", args.data(), args.size(),
+                                        defines.data(), defines.size(),
+                                        pIncludeHandler, &pResult));
+    return pResult;
+  };
+  auto disassemble = [&](IDxcOperationResult *pResult) {
+    CComPtr<IDxcBlob> pProgram;
+    CheckOperationSucceeded(pResult, &pProgram);
+    return DisassembleProgram(m_dllSupport, pProgram);
+  };
+  const char *sinOp = "call float @dx.op.unary.f32(i32 13";
+  const char *cosOp = "call float @dx.op.unary.f32(i32 12";
+
+  // Miss: the library is compiled and written to the directory.
+  std::string sinDisassembly = disassemble(compile(shader, cacheDir, L"1"));
+  VERIFY_IS_TRUE(sinDisassembly.find(sinOp) != std::string::npos);
+  std::vector<std::string> libraries = listLibraries(cacheDir);
+  VERIFY_ARE_EQUAL(1u, libraries.size());
+  std::string libraryName = llvm::sys::path::filename(libraries[0]);
+
+  // In-process hit: the library is not compiled or written again.
+  VERIFY_IS_FALSE(llvm::sys::fs::remove(libraries[0]));
+  VERIFY_ARE_EQUAL(sinDisassembly, disassemble(compile(shader, cacheDir, L"1")));
+  VERIFY_ARE_EQUAL(0u, listLibraries(cacheDir).size());
+
+  // Directory hit: a library another process left under the same key is
+  // linked as is. Plant one whose Shade differs to tell it apart.
+  CComPtr<IDxcBlob> pOtherLibrary;
+  {
+    CComPtr<IDxcCompiler> pCompiler;
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+    CreateBlobFromText("float Shade(float f) { return f * 42; }\n", &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"",
+                                        L"lib_6_x", nullptr, 0, nullptr, 0,
+                                        nullptr, &pResult));
+    CheckOperationSucceeded(pResult, &pOtherLibrary);
+  }
+  {
+    llvm::SmallString<128> path(otherCacheDir);
+    llvm::sys::path::append(path, libraryName);
+    std::ofstream file(path.c_str(), std::ios::binary);
+    file.write((const char *)pOtherLibrary->GetBufferPointer(),
+               pOtherLibrary->GetBufferSize());
+  }
+  std::string otherDisassembly =
+      disassemble(compile(shader, otherCacheDir, L"1"));
+  VERIFY_IS_TRUE(otherDisassembly.find(sinOp) == std::string::npos);
+  VERIFY_IS_TRUE(otherDisassembly.find("4.200000e+01") != std::string::npos);
+
+  // Macro mismatch: another value on the command line is another library.
+  std::string cosDisassembly = disassemble(compile(shader, cacheDir, L"0"));
+  VERIFY_IS_TRUE(cosDisassembly.find(cosOp) != std::string::npos);
+  VERIFY_IS_TRUE(cosDisassembly.find(sinOp) == std::string::npos);
+  libraries = listLibraries(cacheDir);
+  VERIFY_ARE_EQUAL(1u, libraries.size());
+  VERIFY_ARE_NOT_EQUAL(libraryName,
+                       llvm::sys::path::filename(libraries[0]).str());
+
+  // A macro defined in the shader ahead of the include is not in the key;
+  // the compile is rejected rather than linked with a mismatched library.
+  std::string defineFirst = std::string("#define SHADE_SIN 0\n") + shader;
+  CComPtr<IDxcOperationResult> pRejected =
+      compile(defineFirst.c_str(), cacheDir, nullptr);
+  HRESULT status;
+  VERIFY_SUCCEEDED(pRejected->GetStatus(&status));
+  VERIFY_FAILED(status);
+  CComPtr<IDxcBlobEncoding> pErrors;
+  VERIFY_SUCCEEDED(pRejected->GetErrorBuffer(&pErrors));
+  std::string errors = BlobToUtf8(pErrors);
+  VERIFY_IS_TRUE(errors.find("macro 'SHADE_SIN' is changed before "
+                             "-lib-cache-include") != std::string::npos);
+
+  for (llvm::StringRef dir : { cacheDir.str(), otherCacheDir.str() }) {
+    for (const std::string &file : listLibraries(dir))
+      llvm::sys::fs::remove(file);
+    llvm::sys::fs::remove(dir);
+  }
+  llvm::sys::fs::remove(headerPath);
+  llvm::sys::fs::remove(headerDir);
+}
+
 TEST_F(CompilerTest, CompileWhenIncludeLocalThenLoadRelative) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -1958,7 +2642,11 @@ TEST_F(CompilerTest, CodeGenRootSigProfile5) {
   CodeGenTest(L"rootSigProfile5.hlsl");
 }
 
+#ifdef _WIN32 // Container reflection unsupported
 TEST_F(CompilerTest, LibGVStore) {
+#else
+TEST_F(CompilerTest, DISABLED_LibGVStore) {
+#endif
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
   CComPtr<IDxcBlobEncoding> pSource;
@@ -2310,7 +2998,11 @@ TEST_F(CompilerTest, CodeGenHashStability) {
   CodeGenTestCheckBatchHash(L"");
 }
 
+#ifdef _WIN32 // D3D reflection unsupported
 TEST_F(CompilerTest, BatchD3DReflect) {
+#else
+TEST_F(CompilerTest, DISABLED_BatchD3DReflect) {
+#endif
   CodeGenTestCheckBatchDir(L"d3dreflect");
 }
 
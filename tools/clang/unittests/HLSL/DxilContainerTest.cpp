@@ -51,6 +51,8 @@
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/Support/HLSLOptions.h"
 #include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/DxilContainer/DxilContainerAssembler.h"
+#include "dxc/DxilContainer/DxilContainerInspector.h"
 #include "dxc/DxilContainer/DxilRuntimeReflection.h"
 #include <assert.h> // Needed for DxilPipelineStateValidation.h
 #include "dxc/DxilContainer/DxilPipelineStateValidation.h"
@@ -61,6 +63,7 @@
 #include <chrono>
 
 #include <codecvt>
+#include <locale>
 
 
 using namespace std;
@@ -101,6 +104,9 @@ public:
   TEST_METHOD(CompileWhenOkThenCheckReflection1)
   TEST_METHOD(DxcUtils_CreateReflection)
   TEST_METHOD(CompileWhenOKThenIncludesFeatureInfo)
+  TEST_METHOD(InspectContainersWhenBatchThenTablesMatch)
+  TEST_METHOD(InspectContainersWhenCorruptThenSkipped)
+  TEST_METHOD(CompressWhenRoundTripThenMatches)
   TEST_METHOD(CompileWhenOKThenIncludesSignatures)
   TEST_METHOD(CompileWhenSigSquareThenIncludeSplit)
   TEST_METHOD(DisassemblyWhenMissingThenFails)
@@ -447,6 +453,7 @@ public:
     return !(Major == 1 && Minor < 5);
   }
 
+#ifdef _WIN32 // Container reflection unsupported
   std::string CompileToDebugName(LPCSTR program, LPCWSTR entryPoint,
                                  LPCWSTR target, LPCWSTR *pArguments, UINT32 argCount) {
     CComPtr<IDxcBlob> pProgram;
@@ -505,6 +512,7 @@ public:
 
     return hashFromPart;
   }
+#endif // _WIN32 - Container reflection unsupported
 
   std::string DisassembleProgram(LPCSTR program, LPCWSTR entryPoint,
                                  LPCWSTR target) {
@@ -787,6 +795,7 @@ TEST_F(DxilContainerTest, CompileWhenSigSquareThenIncludeSplit) {
 #endif
 }
 
+#ifdef _WIN32 // Container reflection unsupported
 TEST_F(DxilContainerTest, CompileAS_CheckPSV0) {
   if (m_ver.SkipDxilVersion(1, 5)) return;
   const char asSource[] =
@@ -1547,6 +1556,7 @@ TEST_F(DxilContainerTest, DxcUtils_CreateReflection) {
     }
   }
 }
+#endif // _WIN32 - Container reflection unsupported
 
 TEST_F(DxilContainerTest, CompileWhenOKThenIncludesFeatureInfo) {
   CComPtr<IDxcCompiler> pCompiler;
@@ -1573,6 +1583,305 @@ TEST_F(DxilContainerTest, CompileWhenOKThenIncludesFeatureInfo) {
   VERIFY_ARE_EQUAL(0U, *(const uint64_t *)hlsl::GetDxilPartData(*pPartIter));
 }
 
+TEST_F(DxilContainerTest, InspectContainersWhenBatchThenTablesMatch) {
+  CComPtr<IDxcBlob> pVS, pLib;
+  CompileToProgram(
+      "Texture2D<float4> T : register(t3, space1); SamplerState S : register(s0);"
+      "float4 main(float2 uv : TEXCOORD0, float4 p : POSITION) : SV_Position {"
+      "  return T.SampleLevel(S, uv, 0) + p; }",
+      L"main", L"vs_6_0", nullptr, 0, &pVS);
+  CompileToProgram(
+      "struct Payload { float4 c; };"
+      "RaytracingAccelerationStructure AS : register(t0);"
+      "[shader(\"raygeneration\")] void RayGen() {"
+      "  Payload p = (Payload)0; RayDesc r = (RayDesc)0;"
+      "  TraceRay(AS, 0, 0xff, 0, 1, 0, r, p); }",
+      L"", L"lib_6_3", nullptr, 0, &pLib);
+
+  const char Garbage[] = "not a container";
+  std::vector<hlsl::DxilContainerView> Views;
+  for (unsigned i = 0; i < 100; ++i) {
+    Views.push_back({pVS->GetBufferPointer(), pVS->GetBufferSize()});
+    Views.push_back({pLib->GetBufferPointer(), pLib->GetBufferSize()});
+    Views.push_back({Garbage, sizeof(Garbage)});
+  }
+  hlsl::DxilContainerInspection Result;
+  hlsl::InspectDxilContainers(Views, Result);
+  VERIFY_ARE_EQUAL(Views.size(), Result.Containers.size());
+
+  for (unsigned i = 0; i < Views.size(); i += 3) {
+    const hlsl::DxilInspectedContainer &VS = Result.Containers[i];
+    VERIFY_IS_TRUE(VS.Valid);
+    VERIFY_IS_TRUE(VS.HasShaderFlags);
+    VERIFY_IS_TRUE(hlsl::DXIL::ShaderKind::Vertex == VS.ShaderKind);
+    VERIFY_ARE_EQUAL(2U, VS.ResourceCount);
+    VERIFY_ARE_EQUAL(3U, VS.SignatureElementCount);
+    VERIFY_ARE_EQUAL(0U, VS.FunctionCount);
+    bool FoundTexture = false;
+    for (unsigned r = 0; r < VS.ResourceCount; ++r) {
+      const hlsl::DxilInspectedResource &Res =
+          Result.Resources[VS.FirstResource + r];
+      VERIFY_ARE_EQUAL(i, Res.Container);
+      if (Res.Space == 1 && Res.LowerBound == 3)
+        FoundTexture = true;
+    }
+    VERIFY_IS_TRUE(FoundTexture);
+    const hlsl::DxilInspectedSignatureElement &First =
+        Result.SignatureElements[VS.FirstSignatureElement];
+    VERIFY_ARE_EQUAL(i, First.Container);
+    VERIFY_IS_TRUE(hlsl::DFCC_InputSignature == First.Signature);
+    VERIFY_ARE_EQUAL(std::string("TEXCOORD"), std::string(First.SemanticName));
+
+    const hlsl::DxilInspectedContainer &Lib = Result.Containers[i + 1];
+    VERIFY_IS_TRUE(Lib.Valid);
+    VERIFY_ARE_EQUAL(1U, Lib.FunctionCount);
+    const hlsl::DxilInspectedFunction &F = Result.Functions[Lib.FirstFunction];
+    VERIFY_ARE_EQUAL(i + 1, F.Container);
+    VERIFY_IS_TRUE(hlsl::DXIL::ShaderKind::RayGeneration == F.ShaderKind);
+    VERIFY_ARE_EQUAL(std::string("RayGen"), std::string(F.UnmangledName));
+
+    const hlsl::DxilInspectedContainer &Bad = Result.Containers[i + 2];
+    VERIFY_IS_FALSE(Bad.Valid);
+    VERIFY_ARE_EQUAL(0U, Bad.ResourceCount + Bad.SignatureElementCount +
+                             Bad.FunctionCount);
+  }
+}
+
+namespace {
+std::vector<char> BlobToBytes(IDxcBlob *pBlob) {
+  const char *pStart = (const char *)pBlob->GetBufferPointer();
+  return std::vector<char>(pStart, pStart + pBlob->GetBufferSize());
+}
+
+char *GetPartData(std::vector<char> &container, hlsl::DxilFourCC fourCC,
+                  uint32_t &size) {
+  const hlsl::DxilPartHeader *pPart = hlsl::GetDxilPartByType(
+      (const hlsl::DxilContainerHeader *)container.data(), fourCC);
+  VERIFY_IS_NOT_NULL(pPart);
+  size = pPart->PartSize;
+  return const_cast<char *>(hlsl::GetDxilPartData(pPart));
+}
+
+// Returns the header of a part of the runtime data in a container.
+hlsl::RDAT::RuntimeDataPartHeader *
+GetRDATPart(std::vector<char> &container,
+            hlsl::RDAT::RuntimeDataPartType type) {
+  uint32_t size;
+  char *pData = GetPartData(container, hlsl::DFCC_RuntimeData, size);
+  const hlsl::RDAT::RuntimeDataHeader *pRDAT =
+      (const hlsl::RDAT::RuntimeDataHeader *)pData;
+  const uint32_t *pOffsets = (const uint32_t *)(pRDAT + 1);
+  for (uint32_t i = 0; i < pRDAT->PartCount; ++i) {
+    hlsl::RDAT::RuntimeDataPartHeader *pPart =
+        (hlsl::RDAT::RuntimeDataPartHeader *)(pData + pOffsets[i]);
+    if (pPart->Type == type)
+      return pPart;
+  }
+  VERIFY_FAIL();
+  return nullptr;
+}
+} // namespace
+
+TEST_F(DxilContainerTest, InspectContainersWhenCorruptThenSkipped) {
+  CComPtr<IDxcBlob> pPS, pLib;
+  CompileToProgram(
+      "Texture2D<float4> T : register(t3, space1);\n"
+      "SamplerState S : register(s0);\n"
+      "float4 main(float2 uv : TEXCOORD0) : SV_Target {\n"
+      "  return T.Sample(S, uv);\n"
+      "}\n",
+      L"main", L"ps_6_0", nullptr, 0, &pPS);
+  CompileToProgram(
+      "struct Payload { float4 c; };\n"
+      "RaytracingAccelerationStructure AS : register(t0);\n"
+      "[shader(\"raygeneration\")] void RayGen() {\n"
+      "  Payload p = (Payload)0; RayDesc r = (RayDesc)0;\n"
+      "  TraceRay(AS, 0, 0xff, 0, 1, 0, r, p);\n"
+      "}\n",
+      L"", L"lib_6_3", nullptr, 0, &pLib);
+  const std::vector<char> ps = BlobToBytes(pPS);
+  const std::vector<char> lib = BlobToBytes(pLib);
+  uint32_t size;
+
+  // Cut off in the middle of its parts.
+  std::vector<char> truncated(ps.begin(), ps.begin() + ps.size() / 2);
+
+  std::vector<char> badPSV(ps);
+  char *pData = GetPartData(badPSV, hlsl::DFCC_PipelineStateValidation, size);
+  memset(pData, 0xFF, size);
+
+  std::vector<char> badSignature(ps);
+  pData = GetPartData(badSignature, hlsl::DFCC_InputSignature, size);
+  ((hlsl::DxilProgramSignature *)pData)->ParamCount = 0xFFFFFFFF;
+
+  std::vector<char> badRDAT(lib);
+  pData = GetPartData(badRDAT, hlsl::DFCC_RuntimeData, size);
+  memset(pData, 0xFF, size);
+
+  // Shrink the string buffer of the runtime data so that the function names
+  // point past it.
+  std::vector<char> badStrings(lib);
+  GetRDATPart(badStrings, hlsl::RDAT::RuntimeDataPartType::StringBuffer)
+      ->Size = 4;
+
+  // Make every index row claim more elements than the index table holds.
+  std::vector<char> badIndex(lib);
+  hlsl::RDAT::RuntimeDataPartHeader *pIndex =
+      GetRDATPart(badIndex, hlsl::RDAT::RuntimeDataPartType::IndexArrays);
+  memset(pIndex + 1, 0xFF, pIndex->Size);
+
+  // A record count and stride whose 32-bit product wraps around to a size
+  // that fits in the part.
+  std::vector<char> badStride(lib);
+  hlsl::RDAT::RuntimeDataPartHeader *pFunctions =
+      GetRDATPart(badStride, hlsl::RDAT::RuntimeDataPartType::FunctionTable);
+  hlsl::RDAT::RuntimeDataTableHeader *pTable =
+      (hlsl::RDAT::RuntimeDataTableHeader *)(pFunctions + 1);
+  pTable->RecordCount = 0x80000001;
+  pTable->RecordStride = 0x20;
+
+  // Enough copies for the batch to be split over several tasks.
+  const std::vector<char> *batch[] = {&ps,        &truncated, &badPSV,
+                                      &badSignature, &lib,    &badRDAT,
+                                      &badStrings, &badIndex, &badStride};
+  const unsigned kinds = _countof(batch);
+  std::vector<hlsl::DxilContainerView> views;
+  for (unsigned i = 0; i < 40; ++i) {
+    for (const std::vector<char> *pBytes : batch)
+      views.push_back({pBytes->data(), pBytes->size()});
+  }
+  views.push_back({nullptr, 0});
+
+  hlsl::DxilContainerInspection result;
+  hlsl::InspectDxilContainers(views, result);
+  VERIFY_ARE_EQUAL(views.size(), result.Containers.size());
+
+  const hlsl::DxilInspectedContainer &PS = result.Containers[0];
+  VERIFY_IS_TRUE(PS.Valid);
+  VERIFY_IS_TRUE(hlsl::DXIL::ShaderKind::Pixel == PS.ShaderKind);
+  VERIFY_ARE_EQUAL(2U, PS.ResourceCount);
+  VERIFY_ARE_EQUAL(2U, PS.SignatureElementCount);
+
+  for (unsigned i = 0; i + 1 < views.size(); i += kinds) {
+    const hlsl::DxilInspectedContainer *C = &result.Containers[i];
+    VERIFY_ARE_EQUAL(PS.ResourceCount, C[0].ResourceCount);
+    VERIFY_ARE_EQUAL(i, result.Resources[C[0].FirstResource].Container);
+
+    VERIFY_IS_FALSE(C[1].Valid);
+    VERIFY_ARE_EQUAL(0U, C[1].ResourceCount + C[1].SignatureElementCount +
+                             C[1].FunctionCount);
+
+    // A malformed part only loses its own rows.
+    VERIFY_IS_TRUE(C[2].Valid);
+    VERIFY_IS_TRUE(hlsl::DXIL::ShaderKind::Invalid == C[2].ShaderKind);
+    VERIFY_ARE_EQUAL(0U, C[2].ResourceCount);
+    VERIFY_ARE_EQUAL(PS.SignatureElementCount, C[2].SignatureElementCount);
+    VERIFY_IS_TRUE(C[2].HasShaderFlags);
+
+    VERIFY_IS_TRUE(C[3].Valid);
+    VERIFY_IS_TRUE(hlsl::DXIL::ShaderKind::Pixel == C[3].ShaderKind);
+    VERIFY_ARE_EQUAL(PS.ResourceCount, C[3].ResourceCount);
+    VERIFY_ARE_EQUAL(1U, C[3].SignatureElementCount);
+    VERIFY_IS_TRUE(hlsl::DFCC_OutputSignature ==
+                   result.SignatureElements[C[3].FirstSignatureElement]
+                       .Signature);
+
+    VERIFY_IS_TRUE(C[4].Valid);
+    VERIFY_ARE_EQUAL(1U, C[4].FunctionCount);
+    const hlsl::DxilInspectedFunction &F = result.Functions[C[4].FirstFunction];
+    VERIFY_ARE_EQUAL(i + 4, F.Container);
+    VERIFY_ARE_EQUAL(std::string("RayGen"), std::string(F.UnmangledName));
+    VERIFY_ARE_EQUAL(1U, F.ResourceCount);
+
+    VERIFY_IS_TRUE(C[5].Valid);
+    VERIFY_ARE_EQUAL(0U, C[5].FunctionCount);
+
+    // Names outside of the string buffer read as empty.
+    VERIFY_IS_TRUE(C[6].Valid);
+    VERIFY_ARE_EQUAL(1U, C[6].FunctionCount);
+    const hlsl::DxilInspectedFunction &G = result.Functions[C[6].FirstFunction];
+    VERIFY_ARE_EQUAL(i + 6, G.Container);
+    VERIFY_IS_TRUE(hlsl::DXIL::ShaderKind::RayGeneration == G.ShaderKind);
+    VERIFY_ARE_EQUAL(std::string(), std::string(G.Name));
+    VERIFY_ARE_EQUAL(std::string(), std::string(G.UnmangledName));
+
+    // Index rows that run past the index table read as empty.
+    VERIFY_IS_TRUE(C[7].Valid);
+    VERIFY_ARE_EQUAL(1U, C[7].FunctionCount);
+    const hlsl::DxilInspectedFunction &H =
+        result.Functions[C[7].FirstFunction];
+    VERIFY_ARE_EQUAL(std::string("RayGen"), std::string(H.UnmangledName));
+    VERIFY_ARE_EQUAL(0U, H.ResourceCount);
+
+    // A table larger than its part rejects the runtime data.
+    VERIFY_IS_TRUE(C[8].Valid);
+    VERIFY_ARE_EQUAL(0U, C[8].FunctionCount);
+  }
+  VERIFY_IS_FALSE(result.Containers.back().Valid);
+}
+
+TEST_F(DxilContainerTest, CompressWhenRoundTripThenMatches) {
+  LPCWSTR args[] = {L"/Zi", L"/Qembed_debug"};
+  CComPtr<IDxcBlob> pProgram;
+  CompileToProgram(
+      "float4 main(float4 a : A) : SV_Target {\n"
+      "  return a * a + 1;\n"
+      "}\n",
+      L"main", L"ps_6_0", args, _countof(args), &pProgram);
+
+  CComPtr<IDxcContainerBuilder> pBuilder;
+  CComPtr<IDxcContainerBuilder2> pBuilder2;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcContainerBuilder, &pBuilder));
+  VERIFY_SUCCEEDED(pBuilder.QueryInterface(&pBuilder2));
+  VERIFY_SUCCEEDED(pBuilder2->Load(pProgram));
+  VERIFY_SUCCEEDED(pBuilder2->SetPartCompression(256));
+  CComPtr<IDxcOperationResult> pResult;
+  VERIFY_SUCCEEDED(pBuilder2->SerializeContainer(&pResult));
+  CComPtr<IDxcBlob> pCompressed;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pCompressed));
+
+  const hlsl::DxilContainerHeader *pHeader = hlsl::IsDxilContainerLike(
+      pCompressed->GetBufferPointer(), pCompressed->GetBufferSize());
+  VERIFY_IS_TRUE(hlsl::IsValidDxilContainer(pHeader, pCompressed->GetBufferSize()));
+  if (!hlsl::IsCompressedDxilContainer(pHeader)) {
+    // The codec is not available in this build; the container is unchanged.
+    VERIFY_ARE_EQUAL(pProgram->GetBufferSize(), pCompressed->GetBufferSize());
+    return;
+  }
+  VERIFY_IS_TRUE(pCompressed->GetBufferSize() < pProgram->GetBufferSize());
+  VERIFY_IS_NULL(hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_ShaderDebugInfoDXIL));
+
+  // Expanding restores the original container, including its hash.
+  std::vector<char> expanded;
+  VERIFY_IS_TRUE(hlsl::DecompressDxilContainer(pHeader, expanded));
+  VERIFY_ARE_EQUAL(pProgram->GetBufferSize(), expanded.size());
+  VERIFY_IS_TRUE(0 == memcmp(pProgram->GetBufferPointer(), expanded.data(),
+                             expanded.size()));
+
+  // Compressing the expanded copy directly gives the same bytes back.
+  std::vector<char> recompressed;
+  VERIFY_IS_TRUE(hlsl::CompressDxilContainer(
+      (const hlsl::DxilContainerHeader *)expanded.data(), 256, recompressed));
+  VERIFY_ARE_EQUAL(pCompressed->GetBufferSize(), recompressed.size());
+  VERIFY_IS_TRUE(0 == memcmp(pCompressed->GetBufferPointer(),
+                             recompressed.data(), recompressed.size()));
+
+  // The builder expands compressed containers on load.
+  pBuilder.Release();
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcContainerBuilder, &pBuilder));
+  VERIFY_SUCCEEDED(pBuilder->Load(pCompressed));
+  VERIFY_SUCCEEDED(pBuilder->RemovePart(hlsl::DFCC_ShaderDebugInfoDXIL));
+  pResult.Release();
+  VERIFY_SUCCEEDED(pBuilder->SerializeContainer(&pResult));
+  CComPtr<IDxcBlob> pStripped;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pStripped));
+  pHeader = hlsl::IsDxilContainerLike(pStripped->GetBufferPointer(),
+                                pStripped->GetBufferSize());
+  VERIFY_IS_TRUE(hlsl::IsValidDxilContainer(pHeader, pStripped->GetBufferSize()));
+  VERIFY_IS_FALSE(hlsl::IsCompressedDxilContainer(pHeader));
+  VERIFY_IS_NOT_NULL(hlsl::GetDxilProgramHeader(pHeader, hlsl::DFCC_DXIL));
+}
+
 TEST_F(DxilContainerTest, DisassemblyWhenBCInvalidThenFails) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcBlobEncoding> pSource;
@@ -18,13 +18,20 @@
 #include "dxc/DXIL/DxilInstructions.h"
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilSubobject.h"
+#include "dxc/DXIL/DxilTypeSystem.h"
+#include "dxc/DXIL/DxilMetadataHelper.h"
+#include "dxc/HLSL/HLModule.h"
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/MSFileSystem.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
 #include "llvm/IR/InstIterator.h"
 
 using namespace hlsl;
@@ -68,6 +75,13 @@ public:
 
   TEST_METHOD(SetValidatorVersion)
 
+  TEST_METHOD(FunctionSummaryMatchesShaderFlags)
+
+  TEST_METHOD(HLOpFunctionRegistryForgetsReplacedErased)
+
+  TEST_METHOD(LazyMetadataLoadsOnAccess)
+  TEST_METHOD(LazyStructAnnotationsDecodeOnUse)
+
   void VerifyValidatorVersionFails(
     LPCWSTR shaderModel, const std::vector<LPCWSTR> &arguments,
     const std::vector<LPCSTR> &expectedErrors);
@@ -578,3 +592,343 @@ TEST_F(DxilModuleTest, SetValidatorVersion) {
   VerifyValidatorVersionFails(L"lib_6_x", {L"-validator-version", L"1.3"}, {
     "Offline library profile cannot be used with non-zero -validator-version."});
 }
+
+TEST_F(DxilModuleTest, FunctionSummaryMatchesShaderFlags) {
+  Compiler c(m_dllSupport);
+  c.Compile(
+    "Texture2D<float4> tex : register(t0);\n"
+    "SamplerState samp : register(s0);\n"
+    "cbuffer C : register(b0) { double d; };\n"
+    "float4 main(float2 uv : TEXCOORD) : SV_Target {\n"
+    "  float4 v = tex.Sample(samp, uv);\n"
+    "  return v + WaveActiveSum((float)(d / 3.0));\n"
+    "}\n"
+    ,
+    L"ps_6_0"
+  );
+
+  DxilModule &DM = c.GetDxilModule();
+  const llvm::Function *F = DM.GetEntryFunction();
+  const DxilFunctionSummary &S = DM.GetFunctionSummary(F);
+  VERIFY_IS_TRUE(S.UsesOp(DXIL::OpCode::Sample));
+  VERIFY_IS_TRUE(S.UsesDerivatives());
+  VERIFY_IS_TRUE(S.HasWaveOps);
+  VERIFY_IS_TRUE(S.HasDouble);
+  VERIFY_IS_TRUE(S.HasDoubleExtension);
+  VERIFY_IS_FALSE(S.UsesOp(DXIL::OpCode::Msad));
+
+  // Repeated queries reuse the cached summary.
+  VERIFY_ARE_EQUAL(&S, &DM.GetFunctionSummary(F));
+
+  // Flags built from the summary agree with the flags in the container.
+  ShaderFlags calcFlags;
+  DM.CollectShaderFlagsForModule(calcFlags);
+  const uint64_t mask = ShaderFlags::GetShaderFlagsRawForCollection();
+  VERIFY_ARE_EQUAL(DM.m_ShaderFlags.GetShaderFlagsRaw() & mask,
+                   calcFlags.GetShaderFlagsRaw() & mask);
+  VERIFY_IS_TRUE(calcFlags.GetWaveOps());
+  VERIFY_IS_TRUE(calcFlags.GetEnableDoubleExtensions());
+}
+
+TEST_F(DxilModuleTest, HLOpFunctionRegistryForgetsReplacedErased) {
+  LLVMContext ctx;
+  Module M("registry", ctx);
+  HLOpFunctionRegistry &registry =
+      M.GetOrCreateHLModule(/*skipInit*/ true).GetHLOpFunctionRegistry();
+  Type *f32 = Type::getFloatTy(ctx);
+  FunctionType *FT = FunctionType::get(f32, {Type::getInt32Ty(ctx), f32}, false);
+  const unsigned opcode = (unsigned)IntrinsicOp::IOP_abs;
+  auto getFn = [&]() {
+    return GetOrCreateHLFunction(M, FT, HLOpcodeGroup::HLIntrinsic, opcode);
+  };
+
+  // Interned: the second request returns the same function.
+  Function *F = getFn();
+  std::string name = F->getName();
+  VERIFY_ARE_EQUAL(F, getFn());
+  VERIFY_ARE_EQUAL(HLOpcodeGroup::HLIntrinsic, GetHLOpcodeGroupByName(F));
+  VERIFY_ARE_EQUAL(1u, registry.GetNumEntries());
+
+  // Replace: the entry goes away instead of following the replacement,
+  // including when the replacement is not a function.
+  Function *G = Function::Create(FT, GlobalValue::ExternalLinkage, "other", &M);
+  F->replaceAllUsesWith(ConstantExpr::getBitCast(G, F->getType()));
+  VERIFY_ARE_EQUAL(0u, registry.GetNumEntries());
+  F->eraseFromParent();
+  F = getFn();
+  VERIFY_ARE_NOT_EQUAL(F, G);
+  VERIFY_ARE_EQUAL(name, F->getName().str());
+  F->replaceAllUsesWith(G);
+  VERIFY_ARE_EQUAL(0u, registry.GetNumEntries());
+  VERIFY_IS_TRUE(F->use_empty());
+  F->eraseFromParent();
+
+  // Erase: a new function is created under the same name.
+  F = getFn();
+  VERIFY_ARE_EQUAL(name, F->getName().str());
+  F->eraseFromParent();
+  VERIFY_ARE_EQUAL(0u, registry.GetNumEntries());
+  F = getFn();
+  VERIFY_ARE_EQUAL(name, F->getName().str());
+  VERIFY_ARE_EQUAL(HLOpcodeGroup::HLIntrinsic, GetHLOpcodeGroupByName(F));
+
+  // Rename: entries are keyed on the function, so it keeps its entry.
+  F->setName("renamed");
+  VERIFY_ARE_EQUAL(HLOpcodeGroup::HLIntrinsic, GetHLOpcodeGroupByName(F));
+  VERIFY_ARE_EQUAL(F, getFn());
+  VERIFY_ARE_EQUAL(1u, registry.GetNumEntries());
+  F->eraseFromParent();
+  VERIFY_ARE_EQUAL(0u, registry.GetNumEntries());
+}
+
+namespace {
+typedef DxilModule::LazyMetadata LazyMetadata;
+
+// Renders the category through its accessor, which loads it.
+std::string DescribeMetadata(DxilModule &DM, LazyMetadata Kind) {
+  std::string desc;
+  raw_string_ostream OS(desc);
+  switch (Kind) {
+  case LazyMetadata::TypeSystem: {
+    DxilTypeSystem &TS = DM.GetTypeSystem();
+    TS.MaterializeStructAnnotations();
+    OS << "structs " << TS.GetStructAnnotationMap().size() << " functions "
+       << TS.GetFunctionAnnotationMap().size();
+  } break;
+  case LazyMetadata::RootSignature:
+    for (uint8_t b : DM.GetSerializedRootSignature())
+      OS << (unsigned)b << " ";
+    break;
+  case LazyMetadata::ViewIdState:
+    for (unsigned u : DM.GetSerializedViewIdState())
+      OS << u << " ";
+    break;
+  case LazyMetadata::Subobjects:
+    if (const DxilSubobjects *pSubobjects = DM.GetSubobjects()) {
+      for (auto &it : pSubobjects->GetSubobjects())
+        OS << it.first << ":" << (unsigned)it.second->GetKind() << " ";
+    }
+    break;
+  }
+  return OS.str();
+}
+
+// Writes the module as bitcode and parses it back; the new module's
+// DxilModule loads the lazy categories on first access.
+std::unique_ptr<Module> ReloadModule(Module &M) {
+  std::string bitcode;
+  {
+    raw_string_ostream OS(bitcode);
+    WriteBitcodeToFile(&M, OS);
+  }
+  std::unique_ptr<MemoryBuffer> pBuffer =
+      MemoryBuffer::getMemBuffer(bitcode, "", false);
+  ErrorOr<std::unique_ptr<Module>> pModule =
+      parseBitcodeFile(pBuffer->getMemBufferRef(), M.getContext());
+  VERIFY_IS_FALSE((bool)pModule.getError());
+  VERIFY_IS_NOT_NULL(DxilModule::TryGetDxilModule(pModule.get().get()));
+  return std::move(pModule.get());
+}
+
+// Checks each category in Kinds, whose expected renderings are in Expected,
+// through lazy load, access, a write after access and a write without
+// access.
+void VerifyLazyMetadata(Module &M, ArrayRef<LazyMetadata> Kinds,
+                        ArrayRef<std::string> Expected) {
+  for (unsigned i = 0; i < Kinds.size(); ++i) {
+    // Lazy load: nothing is decoded until asked for.
+    std::unique_ptr<Module> pLoaded = ReloadModule(M);
+    DxilModule &DM = pLoaded->GetDxilModule();
+    for (LazyMetadata Kind : Kinds) {
+      VERIFY_IS_TRUE(DM.IsMetadataPending(Kind));
+      VERIFY_IS_FALSE(DM.IsMetadataAccessed(Kind));
+    }
+
+    // Access: only the requested category is decoded, through the const
+    // accessor as well.
+    const DxilModule &ConstDM = DM;
+    if (Kinds[i] == LazyMetadata::RootSignature)
+      ConstDM.GetSerializedRootSignature();
+    else if (Kinds[i] == LazyMetadata::ViewIdState)
+      ConstDM.GetSerializedViewIdState();
+    else if (Kinds[i] == LazyMetadata::Subobjects)
+      ConstDM.GetSubobjects();
+    else
+      DM.GetTypeSystem();
+    for (LazyMetadata Kind : Kinds) {
+      VERIFY_ARE_EQUAL(Kind != Kinds[i], DM.IsMetadataPending(Kind));
+      VERIFY_ARE_EQUAL(Kind == Kinds[i], DM.IsMetadataAccessed(Kind));
+    }
+    VERIFY_ARE_EQUAL(Expected[i], DescribeMetadata(DM, Kinds[i]));
+
+    // Round trip after access: the re-emitted metadata reads back the same.
+    DM.ReEmitDxilResources();
+    std::unique_ptr<Module> pWritten = ReloadModule(*pLoaded);
+    VERIFY_ARE_EQUAL(Expected[i],
+                     DescribeMetadata(pWritten->GetDxilModule(), Kinds[i]));
+  }
+
+  // Write without access: re-emitting loads the pending categories first,
+  // and writing the module as is keeps their metadata.
+  std::unique_ptr<Module> pLoaded = ReloadModule(M);
+  std::unique_ptr<Module> pCopied = ReloadModule(*pLoaded);
+  pLoaded->GetDxilModule().ReEmitDxilResources();
+  std::unique_ptr<Module> pReEmitted = ReloadModule(*pLoaded);
+  for (unsigned i = 0; i < Kinds.size(); ++i) {
+    VERIFY_ARE_EQUAL(Expected[i],
+                     DescribeMetadata(pCopied->GetDxilModule(), Kinds[i]));
+    VERIFY_ARE_EQUAL(Expected[i],
+                     DescribeMetadata(pReEmitted->GetDxilModule(), Kinds[i]));
+  }
+}
+} // namespace
+
+TEST_F(DxilModuleTest, LazyMetadataLoadsOnAccess) {
+  const std::vector<uint8_t> rootSignature = {1, 2, 3, 4, 5, 6, 7, 8};
+
+  // Type system, root signature and ViewID state of a shader.
+  {
+    Compiler c(m_dllSupport);
+    c.Compile(
+      "struct S { float4 f; };\n"
+      "cbuffer CB { S s; };\n"
+      "float4 main(float4 a : A, float4 b : B) : SV_Target {\n"
+      "  return a * s.f + b.x;\n"
+      "}\n",
+      L"ps_6_0");
+    DxilModule &DM = c.GetDxilModule();
+    // Root signatures are stripped from the DXIL part; add one back.
+    std::vector<uint8_t> value(rootSignature);
+    DM.ResetSerializedRootSignature(value);
+    DM.ReEmitDxilResources();
+
+    const LazyMetadata kinds[] = {LazyMetadata::TypeSystem,
+                                  LazyMetadata::RootSignature,
+                                  LazyMetadata::ViewIdState};
+    std::vector<std::string> expected;
+    for (LazyMetadata Kind : kinds) {
+      expected.push_back(DescribeMetadata(DM, Kind));
+      VERIFY_IS_FALSE(expected.back().empty());
+    }
+    VerifyLazyMetadata(*c.m_module, kinds, expected);
+  }
+
+  // Type system and subobjects of a library.
+  {
+    Compiler c(m_dllSupport);
+    c.Compile(
+      "struct S { float4 f; };\n"
+      "export float4 Foo(S s) { return s.f; }\n",
+      L"lib_6_3");
+    DxilModule &DM = c.GetDxilModule();
+    // Subobjects are stripped from the DXIL part; add one back.
+    std::unique_ptr<DxilSubobjects> pSubobjects(new DxilSubobjects());
+    pSubobjects->CreateStateObjectConfig("config", 1);
+    DM.ResetSubobjects(pSubobjects.release());
+    DM.ReEmitDxilResources();
+
+    const LazyMetadata kinds[] = {LazyMetadata::TypeSystem,
+                                  LazyMetadata::Subobjects};
+    std::vector<std::string> expected;
+    for (LazyMetadata Kind : kinds) {
+      expected.push_back(DescribeMetadata(DM, Kind));
+      VERIFY_IS_FALSE(expected.back().empty());
+    }
+    VerifyLazyMetadata(*c.m_module, kinds, expected);
+  }
+}
+
+namespace {
+// Replaces the field annotation in the struct annotation of StructName with
+// something that is not a tuple, so that the annotation fails to decode.
+void CorruptStructAnnotation(Module &M, StringRef StructName) {
+  StructType *pStructType = M.getTypeByName(StructName);
+  VERIFY_IS_NOT_NULL(pStructType);
+  NamedMDNode *pTypes =
+      M.getNamedMetadata(DxilMDHelper::kDxilTypeSystemMDName);
+  VERIFY_IS_NOT_NULL(pTypes);
+  for (MDNode *pNode : pTypes->operands()) {
+    if (mdconst::extract<ConstantInt>(pNode->getOperand(0))->getZExtValue() !=
+        DxilMDHelper::kDxilTypeSystemStructTag)
+      continue;
+    for (unsigned i = 1; i + 1 < pNode->getNumOperands(); i += 2) {
+      if (mdconst::extract<Constant>(pNode->getOperand(i))->getType() !=
+          pStructType)
+        continue;
+      MDNode *pAnnotation = cast<MDNode>(pNode->getOperand(i + 1));
+      Metadata *Ops[] = {pAnnotation->getOperand(0),
+                         MDString::get(M.getContext(), "field")};
+      pNode->replaceOperandWith(i + 1, MDNode::get(M.getContext(), Ops));
+      return;
+    }
+  }
+  VERIFY_FAIL();
+}
+} // namespace
+
+TEST_F(DxilModuleTest, LazyStructAnnotationsDecodeOnUse) {
+  Compiler c(m_dllSupport);
+  c.Compile(
+    "struct S { float4 f; float4 g; };\n"
+    "struct T { float h; };\n"
+    "export float4 Foo(S s, T t) { return s.f * s.g * t.h; }\n",
+    L"lib_6_3");
+  c.GetDxilModule();
+
+  // Each annotation is decoded on its first use, through the const accessor
+  // as well.
+  {
+    std::unique_ptr<Module> pLoaded = ReloadModule(*c.m_module);
+    StructType *pS = pLoaded->getTypeByName("struct.S");
+    StructType *pT = pLoaded->getTypeByName("struct.T");
+    VERIFY_IS_NOT_NULL(pS);
+    VERIFY_IS_NOT_NULL(pT);
+    const DxilTypeSystem &TS = pLoaded->GetDxilModule().GetTypeSystem();
+    VERIFY_IS_TRUE(TS.IsStructAnnotationPending(pS));
+    VERIFY_IS_TRUE(TS.IsStructAnnotationPending(pT));
+
+    const DxilStructAnnotation *pSA = TS.GetStructAnnotation(pS);
+    VERIFY_IS_NOT_NULL(pSA);
+    VERIFY_ARE_EQUAL(2u, pSA->GetNumFields());
+    VERIFY_ARE_EQUAL(std::string("g"),
+                     pSA->GetFieldAnnotation(1).GetFieldName());
+    VERIFY_IS_FALSE(TS.IsStructAnnotationPending(pS));
+    VERIFY_IS_TRUE(TS.IsStructAnnotationPending(pT));
+    VERIFY_ARE_EQUAL(pSA, TS.GetStructAnnotation(pS));
+  }
+
+  // Walking the map decodes everything still pending first.
+  {
+    std::unique_ptr<Module> pLoaded = ReloadModule(*c.m_module);
+    DxilTypeSystem &TS = pLoaded->GetDxilModule().GetTypeSystem();
+    StructType *pT = pLoaded->getTypeByName("struct.T");
+    VERIFY_IS_TRUE(TS.IsStructAnnotationPending(pT));
+    unsigned count = 0;
+    for (auto &it : TS.GetStructAnnotationMap()) {
+      VERIFY_IS_NOT_NULL(it.second.get());
+      VERIFY_IS_FALSE(TS.IsStructAnnotationPending(it.first));
+      VERIFY_ARE_EQUAL(it.first->getNumElements(),
+                       it.second->GetNumFields());
+      ++count;
+    }
+    VERIFY_IS_GREATER_THAN(count, 1u);
+    VERIFY_IS_FALSE(TS.HasStructAnnotationLoadErrors());
+  }
+
+  // Malformed metadata still loads; the annotation is dropped when it fails
+  // to decode, and the module then reports metadata errors.
+  {
+    CorruptStructAnnotation(*c.m_module, "struct.T");
+    std::unique_ptr<Module> pLoaded = ReloadModule(*c.m_module);
+    DxilModule &DM = pLoaded->GetDxilModule();
+    StructType *pS = pLoaded->getTypeByName("struct.S");
+    StructType *pT = pLoaded->getTypeByName("struct.T");
+    const DxilTypeSystem &TS = DM.GetTypeSystem();
+    VERIFY_IS_TRUE(TS.IsStructAnnotationPending(pT));
+    VERIFY_IS_NULL(TS.GetStructAnnotation(pT));
+    VERIFY_IS_FALSE(TS.IsStructAnnotationPending(pT));
+    VERIFY_IS_TRUE(TS.HasStructAnnotationLoadErrors());
+    VERIFY_IS_NOT_NULL(TS.GetStructAnnotation(pS));
+    VERIFY_IS_TRUE(DM.HasMetadataErrors());
+  }
+}
@@ -18,17 +18,32 @@
 
 #include <fstream>
 
+#ifdef _WIN32
 #include "WexTestClass.h"
+#endif
 #include "dxc/Test/HlslTestUtils.h"
 #include "dxc/Test/DxcTestUtils.h"
 #include "dxc/dxcapi.h"
+#include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/HLSL/DxilPipelineLink.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 using namespace std;
 using namespace hlsl;
 using namespace llvm;
 
 // The test fixture.
+#ifdef _WIN32
 class LinkerTest
+#else
+class LinkerTest : public ::testing::Test
+#endif
 {
 public:
   BEGIN_TEST_CLASS(LinkerTest)
@@ -65,6 +80,10 @@ public:
   TEST_METHOD(RunLinkWithValidatorVersion);
   TEST_METHOD(RunLinkWithTempReg);
   TEST_METHOD(RunLinkToLibWithGlobalCtor);
+  TEST_METHOD(RunLinkWithFunctionIndex);
+  TEST_METHOD(RunLinkWithFunctionIndexChecked);
+  TEST_METHOD(RunLinkPipelineRemovesUnreadOutputs);
+  TEST_METHOD(RunCompilePipelineRemovesUnreadOutputs);
 
 
   dxc::DxcDllSupport m_dllSupport;
@@ -155,6 +174,46 @@ public:
     CheckOperationResultMsgs(pResult, pErrorMsgs.data(), pErrorMsgs.size(),
                              false, false);
   }
+
+  void CompileProgram(LPCSTR program, LPCWSTR pShaderTarget,
+                      IDxcBlob **pResultBlob,
+                      llvm::ArrayRef<LPCWSTR> pArguments = {}) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    Utf8ToBlob(m_dllSupport, program, &pSource);
+
+    CComPtr<IDxcCompiler> pCompiler;
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(
+        m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"hlsl.hlsl", L"main",
+                                        pShaderTarget,
+                                        const_cast<LPCWSTR *>(pArguments.data()),
+                                        pArguments.size(), nullptr, 0,
+                                        nullptr, &pResult));
+    CheckOperationSucceeded(pResult, pResultBlob);
+  }
+
+  // Parses the module in the DXIL part of a compiled program.
+  std::unique_ptr<Module> CompileToModule(LPCSTR program,
+                                          LPCWSTR pShaderTarget,
+                                          LLVMContext &Context) {
+    CComPtr<IDxcBlob> pProgram;
+    CompileProgram(program, pShaderTarget, &pProgram);
+    const DxilContainerHeader *pContainer = IsDxilContainerLike(
+        pProgram->GetBufferPointer(), pProgram->GetBufferSize());
+    VERIFY_IS_NOT_NULL(pContainer);
+    const char *pIL;
+    uint32_t ILLength;
+    GetDxilProgramBitcode(GetDxilProgramHeader(pContainer, DFCC_DXIL), &pIL,
+                          &ILLength);
+    std::unique_ptr<MemoryBuffer> pBitcode =
+        MemoryBuffer::getMemBuffer(StringRef(pIL, ILLength), "", false);
+    ErrorOr<std::unique_ptr<Module>> pModule =
+        parseBitcodeFile(pBitcode->getMemBufferRef(), Context);
+    VERIFY_IS_FALSE((bool)pModule.getError());
+    VERIFY_IS_NOT_NULL(DxilModule::TryGetDxilModule(pModule.get().get()));
+    return std::move(pModule.get());
+  }
 };
 
 bool LinkerTest::InitSupport() {
@@ -182,7 +241,11 @@ TEST_F(LinkerTest, RunLinkResource) {
   Link(L"entry", L"cs_6_0", pLinker, {libResName, libName}, {} ,{});
 }
 
+#ifdef _WIN32 // Container reflection unsupported
 TEST_F(LinkerTest, RunLinkResourceWithBinding) {
+#else
+TEST_F(LinkerTest, DISABLED_RunLinkResourceWithBinding) {
+#endif
   // These two libraries both have a ConstantBuffer resource named g_buf.
   // These are explicitly bound to different slots, and the types don't match.
   // This test runs a pass to rename resources to prevent merging of resource globals.
@@ -789,3 +852,315 @@ TEST_F(LinkerTest, RunLinkToLibWithGlobalCtor) {
        {},
        {});
 }
+
+TEST_F(LinkerTest, RunLinkWithFunctionIndex) {
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+
+  LPCWSTR libName = L"entry";
+  LPCWSTR option[] = { L"-Qfunction_index" };
+
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_entries2.hlsl", &pEntryLib, option);
+
+  const DxilContainerHeader *pHeader = IsDxilContainerLike(
+      pEntryLib->GetBufferPointer(), pEntryLib->GetBufferSize());
+  VERIFY_IS_NOT_NULL(pHeader);
+  VERIFY_IS_NOT_NULL(GetDxilPartByType(pHeader, DFCC_FunctionIndex));
+  RegisterDxcModule(libName, pEntryLib, pLinker);
+
+  // Each link loads a different subset of the bodies through the index.
+  Link(L"ps_main", L"ps_6_0", pLinker, {libName}, {},{});
+  Link(L"ds_main", L"ds_6_0", pLinker, {libName}, {},{});
+  Link(L"hs_main", L"hs_6_0", pLinker, {libName}, {},{});
+
+  CComPtr<IDxcBlob> pResLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_resource2.hlsl", &pResLib, option);
+
+  LPCWSTR libResName = L"res";
+  RegisterDxcModule(libResName, pResLib, pLinker);
+  Link(L"cs_main", L"cs_6_0", pLinker, {libName, libResName}, {},{});
+}
+
+namespace {
+// Registers a copy of the library with a new linker and links the entry,
+// returning the disassembly of the result, or an empty string on failure.
+std::string LinkFromLibrary(dxc::DxcDllSupport &dllSupport,
+                            IDxcLibrary *pLibrary,
+                            const std::vector<char> &lib, LPCWSTR entry) {
+  CComPtr<IDxcBlobEncoding> pLib;
+  VERIFY_SUCCEEDED(pLibrary->CreateBlobWithEncodingFromPinned(
+      lib.data(), lib.size(), CP_ACP, &pLib));
+  CComPtr<IDxcLinker> pLinker;
+  VERIFY_SUCCEEDED(dllSupport.CreateInstance(CLSID_DxcLinker, &pLinker));
+  LPCWSTR libName = L"lib";
+  if (FAILED(pLinker->RegisterLibrary(libName, pLib)))
+    return std::string();
+  CComPtr<IDxcOperationResult> pResult;
+  VERIFY_SUCCEEDED(
+      pLinker->Link(entry, L"ps_6_0", &libName, 1, nullptr, 0, &pResult));
+  HRESULT status;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  if (FAILED(status))
+    return std::string();
+  CComPtr<IDxcBlob> pProgram;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  return DisassembleProgram(dllSupport, pProgram);
+}
+
+struct FunctionIndexParts {
+  char *pBitcode;
+  uint32_t BitcodeSize;
+  DxilFunctionIndexHeader *pIndex;
+  uint64_t *pBodyBits;
+};
+
+FunctionIndexParts GetFunctionIndexParts(std::vector<char> &lib) {
+  const DxilContainerHeader *pHeader =
+      IsDxilContainerLike(lib.data(), lib.size());
+  VERIFY_IS_TRUE(IsValidDxilContainer(pHeader, lib.size()));
+  FunctionIndexParts parts;
+  const char *pIL;
+  GetDxilProgramBitcode(GetDxilProgramHeader(pHeader, DFCC_DXIL), &pIL,
+                        &parts.BitcodeSize);
+  parts.pBitcode = const_cast<char *>(pIL);
+  const DxilPartHeader *pPart =
+      GetDxilPartByType(pHeader, DFCC_FunctionIndex);
+  VERIFY_IS_NOT_NULL(pPart);
+  parts.pIndex = (DxilFunctionIndexHeader *)GetDxilPartData(pPart);
+  parts.pBodyBits = (uint64_t *)(parts.pIndex + 1);
+  return parts;
+}
+
+void DigestBitcode(const FunctionIndexParts &parts,
+                   llvm::MD5::MD5Result &digest) {
+  llvm::MD5 md5;
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)parts.pBitcode,
+                               parts.BitcodeSize));
+  md5.final(digest);
+}
+} // namespace
+
+TEST_F(LinkerTest, RunLinkWithFunctionIndexChecked) {
+  CComPtr<IDxcBlob> pProgram;
+  CompileProgram(
+    "[shader(\"pixel\")] float4 PSZero(float4 a : A) : SV_Target {\n"
+    "  return a * 2;\n"
+    "}\n"
+    "[shader(\"pixel\")] float4 PSOne(float4 a : A) : SV_Target {\n"
+    "  return a + 3;\n"
+    "}\n"
+    "[shader(\"pixel\")] float4 PSTwo(float4 a : A) : SV_Target {\n"
+    "  return sin(a);\n"
+    "}\n",
+    L"lib_6_3", &pProgram, {L"-Qfunction_index"});
+  const char *pStart = (const char *)pProgram->GetBufferPointer();
+  const std::vector<char> lib(pStart, pStart + pProgram->GetBufferSize());
+  CComPtr<IDxcLibrary> pLibrary;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+
+  // The index describes the bitcode it was written with.
+  std::vector<char> copy(lib);
+  FunctionIndexParts parts = GetFunctionIndexParts(copy);
+  VERIFY_ARE_EQUAL(parts.BitcodeSize, parts.pIndex->BitcodeSize);
+  llvm::MD5::MD5Result digest;
+  DigestBitcode(parts, digest);
+  VERIFY_IS_TRUE(0 == memcmp(digest, parts.pIndex->BitcodeDigest,
+                             sizeof(digest)));
+
+  // Bodies are indexed in the order their functions are defined.
+  std::vector<std::wstring> bodyEntries;
+  {
+    LLVMContext Context;
+    ErrorOr<std::unique_ptr<Module>> pModule = getLazyBitcodeModule(
+        MemoryBuffer::getMemBuffer(
+            StringRef(parts.pBitcode, parts.BitcodeSize), "", false),
+        Context);
+    VERIFY_IS_FALSE(pModule.getError());
+    for (Function &F : *pModule.get()) {
+      if (!F.isMaterializable())
+        continue;
+      for (const wchar_t *name : {L"PSZero", L"PSOne", L"PSTwo"}) {
+        if (F.getName().find(CW2A(name).m_psz) != StringRef::npos)
+          bodyEntries.push_back(name);
+      }
+    }
+  }
+  VERIFY_ARE_EQUAL(3u, bodyEntries.size());
+  VERIFY_ARE_EQUAL(3u, parts.pIndex->FunctionCount);
+
+  std::vector<std::string> expected;
+  for (const std::wstring &entry : bodyEntries) {
+    expected.push_back(
+        LinkFromLibrary(m_dllSupport, pLibrary, lib, entry.c_str()));
+    VERIFY_IS_FALSE(expected.back().empty());
+  }
+
+  // Offsets that do not point at function bodies are not trusted, and
+  // neither is an index of bitcode that has since changed.
+  for (unsigned corruption = 0; corruption < 3; ++corruption) {
+    copy = lib;
+    parts = GetFunctionIndexParts(copy);
+    switch (corruption) {
+    case 0: parts.pBodyBits[1] += 8; break;
+    case 1: parts.pBodyBits[2] = parts.pBodyBits[1] + 32; break;
+    case 2: parts.pIndex->BitcodeDigest[0] ^= 1; break;
+    }
+    for (unsigned i = 0; i < bodyEntries.size(); ++i)
+      VERIFY_ARE_EQUAL(expected[i],
+                       LinkFromLibrary(m_dllSupport, pLibrary, copy,
+                                       bodyEntries[i].c_str()));
+  }
+
+  // Destroy the length of the second body, so that scanning the module can
+  // no longer get past it, and record the new bitcode in the index. The last
+  // body can then only be found through the index.
+  copy = lib;
+  parts = GetFunctionIndexParts(copy);
+  uint64_t lengthWord = (parts.pBodyBits[1] + 4 + 31) / 32;
+  VERIFY_IS_TRUE((lengthWord + 1) * 4 <= parts.BitcodeSize);
+  memset(parts.pBitcode + lengthWord * 4, 0xFF, 4);
+  DigestBitcode(parts, digest);
+  memcpy(parts.pIndex->BitcodeDigest, digest, sizeof(digest));
+  VERIFY_ARE_EQUAL(expected[2], LinkFromLibrary(m_dllSupport, pLibrary, copy,
+                                                bodyEntries[2].c_str()));
+}
+
+TEST_F(LinkerTest, RunLinkPipelineRemovesUnreadOutputs) {
+  LLVMContext Context;
+  std::unique_ptr<Module> pVS = CompileToModule(
+    "struct VSOut { float4 pos : SV_Position; float2 a : A; float2 b : B; float4 c : C; };\n"
+    "VSOut main(float2 p : P) {\n"
+    "  float s = sin(p.x), c = cos(p.y);\n"
+    "  VSOut o;\n"
+    "  o.pos = float4(p, 0, 1);\n"
+    "  o.a = float2(s * c, p.y);\n"
+    "  o.b = float2(c, s);\n"
+    "  o.c = float4(p.x, s, c, s * c);\n"
+    "  return o;\n"
+    "}\n"
+    ,
+    L"vs_6_0", Context
+  );
+  std::unique_ptr<Module> pPS = CompileToModule(
+    "float4 main(float2 a : A, float2 b : B, float4 c : C) : SV_Target {\n"
+    "  return a.y + c.x;\n"
+    "}\n"
+    ,
+    L"ps_6_0", Context
+  );
+
+  DxilModule &VS = pVS->GetDxilModule();
+  DxilModule &PS = pPS->GetDxilModule();
+  DxilModule *Stages[] = { &VS, &PS };
+  DxilPipelineLinkStats Stats;
+  VERIFY_IS_TRUE(LinkPipelineStages(Stages, &Stats));
+  VERIFY_ARE_EQUAL(2u, Stats.RepackedSignatures);
+
+  // B is gone from both sides; A and C stay where the pixel shader reads them.
+  const DxilSignature &Out = VS.GetOutputSignature();
+  const DxilSignature &In = PS.GetInputSignature();
+  VERIFY_ARE_EQUAL(3u, Out.GetElements().size());
+  VERIFY_ARE_EQUAL(2u, In.GetElements().size());
+  for (auto &E : In.GetElements()) {
+    VERIFY_IS_TRUE(E->GetSemanticName() != "B");
+    const DxilSignatureElement *Linked = nullptr;
+    for (auto &O : Out.GetElements()) {
+      if (O->GetSemanticName() == E->GetSemanticName())
+        Linked = O.get();
+    }
+    VERIFY_IS_NOT_NULL(Linked);
+    VERIFY_ARE_EQUAL(E->GetStartRow(), Linked->GetStartRow());
+    VERIFY_ARE_EQUAL(E->GetStartCol(), Linked->GetStartCol());
+    // Only the components the pixel shader reads are still written.
+    VERIFY_ARE_EQUAL(E->GetUsageMask(), Linked->GetUsageMask());
+  }
+
+  // Nothing read depends on sin or cos any more.
+  for (Function &F : VS.GetModule()->functions()) {
+    if (OP::IsDxilOpFunc(&F))
+      VERIFY_IS_FALSE(F.getName().startswith("dx.op.unary") && !F.use_empty());
+  }
+}
+
+namespace {
+// Semantic names of the elements in a signature part of a container.
+std::vector<std::string> GetSignatureNames(IDxcBlob *pContainer,
+                                           DxilFourCC fourCC) {
+  const DxilPartHeader *pPart = GetDxilPartByType(
+      (const DxilContainerHeader *)pContainer->GetBufferPointer(), fourCC);
+  VERIFY_IS_NOT_NULL(pPart);
+  const char *pData = GetDxilPartData(pPart);
+  const DxilProgramSignature *pSig = (const DxilProgramSignature *)pData;
+  const DxilProgramSignatureElement *pElements =
+      (const DxilProgramSignatureElement *)(pData + pSig->ParamOffset);
+  std::vector<std::string> names;
+  for (uint32_t i = 0; i < pSig->ParamCount; ++i)
+    names.push_back(pData + pElements[i].SemanticName);
+  return names;
+}
+} // namespace
+
+TEST_F(LinkerTest, RunCompilePipelineRemovesUnreadOutputs) {
+  const char *program =
+    "struct VSOut { float4 pos : SV_Position; float2 a : A; float2 b : B; };\n"
+    "VSOut VSMain(float2 p : P) {\n"
+    "  VSOut o;\n"
+    "  o.pos = float4(p, 0, 1);\n"
+    "  o.a = p * 2;\n"
+    "  o.b = float2(sin(p.x), cos(p.y));\n"
+    "  return o;\n"
+    "}\n"
+    "float4 PSMain(float2 a : A, float2 b : B) : SV_Target {\n"
+    "  return a.xyxy;\n"
+    "}\n";
+  CComPtr<IDxcCompiler8> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  DxcBuffer source = { program, strlen(program), DXC_CP_UTF8 };
+  auto compilePipeline = [&](LPCWSTR psEntry) {
+    DxcPipelineStage stages[] = { { L"VSMain", L"vs_6_0" },
+                                  { psEntry, L"ps_6_0" } };
+    CComPtr<IDxcPipelineResults> pResults;
+    VERIFY_SUCCEEDED(pCompiler->CompilePipeline(&source, nullptr, 0, stages,
+                                                _countof(stages), nullptr,
+                                                IID_PPV_ARGS(&pResults)));
+    VERIFY_ARE_EQUAL(2u, pResults->GetStageCount());
+    return pResults;
+  };
+
+  CComPtr<IDxcPipelineResults> pResults = compilePipeline(L"PSMain");
+  VERIFY_IS_TRUE(pResults->IsLinked());
+  CComPtr<IDxcBlob> pVS, pPS;
+  for (UINT32 i = 0; i < 2; ++i) {
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pResults->GetResult(i, IID_PPV_ARGS(&pResult)));
+    CheckOperationSucceeded(pResult, i == 0 ? &pVS : &pPS);
+  }
+
+  // B is no longer written by the vertex shader or read by the pixel shader,
+  // and the sin and cos feeding it are gone.
+  std::vector<std::string> vsOut = GetSignatureNames(pVS, DFCC_OutputSignature);
+  std::vector<std::string> psIn = GetSignatureNames(pPS, DFCC_InputSignature);
+  VERIFY_ARE_EQUAL(2u, vsOut.size());
+  VERIFY_IS_TRUE(std::count(vsOut.begin(), vsOut.end(), "B") == 0);
+  VERIFY_IS_TRUE(std::count(vsOut.begin(), vsOut.end(), "A") == 1);
+  VERIFY_ARE_EQUAL(1u, psIn.size());
+  VERIFY_ARE_EQUAL(std::string("A"), psIn[0]);
+  std::string vsText = DisassembleProgram(m_dllSupport, pVS);
+  VERIFY_IS_TRUE(vsText.find("@dx.op.unary") == std::string::npos);
+
+  // A stage that fails to compile leaves the others unlinked.
+  CComPtr<IDxcPipelineResults> pFailed = compilePipeline(L"Missing");
+  VERIFY_IS_FALSE(pFailed->IsLinked());
+  CComPtr<IDxcOperationResult> pResult;
+  VERIFY_SUCCEEDED(pFailed->GetResult(1, IID_PPV_ARGS(&pResult)));
+  HRESULT status;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_FAILED(status);
+  pResult.Release();
+  VERIFY_SUCCEEDED(pFailed->GetResult(0, IID_PPV_ARGS(&pResult)));
+  CComPtr<IDxcBlob> pUnlinkedVS;
+  CheckOperationSucceeded(pResult, &pUnlinkedVS);
+  VERIFY_ARE_EQUAL(3u,
+                   GetSignatureNames(pUnlinkedVS, DFCC_OutputSignature).size());
+}
@@ -29,11 +29,17 @@
 #include "dxc/Test/DxcTestUtils.h"
 
 #include "llvm/Support/raw_os_ostream.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/Support/microcom.h"
 #include "dxc/Support/HLSLOptions.h"
 #include "dxc/Support/Unicode.h"
+#include "dxc/HLSL/DxilGenerationPass.h"
 
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MSFileSystem.h"
@@ -47,6 +53,24 @@ using namespace hlsl_test;
 ///////////////////////////////////////////////////////////////////////////////
 // Optimizer test cases.
 
+// Records the phases a compile reports to it.
+class PhaseRecordingCallback : public IDxcCompileCallback {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  std::vector<std::string> Phases;
+  PhaseRecordingCallback() : m_dwRef(0) { }
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override {
+    return DoBasicQueryInterface<IDxcCompileCallback>(this, iid, ppvObject);
+  }
+
+  void STDMETHODCALLTYPE OnDiagnostic(LPCSTR, SIZE_T) override { }
+  void STDMETHODCALLTYPE OnProgress(LPCSTR pPhase) override {
+    Phases.emplace_back(pPhase);
+  }
+  BOOL STDMETHODCALLTYPE IsCancelled() override { return FALSE; }
+};
+
 #ifdef _WIN32
 class OptimizerTest {
 #else
@@ -66,6 +90,8 @@ public:
   TEST_METHOD(OptimizerWhenSlice2ThenOK)
   TEST_METHOD(OptimizerWhenSlice3ThenOK)
   TEST_METHOD(OptimizerWhenSliceWithIntermediateOptionsThenOK)
+  TEST_METHOD(OptimizerWhenCompileCallbackThenPassesReported)
+  TEST_METHOD(OptimizerWhenSnapshotThenResumedOnlyByItsCompiler)
 
   void OptimizerWhenSliceNThenOK(int optLevel);
   void OptimizerWhenSliceNThenOK(int optLevel, LPCSTR pText, LPCWSTR pTarget, llvm::ArrayRef<LPCWSTR> args = {});
@@ -120,6 +146,116 @@ TEST_F(OptimizerTest, OptimizerWhenSliceWithIntermediateOptionsThenOK) {
   OptimizerWhenSliceNThenOK(1, SampleProgram, L"ps_6_0", { L"-flegacy-resource-reservation" });
 }
 
+TEST_F(OptimizerTest, OptimizerWhenCompileCallbackThenPassesReported) {
+  CComPtr<IDxcCompiler9> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  LPCSTR SampleProgram =
+    "float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+    "  return pos * 2;\r\n"
+    "}";
+  DxcBuffer buffer = { SampleProgram, strlen(SampleProgram), DXC_CP_UTF8 };
+
+  auto compile = [&](LPCWSTR optLevel) {
+    LPCWSTR args[] = { L"-T", L"ps_6_0", optLevel };
+    CComPtr<PhaseRecordingCallback> pCallback = new PhaseRecordingCallback();
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->CompileWithCallback(
+        &buffer, args, _countof(args), nullptr, pCallback,
+        IID_PPV_ARGS(&pResult)));
+    VerifyOperationSucceeded(pResult);
+    return pCallback->Phases;
+  };
+
+  // Each pass the optimizer runs is reported between the front end and
+  // container assembly, so a full optimization reports more of them.
+  std::vector<std::string> optimized = compile(L"-O3");
+  std::vector<std::string> unoptimized = compile(L"-Od");
+  VERIFY_ARE_EQUAL(std::string("front end"), optimized.front());
+  VERIFY_IS_TRUE(std::find(optimized.begin(), optimized.end(),
+                           "container assembly and validation") !=
+                 optimized.end());
+  VERIFY_ARE_EQUAL(std::string("front end"), unoptimized.front());
+  VERIFY_IS_GREATER_THAN(optimized.size(), unoptimized.size());
+}
+
+TEST_F(OptimizerTest, OptimizerWhenSnapshotThenResumedOnlyByItsCompiler) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  LPCSTR SampleProgram =
+    "float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+    "  return sin(pos) * 2;\r\n"
+    "}";
+
+  auto compile = [&](const void *pData, size_t size, LPCWSTR pExtraArg) {
+    std::vector<LPCWSTR> args = { L"-T", L"ps_6_0", L"-E", L"main" };
+    if (pExtraArg)
+      args.push_back(pExtraArg);
+    DxcBuffer buffer = { pData, size, DXC_CP_UTF8 };
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(&buffer, args.data(), args.size(),
+                                        nullptr, IID_PPV_ARGS(&pResult)));
+    return pResult;
+  };
+  auto getErrors = [](IDxcResult *pResult) {
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_FAILED(status);
+    CComPtr<IDxcBlobEncoding> pErrors;
+    VERIFY_SUCCEEDED(pResult->GetErrorBuffer(&pErrors));
+    return BlobToUtf8(pErrors);
+  };
+
+  CComPtr<IDxcResult> pSnapshotResult =
+      compile(SampleProgram, strlen(SampleProgram), L"-fsnapshot-dxil");
+  VerifyOperationSucceeded(pSnapshotResult);
+  CComPtr<IDxcBlob> pSnapshot;
+  VERIFY_SUCCEEDED(pSnapshotResult->GetResult(&pSnapshot));
+  VerifyOperationSucceeded(compile(pSnapshot->GetBufferPointer(),
+                                   pSnapshot->GetBufferSize(), nullptr));
+
+  // Writes the snapshot back out after edit changes its module.
+  auto rewrite = [&](void (*edit)(llvm::Module &)) {
+    llvm::LLVMContext Context;
+    std::unique_ptr<llvm::MemoryBuffer> pBuffer =
+        llvm::MemoryBuffer::getMemBuffer(
+            llvm::StringRef((const char *)pSnapshot->GetBufferPointer(),
+                            pSnapshot->GetBufferSize()),
+            "", false);
+    llvm::ErrorOr<std::unique_ptr<llvm::Module>> pModule =
+        llvm::parseBitcodeFile(pBuffer->getMemBufferRef(), Context);
+    VERIFY_IS_FALSE((bool)pModule.getError());
+    edit(*pModule.get());
+    std::string bitcode;
+    {
+      llvm::raw_string_ostream OS(bitcode);
+      llvm::WriteBitcodeToFile(pModule.get().get(), OS);
+    }
+    return bitcode;
+  };
+
+  // Bitcode without a pause point is not a snapshot.
+  std::string unmarked = rewrite([](llvm::Module &M) {
+    VERIFY_IS_TRUE(hlsl::ClearPauseResumePasses(M));
+  });
+  VERIFY_ARE_NOT_EQUAL(
+      std::string::npos,
+      getErrors(compile(unmarked.data(), unmarked.size(), nullptr))
+          .find("not a module snapshot"));
+
+  // The passes ahead of the pause point may differ in another compiler.
+  std::string foreign = rewrite([](llvm::Module &M) {
+    llvm::NamedMDNode *pIdent = M.getNamedMetadata("llvm.ident");
+    VERIFY_IS_NOT_NULL(pIdent);
+    llvm::Metadata *Ops[] = {
+        llvm::MDString::get(M.getContext(), "other compiler")};
+    pIdent->setOperand(0, llvm::MDNode::get(M.getContext(), Ops));
+  });
+  VERIFY_ARE_NOT_EQUAL(
+      std::string::npos,
+      getErrors(compile(foreign.data(), foreign.size(), nullptr))
+          .find("written by compiler 'other compiler'"));
+}
+
 void OptimizerTest::OptimizerWhenSliceNThenOK(int optLevel) {
   LPCSTR SampleProgram =
     "Texture2D g_Tex;\r\n"
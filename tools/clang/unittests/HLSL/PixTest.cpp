@@ -9,10 +9,6 @@
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-// This whole file is win32-only
-#ifdef _WIN32
-
-
 #ifndef UNICODE
 #define UNICODE
 #endif
@@ -28,9 +24,11 @@
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/dxcapi.h"
+#ifdef _WIN32
 #include "dxc/dxcpix.h"
 #include <atlfile.h>
 #include "dia2.h"
+#endif
 
 #include "dxc/DXIL/DxilModule.h"
 
@@ -47,6 +45,8 @@
 
 #include <fstream>
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -61,15 +61,21 @@
 #include "llvm/ADT/StringSwitch.h"
 
 
+#ifdef _WIN32
 #include <../lib/DxilDia/DxilDiaSession.h>
 #include <../lib/DxilDia/DxcPixLiveVariables.h>
 #include <../lib/DxilDia/DxcPixLiveVariables_FragmentIterator.h>
+#endif
+#include <dxc/DxilPIXPasses/DxilPIXCompactTrace.h>
 #include <dxc/DxilPIXPasses/DxilPIXVirtualRegisters.h>
 
 using namespace std;
 using namespace hlsl;
 using namespace hlsl_test;
 
+// DIA and container reflection are win32-only; so are the tests that use
+// them.  The tests of the PIX passes on their own build everywhere.
+#ifdef _WIN32
 // Aligned to SymTagEnum.
 const char *SymTagEnumText[] = {
     "Null",               // SymTagNull
@@ -168,8 +174,13 @@ static std::vector<std::string> Tokenize(const std::string &str,
 
   return tokens;
 }
+#endif // _WIN32
 
+#ifdef _WIN32
 class PixTest {
+#else
+class PixTest : public ::testing::Test {
+#endif
 public:
   BEGIN_TEST_CLASS(PixTest)
     TEST_CLASS_PROPERTY(L"Parallel", L"true")
@@ -207,9 +218,13 @@ public:
   TEST_METHOD(PixStructAnnotation_MemberFunction)
   TEST_METHOD(PixStructAnnotation_BigMess)
 
+  TEST_METHOD(PixCompactTrace_ExpandsToStepTrace)
+  TEST_METHOD(PixCompactTrace_RecordsFloatArithmetic)
+
   dxc::DxcDllSupport m_dllSupport;
   VersionSupportInfo m_ver;
 
+#ifdef _WIN32
   void CreateBlobPinned(_In_bytecount_(size) LPCVOID data, SIZE_T size,
                         UINT32 codePage, _Outptr_ IDxcBlobEncoding **ppBlob) {
     CComPtr<IDxcLibrary> library;
@@ -973,7 +988,7 @@ public:
 
   TestableResults TestStructAnnotationCase(const char* hlsl);
   void ValidateAllocaWrite(std::vector<AllocaWrite> const& allocaWrites, size_t index, const char* name);
-
+#endif // _WIN32
 };
 
 
@@ -985,6 +1000,7 @@ bool PixTest::InitSupport() {
   return true;
 }
 
+#ifdef _WIN32
 TEST_F(PixTest, CompileWhenDebugThenDIPresent) {
   // BUG: the first test written was of this form:
   // float4 local = 0; return local;
@@ -2487,4 +2503,162 @@ void main()
 }
 
 
-#endif
+TEST_F(PixTest, PixCompactTrace_ExpandsToStepTrace) {
+  if (m_ver.SkipDxilVersion(1, 5)) return;
+
+  const char *hlsl = R"(
+float4 main(float4 pos : SV_Position) : SV_Target
+{
+    return pos.x * pos.y + 1;
+}
+)";
+
+  auto pOperationResult = Compile(hlsl, L"ps_6_0");
+  CComPtr<IDxcBlob> pBlob;
+  CheckOperationSucceeded(pOperationResult, &pBlob);
+
+  CComPtr<IDxcBlob> pDxil = FindModule(DFCC_ShaderDebugInfoDXIL, pBlob);
+  PassOutput passOutput = RunAnnotationPasses(pDxil);
+
+  CComPtr<IDxcBlob> pAnnotatedContainer;
+  ReplaceDxilBlobPart(pBlob->GetBufferPointer(), pBlob->GetBufferSize(),
+                      passOutput.blob, &pAnnotatedContainer);
+
+  ModuleAndHangersOn moduleEtc(pAnnotatedContainer);
+  llvm::Function *entryFunction = moduleEtc.GetDxilModule().GetEntryFunction();
+  VERIFY_ARE_EQUAL(1, entryFunction->size());
+
+  // Write the compact trace the instrumented shader would for an invocation
+  // whose every load returns 2: the start marker, the record of the only
+  // block, and records for the values that cannot be recomputed.  The
+  // arithmetic is recorded with the bits a device that fuses the multiply and
+  // add might produce, which the host could not reproduce.
+  constexpr uint32_t UID = 5;
+  const float Two = 2.0f;
+  uint32_t TwoBits;
+  memcpy(&TwoBits, &Two, sizeof(TwoBits));
+  constexpr uint32_t DeviceBits = 0x33800000;
+  std::vector<uint32_t> compact = {0, UID, 1 | (250 << 8), UID, 0};
+  size_t tracedCount = 0;
+  size_t arithmeticCount = 0;
+  for (llvm::Instruction &I : entryFunction->getEntryBlock()) {
+    std::uint32_t instNum, regNum, regSize;
+    llvm::Value *index;
+    bool traced;
+    if (auto *St = llvm::dyn_cast<llvm::StoreInst>(&I)) {
+      traced = pix_dxil::PixAllocaRegWrite::FromInst(St, &regNum, &regSize,
+                                                     &index);
+    } else {
+      traced = I.getType()->isFloatTy() &&
+               pix_dxil::PixDxilReg::FromInst(&I, &regNum);
+    }
+    if (!traced || !pix_dxil::PixDxilInstNum::FromInst(&I, &instNum)) {
+      continue;
+    }
+    ++tracedCount;
+    // Float arithmetic is never recomputed.
+    bool arithmetic = llvm::isa<llvm::BinaryOperator>(&I);
+    if (arithmetic) {
+      VERIFY_IS_FALSE(pix_dxil::PixCompactTrace::IsReplayable(&I));
+      ++arithmeticCount;
+    }
+    if (!pix_dxil::PixCompactTrace::IsReplayable(&I)) {
+      compact.insert(compact.end(),
+                     {3 | (252 << 8), UID, instNum,
+                      arithmetic ? DeviceBits : TwoBits, regNum << 16});
+    }
+  }
+  VERIFY_IS_TRUE(arithmeticCount > 0);
+
+  std::vector<uint32_t> steps;
+  VERIFY_IS_TRUE(pix_dxil::PixCompactTrace::ExpandToStepTrace(
+      *entryFunction, compact.data(), compact.size(), steps));
+
+  // The start marker, then a step per traced instruction, the arithmetic
+  // among them carrying the recorded bits rather than pos.x * pos.y + 1.
+  size_t stepCount = 0;
+  size_t deviceCount = 0;
+  for (size_t i = 2; i < steps.size(); i += 2 + (steps[i] & 0xF)) {
+    ++stepCount;
+    bool isFloatStep = ((steps[i] >> 8) & 0xFF) == 252;
+    deviceCount += isFloatStep && steps[i + 3] == DeviceBits;
+  }
+  VERIFY_ARE_EQUAL(tracedCount, stepCount);
+  VERIFY_ARE_EQUAL(arithmeticCount, deviceCount);
+}
+
+#endif // _WIN32
+
+// Float results depend on the device: a driver may contract a fast multiply
+// and add into an fma, and may flush denormals.  The compact trace records
+// them, so that the expanded trace shows what the shader computed rather than
+// what the host would.
+TEST_F(PixTest, PixCompactTrace_RecordsFloatArithmetic) {
+  llvm::LLVMContext Ctx;
+  llvm::Module M("compact", Ctx);
+  llvm::Type *FloatTy = llvm::Type::getFloatTy(Ctx);
+  llvm::Type *I32Ty = llvm::Type::getInt32Ty(Ctx);
+  llvm::Function *F = llvm::Function::Create(
+      llvm::FunctionType::get(llvm::Type::getVoidTy(Ctx),
+                              {FloatTy->getPointerTo(), I32Ty->getPointerTo()},
+                              false),
+      llvm::GlobalValue::ExternalLinkage, "main", &M);
+  auto Args = F->arg_begin();
+  llvm::Value *pFloats = &*Args++;
+  llvm::Value *pInt = &*Args;
+  llvm::IRBuilder<> B(llvm::BasicBlock::Create(Ctx, "entry", F));
+  llvm::FastMathFlags FMF;
+  FMF.setUnsafeAlgebra();
+  B.SetFastMathFlags(FMF);
+
+  std::vector<llvm::Instruction *> traced;
+  auto Trace = [&](llvm::Value *V) {
+    llvm::Instruction *I = llvm::cast<llvm::Instruction>(V);
+    traced.push_back(I);
+    pix_dxil::PixDxilInstNum::AddMD(Ctx, I, traced.size());
+    pix_dxil::PixDxilReg::AddMD(Ctx, I, traced.size());
+    return I;
+  };
+  llvm::Value *a = Trace(B.CreateLoad(pFloats));
+  llvm::Value *b = Trace(B.CreateLoad(B.CreateConstGEP1_32(pFloats, 1)));
+  llvm::Value *c = Trace(B.CreateLoad(B.CreateConstGEP1_32(pFloats, 2)));
+  llvm::Value *e = Trace(B.CreateLoad(B.CreateConstGEP1_32(pFloats, 3)));
+  llvm::Value *n = Trace(B.CreateLoad(pInt));
+  llvm::Value *sum = Trace(B.CreateFAdd(Trace(B.CreateFMul(a, b)), c));
+  Trace(B.CreateFMul(e, llvm::ConstantFP::get(FloatTy, 0.5)));
+  Trace(B.CreateFCmpOGT(sum, llvm::ConstantFP::get(FloatTy, 0.0)));
+  Trace(B.CreateSIToFP(n, FloatTy));
+  llvm::Instruction *increment = Trace(B.CreateAdd(n, B.getInt32(1)));
+  B.CreateRetVoid();
+
+  for (llvm::Instruction *I : traced)
+    VERIFY_ARE_EQUAL(I == increment,
+                     pix_dxil::PixCompactTrace::IsReplayable(I));
+
+  // a = b = 1 + 2^-12 and c = -(1 + 2^-11).  Rounding a * b gives c exactly,
+  // so the host would compute 0 for the sum; the fma is 2^-24.  e = 2^-126,
+  // and the device flushes e * 0.5 to zero where the host would not.
+  const std::vector<uint32_t> device = {
+      0x3F800800, 0x3F800800, 0xBF801000, 0x00800000, 7,
+      0x3F801000, 0x33800000, 0x00000000, 1, 0x40E00000};
+  constexpr uint32_t UID = 9;
+  std::vector<uint32_t> compact = {0, UID, 1 | (250 << 8), UID, 0};
+  for (size_t i = 0; i < device.size(); ++i) {
+    uint32_t type = traced[i]->getType()->isFloatTy() ? 252 : 253;
+    uint32_t instNum = i + 1;
+    compact.insert(compact.end(),
+                   {3 | (type << 8), UID, instNum, device[i], instNum << 16});
+  }
+
+  std::vector<uint32_t> steps;
+  VERIFY_IS_TRUE(pix_dxil::PixCompactTrace::ExpandToStepTrace(
+      *F, compact.data(), compact.size(), steps));
+
+  // The start marker, the recorded steps unchanged, then the recomputed
+  // increment.
+  std::vector<uint32_t> expected(compact.begin(), compact.begin() + 2);
+  expected.insert(expected.end(), compact.begin() + 5, compact.end());
+  expected.insert(expected.end(),
+                  {3 | (253 << 8), UID, 11, 8, 11 << 16});
+  VERIFY_IS_TRUE(expected == steps);
+}
@@ -20,6 +20,7 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/DxilContainer/DxilContainerAssembler.h"
+#include "dxc/HLSL/DxilValidationCache.h"
 
 #ifdef _WIN32
 #include <atlbase.h>
@@ -47,6 +48,8 @@ public:
   TEST_CLASS_SETUP(InitSupport);
 
   TEST_METHOD(WhenCorrectThenOK)
+  TEST_METHOD(ValidationCacheMatchesOnlyIdenticalBytes)
+  TEST_METHOD(ValidationCacheEvictsLeastRecentlyUsed)
   TEST_METHOD(WhenMisalignedThenFail)
   TEST_METHOD(WhenEmptyFileThenFail)
   TEST_METHOD(WhenIncorrectMagicThenFail)
@@ -135,8 +138,9 @@ public:
   TEST_METHOD(BigStructInBuffer)
   TEST_METHOD(GloballyCoherent2)
   TEST_METHOD(GloballyCoherent3)
+  TEST_METHOD(TGSMRaceCond)
+  TEST_METHOD(TGSMRaceCondRequiresValidator1_6)
   // TODO: enable this.
-  //TEST_METHOD(TGSMRaceCond)
   //TEST_METHOD(TGSMRaceCond2)
   TEST_METHOD(AddUint64Odd)
 
@@ -215,6 +219,8 @@ public:
 
   TEST_METHOD(WhenRootSigMismatchThenFail)
   TEST_METHOD(WhenRootSigCompatThenSucceed)
+  TEST_METHOD(WhenCachedRootSigMismatchThenFail)
+  TEST_METHOD(WhenCachedRootSigRevalidatedThenVisibilityChecked)
   TEST_METHOD(WhenRootSigMatchShaderSucceed_RootConstVis)
   TEST_METHOD(WhenRootSigMatchShaderFail_RootConstVis)
   TEST_METHOD(WhenRootSigMatchShaderSucceed_RootCBV)
@@ -1626,11 +1632,29 @@ TEST_F(ValidationTest, GloballyCoherent3) {
   TestCheck(L"..\\CodeGenHLSL\\globallycoherent3.hlsl");
 }
 
+TEST_F(ValidationTest, TGSMRaceCond) {
+  TestCheck(L"..\\CodeGenHLSL\\RaceCond.hlsl");
+}
+
+TEST_F(ValidationTest, TGSMRaceCondRequiresValidator1_6) {
+  if (m_ver.SkipDxilVersion(1, 6)) return;
+  // Compiles for validator 1.5, which does not check for the race, and
+  // fails once the module asks for 1.6.
+  LPCWSTR args[] = { L"-validator-version", L"1.5" };
+  RewriteAssemblyCheckMsg(
+    "RWBuffer<int> g_Intensities : register(u1);\n"
+    "groupshared int sharedData;\n"
+    "[numthreads(64, 1, 1)]\n"
+    "void main(uint GI : SV_GroupIndex) {\n"
+    "  sharedData = GI;\n"
+    "  InterlockedAdd(sharedData, g_Intensities[GI]);\n"
+    "  g_Intensities[GI] = sharedData;\n"
+    "}\n", "cs_6_0", args, _countof(args), nullptr, 0,
+    "!{i32 1, i32 5}", "!{i32 1, i32 6}",
+    "Race condition writing to shared memory detected, consider making this write conditional");
+}
+
 // TODO: enable this.
-//TEST_F(ValidationTest, TGSMRaceCond) {
-//  TestCheck(L"..\\CodeGenHLSL\\RaceCond.hlsl");
-//}
-//
 //TEST_F(ValidationTest, TGSMRaceCond2) {
 //    RewriteAssemblyCheckMsg(L"..\\CodeGenHLSL\\structInBuffer.hlsl", "cs_6_0",
 //        "ret void",
@@ -2370,6 +2394,54 @@ TEST_F(ValidationTest, WhenRootSigCompatThenSucceed) {
   );
 }
 
+TEST_F(ValidationTest, WhenCachedRootSigMismatchThenFail) {
+  // The first shader verifies the root signature, the second reuses it and
+  // must still be checked against its own bindings.
+  ReplaceContainerPartsCheckMsgs(
+    "float c; float4 main() : semantic { return c; }",
+    "[RootSignature ( \"RootConstants(b0, num32BitConstants = 2)\" )] float4 main() : semantic { return 0; }",
+    "vs_6_0",
+    {DFCC_RootSignature},
+    {}
+  );
+  ReplaceContainerPartsCheckMsgs(
+    "cbuffer B : register(b1) { float c; } float4 main() : semantic { return c; }",
+    "[RootSignature ( \"RootConstants(b0, num32BitConstants = 2)\" )] float4 main() : semantic { return 0; }",
+    "vs_6_0",
+    {DFCC_RootSignature},
+    {
+      "Root Signature in DXIL container is not compatible with shader.",
+      "Validation failed."
+    }
+  );
+}
+
+TEST_F(ValidationTest, WhenCachedRootSigRevalidatedThenVisibilityChecked) {
+  // The verified root signature is cached on its first validation; every
+  // later validation must still check it against the stage of its shader.
+  for (unsigned i = 0; i < 3; ++i) {
+    ReplaceContainerPartsCheckMsgs(
+      "float c; float4 main() : SV_Target { return c; }",
+      "[RootSignature ( \"RootConstants(b0, visibility = SHADER_VISIBILITY_PIXEL, num32BitConstants = 1)\" )]"
+      "  float4 main() : SV_Target { return 0; }",
+      "ps_6_0",
+      {DFCC_RootSignature},
+      {}
+    );
+    ReplaceContainerPartsCheckMsgs(
+      "float c; float4 main() : semantic { return c; }",
+      "[RootSignature ( \"RootConstants(b0, visibility = SHADER_VISIBILITY_PIXEL, num32BitConstants = 1)\" )]"
+      "  float4 main() : semantic { return 0; }",
+      "vs_6_0",
+      {DFCC_RootSignature},
+      {
+        "Root Signature in DXIL container is not compatible with shader.",
+        "Validation failed."
+      }
+    );
+  }
+}
+
 TEST_F(ValidationTest, WhenRootSigMatchShaderSucceed_RootConstVis) {
   ReplaceContainerPartsCheckMsgs(
     "float c; float4 main() : semantic { return c; }",
@@ -3829,3 +3901,79 @@ TEST_F(ValidationTest, ValidatePrintfNotAllowed) {
   TestCheck(L"..\\CodeGenHLSL\\printf.hlsl");
 }
 
+TEST_F(ValidationTest, ValidationCacheMatchesOnlyIdenticalBytes) {
+  typedef DxilValidationCache::LookupResult LookupResult;
+  CComPtr<IDxcBlob> pBlobA, pBlobB;
+  VERIFY_IS_TRUE(CompileSource("float4 main() : SV_Target { return 1; }",
+                               "ps_6_0", &pBlobA));
+  VERIFY_IS_TRUE(CompileSource("float4 main() : SV_Target { return 2; }",
+                               "ps_6_0", &pBlobB));
+  const DxilContainerHeader *pA = IsDxilContainerLike(
+      pBlobA->GetBufferPointer(), pBlobA->GetBufferSize());
+  const DxilContainerHeader *pB = IsDxilContainerLike(
+      pBlobB->GetBufferPointer(), pBlobB->GetBufferSize());
+  VERIFY_IS_NOT_NULL(pA);
+  VERIFY_IS_NOT_NULL(pB);
+
+  DxilValidationCache Cache("test-build", 8);
+  DxilValidationCache::Key KeyA, KeyB;
+  VERIFY_IS_TRUE(Cache.ComputeKey(pA, KeyA));
+  VERIFY_IS_TRUE(Cache.ComputeKey(pB, KeyB));
+
+  // Miss, then a hit once the container has been validated.
+  VERIFY_IS_TRUE(Cache.Lookup(KeyA) == LookupResult::Miss);
+  Cache.Insert(KeyA);
+  VERIFY_IS_TRUE(Cache.Lookup(KeyA) == LookupResult::ContainerMatch);
+  VERIFY_IS_TRUE(Cache.Lookup(KeyB) == LookupResult::Miss);
+
+  // The same program in a container with a different part only skips the
+  // module checks.
+  std::vector<char> Repacked((const char *)pA,
+                             (const char *)pA + pA->ContainerSizeInBytes);
+  const DxilContainerHeader *pRepacked =
+      (const DxilContainerHeader *)Repacked.data();
+  for (DxilPartIterator it = begin(pRepacked), E = end(pRepacked); it != E;
+       ++it) {
+    if ((*it)->PartFourCC != DFCC_DXIL &&
+        (*it)->PartFourCC != DFCC_ShaderDebugInfoDXIL && (*it)->PartSize) {
+      char *pData = const_cast<char *>(GetDxilPartData(*it));
+      pData[(*it)->PartSize - 1] ^= 1;
+      break;
+    }
+  }
+  DxilValidationCache::Key KeyRepacked;
+  VERIFY_IS_TRUE(Cache.ComputeKey(pRepacked, KeyRepacked));
+  VERIFY_IS_TRUE(Cache.Lookup(KeyRepacked) == LookupResult::ModuleMatch);
+
+  // Another validator build does not share keys.
+  DxilValidationCache Other("other-build", 8);
+  DxilValidationCache::Key KeyOther;
+  VERIFY_IS_TRUE(Other.ComputeKey(pA, KeyOther));
+  VERIFY_ARE_NOT_EQUAL(0, memcmp(KeyA.Container, KeyOther.Container,
+                                 sizeof(KeyA.Container)));
+  VERIFY_ARE_NOT_EQUAL(0, memcmp(KeyA.Module, KeyOther.Module,
+                                 sizeof(KeyA.Module)));
+}
+
+TEST_F(ValidationTest, ValidationCacheEvictsLeastRecentlyUsed) {
+  typedef DxilValidationCache::LookupResult LookupResult;
+  DxilValidationCache Cache("test-build", 2);
+  DxilValidationCache::Key Keys[3];
+  for (unsigned i = 0; i < _countof(Keys); ++i) {
+    memset(Keys[i].Container, i, sizeof(Keys[i].Container));
+    memset(Keys[i].Module, 0x80 | i, sizeof(Keys[i].Module));
+  }
+
+  // Using the first entry again makes the second one the oldest.
+  Cache.Insert(Keys[0]);
+  Cache.Insert(Keys[1]);
+  VERIFY_IS_TRUE(Cache.Lookup(Keys[0]) == LookupResult::ContainerMatch);
+  Cache.Insert(Keys[2]);
+  VERIFY_IS_TRUE(Cache.Lookup(Keys[0]) == LookupResult::ContainerMatch);
+  VERIFY_IS_TRUE(Cache.Lookup(Keys[1]) == LookupResult::Miss);
+  VERIFY_IS_TRUE(Cache.Lookup(Keys[2]) == LookupResult::ContainerMatch);
+
+  // Inserting a present entry does not evict anything.
+  Cache.Insert(Keys[2]);
+  VERIFY_IS_TRUE(Cache.Lookup(Keys[0]) == LookupResult::ContainerMatch);
+}
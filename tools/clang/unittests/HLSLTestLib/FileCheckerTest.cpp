@@ -25,7 +25,7 @@
 #include <atlfile.h>
 #endif
 
-#include "dxc/Test/HlslTestData.h"
+#include "dxc/Test/HLSLTestData.h"
 #include "dxc/Test/HlslTestUtils.h"
 #include "dxc/Test/DxcTestUtils.h"
 
@@ -40,13 +40,17 @@
 #include "dxc/Support/HLSLOptions.h"
 #include "dxc/Support/Unicode.h"
 #include "dxc/DxilContainer/DxilContainer.h"
+#ifdef _WIN32
 #include "dxc/Test/D3DReflectionDumper.h"
 
 #include "d3d12shader.h"
+#endif
 
 using namespace std;
 using namespace hlsl_test;
+#ifdef _WIN32
 using namespace refl_dump;
+#endif
 
 FileRunCommandPart::FileRunCommandPart(const std::string &command, const std::string &arguments, LPCWSTR commandFileName) :
   Command(command), Arguments(arguments), CommandFileName(commandFileName) { }
@@ -474,11 +478,29 @@ FileRunCommandResult FileRunCommandPart::RunDxc(dxc::DxcDllSupport &DllSupport,
   FileRunCommandResult result = {};
   if (SUCCEEDED(resultStatus)) {
     IFT(pResult->GetResult(&pCompiledBlob));
-    if (!opts.AstDump) {
+    if (opts.AstDump) {
+      result.StdOut = BlobToUtf8(pCompiledBlob);
+    } else if (!opts.ScanDependencies) {
       IFT(pCompiler->Disassemble(pCompiledBlob, &pDisassembly));
       result.StdOut = BlobToUtf8(pDisassembly);
-    } else {
-      result.StdOut = BlobToUtf8(pCompiledBlob);
+    }
+    // Dependency lists follow the program, or replace it with -M, and are
+    // headed by the file -MF names for them.
+    if (opts.ScanDependencies || opts.WriteDependencies) {
+      CComPtr<IDxcResult> pDxcResult;
+      CComPtr<IDxcBlobUtf8> pDependencies;
+      CComPtr<IDxcBlobUtf16> pDependencyName;
+      IFT(pResult.QueryInterface(&pDxcResult));
+      IFT(pDxcResult->GetOutput(DXC_OUT_DEPENDENCIES,
+                                IID_PPV_ARGS(&pDependencies),
+                                &pDependencyName));
+      if (pDependencyName && pDependencyName->GetStringLength()) {
+        result.StdOut += "; dependency file ";
+        result.StdOut += Unicode::UTF16ToUTF8StringOrThrow(
+            pDependencyName->GetStringPointer());
+        result.StdOut += "\n";
+      }
+      result.StdOut += BlobToUtf8(pDependencies);
     }
     CComPtr<IDxcBlobEncoding> pStdErr;
     IFT(pResult->GetErrorBuffer(&pStdErr));
@@ -602,6 +624,11 @@ FileRunCommandResult FileRunCommandPart::RunD3DReflect(dxc::DxcDllSupport &DllSu
   if (!Prior)
     return FileRunCommandResult::Error("Prior command required to generate stdin");
 
+#ifndef _WIN32
+  // Reflection dumping needs d3d12shader.h, which is only available on Windows.
+  UNREFERENCED_PARAMETER(DllSupport);
+  return FileRunCommandResult::Error("%D3DReflect is only supported on Windows");
+#else
   CComPtr<IDxcLibrary> pLibrary;
   CComPtr<IDxcBlobEncoding> pSource;
   CComPtr<IDxcAssembler> pAssembler;
@@ -666,6 +693,7 @@ FileRunCommandResult FileRunCommandPart::RunD3DReflect(dxc::DxcDllSupport &DllSu
   ss.flush();
 
   return FileRunCommandResult::Success(ss.str());
+#endif // _WIN32
 }
 
 FileRunCommandResult FileRunCommandPart::RunDxr(dxc::DxcDllSupport &DllSupport, const FileRunCommandResult *Prior) {
@@ -739,7 +767,7 @@ FileRunCommandResult FileRunCommandPart::RunTee(const FileRunCommandResult *Prio
 
 void FileRunCommandPart::SubstituteFilenameVars(std::string &args) {
   size_t pos;
-  std::string baseFileName = CW2A(CommandFileName);
+  std::string baseFileName = CW2A(CommandFileName).m_psz;
   if ((pos = baseFileName.find_last_of(".")) != std::string::npos) {
     baseFileName = baseFileName.substr(0, pos);
   }
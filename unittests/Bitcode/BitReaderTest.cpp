@@ -13,6 +13,7 @@
 #include "llvm/Bitcode/BitstreamWriter.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DiagnosticInfo.h" // HLSL Change
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -191,6 +192,140 @@ TEST(BitReaderTest, MaterializeFunctionsOutOfOrder) {
   EXPECT_FALSE(verifyModule(*M, &dbgs()));
 }
 
+// HLSL Change Begin
+static const char FunctionIndexAssembly[] = "define i32 @f(i32 %a) {\n"
+                                            "  %b = add i32 %a, 1\n"
+                                            "  ret i32 %b\n"
+                                            "}\n"
+                                            "define i32 @g(i32 %a) {\n"
+                                            "  %b = mul i32 %a, 2\n"
+                                            "  ret i32 %b\n"
+                                            "}\n"
+                                            "define i32 @h(i32 %a) {\n"
+                                            "  %b = sub i32 %a, 3\n"
+                                            "  ret i32 %b\n"
+                                            "}\n"
+                                            "define i32 @j(i32 %a) {\n"
+                                            "  %b = xor i32 %a, 4\n"
+                                            "  ret i32 %b\n"
+                                            "}\n";
+
+// Bitcode errors are returned from materialize() rather than diagnosed, as the
+// context would otherwise throw on them.
+static std::unique_ptr<Module>
+getLazyModuleWithIndex(LLVMContext &Context, StringRef Mem,
+                       ArrayRef<uint64_t> FunctionBodyBits) {
+  std::unique_ptr<MemoryBuffer> Buffer =
+      MemoryBuffer::getMemBuffer(Mem, "test", false);
+  ErrorOr<std::unique_ptr<Module>> ModuleOrErr = getLazyBitcodeModule(
+      std::move(Buffer), Context, [](const DiagnosticInfo &) {}, false, false,
+      FunctionBodyBits);
+  return std::move(ModuleOrErr.get());
+}
+
+// Overwrites the length of the function block whose contents start at Bit, so
+// that it can no longer be skipped by scanning the module.
+static void corruptFunctionBlockLength(SmallVectorImpl<char> &Mem,
+                                       uint64_t Bit) {
+  // The block ID is followed by a 4-bit code width, padding to a 32-bit
+  // boundary and then the 32-bit length of the block in words.
+  uint64_t Word = (Bit + bitc::CodeLenWidth + 31) / 32;
+  ASSERT_LE((Word + 1) * 4, Mem.size());
+  memset(Mem.data() + Word * 4, 0xFF, 4);
+}
+
+TEST(BitReaderTest, FunctionBodyBitsMatchBodies) {
+  SmallString<1024> Mem;
+  writeModuleToBuffer(parseAssembly(FunctionIndexAssembly), Mem);
+  std::vector<uint64_t> Bits;
+  ASSERT_TRUE(getBitcodeFunctionBodyBits(
+      MemoryBufferRef(Mem.str(), "test"), Bits));
+  ASSERT_EQ(4u, Bits.size());
+  for (size_t i = 1; i < Bits.size(); ++i)
+    EXPECT_LT(Bits[i - 1], Bits[i]);
+
+  LLVMContext Context;
+  std::unique_ptr<Module> M = getLazyModuleWithIndex(Context, Mem.str(), Bits);
+  for (const char *Name : {"j", "g", "f", "h"}) {
+    Function *F = M->getFunction(Name);
+    EXPECT_FALSE(F->materialize());
+    EXPECT_FALSE(F->empty());
+  }
+  EXPECT_FALSE(verifyModule(*M, &dbgs()));
+}
+
+TEST(BitReaderTest, FunctionBodyBitsAreUsed) {
+  SmallString<1024> Mem;
+  writeModuleToBuffer(parseAssembly(FunctionIndexAssembly), Mem);
+  std::vector<uint64_t> Bits;
+  ASSERT_TRUE(getBitcodeFunctionBodyBits(
+      MemoryBufferRef(Mem.str(), "test"), Bits));
+  ASSERT_EQ(4u, Bits.size());
+
+  // With the length of g's block destroyed, j can only be reached by jumping
+  // straight to it; scanning the module must fail to get past g.
+  corruptFunctionBlockLength(Mem, Bits[1]);
+
+  {
+    LLVMContext Context;
+    std::unique_ptr<Module> M =
+        getLazyModuleWithIndex(Context, Mem.str(), Bits);
+    Function *J = M->getFunction("j");
+    EXPECT_FALSE(J->materialize());
+    EXPECT_FALSE(J->empty());
+    Function *F = M->getFunction("f");
+    EXPECT_FALSE(F->materialize());
+    EXPECT_FALSE(F->empty());
+  }
+  {
+    LLVMContext Context;
+    std::unique_ptr<Module> M = getLazyModuleWithIndex(Context, Mem.str(), None);
+    EXPECT_TRUE(bool(M->getFunction("j")->materialize()));
+  }
+  {
+    // An entry that does not point at a function block is not trusted, so
+    // the reader scans for j instead and fails the same way.
+    std::vector<uint64_t> StaleBits = Bits;
+    StaleBits[3] += 8;
+    LLVMContext Context;
+    std::unique_ptr<Module> M =
+        getLazyModuleWithIndex(Context, Mem.str(), StaleBits);
+    EXPECT_TRUE(bool(M->getFunction("j")->materialize()));
+  }
+}
+
+TEST(BitReaderTest, StaleFunctionBodyBitsAreIgnored) {
+  SmallString<1024> Mem;
+  writeModuleToBuffer(parseAssembly(FunctionIndexAssembly), Mem);
+  std::vector<uint64_t> Bits;
+  ASSERT_TRUE(getBitcodeFunctionBodyBits(
+      MemoryBufferRef(Mem.str(), "test"), Bits));
+  ASSERT_EQ(4u, Bits.size());
+
+  std::vector<std::vector<uint64_t>> StaleIndexes;
+  StaleIndexes.push_back(std::vector<uint64_t>(Bits.begin(), Bits.end() - 1));
+  StaleIndexes.push_back(Bits);
+  StaleIndexes.back()[0] += 32;
+  StaleIndexes.push_back(Bits);
+  StaleIndexes.back()[2] += 8;
+  StaleIndexes.push_back(Bits);
+  StaleIndexes.back()[3] = Mem.size() * 8;
+  StaleIndexes.push_back(Bits);
+  std::swap(StaleIndexes.back()[1], StaleIndexes.back()[2]);
+
+  for (const std::vector<uint64_t> &Stale : StaleIndexes) {
+    LLVMContext Context;
+    std::unique_ptr<Module> M = getLazyModuleWithIndex(Context, Mem.str(), Stale);
+    for (const char *Name : {"j", "h", "g", "f"}) {
+      Function *F = M->getFunction(Name);
+      EXPECT_FALSE(F->materialize());
+      EXPECT_FALSE(F->empty());
+    }
+    EXPECT_FALSE(verifyModule(*M, &dbgs()));
+  }
+}
+// HLSL Change End
+
 TEST(BitReaderTest, MaterializeFunctionsForBlockAddr) { // PR11677
   SmallString<1024> Mem;
 
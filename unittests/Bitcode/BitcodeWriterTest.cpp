@@ -0,0 +1,140 @@
+//===- llvm/unittest/Bitcode/BitcodeWriterTest.cpp - Tests for BitWriter --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+// Builds a module with enough instructions for the writer to split the
+// function blocks over several tasks.  Functions call each other and share
+// globals and constants, so that every block refers to module-level values.
+std::unique_ptr<Module> makeLargeModule(LLVMContext &Context) {
+  std::unique_ptr<Module> M(new Module("large", Context));
+  Type *I32 = Type::getInt32Ty(Context);
+  FunctionType *FTy = FunctionType::get(I32, {I32, I32}, false);
+  GlobalVariable *G = new GlobalVariable(
+      *M, I32, false, GlobalValue::ExternalLinkage, ConstantInt::get(I32, 7),
+      "g");
+
+  const unsigned NumFunctions = 64;
+  const unsigned InstsPerFunction = 600;
+  Function *Prev = nullptr;
+  for (unsigned i = 0; i < NumFunctions; ++i) {
+    Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                   "f" + Twine(i), M.get());
+    BasicBlock *BB = BasicBlock::Create(Context, "entry", F);
+    IRBuilder<> Builder(BB);
+    auto Args = F->arg_begin();
+    Value *A = &*Args++;
+    Value *B = &*Args;
+    Value *V = Builder.CreateLoad(G);
+    for (unsigned j = 0; j < InstsPerFunction; ++j) {
+      switch (j % 4) {
+      case 0: V = Builder.CreateAdd(V, A); break;
+      case 1: V = Builder.CreateMul(V, ConstantInt::get(I32, j % 13 + 1)); break;
+      case 2: V = Builder.CreateXor(V, B); break;
+      case 3: V = Builder.CreateSub(V, ConstantInt::get(I32, i)); break;
+      }
+    }
+    if (Prev)
+      V = Builder.CreateCall(Prev, {V, A});
+    Builder.CreateStore(V, G);
+    Builder.CreateRet(V);
+    Prev = F;
+  }
+  return M;
+}
+
+void writeModule(const Module &M, bool ShouldPreserveUseListOrder,
+                 const BitcodeParallelFor &ParallelFor,
+                 SmallVectorImpl<char> &Buffer) {
+  raw_svector_ostream OS(Buffer);
+  WriteBitcodeToFile(&M, OS, ShouldPreserveUseListOrder, ParallelFor);
+}
+
+TEST(BitcodeWriterTest, ParallelFunctionBlocksMatchSerial) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M = makeLargeModule(Context);
+  ASSERT_FALSE(verifyModule(*M, &dbgs()));
+
+  for (bool PreserveUseListOrder : {false, true}) {
+    SmallString<0> Serial;
+    writeModule(*M, PreserveUseListOrder, nullptr, Serial);
+
+    // Run every task on its own thread, and start them in reverse order so
+    // that an order dependence between tasks shows up.
+    std::atomic<unsigned> TaskRuns(0);
+    unsigned TaskCount = 0;
+    BitcodeParallelFor ParallelFor =
+        [&](unsigned Count, const std::function<void(unsigned)> &Task) {
+          TaskCount = Count;
+          std::vector<std::thread> Threads;
+          for (unsigned i = Count; i-- > 0;)
+            Threads.emplace_back([&, i]() {
+              Task(i);
+              ++TaskRuns;
+            });
+          for (std::thread &Thread : Threads)
+            Thread.join();
+        };
+    SmallString<0> Parallel;
+    writeModule(*M, PreserveUseListOrder, ParallelFor, Parallel);
+
+    EXPECT_LT(1u, TaskCount);
+    EXPECT_EQ(TaskCount, TaskRuns.load());
+    ASSERT_EQ(Serial.size(), Parallel.size());
+    EXPECT_TRUE(Serial.str() == Parallel.str());
+
+    LLVMContext ReadContext;
+    ErrorOr<std::unique_ptr<Module>> ReadM = parseBitcodeFile(
+        MemoryBufferRef(Parallel.str(), "parallel"), ReadContext);
+    ASSERT_FALSE(ReadM.getError());
+    EXPECT_FALSE(verifyModule(*ReadM.get(), &dbgs()));
+    EXPECT_EQ(M->size(), ReadM.get()->size());
+  }
+}
+
+// A module below the size at which the writer splits the work never calls
+// the runner.
+TEST(BitcodeWriterTest, SmallModuleIsWrittenSerially) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M(new Module("small", Context));
+  Function *F = Function::Create(
+      FunctionType::get(Type::getVoidTy(Context), false),
+      GlobalValue::ExternalLinkage, "f", M.get());
+  ReturnInst::Create(Context, BasicBlock::Create(Context, "entry", F));
+
+  bool Called = false;
+  SmallString<0> Buffer;
+  writeModule(*M, false,
+              [&](unsigned, const std::function<void(unsigned)> &) {
+                Called = true;
+              },
+              Buffer);
+  EXPECT_FALSE(Called);
+  EXPECT_FALSE(Buffer.empty());
+}
+
+} // end anonymous namespace
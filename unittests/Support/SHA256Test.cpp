@@ -0,0 +1,56 @@
+//===- llvm/unittest/Support/SHA256Test.cpp - SHA-256 tests ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements unit tests for the SHA-256 functions.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/SHA256.h"
+#include "gtest/gtest.h"
+
+#include <string>
+
+using namespace llvm;
+
+namespace {
+void TestSHA256Sum(StringRef Input, StringRef Final) {
+  SHA256 Hash;
+  Hash.update(Input);
+  SHA256::SHA256Result Result;
+  Hash.final(Result);
+  SmallString<64> Res;
+  SHA256::stringifyResult(Result, Res);
+  EXPECT_EQ(Res, Final);
+}
+
+TEST(SHA256Test, SHA256) {
+  TestSHA256Sum("",
+      "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  TestSHA256Sum("abc",
+      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  TestSHA256Sum("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+TEST(SHA256Test, SHA256Chunked) {
+  // A million 'a's, fed in pieces that do not line up with the block size.
+  std::string Input(1000000, 'a');
+  SHA256 Hash;
+  for (size_t I = 0; I < Input.size(); I += 997)
+    Hash.update(StringRef(Input).substr(I, 997));
+  SHA256::SHA256Result Result;
+  Hash.final(Result);
+  SmallString<64> Res;
+  SHA256::stringifyResult(Result, Res);
+  EXPECT_EQ(Res,
+      "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+}
@@ -1285,6 +1285,8 @@ def get_validation_version():
 // - HASH container part support
 // - Mesh and Amplification shaders
 // - DXR 1.1 & RayQuery support
+// 1.6 adds:
+// - Race condition check on divergent writes to groupshared memory
 *pMajor = 1;
 *pMinor = %d;
 """ % highest_minor